@@ -22,6 +22,10 @@ interface HTMLLibreOfficeEmbed<Client = LibreOffice.DocumentClient>
       disableInput?: boolean;
       /** restore key from a previous call to renderDocument **/
       restoreKey?: string;
+      /** the result of exportRenderer from an embed in another window, showing the same document **/
+      restoreFrom?: ArrayBuffer | ArrayBufferView;
+      /** the size of a tile in device pixels, by default it is chosen by the device scale and document type. only applies to this call, a later renderDocument without it uses the default **/
+      tileSize?: 256 | 512 | 1024;
     }
   ): string;
   /**
@@ -48,6 +52,19 @@ interface HTMLLibreOfficeEmbed<Client = LibreOffice.DocumentClient>
    * @param interval in ms to debounce
    **/
   debounceUpdates(interval: number): void;
+
+  /** Counters and latency histograms for the render pipeline of this embed
+   * @returns the stats, undefined if nothing has been rendered
+   **/
+  getRenderStats(): LibreOffice.RenderStats | undefined;
+
+  /** Exports the painted tiles, page rects and scroll state, so that the document can move to another window without a repaint.
+   * Send it to the other window through IPC and pass it to renderDocument as restoreFrom, IPC copies the buffer.
+   * restoreFrom renders from scratch unless the buffer was exported for the same document URL, and either from this
+   * document with no invalidations since or from a document without unsaved changes
+   * @returns a plain buffer, undefined if nothing has been rendered
+   **/
+  exportRenderer(): ArrayBuffer | undefined;
 }
 
 declare namespace LibreOffice {
@@ -88,6 +105,37 @@ declare namespace LibreOffice {
   /** Rect in twips */
   type TwipsRect = Rect & {};
 
+  type LatencyHistogram = {
+    /** upper bound of each bucket in ms, the final count is unbounded */
+    bucketsMs: number[];
+    /** count per bucket, has one more entry than bucketsMs */
+    counts: number[];
+    count: number;
+    meanMs: number;
+  };
+
+  type RenderStats = {
+    /** the size of a tile in device pixels */
+    tileSizePx: number;
+    tilesPainted: number;
+    /** tiles skipped because the paint was cancelled or became stale */
+    tilesCancelled: number;
+    /** tiles that were outside of the document when they were painted */
+    tilesFailed: number;
+    poolHits: number;
+    poolMisses: number;
+    /** [0, 1] */
+    poolHitRate: number;
+    /** invalidations away from the caret, like squiggles, that waited for input and visible paints */
+    invalidationsDeferred: number;
+    /** time spent by LibreOffice painting a single tile */
+    tilePaintLatency: LatencyHistogram;
+    /** time from scheduling a paint until the embed is invalidated */
+    frameLatency: LatencyHistogram;
+    /** LibreOffice callbacks waiting to be handled, shared by all documents */
+    callbackQueueDepth: number;
+  };
+
   type EventPayload<T> = {
     payload: T;
   };
@@ -96,6 +144,26 @@ declare namespace LibreOffice {
     | string
     | { commandId: string; value: any; viewId?: number };
 
+  /** an entry of a table kept by the document, with string fields from LOK */
+  type StateTableEntry = { [field: string]: any };
+
+  type StateTableDiff = {
+    /** the entries that were added or modified */
+    changed: StateTableEntry[];
+    /** the ids of the entries that were removed */
+    removed: string[];
+  };
+
+  /** only the parts that changed are present */
+  type StateDiff = {
+    /** the new value of each command that changed */
+    state?: { [command: string]: StateChangedValue };
+    /** comments, keyed by `id` */
+    comments?: StateTableDiff;
+    /** tracked changes, keyed by `index` */
+    trackedChanges?: StateTableDiff;
+  };
+
   type ContextMenuSeperator = { type: 'separator' };
   type ContextMenuCommand<Commands> = {
     type: 'command';
@@ -121,6 +189,12 @@ declare namespace LibreOffice {
     set_part: EventPayload<number>;
     ready: StateChangedValue[];
     state_changed: EventPayload<StateChangedValue>;
+    /** the changes to getState, getComments and getTrackedChanges, at most
+     * once a frame */
+    state_diff: EventPayload<StateDiff>;
+    /** a hibernated document couldn't be loaded again, it stays hibernated and
+     * its calls do nothing */
+    reload_failed: EventPayload<''>;
     context_menu: EventPayload<ContextMenu<Commands>>;
     clipboard_changed:
       | null
@@ -173,6 +247,96 @@ declare namespace LibreOffice {
     };
   }
 
+  type PageThumbnail = {
+    page: number;
+    width: number;
+    height: number;
+    /** unpremultiplied RGBA pixels, usable with `new ImageData(data, width, height)`. a copy of the cached pixels, so it can be modified */
+    data: Uint8ClampedArray;
+  };
+
+  type SlideImage = Omit<PageThumbnail, 'page'> & {
+    part: number;
+  };
+
+  type PdfPreview = PageThumbnail & {
+    /** the page was edited during the export, so it may not match the PDF */
+    stale: boolean;
+  };
+
+  type SearchResult = {
+    /** every match, including those past `maxMatches` */
+    count: number;
+    /** x, y, width, height in twips for each returned match, ordered by page, a match that wraps is covered by the bounds of its lines */
+    rects: Int32Array;
+    /** the zero-based pages with matches, ascending */
+    pages: Uint32Array;
+    /** the rects of `pages[i]` are matches `pageOffsets[i]` to `pageOffsets[i + 1]` */
+    pageOffsets: Uint32Array;
+  };
+
+  type DataRange = {
+    /** the cell range, ex: 'A1:C100' */
+    range: string;
+    /** the sheet name or zero-based index, defaults to the active sheet of the view */
+    sheet?: string | number;
+  };
+
+  /** the cells of a range in column-major order */
+  type DataArray = {
+    rows: number;
+    columns: number;
+    /** a Float64Array for each column, NaN where the cell isn't a number */
+    numbers: Float64Array[];
+    /** for each cell, 0 if it's empty, 1 if it's a number, 2 if it's a string */
+    kinds: Uint8Array;
+    /** the UTF-8 text of every string cell, packed together */
+    text: Uint8Array;
+    /** the text of cell `i` is `text.subarray(textOffsets[i], textOffsets[i + 1])` */
+    textOffsets: Uint32Array;
+  };
+
+  interface AutosaveProgress {
+    phase: 'serializing' | 'writing' | 'done' | 'failed';
+    bytesWritten: number;
+    totalBytes: number;
+    /** how long the document was busy serializing */
+    serializeMs: number;
+  }
+
+  interface ViewMemoryUsage {
+    /** the tile pool, allocated as a whole by the first painted tile */
+    tilePoolBytes: number;
+    /** the paint images of the valid tiles */
+    tileBytes: number;
+    /** the snapshot drawn while zooming and in place of missing tiles, without the tiles it shares with tileBytes */
+    snapshotBytes: number;
+    visible: boolean;
+    /** unmounted and waiting to be remounted with a restore key */
+    restorable: boolean;
+  }
+
+  interface MemoryUsage {
+    /** LibreOffice's own memory isn't included */
+    totalBytes: number;
+    /** page thumbnails and slides */
+    thumbnailBytes: number;
+    /** the compressed document while it's unloaded in memory */
+    unloadedBytes: number;
+    hibernated: boolean;
+    views: ViewMemoryUsage[];
+    budgetBytes?: number;
+  }
+
+  interface PdfExportProgress {
+    phase: 'exporting' | 'previews' | 'done' | 'failed';
+    /** previews that were painted for the export, cached ones aren't counted */
+    previewsDone: number;
+    previewCount: number;
+    /** how long the document was busy writing the PDF */
+    exportMs: number;
+  }
+
   interface DocumentClient<
     Events extends DocumentEvents = DocumentEvents,
     Commands extends string | number = keyof UnoCommands,
@@ -183,10 +347,26 @@ declare namespace LibreOffice {
      * add an event listener
      * @param eventName - the name of the event
      * @param callback - the callback function
+     * @param options.keys - only deliver events matching one of these keys, for state_changed the key is the command, ex: '.uno:Bold'
      */
     on<K extends keyof Events = keyof Events>(
       eventName: K,
-      callback: DocumentEventHandler<Events, K>
+      callback: DocumentEventHandler<Events, K>,
+      options?: { batched?: false; keys?: string[] }
+    ): void;
+
+    /**
+     * add an event listener that receives the events of a frame at once,
+     * after the frame is drawn. state_changed payloads like '.uno:Bold=true'
+     * arrive typed, as { commandId: '.uno:Bold', value: true }
+     * @param eventName - the name of the event
+     * @param callback - the callback function, called with every event since the last call
+     * @param options.keys - only deliver events matching one of these keys, for state_changed the key is the command, ex: '.uno:Bold'
+     */
+    on<K extends keyof Events = keyof Events>(
+      eventName: K,
+      callback: (args: Array<Events[K]>) => void,
+      options: { batched: true; keys?: string[] }
     ): void;
 
     /**
@@ -253,6 +433,22 @@ declare namespace LibreOffice {
      */
     setClipboard(clipboardData: ClipboardItem[]): boolean;
 
+    /**
+     * same as getClipboard, but reads the clipboard off of the main thread
+     * @param mimeTypes - desired MIME types from the clipboard
+     * @returns a promise of an array of clipboard items, binary items are not copied
+     */
+    getClipboardAsync(
+      mimeTypes?: Array<ClipboardItem['mimeType']>
+    ): Promise<Array<ClipboardItem | undefined>>;
+
+    /**
+     * same as setClipboard, but writes the clipboard off of the main thread
+     * @param clipboardData - array of clipboard items used to populate the clipboard, buffers should not be modified until the promise resolves
+     * @returns a promise of whether the operation was successful
+     */
+    setClipboardAsync(clipboardData: ClipboardItem[]): Promise<boolean>;
+
     /**
      * pastes content at the current cursor position
      * @param mimeType - the mime type of the data to paste
@@ -343,9 +539,241 @@ declare namespace LibreOffice {
      **/
     newView(): DocumentClient<Events, Commands, CommandMap, GCV>;
 
+    /**
+     * rasterizes pages at thumbnail size off the renderer thread, thumbnails are
+     * cached until an invalidation touches their page
+     * @param options.pages - the zero-based page indices, defaults to every page. for presentations and drawings these are slides, shared with renderSlide, and for spreadsheets they are sheets
+     * @param options.width - the thumbnail width in pixels, the height keeps the page's aspect ratio
+     * @returns a thumbnail for each requested page, undefined for pages that don't exist
+     */
+    renderPages(options: {
+      pages?: number[];
+      width: number;
+    }): Promise<Array<PageThumbnail | undefined>>;
+
+    /**
+     * exports the document to a PDF along with previews of its pages. the
+     * previews are painted right after the PDF is written, in the same task off
+     * of the renderer, and are passed to onPreview as soon as each is converted.
+     * input is still handled during the export, so a page that is edited in the
+     * meantime may not match the PDF, and its preview is marked stale. the
+     * previews are cached the same as renderPages, or renderSlide for parts
+     * @param path - the path or file URL of the PDF
+     * @param options.previewWidth - the preview width in pixels, no previews if unset
+     * @param options.pages - the zero-based page indices to preview, defaults to every page. for presentations and drawings these are parts, for spreadsheets they are sheets rather than pages of the PDF
+     * @param options.filterOptions - the PDF export filter options, as for saveAs
+     * @returns true if the PDF was written
+     */
+    exportPdf(
+      path: string,
+      options?: {
+        previewWidth?: number;
+        pages?: number[];
+        filterOptions?: string;
+        onPreview?: (preview: PdfPreview) => void;
+        onProgress?: (progress: PdfExportProgress) => void;
+      }
+    ): Promise<boolean>;
+
+    /**
+     * finds every match of a query in a text document through a native index
+     * of its paragraphs, built off the renderer thread and refreshed after
+     * edits, so find-as-you-type doesn't traverse the document for every key.
+     * once the body has a match, the count and rects are LibreOffice's, which
+     * also covers tables, frames and headers
+     * @param options.matchCase - defaults to false
+     * @param options.wholeWords - defaults to false
+     * @param options.maxMatches - matches past this are counted but have no rect, defaults to 1000
+     * @returns the match rects grouped by page, rejects if the document isn't a text document
+     */
+    findAll(
+      query: string,
+      options?: {
+        matchCase?: boolean;
+        wholeWords?: boolean;
+        maxMatches?: number;
+      }
+    ): Promise<SearchResult>;
+
+    /**
+     * rasterizes a slide of a presentation or a page of a drawing off the
+     * renderer thread, slides are cached per part until an invalidation touches
+     * them
+     * @param options.part - the zero-based slide or page index
+     * @param options.width - the width in pixels, the height keeps the slide's aspect ratio
+     * @param options.prerender - also render the next and previous slides in the background, defaults to true
+     * @returns the slide, rejects if the document isn't a presentation or drawing
+     */
+    renderSlide(options: {
+      part: number;
+      width: number;
+      prerender?: boolean;
+    }): Promise<SlideImage>;
+
+    /**
+     * reads every cell of a spreadsheet range in a single UNO call, off the renderer thread
+     * @param options - the range to read
+     * @returns the cells of the range, rejects if the document isn't a spreadsheet or the range is invalid
+     */
+    getDataArray(options: DataRange): Promise<DataArray>;
+
+    /**
+     * writes every cell of a spreadsheet range in a single UNO call, off the renderer thread
+     * @param options.values - the columns of the range, NaN, null and undefined clear a cell
+     * @returns rejects if the size of values doesn't match the range
+     */
+    setDataArray(
+      options: DataRange & {
+        values: Array<Float64Array | Array<number | string | null | undefined>>;
+      }
+    ): Promise<void>;
+
+    /**
+     * configures how the document hibernates once none of its embeds are
+     * visible, hibernating releases the tiles of hidden embeds and optionally
+     * unloads the document from LibreOffice until it is used again
+     * @param options.idleMs - how long the document is idle before it hibernates, defaults to 60000
+     * @param options.unload - where the unloaded document is kept compressed, 'none' keeps it loaded (the default)
+     */
+    setHibernation(options: {
+      idleMs?: number;
+      unload?: 'none' | 'memory' | 'disk';
+    }): void;
+
+    /**
+     * if the document is unloaded from LibreOffice while hibernating, it is
+     * loaded again in the background the next time it is used. calls made
+     * while it reloads return empty results (newView throws), posted commands
+     * and input wait for it. the content, the modified flag and the options of
+     * initializeForRendering are kept, but the undo history and other view
+     * state (selection, online spelling) are not. a document with more than
+     * one view is never unloaded. hibernation starts once the document is
+     * loaded, and is put off while any of its embeds are visible
+     */
+    readonly isHibernated: boolean;
+
+    /**
+     * saves the document in the background while it is modified, the document
+     * is only serialized once there was no input for `idleMs`
+     * @param options - null disables autosave
+     * @param options.path - the file system path that is replaced on every save
+     * @param options.format - the export filter, ex: 'docx', defaults to the format of the document
+     * @param options.intervalMs - how long to wait between saves, defaults to 30000
+     * @param options.idleMs - how long input must be idle before serializing, defaults to 2000
+     * @param options.onProgress - called as the save progresses
+     */
+    setAutosave(
+      options: {
+        path: string;
+        format?: string;
+        intervalMs?: number;
+        idleMs?: number;
+        onProgress?: (progress: AutosaveProgress) => void;
+      } | null
+    ): void;
+
+    /**
+     * enables online spelling, which starts once there was no input for a
+     * second and then stays on. while typing, repaints away from the caret's
+     * line, which are mostly squiggles, are batched and wait for the input and
+     * any pending paints
+     * @param enabled - false stops spelling, which is the default
+     */
+    setSpellcheck(enabled: boolean): void;
+
+    /**
+     * the last reported state of a command, kept natively from state_changed
+     * events, so it doesn't need getCommandValues
+     * @param command - ex: '.uno:Bold'
+     * @returns the value after the '=' or the parsed JSON state, undefined if
+     * the command wasn't reported
+     */
+    getState(command: string): StateChangedValue | undefined;
+    /** the last reported state of every command */
+    getState(): { [command: string]: StateChangedValue };
+    /**
+     * the comments of the document, as from `.uno:ViewAnnotations`, kept up to
+     * date by comment events
+     */
+    getComments(): StateTableEntry[];
+    /**
+     * the tracked changes of the document, as from `.uno:AcceptTrackedChanges`,
+     * kept up to date by redline events
+     */
+    getTrackedChanges(): StateTableEntry[];
+
+    /**
+     * the bytes held by the document and each of its renderers, the same
+     * values are reported in the electron_office memory dumps of a trace
+     */
+    getMemoryUsage(): MemoryUsage;
+
+    /**
+     * keeps the document within a memory budget, checked when it is set and
+     * every second after. while over it, the tiles of hidden renderers are
+     * evicted first, then their snapshots are released and, once no renderer
+     * is visible, the document is hibernated and unloaded. visible renderers
+     * are never reclaimed. LOK doesn't unload a document with other views, so
+     * after it refuses, unloading is retried less and less often
+     * @param options - null disables the budget
+     * @param options.maxBytes - the budget for getMemoryUsage().totalBytes
+     */
+    setMemoryBudget(options: { maxBytes: number } | null): void;
+
     as: import('./lok_api').text.GenericTextDocument['as'];
   }
 
+  type ConversionJob = {
+    /** the path of the document to convert */
+    input: string;
+    /** the path to write the converted document to */
+    output: string;
+    /** the export format, ex: 'pdf', 'docx' */
+    format?: string;
+    /** options for the export filter */
+    filterOptions?: string;
+  };
+
+  type ConversionResult = {
+    /** the index of the job in the batch */
+    index: number;
+    status: 'succeeded' | 'failed' | 'timedOut' | 'cancelled';
+    error?: string;
+    elapsedMs: number;
+    bytesRead: number;
+    bytesWritten: number;
+  };
+
+  type ConversionStats = {
+    succeeded: number;
+    failed: number;
+    timedOut: number;
+    cancelled: number;
+    bytesRead: number;
+    bytesWritten: number;
+    elapsedMs: number;
+    jobsPerSecond: number;
+  };
+
+  type ConversionBatch = {
+    /** resolves once every job has finished */
+    done: Promise<ConversionStats & { results: ConversionResult[] }>;
+    /** cancels jobs that haven't started and stops running jobs at their next stage */
+    cancel(): void;
+    /** the stats so far, undefined once the batch is done */
+    getStats(): ConversionStats | undefined;
+  };
+
+  type StartupProfile = {
+    /** the phases of loading LibreOffice, in order */
+    phases: { name: string; durationMs: number }[];
+    totalMs: number;
+    /** the files from the previous launch that were read ahead while loading */
+    prefetch: { files: number; bytes: number; durationMs: number };
+    /** the libraries mapped and the configuration files read while loading, relative to the LibreOffice install. empty until shortly after loading, only the configuration files on Windows */
+    filesRead: string[];
+  };
+
   interface OfficeClient {
     /**
      * set password required for loading or editing a document
@@ -383,5 +811,28 @@ declare namespace LibreOffice {
 
     /** gets the last error thrown by LOK */
     getLastError(): string;
+
+    /** the time spent loading LibreOffice by phase, and the files prefetched for it */
+    getStartupProfile(): StartupProfile;
+
+    /**
+     * converts many documents with a bounded number running at once, so that
+     * file reads and writes overlap with LibreOffice loading and exporting
+     * @param jobs - the file paths to convert from and to, with the export format
+     * @param options.concurrency - the maximum number of running conversions, defaults to 4 or `processes` and is at most `processes` when set
+     * @param options.processes - converts in this many headless LibreOffice worker processes instead of in this process, so throughput isn't limited by the LibreOfficeKit lock. a format with a filter name, ex: 'pdf:writer_pdf_Export', is required to pass filterOptions
+     * @param options.timeoutMs - fails a conversion that takes longer than this
+     * @param options.onProgress - called as each conversion finishes
+     * @returns the batch, which can be cancelled while it runs
+     */
+    convertBatch(
+      jobs: ConversionJob[],
+      options?: {
+        concurrency?: number;
+        processes?: number;
+        timeoutMs?: number;
+        onProgress?: (result: ConversionResult) => void;
+      }
+    ): ConversionBatch;
   }
 }
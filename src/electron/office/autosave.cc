@@ -0,0 +1,223 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "office/autosave.h"
+
+#include <algorithm>
+#include <utility>
+#include "base/bind.h"
+#include "base/files/file_util.h"
+#include "base/task/bind_post_task.h"
+#include "base/task/task_traits.h"
+#include "base/task/thread_pool.h"
+#include "base/threading/sequenced_task_runner_handle.h"
+#include "base/trace_event/trace_event.h"
+
+namespace electron::office {
+
+Autosave::Serialized::Serialized() = default;
+Autosave::Serialized::Serialized(char* data_, size_t size_, void (*free_)(void*))
+    : data(data_), size(size_), free(free_) {}
+Autosave::Serialized::Serialized(Serialized&& other) noexcept
+    : data(std::exchange(other.data, nullptr)),
+      size(std::exchange(other.size, 0)),
+      free(other.free) {}
+Autosave::Serialized& Autosave::Serialized::operator=(
+    Serialized&& other) noexcept {
+  if (this != &other) {
+    if (data && free)
+      free(data);
+    data = std::exchange(other.data, nullptr);
+    size = std::exchange(other.size, 0);
+    free = other.free;
+  }
+  return *this;
+}
+Autosave::Serialized::~Serialized() {
+  if (data && free)
+    free(data);
+}
+
+namespace {
+bool WriteChunk(base::File* file,
+                const base::FilePath& temp_path,
+                scoped_refptr<base::RefCountedData<Autosave::Serialized>> data,
+                size_t offset,
+                size_t size) {
+  TRACE_EVENT1("electron", "Autosave::WriteChunk", "offset", offset);
+  if (offset == 0) {
+    file->Initialize(temp_path,
+                     base::File::FLAG_CREATE_ALWAYS | base::File::FLAG_WRITE);
+  }
+  if (!file->IsValid())
+    return false;
+
+  return file->WriteAtCurrentPos(data->data.data + offset, size) ==
+         static_cast<int>(size);
+}
+
+bool Commit(base::File* file,
+            const base::FilePath& temp_path,
+            const base::FilePath& path) {
+  TRACE_EVENT0("electron", "Autosave::Commit");
+  bool flushed = file->Flush();
+  file->Close();
+  // the previous save stays intact until the new one is complete
+  if (flushed && base::ReplaceFile(temp_path, path, nullptr))
+    return true;
+  base::DeleteFile(temp_path);
+  return false;
+}
+}  // namespace
+
+Autosave::Autosave(base::FilePath path,
+                   base::TimeDelta interval,
+                   base::TimeDelta idle,
+                   Serializer serializer,
+                   ProgressCallback progress)
+    : path_(std::move(path)),
+      temp_path_(path_.AddExtension(FILE_PATH_LITERAL("autosave"))),
+      interval_(interval),
+      idle_(idle),
+      serializer_(std::move(serializer)),
+      progress_callback_(std::move(progress)),
+      file_task_runner_(base::ThreadPool::CreateSequencedTaskRunner(
+          {base::MayBlock(), base::TaskPriority::BEST_EFFORT,
+           base::TaskShutdownBehavior::BLOCK_SHUTDOWN})) {}
+
+Autosave::~Autosave() {
+  if (!file_)
+    return;
+
+  // pending writes are ordered before the file is closed, and the partial
+  // save is removed after them, a queued commit has already moved it
+  file_task_runner_->DeleteSoon(FROM_HERE, std::move(file_));
+  file_task_runner_->PostTask(FROM_HERE,
+                              base::GetDeleteFileCallback(temp_path_));
+}
+
+void Autosave::MarkDirty() {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  dirty_ = true;
+  if (!timer_.IsRunning() && !saving_)
+    Schedule(interval_);
+}
+
+void Autosave::RecordInput() {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  last_input_ = base::TimeTicks::Now();
+}
+
+void Autosave::Schedule(base::TimeDelta delay) {
+  timer_.Start(FROM_HERE, delay,
+               base::BindOnce(&Autosave::MaybeSave, base::Unretained(this)));
+}
+
+void Autosave::MaybeSave() {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  // a save that finishes reschedules if the document was modified meanwhile
+  if (saving_ || !dirty_)
+    return;
+
+  base::TimeTicks now = base::TimeTicks::Now();
+  base::TimeDelta since_input = now - last_input_;
+  if (since_input < idle_) {
+    Schedule(idle_ - since_input);
+    return;
+  }
+
+  TRACE_EVENT_NESTABLE_ASYNC_BEGIN0("electron", "Autosave", this);
+  saving_ = true;
+  dirty_ = false;
+  progress_ = Progress();
+  progress_.phase = Phase::kSerializing;
+  ReportProgress();
+
+  serializer_.Run(base::BindPostTask(
+      base::SequencedTaskRunnerHandle::Get(),
+      base::BindOnce(&Autosave::OnSerialized, weak_factory_.GetWeakPtr(),
+                     now)));
+}
+
+void Autosave::OnSerialized(base::TimeTicks start, Serialized serialized) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  progress_.serialize_time = base::TimeTicks::Now() - start;
+  if (!serialized.data || serialized.size == 0) {
+    Finish(false);
+    return;
+  }
+
+  progress_.phase = Phase::kWriting;
+  progress_.total_bytes = serialized.size;
+  data_ = base::MakeRefCounted<base::RefCountedData<Serialized>>(
+      std::move(serialized));
+  file_ = std::make_unique<base::File>();
+  ReportProgress();
+  WriteNextChunk();
+}
+
+void Autosave::WriteNextChunk() {
+  size_t offset = progress_.bytes_written;
+  size_t size = std::min(kChunkSize, data_->data.size - offset);
+  // a chunk at a time, so that the file sequence isn't held by a large save
+  file_task_runner_->PostTaskAndReplyWithResult(
+      FROM_HERE,
+      base::BindOnce(&WriteChunk, base::Unretained(file_.get()), temp_path_,
+                     data_, offset, size),
+      base::BindOnce(&Autosave::OnChunkWritten, weak_factory_.GetWeakPtr(),
+                     size));
+}
+
+void Autosave::OnChunkWritten(size_t size, bool success) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  if (!success) {
+    file_task_runner_->PostTask(FROM_HERE,
+                                base::GetDeleteFileCallback(temp_path_));
+    Finish(false);
+    return;
+  }
+
+  progress_.bytes_written += size;
+  ReportProgress();
+  if (static_cast<size_t>(progress_.bytes_written) < data_->data.size) {
+    WriteNextChunk();
+    return;
+  }
+
+  file_task_runner_->PostTaskAndReplyWithResult(
+      FROM_HERE,
+      base::BindOnce(&Commit, base::Unretained(file_.get()), temp_path_,
+                     path_),
+      base::BindOnce(&Autosave::OnCommitted, weak_factory_.GetWeakPtr()));
+}
+
+void Autosave::OnCommitted(bool success) {
+  Finish(success);
+}
+
+void Autosave::ReportProgress() {
+  if (progress_callback_)
+    progress_callback_.Run(progress_);
+}
+
+void Autosave::Finish(bool success) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  TRACE_EVENT_NESTABLE_ASYNC_END1("electron", "Autosave", this,
+                                  "success", success);
+  if (file_)
+    file_task_runner_->DeleteSoon(FROM_HERE, std::move(file_));
+  data_ = nullptr;
+  saving_ = false;
+  // a failed save is retried with the next interval
+  if (!success)
+    dirty_ = true;
+
+  progress_.phase = success ? Phase::kDone : Phase::kFailed;
+  ReportProgress();
+
+  if (dirty_ && !timer_.IsRunning())
+    Schedule(interval_);
+}
+
+}  // namespace electron::office
@@ -0,0 +1,120 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include "base/callback.h"
+#include "base/files/file.h"
+#include "base/files/file_path.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/weak_ptr.h"
+#include "base/sequence_checker.h"
+#include "base/task/sequenced_task_runner.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
+
+namespace electron::office {
+
+// Saves a modified document in the background once the user is idle.
+//
+// LOK can't serialize a document incrementally or while it is being edited,
+// so the serialization (which holds LOK's lock) only starts after no input for
+// `idle`, and input that arrives during a save waits at most for the
+// serialization. The result is written to a temporary file in chunks off of
+// the renderer, reporting progress, and then replaces `path` so that a partial
+// save is never visible.
+class Autosave {
+ public:
+  enum class Phase { kSerializing, kWriting, kDone, kFailed };
+
+  struct Progress {
+    Phase phase = Phase::kSerializing;
+    int64_t bytes_written = 0;
+    int64_t total_bytes = 0;
+    // how long LOK was busy serializing, input is delayed by up to this much
+    base::TimeDelta serialize_time;
+  };
+
+  // the serialized document, freed with `free`
+  struct Serialized {
+    char* data = nullptr;
+    size_t size = 0;
+    void (*free)(void*) = nullptr;
+
+    Serialized();
+    Serialized(char* data_, size_t size_, void (*free_)(void*));
+    Serialized(Serialized&& other) noexcept;
+    Serialized& operator=(Serialized&& other) noexcept;
+    ~Serialized();
+
+    // no copy
+    Serialized(const Serialized&) = delete;
+    Serialized& operator=(const Serialized&) = delete;
+  };
+
+  // serializes the document off of the renderer and runs the callback with
+  // the result on any sequence
+  using Serializer = base::RepeatingCallback<void(
+      base::OnceCallback<void(Serialized serialized)> done)>;
+  using ProgressCallback = base::RepeatingCallback<void(const Progress&)>;
+
+  static constexpr base::TimeDelta kDefaultInterval = base::Seconds(30);
+  static constexpr base::TimeDelta kDefaultIdle = base::Seconds(2);
+  static constexpr size_t kChunkSize = 1024 * 1024;
+
+  Autosave(base::FilePath path,
+           base::TimeDelta interval,
+           base::TimeDelta idle,
+           Serializer serializer,
+           ProgressCallback progress);
+  ~Autosave();
+
+  // no copy
+  Autosave(const Autosave&) = delete;
+  Autosave& operator=(const Autosave&) = delete;
+
+  // the document was modified, a save is scheduled after the interval
+  void MarkDirty();
+  // user input was sent to the document, a save waits until it is idle
+  void RecordInput();
+
+  bool IsDirty() const { return dirty_; }
+  bool IsSaving() const { return saving_; }
+
+ private:
+  void Schedule(base::TimeDelta delay);
+  void MaybeSave();
+  void OnSerialized(base::TimeTicks start, Serialized serialized);
+  void WriteNextChunk();
+  void OnChunkWritten(size_t size, bool success);
+  void OnCommitted(bool success);
+  void ReportProgress();
+  void Finish(bool success);
+
+  const base::FilePath path_;
+  const base::FilePath temp_path_;
+  const base::TimeDelta interval_;
+  const base::TimeDelta idle_;
+  Serializer serializer_;
+  ProgressCallback progress_callback_;
+
+  bool dirty_ = false;
+  bool saving_ = false;
+  base::TimeTicks last_input_;
+  base::OneShotTimer timer_;
+
+  // the save in progress, the data is shared with the file sequence
+  scoped_refptr<base::RefCountedData<Serialized>> data_;
+  Progress progress_;
+  scoped_refptr<base::SequencedTaskRunner> file_task_runner_;
+  // only used on file_task_runner_
+  std::unique_ptr<base::File> file_;
+
+  SEQUENCE_CHECKER(sequence_checker_);
+  base::WeakPtrFactory<Autosave> weak_factory_{this};
+};
+
+}  // namespace electron::office
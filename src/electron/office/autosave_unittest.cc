@@ -0,0 +1,162 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "autosave.h"
+
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/test/bind.h"
+#include "base/test/task_environment.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace electron::office {
+
+namespace {
+Autosave::Serialized MakeDocument(size_t size, char fill) {
+  char* data = static_cast<char*>(malloc(size));
+  std::memset(data, fill, size);
+  return Autosave::Serialized(data, size, &free);
+}
+}  // namespace
+
+class AutosaveTest : public ::testing::Test {
+ protected:
+  void SetUp() override { ASSERT_TRUE(temp_dir_.CreateUniqueTempDir()); }
+
+  base::FilePath Path() { return temp_dir_.GetPath().AppendASCII("doc.odt"); }
+
+  base::test::TaskEnvironment task_environment_{
+      base::test::TaskEnvironment::TimeSource::MOCK_TIME};
+  base::ScopedTempDir temp_dir_;
+};
+
+TEST_F(AutosaveTest, WritesInChunksWithProgress) {
+  const size_t size = Autosave::kChunkSize * 2 + 10;
+  int serialized = 0;
+  std::vector<Autosave::Progress> progress;
+
+  Autosave autosave(
+      Path(), base::Seconds(1), base::Seconds(1),
+      base::BindLambdaForTesting(
+          [&](base::OnceCallback<void(Autosave::Serialized)> done) {
+            ++serialized;
+            std::move(done).Run(MakeDocument(size, 'a'));
+          }),
+      base::BindLambdaForTesting(
+          [&](const Autosave::Progress& p) { progress.push_back(p); }));
+
+  autosave.MarkDirty();
+  task_environment_.FastForwardBy(base::Seconds(1));
+  task_environment_.RunUntilIdle();
+
+  EXPECT_EQ(serialized, 1);
+  ASSERT_GE(progress.size(), size_t(5));
+  EXPECT_EQ(progress.front().phase, Autosave::Phase::kSerializing);
+  EXPECT_EQ(progress.back().phase, Autosave::Phase::kDone);
+  EXPECT_EQ(progress.back().bytes_written, static_cast<int64_t>(size));
+  EXPECT_EQ(progress.back().total_bytes, static_cast<int64_t>(size));
+  // serializing, writing, then one report per chunk
+  EXPECT_EQ(progress.size(), size_t(6));
+
+  int64_t file_size = 0;
+  EXPECT_TRUE(base::GetFileSize(Path(), &file_size));
+  EXPECT_EQ(file_size, static_cast<int64_t>(size));
+  EXPECT_FALSE(autosave.IsSaving());
+  EXPECT_FALSE(autosave.IsDirty());
+}
+
+TEST_F(AutosaveTest, WaitsForIdleInput) {
+  int serialized = 0;
+  Autosave autosave(
+      Path(), base::Seconds(1), base::Seconds(2),
+      base::BindLambdaForTesting(
+          [&](base::OnceCallback<void(Autosave::Serialized)> done) {
+            ++serialized;
+            std::move(done).Run(MakeDocument(16, 'b'));
+          }),
+      Autosave::ProgressCallback());
+
+  autosave.MarkDirty();
+  // typing continuously past the interval
+  for (int i = 0; i < 10; ++i) {
+    autosave.RecordInput();
+    task_environment_.FastForwardBy(base::Milliseconds(500));
+  }
+  EXPECT_EQ(serialized, 0);
+
+  task_environment_.FastForwardBy(base::Seconds(2));
+  task_environment_.RunUntilIdle();
+  EXPECT_EQ(serialized, 1);
+}
+
+TEST_F(AutosaveTest, OnlySavesWhenDirty) {
+  int serialized = 0;
+  Autosave autosave(
+      Path(), base::Seconds(1), base::TimeDelta(),
+      base::BindLambdaForTesting(
+          [&](base::OnceCallback<void(Autosave::Serialized)> done) {
+            ++serialized;
+            std::move(done).Run(MakeDocument(16, 'c'));
+          }),
+      Autosave::ProgressCallback());
+
+  task_environment_.FastForwardBy(base::Seconds(5));
+  EXPECT_EQ(serialized, 0);
+
+  autosave.MarkDirty();
+  autosave.MarkDirty();
+  task_environment_.FastForwardBy(base::Seconds(5));
+  task_environment_.RunUntilIdle();
+  EXPECT_EQ(serialized, 1);
+}
+
+TEST_F(AutosaveTest, FailedSaveIsRetried) {
+  int serialized = 0;
+  Autosave autosave(
+      Path(), base::Seconds(1), base::TimeDelta(),
+      base::BindLambdaForTesting(
+          [&](base::OnceCallback<void(Autosave::Serialized)> done) {
+            // the first serialization fails
+            std::move(done).Run(serialized++ ? MakeDocument(16, 'd')
+                                             : Autosave::Serialized());
+          }),
+      Autosave::ProgressCallback());
+
+  autosave.MarkDirty();
+  task_environment_.FastForwardBy(base::Seconds(1));
+  task_environment_.RunUntilIdle();
+  EXPECT_EQ(serialized, 1);
+  EXPECT_TRUE(autosave.IsDirty());
+
+  task_environment_.FastForwardBy(base::Seconds(1));
+  task_environment_.RunUntilIdle();
+  EXPECT_EQ(serialized, 2);
+  EXPECT_TRUE(base::PathExists(Path()));
+}
+
+TEST_F(AutosaveTest, DestroyedMidSaveRemovesThePartialSave) {
+  auto autosave = std::make_unique<Autosave>(
+      Path(), base::Seconds(1), base::TimeDelta(),
+      base::BindLambdaForTesting(
+          [&](base::OnceCallback<void(Autosave::Serialized)> done) {
+            std::move(done).Run(
+                MakeDocument(Autosave::kChunkSize * 4, 'e'));
+          }),
+      Autosave::ProgressCallback());
+
+  autosave->MarkDirty();
+  task_environment_.FastForwardBy(base::Seconds(1));
+  ASSERT_TRUE(autosave->IsSaving());
+  autosave.reset();
+  task_environment_.RunUntilIdle();
+
+  EXPECT_FALSE(base::PathExists(Path()));
+  EXPECT_FALSE(
+      base::PathExists(Path().AddExtension(FILE_PATH_LITERAL("autosave"))));
+}
+
+}  // namespace electron::office
@@ -0,0 +1,293 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "office/conversion_batch.h"
+
+#include <memory>
+#include "LibreOfficeKit/LibreOfficeKit.hxx"
+#include "base/bind.h"
+#include "base/files/file_util.h"
+#include "base/logging.h"
+#include "base/process/memory.h"
+#include "base/strings/string_piece.h"
+#include "base/task/task_traits.h"
+#include "base/task/thread_pool.h"
+#include "base/threading/sequenced_task_runner_handle.h"
+#include "base/trace_event/trace_event.h"
+#include "office/office_instance.h"
+
+namespace electron::office {
+
+ConversionJob::ConversionJob() = default;
+ConversionJob::ConversionJob(const ConversionJob& other) = default;
+ConversionJob& ConversionJob::operator=(const ConversionJob& other) = default;
+ConversionJob::ConversionJob(ConversionJob&& other) noexcept = default;
+ConversionJob& ConversionJob::operator=(ConversionJob&& other) noexcept =
+    default;
+ConversionJob::~ConversionJob() = default;
+
+ConversionResult::ConversionResult() = default;
+ConversionResult::ConversionResult(const ConversionResult& other) = default;
+ConversionResult& ConversionResult::operator=(const ConversionResult& other) =
+    default;
+ConversionResult::~ConversionResult() = default;
+
+double ConversionStats::Throughput() const {
+  double seconds = elapsed.InSecondsF();
+  return seconds > 0 ? (succeeded + failed + timed_out) / seconds : 0.0;
+}
+
+namespace {
+void* UncheckedAlloc(size_t size) {
+  void* ptr;
+  return base::UncheckedMalloc(size, &ptr) ? ptr : nullptr;
+}
+
+ConversionResult Finish(ConversionResult result,
+                        ConversionResult::Status status,
+                        base::TimeTicks start,
+                        std::string error = {}) {
+  result.status = status;
+  result.error = std::move(error);
+  result.elapsed = base::TimeTicks::Now() - start;
+  return result;
+}
+}  // namespace
+
+ConversionResult ConvertWithLok(const ConversionJob& job,
+                                CancelFlagPtr cancel_flag) {
+  using Status = ConversionResult::Status;
+  TRACE_EVENT0("electron", "ConvertWithLok");
+  base::TimeTicks start = base::TimeTicks::Now();
+  ConversionResult result;
+
+  std::string input;
+  {
+    TRACE_EVENT0("electron", "ConvertWithLok::Read");
+    if (!base::ReadFileToString(job.input, &input))
+      return Finish(result, Status::kFailed, start, "unable to read input");
+  }
+  result.bytes_read = input.size();
+
+  if (CancelFlag::IsCancelled(cancel_flag))
+    return Finish(result, Status::kCancelled, start);
+  if (!OfficeInstance::IsValid())
+    return Finish(result, Status::kFailed, start, "office is not loaded");
+
+  std::unique_ptr<lok::Document> doc;
+  {
+    TRACE_EVENT0("electron", "ConvertWithLok::Load");
+    doc.reset(OfficeInstance::Get()->GetOffice()->loadFromMemory(
+        input.data(), input.size()));
+  }
+  // the input isn't needed once it's loaded
+  std::string().swap(input);
+  if (!doc)
+    return Finish(result, Status::kFailed, start, "unable to load input");
+
+  if (CancelFlag::IsCancelled(cancel_flag))
+    return Finish(result, Status::kCancelled, start);
+
+  const char* format = job.format.empty() ? nullptr : job.format.c_str();
+
+  // LOK only accepts filter options when it writes the file itself
+  if (!job.filter_options.empty()) {
+    TRACE_EVENT0("electron", "ConvertWithLok::SaveAs");
+    bool saved = doc->saveAs(job.output.AsUTF8Unsafe().c_str(), format,
+                             job.filter_options.c_str());
+    doc.reset();
+    if (!saved)
+      return Finish(result, Status::kFailed, start, "unable to export");
+    int64_t size = 0;
+    if (base::GetFileSize(job.output, &size))
+      result.bytes_written = size;
+    return Finish(result, Status::kSucceeded, start);
+  }
+
+  char* output = nullptr;
+  size_t size;
+  {
+    TRACE_EVENT0("electron", "ConvertWithLok::Export");
+    size = doc->saveToMemory(&output, UncheckedAlloc, format);
+  }
+  // dispose of the document as soon as possible to keep memory flat
+  doc.reset();
+  if (!output || size == 0) {
+    base::UncheckedFree(output);
+    return Finish(result, Status::kFailed, start, "unable to export");
+  }
+
+  if (CancelFlag::IsCancelled(cancel_flag)) {
+    base::UncheckedFree(output);
+    return Finish(result, Status::kCancelled, start);
+  }
+
+  bool written;
+  {
+    TRACE_EVENT0("electron", "ConvertWithLok::Write");
+    written = base::WriteFile(job.output, base::StringPiece(output, size));
+  }
+  base::UncheckedFree(output);
+  if (!written)
+    return Finish(result, Status::kFailed, start, "unable to write output");
+
+  result.bytes_written = size;
+  return Finish(result, Status::kSucceeded, start);
+}
+
+ConversionBatch::ConversionBatch(std::vector<ConversionJob> jobs,
+                                 size_t concurrency,
+                                 base::TimeDelta timeout,
+                                 Converter converter,
+                                 ProgressCallback progress,
+                                 DoneCallback done)
+    : jobs_(std::move(jobs)),
+      results_(jobs_.size()),
+      cancel_flags_(jobs_.size()),
+      concurrency_(std::max<size_t>(concurrency, 1)),
+      timeout_(timeout),
+      converter_(std::move(converter)),
+      progress_(std::move(progress)),
+      done_(std::move(done)) {
+  for (size_t i = 0; i < results_.size(); ++i) {
+    results_[i].index = i;
+  }
+}
+
+ConversionBatch::~ConversionBatch() {
+  for (auto& flag : cancel_flags_) {
+    CancelFlag::Set(flag);
+  }
+}
+
+void ConversionBatch::Start() {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  TRACE_EVENT_NESTABLE_ASYNC_BEGIN1("electron", "ConversionBatch", this,
+                                    "jobs", jobs_.size());
+  start_time_ = base::TimeTicks::Now();
+  StartNext();
+  MaybeFinish();
+}
+
+void ConversionBatch::Cancel() {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  cancelled_ = true;
+  for (auto& flag : cancel_flags_) {
+    CancelFlag::Set(flag);
+  }
+
+  // jobs that never started are reported now, running jobs report when they
+  // reach their next stage
+  for (; next_job_ < jobs_.size(); ++next_job_) {
+    ConversionResult result;
+    result.index = next_job_;
+    result.status = ConversionResult::Status::kCancelled;
+    Report(std::move(result));
+  }
+  MaybeFinish();
+}
+
+ConversionStats ConversionBatch::Stats() const {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  using Status = ConversionResult::Status;
+  ConversionStats stats;
+  for (const auto& result : results_) {
+    switch (result.status) {
+      case Status::kSucceeded:
+        ++stats.succeeded;
+        break;
+      case Status::kFailed:
+        ++stats.failed;
+        break;
+      case Status::kTimedOut:
+        ++stats.timed_out;
+        break;
+      case Status::kCancelled:
+        ++stats.cancelled;
+        break;
+      case Status::kPending:
+        break;
+    }
+    stats.bytes_read += result.bytes_read;
+    stats.bytes_written += result.bytes_written;
+  }
+  stats.elapsed = IsDone() ? elapsed_ : base::TimeTicks::Now() - start_time_;
+  return stats;
+}
+
+void ConversionBatch::StartNext() {
+  while (!cancelled_ && running_ < concurrency_ && next_job_ < jobs_.size()) {
+    size_t index = next_job_++;
+    ++running_;
+    cancel_flags_[index] = CancelFlag::Create();
+
+    // a converter may wait for a worker process of its own
+    base::ThreadPool::PostTaskAndReplyWithResult(
+        FROM_HERE,
+        {base::TaskPriority::USER_VISIBLE, base::MayBlock(),
+         base::WithBaseSyncPrimitives()},
+        base::BindOnce(converter_, jobs_[index], cancel_flags_[index]),
+        base::BindOnce(&ConversionBatch::OnJobFinished,
+                       weak_factory_.GetWeakPtr(), index));
+
+    if (!timeout_.is_zero()) {
+      base::SequencedTaskRunnerHandle::Get()->PostDelayedTask(
+          FROM_HERE,
+          base::BindOnce(&ConversionBatch::OnJobTimedOut,
+                         weak_factory_.GetWeakPtr(), index),
+          timeout_);
+    }
+  }
+}
+
+void ConversionBatch::OnJobFinished(size_t index, ConversionResult result) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  --running_;
+  result.index = index;
+  Report(std::move(result));
+  StartNext();
+  MaybeFinish();
+}
+
+void ConversionBatch::OnJobTimedOut(size_t index) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  if (results_[index].status != ConversionResult::Status::kPending)
+    return;
+
+  // LOK can't be interrupted, so the job keeps its slot until it reaches its
+  // next stage, but the result is reported now
+  CancelFlag::Set(cancel_flags_[index]);
+  ConversionResult result;
+  result.index = index;
+  result.status = ConversionResult::Status::kTimedOut;
+  result.error = "timed out";
+  result.elapsed = timeout_;
+  Report(std::move(result));
+  MaybeFinish();
+}
+
+void ConversionBatch::Report(ConversionResult result) {
+  ConversionResult& existing = results_[result.index];
+  if (existing.status != ConversionResult::Status::kPending)
+    return;
+
+  existing = std::move(result);
+  ++reported_;
+  if (progress_)
+    progress_.Run(existing);
+}
+
+void ConversionBatch::MaybeFinish() {
+  if (finished_ || reported_ < jobs_.size())
+    return;
+
+  finished_ = true;
+  elapsed_ = base::TimeTicks::Now() - start_time_;
+  TRACE_EVENT_NESTABLE_ASYNC_END0("electron", "ConversionBatch", this);
+  // the callback may delete this
+  std::vector<ConversionResult> results = results_;
+  std::move(done_).Run(Stats(), results);
+}
+
+}  // namespace electron::office
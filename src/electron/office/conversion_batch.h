@@ -0,0 +1,136 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "base/callback.h"
+#include "base/files/file_path.h"
+#include "base/memory/weak_ptr.h"
+#include "base/sequence_checker.h"
+#include "base/time/time.h"
+#include "office/cancellation_flag.h"
+
+namespace electron::office {
+
+struct ConversionJob {
+  base::FilePath input;
+  base::FilePath output;
+  // the export filter name, ex: "pdf", "docx"
+  std::string format;
+  // export filter options, when set the output is written by LOK directly
+  std::string filter_options;
+
+  ConversionJob();
+  ConversionJob(const ConversionJob& other);
+  ConversionJob& operator=(const ConversionJob& other);
+  ConversionJob(ConversionJob&& other) noexcept;
+  ConversionJob& operator=(ConversionJob&& other) noexcept;
+  ~ConversionJob();
+};
+
+struct ConversionResult {
+  enum class Status { kPending, kSucceeded, kFailed, kTimedOut, kCancelled };
+
+  size_t index = 0;
+  Status status = Status::kPending;
+  std::string error;
+  base::TimeDelta elapsed;
+  int64_t bytes_read = 0;
+  int64_t bytes_written = 0;
+
+  ConversionResult();
+  ConversionResult(const ConversionResult& other);
+  ConversionResult& operator=(const ConversionResult& other);
+  ~ConversionResult();
+};
+
+struct ConversionStats {
+  size_t succeeded = 0;
+  size_t failed = 0;
+  size_t timed_out = 0;
+  size_t cancelled = 0;
+  int64_t bytes_read = 0;
+  int64_t bytes_written = 0;
+  base::TimeDelta elapsed;
+
+  // finished conversions per second
+  double Throughput() const;
+};
+
+// Converts the document in `job`, blocking until it is written or fails.
+// Checks `cancel_flag` between the read, load/export and write stages. The
+// document is released as soon as it is exported.
+ConversionResult ConvertWithLok(const ConversionJob& job,
+                                CancelFlagPtr cancel_flag);
+
+// Schedules conversions on the thread pool with bounded concurrency, so that
+// the file IO of some jobs overlaps with LOK loading and exporting others.
+// Lives on and reports to the sequence it was started on.
+class ConversionBatch {
+ public:
+  // runs on the thread pool
+  using Converter =
+      base::RepeatingCallback<ConversionResult(const ConversionJob& job,
+                                               CancelFlagPtr cancel_flag)>;
+  using ProgressCallback =
+      base::RepeatingCallback<void(const ConversionResult& result)>;
+  using DoneCallback =
+      base::OnceCallback<void(const ConversionStats& stats,
+                              const std::vector<ConversionResult>& results)>;
+
+  static constexpr size_t kDefaultConcurrency = 4;
+
+  ConversionBatch(std::vector<ConversionJob> jobs,
+                  size_t concurrency,
+                  base::TimeDelta timeout,
+                  Converter converter,
+                  ProgressCallback progress,
+                  DoneCallback done);
+  ~ConversionBatch();
+
+  // no copy
+  ConversionBatch(const ConversionBatch&) = delete;
+  ConversionBatch& operator=(const ConversionBatch&) = delete;
+
+  void Start();
+  // jobs that haven't started are cancelled, running jobs stop at their next
+  // stage
+  void Cancel();
+
+  bool IsDone() const { return finished_; }
+  ConversionStats Stats() const;
+
+ private:
+  void StartNext();
+  void OnJobFinished(size_t index, ConversionResult result);
+  void OnJobTimedOut(size_t index);
+  // records the result of a job, if it wasn't already
+  void Report(ConversionResult result);
+  void MaybeFinish();
+
+  std::vector<ConversionJob> jobs_;
+  std::vector<ConversionResult> results_;
+  std::vector<CancelFlagPtr> cancel_flags_;
+  const size_t concurrency_;
+  const base::TimeDelta timeout_;
+  Converter converter_;
+  ProgressCallback progress_;
+  DoneCallback done_;
+
+  size_t next_job_ = 0;
+  // jobs running on the thread pool, including those that timed out
+  size_t running_ = 0;
+  size_t reported_ = 0;
+  bool cancelled_ = false;
+  bool finished_ = false;
+  base::TimeTicks start_time_;
+  base::TimeDelta elapsed_;
+
+  SEQUENCE_CHECKER(sequence_checker_);
+  base::WeakPtrFactory<ConversionBatch> weak_factory_{this};
+};
+
+}  // namespace electron::office
@@ -0,0 +1,139 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "conversion_batch.h"
+
+#include <atomic>
+#include "base/bind.h"
+#include "base/run_loop.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/test/bind.h"
+#include "base/test/task_environment.h"
+#include "base/threading/platform_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace electron::office {
+
+namespace {
+std::vector<ConversionJob> MakeJobs(size_t count) {
+  std::vector<ConversionJob> jobs(count);
+  for (size_t i = 0; i < count; ++i) {
+    jobs[i].input = base::FilePath::FromUTF8Unsafe("in" + std::to_string(i));
+    jobs[i].output = base::FilePath::FromUTF8Unsafe("out" + std::to_string(i));
+  }
+  return jobs;
+}
+
+ConversionResult Succeed() {
+  ConversionResult result;
+  result.status = ConversionResult::Status::kSucceeded;
+  result.bytes_read = 10;
+  result.bytes_written = 5;
+  return result;
+}
+}  // namespace
+
+class ConversionBatchTest : public ::testing::Test {
+ protected:
+  base::test::TaskEnvironment task_environment_;
+};
+
+TEST_F(ConversionBatchTest, BoundsConcurrency) {
+  std::atomic<int> active = 0;
+  std::atomic<int> max_active = 0;
+  ConversionStats stats;
+  size_t progress_count = 0;
+  base::RunLoop run_loop;
+
+  ConversionBatch batch(
+      MakeJobs(8), 2, base::TimeDelta(),
+      base::BindLambdaForTesting(
+          [&](const ConversionJob&, CancelFlagPtr) {
+            int now = ++active;
+            int prev = max_active;
+            while (now > prev && !max_active.compare_exchange_weak(prev, now)) {
+            }
+            base::PlatformThread::Sleep(base::Milliseconds(2));
+            --active;
+            return Succeed();
+          }),
+      base::BindLambdaForTesting(
+          [&](const ConversionResult&) { ++progress_count; }),
+      base::BindLambdaForTesting(
+          [&](const ConversionStats& result_stats,
+              const std::vector<ConversionResult>& results) {
+            stats = result_stats;
+            EXPECT_EQ(results.size(), size_t(8));
+            run_loop.Quit();
+          }));
+  batch.Start();
+  run_loop.Run();
+
+  EXPECT_LE(max_active, 2);
+  EXPECT_EQ(progress_count, size_t(8));
+  EXPECT_EQ(stats.succeeded, size_t(8));
+  EXPECT_EQ(stats.bytes_read, 80);
+  EXPECT_EQ(stats.bytes_written, 40);
+  EXPECT_TRUE(batch.IsDone());
+}
+
+TEST_F(ConversionBatchTest, CancelsPendingJobs) {
+  ConversionStats stats;
+  base::RunLoop run_loop;
+
+  ConversionBatch batch(
+      MakeJobs(3), 1, base::TimeDelta(),
+      base::BindRepeating([](const ConversionJob&, CancelFlagPtr cancel_flag) {
+        ConversionResult result;
+        result.status = CancelFlag::IsCancelled(cancel_flag)
+                            ? ConversionResult::Status::kCancelled
+                            : ConversionResult::Status::kSucceeded;
+        return result;
+      }),
+      ConversionBatch::ProgressCallback(),
+      base::BindLambdaForTesting(
+          [&](const ConversionStats& result_stats,
+              const std::vector<ConversionResult>&) {
+            stats = result_stats;
+            run_loop.Quit();
+          }));
+  batch.Start();
+  batch.Cancel();
+  run_loop.Run();
+
+  // the first job may have finished before it saw the cancellation
+  EXPECT_GE(stats.cancelled, size_t(2));
+  EXPECT_EQ(stats.cancelled + stats.succeeded, size_t(3));
+}
+
+TEST_F(ConversionBatchTest, TimesOutStuckJobs) {
+  base::WaitableEvent release;
+  std::vector<ConversionResult> results;
+  base::RunLoop run_loop;
+
+  ConversionBatch batch(
+      MakeJobs(1), 1, base::Milliseconds(10),
+      base::BindLambdaForTesting([&](const ConversionJob&, CancelFlagPtr) {
+        release.Wait();
+        return Succeed();
+      }),
+      ConversionBatch::ProgressCallback(),
+      base::BindLambdaForTesting(
+          [&](const ConversionStats&,
+              const std::vector<ConversionResult>& batch_results) {
+            results = batch_results;
+            run_loop.Quit();
+          }));
+  batch.Start();
+  run_loop.Run();
+  release.Signal();
+  task_environment_.RunUntilIdle();
+
+  ASSERT_EQ(results.size(), size_t(1));
+  EXPECT_EQ(results[0].status, ConversionResult::Status::kTimedOut);
+  // the late result doesn't replace the timeout
+  EXPECT_EQ(batch.Stats().timed_out, size_t(1));
+}
+
+}  // namespace electron::office
@@ -0,0 +1,201 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "office/data_array.h"
+
+#include <cmath>
+#include <limits>
+#include "base/trace_event/trace_event.h"
+#include "com/sun/star/container/XIndexAccess.hpp"
+#include "com/sun/star/frame/XModel.hpp"
+#include "com/sun/star/lang/XComponent.hpp"
+#include "com/sun/star/sheet/XCellRangeData.hpp"
+#include "com/sun/star/sheet/XSpreadsheet.hpp"
+#include "com/sun/star/sheet/XSpreadsheetDocument.hpp"
+#include "com/sun/star/sheet/XSpreadsheetView.hpp"
+#include "com/sun/star/sheet/XSpreadsheets.hpp"
+#include "com/sun/star/table/XCellRange.hpp"
+#include "com/sun/star/uno/Any.hxx"
+#include "com/sun/star/uno/Reference.hxx"
+#include "com/sun/star/uno/Sequence.hxx"
+#include "rtl/string.hxx"
+#include "rtl/ustring.hxx"
+
+namespace electron::office {
+
+DataArray::DataArray() = default;
+DataArray::DataArray(size_t rows_, size_t columns_)
+    : rows(rows_),
+      columns(columns_),
+      numbers(rows_ * columns_, std::numeric_limits<double>::quiet_NaN()),
+      kinds(rows_ * columns_, static_cast<uint8_t>(Kind::kEmpty)),
+      text_offsets(rows_ * columns_ + 1, 0) {}
+DataArray::DataArray(DataArray&& other) noexcept = default;
+DataArray& DataArray::operator=(DataArray&& other) noexcept = default;
+DataArray::~DataArray() = default;
+
+DataRange::DataRange() = default;
+DataRange::DataRange(const DataRange& other) = default;
+DataRange& DataRange::operator=(const DataRange& other) = default;
+DataRange::~DataRange() = default;
+
+namespace {
+namespace css = ::com::sun::star;
+using css::uno::Reference;
+using css::uno::UNO_QUERY;
+
+OUString ToOUString(const std::string& str) {
+  return OUString(str.data(), str.size(), RTL_TEXTENCODING_UTF8);
+}
+
+Reference<css::sheet::XCellRangeData> GetRangeData(void* component,
+                                                   const DataRange& range,
+                                                   std::string* error) {
+  Reference<css::sheet::XSpreadsheetDocument> document(
+      static_cast<css::lang::XComponent*>(component), UNO_QUERY);
+  if (!document.is()) {
+    *error = "document is not a spreadsheet";
+    return {};
+  }
+
+  Reference<css::sheet::XSpreadsheet> sheet;
+  Reference<css::sheet::XSpreadsheets> sheets = document->getSheets();
+  if (!range.sheet_name.empty()) {
+    OUString name = ToOUString(range.sheet_name);
+    if (sheets->hasByName(name))
+      sheets->getByName(name) >>= sheet;
+  } else if (range.sheet_index >= 0) {
+    Reference<css::container::XIndexAccess> indexed(sheets, UNO_QUERY);
+    if (indexed.is() && range.sheet_index < indexed->getCount())
+      indexed->getByIndex(range.sheet_index) >>= sheet;
+  } else {
+    // the active sheet of the current view
+    Reference<css::frame::XModel> model(document, UNO_QUERY);
+    if (model.is()) {
+      Reference<css::sheet::XSpreadsheetView> view(
+          model->getCurrentController(), UNO_QUERY);
+      if (view.is())
+        sheet = view->getActiveSheet();
+    }
+  }
+  if (!sheet.is()) {
+    *error = "sheet not found";
+    return {};
+  }
+
+  Reference<css::sheet::XCellRangeData> data(
+      sheet->getCellRangeByName(ToOUString(range.range)), UNO_QUERY);
+  if (!data.is())
+    *error = "invalid range";
+  return data;
+}
+}  // namespace
+
+bool ReadDataArray(void* component,
+                   const DataRange& range,
+                   DataArray* out,
+                   std::string* error) {
+  TRACE_EVENT0("electron", "ReadDataArray");
+  try {
+    Reference<css::sheet::XCellRangeData> range_data =
+        GetRangeData(component, range, error);
+    if (!range_data.is())
+      return false;
+
+    // rows of columns
+    const css::uno::Sequence<css::uno::Sequence<css::uno::Any>> values =
+        range_data->getDataArray();
+    size_t rows = values.getLength();
+    size_t columns = rows ? values[0].getLength() : 0;
+
+    TRACE_EVENT0("electron", "ReadDataArray::Pack");
+    DataArray result(rows, columns);
+    // the text offsets are cumulative in column-major order, so the strings
+    // are collected per cell first
+    std::vector<OString> strings(rows * columns);
+    for (size_t row = 0; row < rows; ++row) {
+      const css::uno::Sequence<css::uno::Any>& row_values = values[row];
+      for (size_t column = 0;
+           column < columns && column < size_t(row_values.getLength());
+           ++column) {
+        const css::uno::Any& value = row_values[column];
+        size_t index = result.Index(row, column);
+        double number;
+        OUString str;
+        if (value >>= number) {
+          result.numbers[index] = number;
+          result.kinds[index] = static_cast<uint8_t>(DataArray::Kind::kNumber);
+        } else if (value >>= str) {
+          strings[index] = OUStringToOString(str, RTL_TEXTENCODING_UTF8);
+          result.kinds[index] = static_cast<uint8_t>(DataArray::Kind::kString);
+        }
+      }
+    }
+
+    size_t text_size = 0;
+    for (const OString& str : strings) {
+      text_size += str.getLength();
+    }
+    if (text_size > std::numeric_limits<uint32_t>::max()) {
+      *error = "range text is too large";
+      return false;
+    }
+    result.text.reserve(text_size);
+    for (size_t i = 0; i < strings.size(); ++i) {
+      result.text.append(strings[i].getStr(), strings[i].getLength());
+      result.text_offsets[i + 1] = result.text.size();
+    }
+
+    *out = std::move(result);
+    return true;
+  } catch (const css::uno::Exception& e) {
+    *error = OUStringToOString(e.Message, RTL_TEXTENCODING_UTF8).getStr();
+    return false;
+  }
+}
+
+bool WriteDataArray(void* component,
+                    const DataRange& range,
+                    const DataArray& data,
+                    std::string* error) {
+  TRACE_EVENT0("electron", "WriteDataArray");
+  try {
+    Reference<css::sheet::XCellRangeData> range_data =
+        GetRangeData(component, range, error);
+    if (!range_data.is())
+      return false;
+
+    css::uno::Sequence<css::uno::Sequence<css::uno::Any>> values(data.rows);
+    css::uno::Sequence<css::uno::Any>* rows = values.getArray();
+    for (size_t row = 0; row < data.rows; ++row) {
+      rows[row].realloc(data.columns);
+      css::uno::Any* row_values = rows[row].getArray();
+      for (size_t column = 0; column < data.columns; ++column) {
+        size_t index = data.Index(row, column);
+        switch (static_cast<DataArray::Kind>(data.kinds[index])) {
+          case DataArray::Kind::kNumber:
+            row_values[column] <<= data.numbers[index];
+            break;
+          case DataArray::Kind::kString:
+            row_values[column] <<= OUString(
+                data.text.data() + data.text_offsets[index],
+                data.text_offsets[index + 1] - data.text_offsets[index],
+                RTL_TEXTENCODING_UTF8);
+            break;
+          case DataArray::Kind::kEmpty:
+            // a void Any clears the cell
+            break;
+        }
+      }
+    }
+
+    range_data->setDataArray(values);
+    return true;
+  } catch (const css::uno::Exception& e) {
+    *error = OUStringToOString(e.Message, RTL_TEXTENCODING_UTF8).getStr();
+    return false;
+  }
+}
+
+}  // namespace electron::office
@@ -0,0 +1,74 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace electron::office {
+
+// A rectangular block of cell values in column-major order, so that a column
+// of numbers is contiguous.
+struct DataArray {
+  enum class Kind : uint8_t { kEmpty = 0, kNumber = 1, kString = 2 };
+
+  size_t rows = 0;
+  size_t columns = 0;
+  // one per cell, NaN if the cell isn't a number
+  std::vector<double> numbers;
+  // one per cell, a Kind
+  std::vector<uint8_t> kinds;
+  // the UTF-8 text of every string cell, packed together
+  std::string text;
+  // one per cell plus one, the text of a cell is [offsets[i], offsets[i + 1])
+  std::vector<uint32_t> text_offsets;
+
+  DataArray();
+  DataArray(size_t rows_, size_t columns_);
+  DataArray(DataArray&& other) noexcept;
+  DataArray& operator=(DataArray&& other) noexcept;
+  ~DataArray();
+
+  // no copy
+  DataArray(const DataArray&) = delete;
+  DataArray& operator=(const DataArray&) = delete;
+
+  size_t Index(size_t row, size_t column) const {
+    return column * rows + row;
+  }
+};
+
+// A cell range in a spreadsheet, ex: "A1:C100"
+struct DataRange {
+  std::string range;
+  // the sheet named `sheet_name` if it's set, otherwise the sheet at
+  // `sheet_index` if it isn't negative, otherwise the view's active sheet; a
+  // name or index that matches no sheet is an error rather than a fallback
+  std::string sheet_name;
+  int sheet_index = -1;
+
+  DataRange();
+  DataRange(const DataRange& other);
+  DataRange& operator=(const DataRange& other);
+  ~DataRange();
+};
+
+// Reads every cell in `range` with a single UNO call. `component` is the
+// document's XComponent. Returns false and sets `error` if the document isn't
+// a spreadsheet or the range is invalid.
+bool ReadDataArray(void* component,
+                   const DataRange& range,
+                   DataArray* out,
+                   std::string* error);
+
+// Writes `data` to `range` with a single UNO call, the size of the range must
+// match the size of `data`.
+bool WriteDataArray(void* component,
+                    const DataRange& range,
+                    const DataArray& data,
+                    std::string* error);
+
+}  // namespace electron::office
@@ -5,20 +5,37 @@
 #include "office/document_client.h"
 #include <sys/types.h>
 
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstring>
+#include <limits>
 #include <memory>
+#include <numeric>
 #include <string_view>
+#include <tuple>
 #include <vector>
 #include "LibreOfficeKit/LibreOfficeKit.hxx"
+#include "LibreOfficeKit/LibreOfficeKitEnums.h"
 #include "base/bind.h"
+#include "base/hash/hash.h"
 #include "base/logging.h"
 #include "base/memory/scoped_refptr.h"
 #include "base/process/memory.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/stringprintf.h"
+#include "base/task/bind_post_task.h"
 #include "base/threading/sequenced_task_runner_handle.h"
+#include "base/trace_event/memory_allocator_dump.h"
+#include "base/trace_event/memory_dump_manager.h"
+#include "base/trace_event/process_memory_dump.h"
+#include "base/trace_event/trace_event.h"
 #include "gin/converter.h"
 #include "gin/dictionary.h"
 #include "gin/handle.h"
 #include "gin/object_template_builder.h"
 #include "gin/per_isolate_data.h"
+#include "office/data_array.h"
 #include "office/document_holder.h"
 #include "office/lok_callback.h"
 #include "office/office_client.h"
@@ -37,6 +54,7 @@
 #include "v8/include/v8-json.h"
 #include "v8/include/v8-local-handle.h"
 #include "v8/include/v8-primitive.h"
+#include "v8/include/v8-typed-array.h"
 #include "v8_stringify.h"
 
 namespace electron::office {
@@ -90,18 +108,44 @@ DocumentClient::DocumentClient(DocumentHolderWithView holder)
       LOK_CALLBACK_DOCUMENT_SIZE_CHANGED,
       LOK_CALLBACK_INVALIDATE_TILES,
       LOK_CALLBACK_STATE_CHANGED,
+      // kept in document_state_
+      LOK_CALLBACK_COMMENT,
+      LOK_CALLBACK_REDLINE_TABLE_SIZE_CHANGED,
+      LOK_CALLBACK_REDLINE_TABLE_ENTRY_MODIFIED,
   };
   for (auto event_type : internal_monitors) {
     document_holder_.AddDocumentObserver(event_type, this);
     event_types_registered_.emplace(event_type);
   }
   OfficeInstance::Get()->AddDestroyedObserver(this);
+  base::trace_event::MemoryDumpManager::GetInstance()->RegisterDumpProvider(
+      this, "ElectronOffice", base::SequencedTaskRunnerHandle::Get());
+
+  document_type_ = document_holder_->getDocumentType();
+  // a document that's never rendered hibernates too
+  hibernate_timer_.Start(FROM_HERE, hibernate_delay_,
+                         base::BindOnce(&DocumentClient::Hibernate,
+                                        base::Unretained(this)));
 }
 
 DocumentClient::~DocumentClient() {
   if (document_holder_) {
     document_holder_.RemoveDocumentObservers();
+    // the hidden view of a search would outlive this view of the document
+    document_holder_.PostBlocking(base::BindOnce(
+        [](scoped_refptr<TextSearch> text_search,
+           DocumentHolderWithView holder) {
+          if (holder.holder()->IsUnloaded())
+            return;
+          PinnedDocument doc(holder.holder().get(), -1);
+          if (doc)
+            text_search->ReleaseView(doc.get());
+        },
+        text_search_));
   }
+  // a no-op for a client that never registered, like the destroyed observer
+  base::trace_event::MemoryDumpManager::GetInstance()->UnregisterDumpProvider(
+      this);
   OfficeInstance::Get()->RemoveDestroyedObserver(this);
 }
 
@@ -130,13 +174,30 @@ gin::ObjectTemplateBuilder DocumentClient::GetObjectTemplateBuilder(
       .SetMethod("setTextSelection", &DocumentClient::SetTextSelection)
       .SetMethod("getClipboard", &DocumentClient::GetClipboard)
       .SetMethod("setClipboard", &DocumentClient::SetClipboard)
+      .SetMethod("getClipboardAsync", &DocumentClient::GetClipboardAsync)
+      .SetMethod("setClipboardAsync", &DocumentClient::SetClipboardAsync)
       .SetMethod("paste", &DocumentClient::Paste)
       .SetMethod("setGraphicSelection", &DocumentClient::SetGraphicSelection)
       .SetMethod("resetSelection", &DocumentClient::ResetSelection)
       .SetMethod("getCommandValues", &DocumentClient::GetCommandValues)
       .SetMethod("as", &DocumentClient::As)
+      .SetMethod("getDataArray", &DocumentClient::GetDataArray)
+      .SetMethod("setDataArray", &DocumentClient::SetDataArray)
       .SetMethod("newView", &DocumentClient::NewView)
+      .SetMethod("renderPages", &DocumentClient::RenderPages)
+      .SetMethod("renderSlide", &DocumentClient::RenderSlide)
+      .SetMethod("findAll", &DocumentClient::FindAll)
+      .SetMethod("setHibernation", &DocumentClient::SetHibernation)
+      .SetMethod("setAutosave", &DocumentClient::SetAutosave)
+      .SetMethod("setSpellcheck", &DocumentClient::SetSpellcheck)
+      .SetMethod("exportPdf", &DocumentClient::ExportPdf)
+      .SetMethod("getState", &DocumentClient::GetState)
+      .SetMethod("getComments", &DocumentClient::GetComments)
+      .SetMethod("getTrackedChanges", &DocumentClient::GetTrackedChanges)
+      .SetMethod("getMemoryUsage", &DocumentClient::GetMemoryUsage)
+      .SetMethod("setMemoryBudget", &DocumentClient::SetMemoryBudget)
       .SetProperty("isReady", &DocumentClient::IsReady)
+      .SetProperty("isHibernated", &DocumentClient::IsHibernated)
       .SetMethod("initializeForRendering",
                  &DocumentClient::InitializeForRendering);
 }
@@ -171,6 +232,9 @@ bool DocumentClient::Mount(v8::Isolate* isolate) {
   }
 
   RefreshSize();
+  if (PinnedDocument doc = document_holder_.Pin())
+    current_part_ = doc->getPart();
+  SeedDocumentState();
 
   base::SequencedTaskRunnerHandle::Get()->PostTask(
       FROM_HERE,
@@ -192,17 +256,20 @@ bool DocumentClient::Unmount() {
 }
 
 int DocumentClient::GetNumberOfPages() const {
-  return document_holder_->getParts();
+  PinnedDocument doc = document_holder_.Pin();
+  return doc ? doc->getParts() : 0;
 }
 //}
 
 // Editing State {
 bool DocumentClient::CanUndo() {
-	return can_undo_;
+  const std::string* undo = document_state_.State(".uno:Undo");
+  return undo && *undo == "enabled";
 }
 
 bool DocumentClient::CanRedo() {
-	return can_redo_;
+  const std::string* redo = document_state_.State(".uno:Redo");
+  return redo && *redo == "enabled";
 }
 // }
 
@@ -225,6 +292,287 @@ RendererTransferable DocumentClient::GetRestoredRenderer(
   return res;
 }
 
+void DocumentClient::SetRendererActive(bool active) {
+  active_renderers_ += active ? 1 : -1;
+  DCHECK_GE(active_renderers_, 0);
+
+  if (active_renderers_ > 0) {
+    hibernate_timer_.Stop();
+    return;
+  }
+
+  hibernate_timer_.Start(FROM_HERE, hibernate_delay_,
+                         base::BindOnce(&DocumentClient::Hibernate,
+                                        base::Unretained(this)));
+}
+
+base::TimeDelta DocumentClient::HibernateDelay() const {
+  return hibernate_delay_;
+}
+
+void DocumentClient::SetHibernation(v8::Isolate* isolate,
+                                    v8::Local<v8::Object> options) {
+  gin::Dictionary options_dict(isolate, options);
+
+  double idle_ms;
+  if (options_dict.Get("idleMs", &idle_ms) && idle_ms >= 0) {
+    hibernate_delay_ = base::Milliseconds(idle_ms);
+  }
+
+  std::string unload;
+  if (options_dict.Get("unload", &unload)) {
+    if (unload == "memory") {
+      unload_storage_ = DocumentHolder::UnloadStorage::kMemory;
+    } else if (unload == "disk") {
+      unload_storage_ = DocumentHolder::UnloadStorage::kDisk;
+    } else {
+      unload_storage_.reset();
+    }
+  }
+
+  if (hibernate_timer_.IsRunning()) {
+    hibernate_timer_.Start(FROM_HERE, hibernate_delay_,
+                           base::BindOnce(&DocumentClient::Hibernate,
+                                          base::Unretained(this)));
+  }
+}
+
+bool DocumentClient::IsModified() const {
+  const std::string* modified = document_state_.State(".uno:ModifiedStatus");
+  return modified && *modified == "true";
+}
+
+DocumentStamp DocumentClient::Stamp() const {
+  DocumentStamp stamp;
+  if (!document_holder_)
+    return stamp;
+  stamp.url_hash = base::PersistentHash(document_holder_.Path());
+  stamp.document_token = document_holder_.holder()->token();
+  stamp.invalidation_count = invalidation_count_;
+  stamp.modified = IsModified();
+  return stamp;
+}
+
+bool DocumentClient::IsHibernated() const {
+  return document_holder_ && document_holder_.holder()->IsUnloaded();
+}
+
+void DocumentClient::Hibernate() {
+  TRACE_EVENT0("electron", "DocumentClient::Hibernate");
+  // renderers waiting to be remounted no longer paint, so their pools can go
+  for (auto& it : tile_buffers_to_restore_) {
+    if (it.second.tile_buffer)
+      it.second.tile_buffer->ReleasePool();
+  }
+
+  if (!unload_storage_)
+    return;
+
+  Unload(unload_storage_.value(), base::BindOnce([](bool unloaded) {
+           LOG_IF(WARNING, !unloaded)
+               << "document was not unloaded while hibernating";
+         }));
+}
+
+void DocumentClient::Unload(DocumentHolder::UnloadStorage storage,
+                            base::OnceCallback<void(bool)> done) {
+  if (!document_holder_) {
+    std::move(done).Run(false);
+    return;
+  }
+
+  // LOK has no getter for the modified flag, so it's restored from the state
+  document_holder_.PostBlocking(base::BindOnce(
+      [](DocumentHolder::UnloadStorage storage, bool modified,
+         scoped_refptr<TextSearch> text_search,
+         base::OnceCallback<void(bool)> done, DocumentHolderWithView holder) {
+        // an earlier unload was still queued
+        if (holder.holder()->IsUnloaded()) {
+          std::move(done).Run(true);
+          return;
+        }
+        // the search's hidden view would keep the document from unloading
+        if (PinnedDocument doc = holder.Pin())
+          text_search->ReleaseView(doc.get());
+        std::move(done).Run(holder.holder()->Unload(storage, modified));
+      },
+      storage, IsModified(), text_search_,
+      base::BindPostTask(base::SequencedTaskRunnerHandle::Get(),
+                         std::move(done))));
+}
+
+void DocumentClient::AddMemoryReclaimer(MemoryReclaimer* reclaimer) {
+  memory_reclaimers_.AddObserver(reclaimer);
+}
+
+void DocumentClient::RemoveMemoryReclaimer(MemoryReclaimer* reclaimer) {
+  memory_reclaimers_.RemoveObserver(reclaimer);
+}
+
+DocumentMemoryUsage DocumentClient::MemoryUsage() {
+  DocumentMemoryUsage usage;
+  for (MemoryReclaimer& reclaimer : memory_reclaimers_)
+    usage.views.push_back(reclaimer.GetMemoryUsage());
+
+  for (auto& it : tile_buffers_to_restore_) {
+    ViewMemoryUsage view;
+    view.restorable = true;
+    if (it.second.tile_buffer) {
+      view.tile_pool_bytes = it.second.tile_buffer->PoolByteSize();
+      view.tile_bytes = it.second.tile_buffer->TileImageByteSize();
+      view.snapshot_bytes =
+          it.second.tile_buffer->SnapshotByteSize(it.second.snapshot);
+    } else {
+      view.snapshot_bytes = it.second.snapshot.ByteSize();
+    }
+    usage.views.push_back(view);
+  }
+
+  usage.thumbnail_bytes = thumbnail_cache_.ByteSize() + slide_cache_.ByteSize();
+  if (document_holder_)
+    usage.unloaded_bytes = document_holder_.holder()->UnloadedByteSize();
+  usage.hibernated = IsHibernated();
+  return usage;
+}
+
+v8::Local<v8::Value> DocumentClient::GetMemoryUsage(v8::Isolate* isolate) {
+  DocumentMemoryUsage usage = MemoryUsage();
+
+  std::vector<v8::Local<v8::Value>> views;
+  for (const ViewMemoryUsage& view : usage.views) {
+    gin::Dictionary view_dict = gin::Dictionary::CreateEmpty(isolate);
+    view_dict.Set("tilePoolBytes", static_cast<double>(view.tile_pool_bytes));
+    view_dict.Set("tileBytes", static_cast<double>(view.tile_bytes));
+    view_dict.Set("snapshotBytes", static_cast<double>(view.snapshot_bytes));
+    view_dict.Set("visible", view.visible);
+    view_dict.Set("restorable", view.restorable);
+    views.push_back(gin::ConvertToV8(isolate, view_dict));
+  }
+
+  gin::Dictionary dict = gin::Dictionary::CreateEmpty(isolate);
+  dict.Set("totalBytes", static_cast<double>(usage.Total()));
+  dict.Set("thumbnailBytes", static_cast<double>(usage.thumbnail_bytes));
+  dict.Set("unloadedBytes", static_cast<double>(usage.unloaded_bytes));
+  dict.Set("hibernated", usage.hibernated);
+  dict.Set("views", views);
+  if (memory_budget_)
+    dict.Set("budgetBytes", static_cast<double>(*memory_budget_));
+  return gin::ConvertToV8(isolate, dict);
+}
+
+void DocumentClient::SetMemoryBudget(v8::Isolate* isolate,
+                                     v8::Local<v8::Value> options) {
+  memory_budget_.reset();
+  memory_budget_timer_.Stop();
+  // a new budget unloads right away, even if an earlier one was refused
+  budget_unload_backoff_ = base::TimeDelta();
+  budget_unload_retry_ = base::TimeTicks();
+  if (!options->IsObject())
+    return;
+
+  gin::Dictionary options_dict(isolate, options.As<v8::Object>());
+  double max_bytes;
+  if (!options_dict.Get("maxBytes", &max_bytes) || max_bytes < 0) {
+    isolate->ThrowError(
+        gin::StringToV8(isolate, "Missing memory budget maxBytes"));
+    return;
+  }
+
+  memory_budget_ = static_cast<size_t>(max_bytes);
+  memory_budget_timer_.Start(
+      FROM_HERE, kMemoryBudgetInterval,
+      base::BindRepeating(&DocumentClient::EnforceMemoryBudget,
+                          base::Unretained(this)));
+  EnforceMemoryBudget();
+}
+
+void DocumentClient::EnforceMemoryBudget() {
+  if (!memory_budget_)
+    return;
+
+  DocumentMemoryUsage usage = MemoryUsage();
+  usage.unload_blocked =
+      budget_unloading_ || base::TimeTicks::Now() < budget_unload_retry_;
+  std::vector<ReclaimStep> steps = PlanReclaim(usage, *memory_budget_);
+  if (steps.empty())
+    return;
+
+  TRACE_EVENT2("electron", "DocumentClient::EnforceMemoryBudget",
+               "bytes", usage.Total(), "steps", steps.size());
+  for (ReclaimStep step : steps) {
+    switch (step) {
+      case ReclaimStep::kEvictTiles:
+        for (auto& it : tile_buffers_to_restore_) {
+          if (it.second.tile_buffer)
+            it.second.tile_buffer->ReleasePool();
+        }
+        for (MemoryReclaimer& reclaimer : memory_reclaimers_)
+          reclaimer.EvictTiles();
+        break;
+      case ReclaimStep::kReleaseSnapshots:
+        for (auto& it : tile_buffers_to_restore_)
+          it.second.snapshot = Snapshot();
+        for (MemoryReclaimer& reclaimer : memory_reclaimers_)
+          reclaimer.ReleaseSnapshot();
+        break;
+      case ReclaimStep::kHibernate:
+        thumbnail_cache_.InvalidateAll();
+        slide_cache_.InvalidateAll();
+        // unloaded even if hibernation doesn't unload, the budget is the
+        // stronger constraint
+        budget_unloading_ = true;
+        Unload(
+            unload_storage_.value_or(DocumentHolder::UnloadStorage::kMemory),
+            base::BindOnce(&DocumentClient::OnBudgetUnloaded, GetWeakPtr()));
+        break;
+    }
+  }
+}
+
+void DocumentClient::OnBudgetUnloaded(bool unloaded) {
+  budget_unloading_ = false;
+  if (unloaded) {
+    budget_unload_backoff_ = base::TimeDelta();
+    return;
+  }
+
+  // warned once until an unload succeeds, the budget is checked every second
+  LOG_IF(WARNING, budget_unload_backoff_.is_zero())
+      << "document was not unloaded for the memory budget";
+  budget_unload_backoff_ =
+      std::min(std::max(budget_unload_backoff_ * 2, kMemoryBudgetInterval),
+               kMaxUnloadBackoff);
+  budget_unload_retry_ = base::TimeTicks::Now() + budget_unload_backoff_;
+}
+
+bool DocumentClient::OnMemoryDump(const base::trace_event::MemoryDumpArgs& args,
+                                  base::trace_event::ProcessMemoryDump* pmd) {
+  using base::trace_event::MemoryAllocatorDump;
+  DocumentMemoryUsage usage = MemoryUsage();
+  const std::string document_name =
+      base::StringPrintf("electron_office/document_0x%" PRIXPTR,
+                         reinterpret_cast<uintptr_t>(this));
+
+  auto add_bytes = [pmd](const std::string& name, size_t bytes) {
+    pmd->CreateAllocatorDump(name)->AddScalar(
+        MemoryAllocatorDump::kNameSize, MemoryAllocatorDump::kUnitsBytes,
+        bytes);
+  };
+  add_bytes(document_name, usage.Total());
+  add_bytes(document_name + "/thumbnails", usage.thumbnail_bytes);
+  add_bytes(document_name + "/unloaded", usage.unloaded_bytes);
+  for (size_t i = 0; i < usage.views.size(); ++i) {
+    const ViewMemoryUsage& view = usage.views[i];
+    const std::string view_name = base::StringPrintf(
+        "%s/%s_%zu", document_name.c_str(),
+        view.restorable ? "restorable" : "view", i);
+    add_bytes(view_name + "/tile_pool", view.tile_pool_bytes);
+    add_bytes(view_name + "/tiles", view.tile_bytes);
+    add_bytes(view_name + "/snapshot", view.snapshot_bytes);
+  }
+  return true;
+}
+
 DocumentHolderWithView DocumentClient::GetDocument() {
   return document_holder_;
 }
@@ -234,14 +582,13 @@ base::WeakPtr<DocumentClient> DocumentClient::GetWeakPtr() {
 }
 
 void DocumentClient::HandleStateChange(const std::string& payload) {
-	static constexpr std::string_view uno_undo = ".uno:Undo=";
-	static constexpr std::string_view uno_redo = ".uno:Redo=";
-	std::string_view sv = payload;
-  if (sv.substr(0, uno_undo.length()) == uno_undo) {
-		can_undo_ = sv.substr(uno_undo.length()) == "enabled";
-  }
-  if (sv.substr(0, uno_redo.length()) == uno_redo) {
-		can_redo_ = sv.substr(uno_redo.length()) == "enabled";
+  if (document_state_.UpdateState(payload))
+    ScheduleStateDiff();
+
+  std::string_view sv = payload;
+  static constexpr std::string_view uno_modified = ".uno:ModifiedStatus=true";
+  if (autosave_ && sv == uno_modified) {
+    autosave_->MarkDirty();
   }
 
   if (!is_ready_) {
@@ -251,17 +598,64 @@ void DocumentClient::HandleStateChange(const std::string& payload) {
 
 void DocumentClient::HandleDocSizeChanged() {
   RefreshSize();
+  // pages may have moved
+  thumbnail_cache_.InvalidateAll();
+  // parts may have been inserted or removed
+  slide_cache_.InvalidateAll();
+  text_search_->MarkStale();
 }
 
-void DocumentClient::HandleInvalidate() {
+void DocumentClient::HandleInvalidate(const std::string& payload) {
   is_ready_ = true;
+  ++invalidation_count_;
+  // LOK only reports the modified flag when it changes, so an edit after a
+  // save shows up as the invalidation of a document that is still modified
+  if (autosave_ && IsModified())
+    autosave_->MarkDirty();
+
+  std::string_view payload_sv(payload);
+  if (payload_sv.substr(0, 5) == "EMPTY") {
+    // LOK issues a full invalidation for every page, in the form "EMPTY, #"
+    auto num_payload = payload_sv.substr(5);
+    std::string_view::const_iterator start = num_payload.begin();
+    auto num = lok_callback::ParseCSV(start, payload_sv.end());
+    text_search_->MarkStale();
+    if (num.empty()) {
+      thumbnail_cache_.InvalidateAll();
+      slide_cache_.InvalidateAll();
+    } else {
+      // for presentations and drawings this is the part
+      thumbnail_cache_.InvalidatePage(static_cast<int>(num[0]));
+      slide_cache_.InvalidatePage(static_cast<int>(num[0]));
+    }
+    return;
+  }
+
+  std::string_view::const_iterator start = payload_sv.begin();
+  gfx::Rect dirty_rect = lok_callback::ParseRect(start, payload_sv.end());
+  if (!dirty_rect.IsEmpty()) {
+    thumbnail_cache_.InvalidateTwipRect(dirty_rect, page_rects_);
+    text_search_->MarkStale(dirty_rect);
+  }
+
+  // an export checks the generations of its parts, even if none are cached
+  if (slide_cache_.size() > 0 || pdf_export_) {
+    // the part follows the rect, otherwise it is the current part
+    std::string_view::const_iterator part_start = payload_sv.begin();
+    auto values = lok_callback::ParseCSV(part_start, payload_sv.end());
+    slide_cache_.InvalidatePage(
+        values.size() > 4 ? static_cast<int>(values[4]) : current_part_);
+  }
 }
 
 void DocumentClient::RefreshSize() {
-  document_holder_->getDocumentSize(&document_width_in_twips_,
-                                    &document_height_in_twips_);
+  // an unloaded document keeps its size
+  PinnedDocument doc = document_holder_.Pin();
+  if (!doc)
+    return;
+  doc->getDocumentSize(&document_width_in_twips_, &document_height_in_twips_);
 
-  LokStrPtr page_rect(document_holder_->getPartPageRectangles());
+  LokStrPtr page_rect(doc->getPartPageRectangles());
   std::string_view page_rect_sv(page_rect.get());
   std::string_view::const_iterator start = page_rect_sv.begin();
   int new_size = GetNumberOfPages();
@@ -271,12 +665,25 @@ void DocumentClient::RefreshSize() {
 
 void DocumentClient::On(v8::Isolate* isolate,
                         const std::u16string& event_name,
-                        v8::Local<v8::Function> listener_callback) {
+                        v8::Local<v8::Function> listener_callback,
+                        gin::Arguments* args) {
   int type = lok_callback::EventStringToType(event_name);
   if (type < 0) {
     LOG(ERROR) << "on, unknown event: " << event_name;
   }
-  event_listeners_[type].emplace_back(isolate, listener_callback);
+
+  bool batched = false;
+  std::vector<std::string> keys;
+  v8::Local<v8::Object> options;
+  if (args->GetNext(&options)) {
+    gin::Dictionary options_dict(isolate, options);
+    options_dict.Get("batched", &batched);
+    options_dict.Get("keys", &keys);
+  }
+
+  event_listeners_[type].emplace_back(
+      SafeV8Function(isolate, listener_callback), batched,
+      EventFilter(std::move(keys)));
   if (event_types_registered_.emplace(type).second) {
     document_holder_.AddDocumentObserver(type, this);
   }
@@ -320,14 +727,18 @@ void DocumentClient::Emit(v8::Isolate* isolate,
   auto itr = event_listeners_.find(type);
   if (itr == event_listeners_.end())
     return;
-  for (auto& callback : itr->second) {
-    V8FunctionInvoker<void(v8::Local<v8::Value>)>::Go(isolate, callback, data);
+  // a copy, since a listener may call off
+  std::vector<EventListener> listeners = itr->second;
+  for (auto& listener : listeners) {
+    V8FunctionInvoker<void(v8::Local<v8::Value>)>::Go(
+        isolate, listener.callback(), data);
   }
 }
 
 v8::Local<v8::Value> DocumentClient::GotoOutline(int idx,
                                                  gin::Arguments* args) {
-  LokStrPtr result(document_holder_->gotoOutline(idx));
+  PinnedDocument doc = document_holder_.Pin();
+  LokStrPtr result(doc ? doc->gotoOutline(idx) : nullptr);
   v8::Isolate* isolate = args->isolate();
 
   if (!result) {
@@ -415,9 +826,144 @@ v8::Local<v8::Promise> DocumentClient::SaveToMemory(v8::Isolate* isolate,
   return handle;
 }
 
+void DocumentClient::SetAutosave(v8::Isolate* isolate,
+                                 v8::Local<v8::Value> options) {
+  autosave_.reset();
+  autosave_progress_.reset();
+  if (!options->IsObject())
+    return;
+
+  gin::Dictionary options_dict(isolate, options.As<v8::Object>());
+  std::string path;
+  if (!options_dict.Get("path", &path) || path.empty()) {
+    isolate->ThrowError(gin::StringToV8(isolate, "Missing autosave path"));
+    return;
+  }
+
+  std::string format;
+  options_dict.Get("format", &format);
+  base::TimeDelta interval = Autosave::kDefaultInterval;
+  base::TimeDelta idle = Autosave::kDefaultIdle;
+  double ms;
+  if (options_dict.Get("intervalMs", &ms) && ms > 0)
+    interval = base::Milliseconds(ms);
+  if (options_dict.Get("idleMs", &ms) && ms >= 0)
+    idle = base::Milliseconds(ms);
+
+  v8::Local<v8::Function> on_progress;
+  if (options_dict.Get("onProgress", &on_progress)) {
+    autosave_progress_.emplace(isolate, on_progress);
+    if (!isolate_)
+      isolate_ = isolate;
+  }
+
+  autosave_ = std::make_unique<Autosave>(
+      base::FilePath::FromUTF8Unsafe(path), interval, idle,
+      base::BindRepeating(&DocumentClient::SerializeForAutosave, GetWeakPtr(),
+                          format),
+      base::BindRepeating(&DocumentClient::ReportAutosaveProgress,
+                          GetWeakPtr()));
+}
+
+void DocumentClient::RecordInput() {
+  last_input_time_ = base::TimeTicks::Now();
+  if (autosave_)
+    autosave_->RecordInput();
+}
+
+void DocumentClient::SetSpellcheck(bool enabled) {
+  spellcheck_enabled_ = enabled;
+  if (enabled) {
+    StartSpellcheckWhenIdle();
+    return;
+  }
+
+  spellcheck_timer_.Stop();
+  if (spellcheck_online_)
+    SetSpellOnline(false);
+}
+
+void DocumentClient::StartSpellcheckWhenIdle() {
+  if (!spellcheck_enabled_ || spellcheck_online_)
+    return;
+
+  base::TimeDelta idle = base::TimeTicks::Now() - last_input_time_;
+  if (idle < kSpellcheckIdle || IsHibernated()) {
+    spellcheck_timer_.Start(
+        FROM_HERE, std::max(kSpellcheckIdle - idle, kSpellcheckIdle / 4),
+        base::BindOnce(&DocumentClient::StartSpellcheckWhenIdle,
+                       base::Unretained(this)));
+    return;
+  }
+
+  SetSpellOnline(true);
+}
+
+bool DocumentClient::HasPendingInput() const {
+  return document_holder_.HasPendingInput() ||
+         base::TimeTicks::Now() - last_input_time_ < kInputSettle;
+}
+
+void DocumentClient::SetSpellOnline(bool enabled) {
+  TRACE_EVENT1("electron", "DocumentClient::SetSpellOnline", "enabled",
+               enabled);
+  // switching it re-marks every word, so it's only switched when spelling is
+  // enabled or disabled, never for input
+  spellcheck_online_ = enabled;
+  document_holder_.Post(base::BindOnce(
+      [](bool enabled, DocumentHolderWithView holder) {
+        holder->postUnoCommand(
+            ".uno:SpellOnline",
+            enabled ? R"({"SpellOnline":{"type":"boolean","value":true}})"
+                    : R"({"SpellOnline":{"type":"boolean","value":false}})",
+            false);
+      },
+      enabled));
+}
+
+void DocumentClient::SerializeForAutosave(
+    const std::string& format,
+    base::OnceCallback<void(Autosave::Serialized)> done) {
+  document_holder_.PostBlocking(base::BindOnce(
+      [](std::string format, base::OnceCallback<void(Autosave::Serialized)> done,
+         DocumentHolderWithView holder) {
+        TRACE_EVENT0("electron", "DocumentClient::SerializeForAutosave");
+        char* output = nullptr;
+        size_t size = holder->saveToMemory(
+            &output, UncheckedAlloc, format.empty() ? nullptr : format.c_str());
+        std::move(done).Run(Autosave::Serialized(output, size, lok_safe_free));
+      },
+      format, std::move(done)));
+}
+
+void DocumentClient::ReportAutosaveProgress(const Autosave::Progress& progress) {
+  if (!autosave_progress_ || !isolate_)
+    return;
+
+  static constexpr const char* phases[] = {"serializing", "writing", "done",
+                                           "failed"};
+  v8::HandleScope handle_scope(isolate_);
+  v8::MicrotasksScope microtasks_scope(
+      isolate_, v8::MicrotasksScope::kDoNotRunMicrotasks);
+  if (!autosave_progress_->IsAlive())
+    return;
+  v8::Local<v8::Context> context =
+      autosave_progress_->NewHandle(isolate_)->GetCreationContextChecked();
+  v8::Context::Scope context_scope(context);
+
+  gin::Dictionary dict = gin::Dictionary::CreateEmpty(isolate_);
+  dict.Set("phase", phases[static_cast<int>(progress.phase)]);
+  dict.Set("bytesWritten", progress.bytes_written);
+  dict.Set("totalBytes", progress.total_bytes);
+  dict.Set("serializeMs", progress.serialize_time.InMillisecondsF());
+  V8FunctionInvoker<void(v8::Local<v8::Value>)>::Go(
+      isolate_, *autosave_progress_, gin::ConvertToV8(isolate_.get(), dict));
+}
+
 void DocumentClient::SetAuthor(const std::string& author,
                                gin::Arguments* args) {
-  document_holder_->setAuthor(author.c_str());
+  if (PinnedDocument doc = document_holder_.Pin())
+    doc->setAuthor(author.c_str());
 }
 
 void DocumentClient::PostUnoCommand(const std::string& command,
@@ -434,30 +980,109 @@ void DocumentClient::PostUnoCommand(const std::string& command,
 
   args->GetNext(&notifyWhenFinished);
 
+  // commands from JS are edits too, ex: typing through .uno:InsertText
+  last_input_time_ = base::TimeTicks::Now();
   PostUnoCommandInternal(command, std::move(json_buffer), notifyWhenFinished);
 }
 
 void DocumentClient::PostUnoCommandInternal(const std::string& command,
                                             std::unique_ptr<char[]> json_buffer,
                                             bool notifyWhenFinished) {
-  document_holder_->postUnoCommand(command.c_str(), json_buffer.get(),
-                                   notifyWhenFinished);
+  if (PinnedDocument doc = document_holder_.Pin()) {
+    doc->postUnoCommand(command.c_str(), json_buffer.get(),
+                        notifyWhenFinished);
+    return;
+  }
+
+  // the document is reloading, the command runs once it's loaded
+  document_holder_.Post(base::BindOnce(
+      [](const std::string& command, std::unique_ptr<char[]> json_buffer,
+         bool notifyWhenFinished, DocumentHolderWithView holder) {
+        holder->postUnoCommand(command.c_str(), json_buffer.get(),
+                               notifyWhenFinished);
+      },
+      command, std::move(json_buffer), notifyWhenFinished));
 }
 
 void DocumentClient::SetTextSelection(int n_type, int n_x, int n_y) {
-  document_holder_->setTextSelection(n_type, n_x, n_y);
+  if (PinnedDocument doc = document_holder_.Pin())
+    doc->setTextSelection(n_type, n_x, n_y);
 }
 
 namespace {
 
+// the out parameters of getClipboard, the streams are owned until they are
+// adopted by an ArrayBuffer
+struct LokClipboard {
+  size_t count = 0;
+  // these are arrays of count size, variable size arrays in C are simply
+  // pointers to the first element
+  char** mime_types = nullptr;
+  size_t* sizes = nullptr;
+  char** streams = nullptr;
+
+  LokClipboard() = default;
+  // no copy
+  LokClipboard(const LokClipboard&) = delete;
+  LokClipboard& operator=(const LokClipboard&) = delete;
+
+  ~LokClipboard() {
+    // free the clipboard items, can't use std::unique_ptr without a wrapper
+    // class since it needs to be size aware
+    for (size_t i = 0; i < count; ++i) {
+      lok_safe_free(streams[i]);
+      lok_safe_free(mime_types[i]);
+    }
+    // free the clipboard item containers
+    lok_safe_free(sizes);
+    lok_safe_free(streams);
+    lok_safe_free(mime_types);
+  }
+};
+
+constexpr std::string_view text_plain = "text/plain";
+
+std::unique_ptr<LokClipboard> ReadLokClipboard(
+    const DocumentHolderWithView& holder,
+    const std::vector<std::string>& mime_types) {
+  TRACE_EVENT0("electron", "ReadLokClipboard");
+  std::vector<const char*> mime_c_str;
+  for (const std::string& mime_type : mime_types) {
+    // LOK explicitly converts all UTF-16 strings to UTF-8, however it still
+    // requests an encoding
+    if (mime_type == text_plain) {
+      mime_c_str.push_back("text/plain;charset=utf-8");
+      continue;
+    }
+    // c_str() gaurantees that the string is null-terminated, data()
+    // does not, don't use data() or bad things will happen
+    mime_c_str.push_back(mime_type.c_str());
+  }
+
+  // add the nullptr terminator to the list of null-terminated strings
+  mime_c_str.push_back(nullptr);
+
+  auto clipboard = std::make_unique<LokClipboard>();
+  bool success = holder->getClipboard(
+      mime_types.size() ? mime_c_str.data() : nullptr, &clipboard->count,
+      &clipboard->mime_types, &clipboard->sizes, &clipboard->streams);
+  if (!success)
+    clipboard->count = 0;
+
+  return clipboard;
+}
+
 v8::Local<v8::Value> lok_clipboard_to_buffer(v8::Isolate* isolate,
                                              const char* mime_type,
-                                             const char* stream,
+                                             char* stream,
                                              size_t size) {
-  // allocate a new ArrayBuffer and copy the stream to the backing
-  // store
-  v8::Local<v8::ArrayBuffer> buffer = v8::ArrayBuffer::New(isolate, size);
-  std::memcpy(buffer->GetBackingStore()->Data(), stream, size);
+  // the stream is from a dangling malloc, so it's adopted by the backing store
+  // with a free(...) deleter instead of being copied
+  auto backing_store = v8::ArrayBuffer::NewBackingStore(
+      stream, size, [](void* data, size_t, void*) { lok_safe_free(data); },
+      nullptr);
+  v8::Local<v8::ArrayBuffer> buffer =
+      v8::ArrayBuffer::New(isolate, std::move(backing_store));
 
   v8::Local<v8::Name> names[2] = {gin::StringToV8(isolate, "mimeType"),
                                   gin::StringToV8(isolate, "buffer")};
@@ -478,144 +1103,198 @@ v8::Local<v8::Value> lok_clipboard_to_string(v8::Isolate* isolate,
   return v8::Object::New(isolate, v8::Null(isolate), names, values, 2);
 }
 
-}  // namespace
-
-v8::Local<v8::Value> DocumentClient::GetClipboard(gin::Arguments* args) {
-  std::vector<std::string> mime_types;
-  std::vector<const char*> mime_c_str;
-  static constexpr std::string_view text_plain = "text/plain";
-
-  if (args->GetNext(&mime_types)) {
-    for (const std::string& mime_type : mime_types) {
-      // LOK explicitly converts all UTF-16 strings to UTF-8, however it still
-      // requests an encoding
-      if (mime_type == text_plain) {
-        mime_c_str.push_back("text/plain;charset=utf-8");
-        continue;
-      }
-      // c_str() gaurantees that the string is null-terminated, data()
-      // does not, don't use data() or bad things will happen
-      mime_c_str.push_back(mime_type.c_str());
-    }
-
-    // add the nullptr terminator to the list of null-terminated strings
-    mime_c_str.push_back(nullptr);
-  }
-
-  size_t out_count;
-
-  // these are arrays of out_count size, variable size arrays in C are
-  // simply pointers to the first element
-  char** out_mime_types = nullptr;
-  size_t* out_sizes = nullptr;
-  char** out_streams = nullptr;
-
-  bool success = document_holder_->getClipboard(
-      mime_types.size() ? mime_c_str.data() : nullptr, &out_count,
-      &out_mime_types, &out_sizes, &out_streams);
+v8::Local<v8::Value> LokClipboardToV8(v8::Isolate* isolate,
+                                      v8::Local<v8::Context> context,
+                                      LokClipboard* clipboard) {
+  // an array of n=count items, empty if getClipboard failed
+  v8::Local<v8::Array> result = v8::Array::New(isolate, clipboard->count);
 
-  // we'll be refrencing this and the context frequently inside of the
-  // loop
-  v8::Isolate* isolate = args->isolate();
-
-  // return an empty array if we failed
-  if (!success)
-    return v8::Array::New(isolate, 0);
-
-  // an array of n=out_count array buffers
-  v8::Local<v8::Array> result = v8::Array::New(isolate, out_count);
-  // we pull out the context once outside of the array
-  v8::Local<v8::Context> context = args->GetHolderCreationContext();
-
-  for (size_t i = 0; i < out_count; ++i) {
-    size_t buffer_size = out_sizes[i];
+  for (size_t i = 0; i < clipboard->count; ++i) {
+    size_t buffer_size = clipboard->sizes[i];
     if (buffer_size <= 0) {
-      std::ignore = result->Set(context, i, v8::Undefined(isolate_));
+      std::ignore = result->Set(context, i, v8::Undefined(isolate));
       continue;
     }
     static constexpr std::string_view text_prefix = "text/";
-    std::string_view sv_mime_type(out_mime_types[i]);
+    std::string_view sv_mime_type(clipboard->mime_types[i]);
     if (sv_mime_type.substr(0, text_prefix.length()) == text_prefix) {
       if (sv_mime_type.substr(0, text_plain.length()) == text_plain) {
-        std::ignore =
-            result->Set(context, i,
-                        lok_clipboard_to_string(isolate_, text_plain.data(),
-                                                out_streams[i]));
+        std::ignore = result->Set(
+            context, i,
+            lok_clipboard_to_string(isolate, text_plain.data(),
+                                    clipboard->streams[i]));
       } else {
-        std::ignore =
-            result->Set(context, i,
-                        lok_clipboard_to_string(isolate_, out_mime_types[i],
-                                                out_streams[i]));
+        std::ignore = result->Set(
+            context, i,
+            lok_clipboard_to_string(isolate, clipboard->mime_types[i],
+                                    clipboard->streams[i]));
       }
     } else {
-      std::ignore =
-          result->Set(context, i,
-                      lok_clipboard_to_buffer(isolate_, out_mime_types[i],
-                                              out_streams[i], out_sizes[i]));
+      std::ignore = result->Set(
+          context, i,
+          lok_clipboard_to_buffer(isolate, clipboard->mime_types[i],
+                                  clipboard->streams[i], buffer_size));
+      // owned by the ArrayBuffer now
+      clipboard->streams[i] = nullptr;
     }
-
-    // free the clipboard item, can't use std::unique_ptr without a
-    // wrapper class since it needs to be size aware
-    lok_safe_free(out_streams[i]);
-    lok_safe_free(out_mime_types[i]);
   }
-  // free the clipboard item containers
-  lok_safe_free(out_sizes);
-  lok_safe_free(out_streams);
-  lok_safe_free(out_mime_types);
 
   return result;
 }
 
-bool DocumentClient::SetClipboard(
-    std::vector<v8::Local<v8::Object>> clipboard_data,
-    gin::Arguments* args) {
-  // entries in clipboard_data
-  const size_t entries = clipboard_data.size();
+// an item to be written to the clipboard, the backing store keeps the
+// ArrayBuffer's contents alive while it is off of the renderer thread
+struct ClipboardEntry {
+  std::string mime_type;
+  std::shared_ptr<v8::BackingStore> backing_store;
+  size_t size = 0;
+};
 
-  // No entries in clipboard_data
-  if (entries == 0) {
-    return false;
+bool ClipboardEntriesFromV8(v8::Isolate* isolate,
+                            const std::vector<v8::Local<v8::Object>>& items,
+                            std::vector<ClipboardEntry>* entries) {
+  for (const v8::Local<v8::Object>& item : items) {
+    gin::Dictionary dictionary(isolate, item);
+
+    ClipboardEntry entry;
+    v8::Local<v8::ArrayBuffer> buffer;
+    if (!dictionary.Get("mimeType", &entry.mime_type) ||
+        !dictionary.Get("buffer", &buffer)) {
+      return false;
+    }
+
+    entry.size = buffer->ByteLength();
+    entry.backing_store = buffer->GetBackingStore();
+    entries->push_back(std::move(entry));
   }
+  return !entries->empty();
+}
 
+bool WriteLokClipboard(const DocumentHolderWithView& holder,
+                       const std::vector<ClipboardEntry>& entries) {
+  TRACE_EVENT0("electron", "WriteLokClipboard");
+  const size_t count = entries.size();
   std::vector<const char*> mime_c_str;
-  size_t in_sizes[entries];
-  const char* streams[entries];
+  std::vector<size_t> in_sizes;
+  std::vector<const char*> streams;
+  for (const ClipboardEntry& entry : entries) {
+    mime_c_str.push_back(entry.mime_type.c_str());
+    in_sizes.push_back(entry.size);
+    streams.push_back(static_cast<const char*>(entry.backing_store->Data()));
+  }
 
-  v8::Isolate* isolate = args->isolate();
-  for (size_t i = 0; i < entries; ++i) {
-    gin::Dictionary dictionary(isolate, clipboard_data[i]);
+  // add the nullptr terminator to the list of null-terminated strings
+  mime_c_str.push_back(nullptr);
 
-    std::string mime_type;
-    dictionary.Get<std::string>("mimeType", &mime_type);
+  return holder->setClipboard(count, mime_c_str.data(), in_sizes.data(),
+                              streams.data());
+}
 
-    v8::Local<v8::ArrayBuffer> buffer;
-    dictionary.Get<v8::Local<v8::ArrayBuffer>>("buffer", &buffer);
+}  // namespace
 
-    in_sizes[i] = buffer->ByteLength();
-    mime_c_str.push_back(mime_type.c_str());
-    streams[i] = static_cast<char*>(buffer->GetBackingStore()->Data());
-  }
+v8::Local<v8::Value> DocumentClient::GetClipboard(gin::Arguments* args) {
+  std::vector<std::string> mime_types;
+  args->GetNext(&mime_types);
 
-  // add the nullptr terminator to the list of null-terminated strings
-  mime_c_str.push_back(nullptr);
+  std::unique_ptr<LokClipboard> clipboard =
+      ReadLokClipboard(document_holder_, mime_types);
+  return LokClipboardToV8(args->isolate(), args->GetHolderCreationContext(),
+                          clipboard.get());
+}
+
+v8::Local<v8::Promise> DocumentClient::GetClipboardAsync(
+    gin::Arguments* args) {
+  Promise<v8::Value> promise(args->isolate());
+  auto handle = promise.GetHandle();
+
+  std::vector<std::string> mime_types;
+  args->GetNext(&mime_types);
+
+  document_holder_.Post(base::BindOnce(
+      [](Promise<v8::Value> promise, std::vector<std::string> mime_types,
+         base::WeakPtr<OfficeClient> office,
+         DocumentHolderWithView doc_holder) {
+        std::unique_ptr<LokClipboard> clipboard =
+            ReadLokClipboard(doc_holder, mime_types);
+        promise.task_runner()->PostTask(
+            FROM_HERE,
+            base::BindOnce(
+                [](Promise<v8::Value> promise,
+                   std::unique_ptr<LokClipboard> clipboard,
+                   base::WeakPtr<OfficeClient> office) {
+                  if (!office.MaybeValid())
+                    return;
+                  v8::Isolate* isolate = promise.isolate();
+                  v8::HandleScope handle_scope(isolate);
+                  v8::MicrotasksScope microtasks_scope(
+                      isolate, v8::MicrotasksScope::kDoNotRunMicrotasks);
+                  v8::Context::Scope context_scope(promise.GetContext());
+
+                  promise.Resolve(LokClipboardToV8(
+                      isolate, promise.GetContext(), clipboard.get()));
+                },
+                std::move(promise), std::move(clipboard), std::move(office)));
+      },
+      std::move(promise), std::move(mime_types), OfficeClient::GetWeakPtr()));
+
+  return handle;
+}
+
+bool DocumentClient::SetClipboard(
+    std::vector<v8::Local<v8::Object>> clipboard_data,
+    gin::Arguments* args) {
+  std::vector<ClipboardEntry> entries;
+  if (!ClipboardEntriesFromV8(args->isolate(), clipboard_data, &entries))
+    return false;
+
+  return WriteLokClipboard(document_holder_, entries);
+}
+
+v8::Local<v8::Promise> DocumentClient::SetClipboardAsync(
+    std::vector<v8::Local<v8::Object>> clipboard_data,
+    gin::Arguments* args) {
+  v8::Isolate* isolate = args->isolate();
+  std::vector<ClipboardEntry> entries;
+  if (!ClipboardEntriesFromV8(isolate, clipboard_data, &entries))
+    return Promise<bool>::ResolvedPromise(isolate, false);
+
+  Promise<bool> promise(isolate);
+  auto handle = promise.GetHandle();
 
-  return document_holder_->setClipboard(entries, mime_c_str.data(), in_sizes,
-                                        streams);
+  document_holder_.Post(base::BindOnce(
+      [](Promise<bool> promise, std::vector<ClipboardEntry> entries,
+         DocumentHolderWithView doc_holder) {
+        bool success = WriteLokClipboard(doc_holder, entries);
+        // the backing stores are released on the renderer thread, along with
+        // the rest of the ArrayBuffer
+        promise.task_runner()->PostTask(
+            FROM_HERE, base::BindOnce(
+                           [](Promise<bool> promise,
+                              std::vector<ClipboardEntry>, bool success) {
+                             promise.Resolve(success);
+                           },
+                           std::move(promise), std::move(entries), success));
+      },
+      std::move(promise), std::move(entries)));
+
+  return handle;
 }
 
 bool DocumentClient::Paste(const std::string& mime_type,
                            const std::string& data,
                            gin::Arguments* args) {
-  return document_holder_->paste(mime_type.c_str(), data.c_str(), data.size());
+  PinnedDocument doc = document_holder_.Pin();
+  return doc && doc->paste(mime_type.c_str(), data.c_str(), data.size());
 }
 
 void DocumentClient::SetGraphicSelection(int n_type, int n_x, int n_y) {
-  document_holder_->setGraphicSelection(n_type, n_x, n_y);
+  if (PinnedDocument doc = document_holder_.Pin())
+    doc->setGraphicSelection(n_type, n_x, n_y);
 }
 
 void DocumentClient::ResetSelection() {
-  document_holder_->resetSelection();
+  if (PinnedDocument doc = document_holder_.Pin())
+    doc->resetSelection();
 }
 
 v8::Local<v8::Promise> DocumentClient::GetCommandValues(
@@ -661,17 +1340,811 @@ v8::Local<v8::Promise> DocumentClient::GetCommandValues(
   return handle;
 }
 
-v8::Local<v8::Value> DocumentClient::As(const std::string& type,
-                                        v8::Isolate* isolate) {
-  void* component = document_holder_->getXComponent();
-  return convert::As(isolate, component, type);
+namespace {
+// a JSON state change is parsed, otherwise the value after the "=" is a string
+v8::Local<v8::Value> StateValueToV8(v8::Isolate* isolate,
+                                    const std::string& value) {
+  v8::Local<v8::String> string = gin::StringToV8(isolate, value);
+  if (!value.empty() && value.front() == '{')
+    return lok_callback::ParseJSON(isolate, string);
+  return string;
 }
+}  // namespace
 
-v8::Local<v8::Value> DocumentClient::NewView(v8::Isolate* isolate) {
-  auto* new_client = new DocumentClient(document_holder_.NewView());
-  v8::Local<v8::Object> result;
+v8::Local<v8::Value> DocumentClient::GetState(gin::Arguments* args) {
+  v8::Isolate* isolate = args->isolate();
+  std::string command;
+  if (args->GetNext(&command)) {
+    const std::string* value = document_state_.State(command);
+    if (!value)
+      return v8::Undefined(isolate);
+    return StateValueToV8(isolate, *value);
+  }
 
-  if (!new_client->GetWrapper(isolate).ToLocal(&result))
+  gin::Dictionary result = gin::Dictionary::CreateEmpty(isolate);
+  for (const auto& [key, value] : document_state_.states()) {
+    result.Set(key, StateValueToV8(isolate, value));
+  }
+  return gin::ConvertToV8(isolate, result);
+}
+
+v8::Local<v8::Value> DocumentClient::GetComments(v8::Isolate* isolate) {
+  return lok_callback::ParseJSON(
+      isolate, gin::StringToV8(isolate, document_state_.CommentsJSON()));
+}
+
+v8::Local<v8::Value> DocumentClient::GetTrackedChanges(v8::Isolate* isolate) {
+  return lok_callback::ParseJSON(
+      isolate, gin::StringToV8(isolate, document_state_.TrackedChangesJSON()));
+}
+
+namespace {
+// thumbnails wider than this are better served by rendering the document
+constexpr int kMaxThumbnailWidth = 2048;
+
+// `index_key` is the name of the page or part index of the thumbnail
+v8::Local<v8::Value> ThumbnailToV8(v8::Isolate* isolate,
+                                   const Thumbnail& thumbnail,
+                                   const char* index_key = "page") {
+  if (!thumbnail.pixels)
+    return v8::Undefined(isolate);
+
+  // copied, since JS can write to the array and the cache's pixels are
+  // returned to every caller
+  const base::RefCountedBytes* pixels = thumbnail.pixels.get();
+  v8::Local<v8::ArrayBuffer> buffer =
+      v8::ArrayBuffer::New(isolate, pixels->size());
+  memcpy(buffer->GetBackingStore()->Data(), pixels->front(), pixels->size());
+
+  gin::Dictionary dict = gin::Dictionary::CreateEmpty(isolate);
+  dict.Set(index_key, thumbnail.page);
+  dict.Set("width", thumbnail.width);
+  dict.Set("height", thumbnail.height);
+  dict.Set("data", v8::Local<v8::Value>(
+                       v8::Uint8ClampedArray::New(buffer, 0, pixels->size())));
+  return gin::ConvertToV8(isolate, dict);
+}
+
+v8::Local<v8::Value> ThumbnailsToV8(v8::Isolate* isolate,
+                                    const std::vector<Thumbnail>& thumbnails) {
+  v8::Local<v8::Context> context = isolate->GetCurrentContext();
+  v8::Local<v8::Array> result = v8::Array::New(isolate, thumbnails.size());
+  for (size_t i = 0; i < thumbnails.size(); ++i) {
+    std::ignore =
+        result->Set(context, i, ThumbnailToV8(isolate, thumbnails[i]));
+  }
+  return result;
+}
+
+constexpr int kMaxSlideWidth = 4096;
+}  // namespace
+
+v8::Local<v8::Promise> DocumentClient::RenderPages(
+    v8::Isolate* isolate,
+    v8::Local<v8::Object> options) {
+  Promise<v8::Value> promise(isolate);
+  auto handle = promise.GetHandle();
+
+  gin::Dictionary options_dict(isolate, options);
+  int width = 0;
+  if (!options_dict.Get("width", &width) || width <= 0 ||
+      width > kMaxThumbnailWidth) {
+    promise.RejectWithErrorMessage("Invalid thumbnail width");
+    return handle;
+  }
+
+  // page_rects_ is only reported for text documents, the others are
+  // rendered by part and share their cache with renderSlide
+  bool by_part = DocumentType() != LOK_DOCTYPE_TEXT;
+  ThumbnailCache& cache = PageCache();
+  size_t count = PageCount();
+  std::vector<int> pages;
+  if (!options_dict.Get("pages", &pages)) {
+    pages.resize(count);
+    std::iota(pages.begin(), pages.end(), 0);
+  }
+
+  std::vector<Thumbnail> thumbnails(pages.size());
+  std::vector<ThumbnailRequest> requests;
+  for (size_t i = 0; i < pages.size(); ++i) {
+    int page = pages[i];
+    if (page < 0 || static_cast<size_t>(page) >= count)
+      continue;
+    if (const Thumbnail* cached = cache.Get(page, width)) {
+      thumbnails[i] = *cached;
+    } else {
+      requests.push_back({i, page,
+                          by_part ? PartRect(page) : page_rects_[page],
+                          cache.Generation(page)});
+    }
+  }
+
+  if (requests.empty()) {
+    promise.Resolve(ThumbnailsToV8(isolate, thumbnails));
+    return handle;
+  }
+
+  auto complete = base::BindPostTask(
+      base::SequencedTaskRunnerHandle::Get(),
+      base::BindOnce(&DocumentClient::CompleteRenderPages, GetWeakPtr(),
+                     std::move(promise), std::move(thumbnails)));
+  document_holder_.PostBlocking(base::BindOnce(
+      [](int width, bool by_part, std::vector<ThumbnailRequest> requests,
+         base::OnceCallback<void(std::vector<ThumbnailRequest>,
+                                 std::vector<Thumbnail>)> complete,
+         DocumentHolderWithView holder) {
+        std::vector<Thumbnail> rendered;
+        rendered.reserve(requests.size());
+        for (const auto& request : requests) {
+          rendered.emplace_back(
+              by_part ? RenderPart(holder, request.page,
+                                   request.page_rect_twips, width)
+                      : RenderThumbnail(holder, request.page,
+                                        request.page_rect_twips, width));
+        }
+        std::move(complete).Run(std::move(requests), std::move(rendered));
+      },
+      width, by_part, std::move(requests), std::move(complete)));
+
+  return handle;
+}
+
+void DocumentClient::CompleteRenderPages(
+    Promise<v8::Value> promise,
+    std::vector<Thumbnail> thumbnails,
+    std::vector<ThumbnailRequest> requests,
+    std::vector<Thumbnail> rendered) {
+  thumbnails_rendered_ += requests.size();
+  ThumbnailCache& cache = PageCache();
+  for (size_t i = 0; i < requests.size(); ++i) {
+    cache.Put(rendered[i], requests[i].generation);
+    thumbnails[requests[i].index] = std::move(rendered[i]);
+  }
+
+  v8::Isolate* isolate = promise.isolate();
+  v8::HandleScope handle_scope(isolate);
+  v8::MicrotasksScope microtasks_scope(isolate,
+                                       v8::MicrotasksScope::kDoNotRunMicrotasks);
+  v8::Context::Scope context_scope(promise.GetContext());
+  promise.Resolve(ThumbnailsToV8(isolate, thumbnails));
+}
+
+v8::Local<v8::Promise> DocumentClient::ExportPdf(v8::Isolate* isolate,
+                                                 const std::string& path,
+                                                 gin::Arguments* args) {
+  Promise<bool> promise(isolate);
+  auto handle = promise.GetHandle();
+  if (pdf_export_) {
+    promise.RejectWithErrorMessage("A PDF export is already running");
+    return handle;
+  }
+
+  int width = 0;
+  std::vector<int> pages;
+  std::string filter_options;
+  pdf_export_preview_.reset();
+  pdf_export_progress_.reset();
+  v8::Local<v8::Object> options;
+  if (args->GetNext(&options)) {
+    gin::Dictionary options_dict(isolate, options);
+    options_dict.Get("filterOptions", &filter_options);
+    if (options_dict.Get("previewWidth", &width) &&
+        (width < 0 || width > kMaxThumbnailWidth)) {
+      promise.RejectWithErrorMessage("Invalid preview width");
+      return handle;
+    }
+    if (!options_dict.Get("pages", &pages)) {
+      pages.resize(PageCount());
+      std::iota(pages.begin(), pages.end(), 0);
+    }
+
+    v8::Local<v8::Function> callback;
+    if (options_dict.Get("onPreview", &callback))
+      pdf_export_preview_.emplace(isolate, callback);
+    if (options_dict.Get("onProgress", &callback))
+      pdf_export_progress_.emplace(isolate, callback);
+    if (!isolate_)
+      isolate_ = isolate;
+  }
+
+  // the pages that are cached at the width aren't painted again, the rest are
+  // painted right after the PDF is written
+  ThumbnailCache& cache = PageCache();
+  std::vector<uint64_t> generations(PageCount());
+  std::vector<int> preview_pages;
+  std::vector<Thumbnail> cached;
+  if (width > 0) {
+    for (int page : pages) {
+      if (page < 0 || static_cast<size_t>(page) >= generations.size())
+        continue;
+      generations[page] = cache.Generation(page);
+      if (const Thumbnail* thumbnail = cache.Get(page, width)) {
+        cached.push_back(*thumbnail);
+      } else {
+        preview_pages.push_back(page);
+      }
+    }
+  }
+
+  // the other documents are previewed by part, each painted at its own size
+  bool by_part = DocumentType() != LOK_DOCTYPE_TEXT;
+  pdf_export_ = std::make_unique<PdfExport>(
+      std::move(preview_pages),
+      base::BindOnce(
+          &DocumentClient::WritePdf, GetWeakPtr(), path, filter_options,
+          width, by_part ? std::vector<gfx::Rect>() : page_rects_,
+          gfx::Rect(document_width_in_twips_, document_height_in_twips_)),
+      base::BindRepeating(&DocumentClient::HandlePdfPreview, GetWeakPtr(),
+                          std::move(generations)),
+      base::BindRepeating(&DocumentClient::ReportPdfExportProgress,
+                          GetWeakPtr()),
+      base::BindOnce(&DocumentClient::CompletePdfExport, GetWeakPtr(),
+                     std::move(promise)));
+
+  // cached previews are reported first, after this returns
+  pdf_export_->AddCachedPreviews(std::move(cached));
+  pdf_export_->Start();
+
+  return handle;
+}
+
+ThumbnailCache& DocumentClient::PageCache() {
+  // the other documents are previewed by part, which is a page of the PDF of
+  // a presentation or drawing and a sheet of a spreadsheet
+  return DocumentType() == LOK_DOCTYPE_TEXT
+             ? thumbnail_cache_
+             : slide_cache_;
+}
+
+size_t DocumentClient::PageCount() {
+  return DocumentType() == LOK_DOCTYPE_TEXT
+             ? page_rects_.size()
+             : static_cast<size_t>(GetNumberOfPages());
+}
+
+gfx::Rect DocumentClient::PartRect(int part) const {
+  return static_cast<size_t>(part) < page_rects_.size()
+             ? page_rects_[part]
+             : gfx::Rect(document_width_in_twips_, document_height_in_twips_);
+}
+
+void DocumentClient::WritePdf(
+    const std::string& path,
+    const std::string& filter_options,
+    int width,
+    const std::vector<gfx::Rect>& page_rects,
+    const gfx::Rect& part_rect,
+    std::vector<int> pages,
+    base::OnceCallback<void(bool)> exported,
+    base::RepeatingCallback<void(PagePaint)> painted) {
+  // the previews are painted in the same task so that no other work for the
+  // document is run between the export and the previews
+  document_holder_.PostBlocking(base::BindOnce(
+      [](std::string path, std::string filter_options, int width,
+         std::vector<gfx::Rect> page_rects, gfx::Rect part_rect,
+         std::vector<int> pages, base::OnceCallback<void(bool)> exported,
+         base::RepeatingCallback<void(PagePaint)> painted,
+         DocumentHolderWithView holder) {
+        bool success;
+        {
+          TRACE_EVENT0("electron", "DocumentClient::WritePdf");
+          success = holder->saveAs(
+              path.c_str(), "pdf",
+              filter_options.empty() ? nullptr : filter_options.c_str());
+        }
+        std::move(exported).Run(success);
+        if (!success)
+          return;
+
+        // pages are text document pages if there are page rects, else parts
+        for (int page : pages) {
+          painted.Run(
+              page_rects.empty()
+                  ? PaintPart(holder, page, part_rect, width)
+                  : PaintThumbnail(holder, page, page_rects[page], width));
+        }
+      },
+      path, filter_options, width, page_rects, part_rect, std::move(pages),
+      std::move(exported), std::move(painted)));
+}
+
+void DocumentClient::HandlePdfPreview(const std::vector<uint64_t>& generations,
+                                      const Thumbnail& preview,
+                                      bool cached) {
+  // later renders at the same width don't paint the page again, unless it was
+  // invalidated since the export started
+  ThumbnailCache& cache = PageCache();
+  bool stale = false;
+  if (!cached)
+    ++thumbnails_rendered_;
+  if (!cached && static_cast<size_t>(preview.page) < generations.size()) {
+    stale = generations[preview.page] != cache.Generation(preview.page);
+    cache.Put(preview, generations[preview.page]);
+  }
+
+  if (!pdf_export_preview_ || !isolate_)
+    return;
+  v8::HandleScope handle_scope(isolate_);
+  v8::MicrotasksScope microtasks_scope(
+      isolate_, v8::MicrotasksScope::kDoNotRunMicrotasks);
+  if (!pdf_export_preview_->IsAlive())
+    return;
+  v8::Local<v8::Context> context =
+      pdf_export_preview_->NewHandle(isolate_)->GetCreationContextChecked();
+  v8::Context::Scope context_scope(context);
+  v8::Local<v8::Value> value = ThumbnailToV8(isolate_, preview);
+  // the page was edited during the export, so it may not match the PDF
+  gin::Dictionary(isolate_, value.As<v8::Object>()).Set("stale", stale);
+  V8FunctionInvoker<void(v8::Local<v8::Value>)>::Go(
+      isolate_, *pdf_export_preview_, value);
+}
+
+void DocumentClient::ReportPdfExportProgress(
+    const PdfExport::Progress& progress) {
+  if (!pdf_export_progress_ || !isolate_)
+    return;
+
+  static constexpr const char* phases[] = {"exporting", "previews", "done",
+                                           "failed"};
+  v8::HandleScope handle_scope(isolate_);
+  v8::MicrotasksScope microtasks_scope(
+      isolate_, v8::MicrotasksScope::kDoNotRunMicrotasks);
+  if (!pdf_export_progress_->IsAlive())
+    return;
+  v8::Local<v8::Context> context =
+      pdf_export_progress_->NewHandle(isolate_)->GetCreationContextChecked();
+  v8::Context::Scope context_scope(context);
+
+  gin::Dictionary dict = gin::Dictionary::CreateEmpty(isolate_);
+  dict.Set("phase", phases[static_cast<int>(progress.phase)]);
+  dict.Set("previewsDone", progress.previews_done);
+  dict.Set("previewCount", progress.preview_count);
+  dict.Set("exportMs", progress.export_time.InMillisecondsF());
+  V8FunctionInvoker<void(v8::Local<v8::Value>)>::Go(
+      isolate_, *pdf_export_progress_, gin::ConvertToV8(isolate_.get(), dict));
+}
+
+void DocumentClient::CompletePdfExport(Promise<bool> promise, bool success) {
+  // deleted in a task, since this is called by the export
+  base::SequencedTaskRunnerHandle::Get()->DeleteSoon(FROM_HERE,
+                                                     std::move(pdf_export_));
+  pdf_export_preview_.reset();
+  pdf_export_progress_.reset();
+  promise.Resolve(success);
+}
+
+v8::Local<v8::Promise> DocumentClient::RenderSlide(
+    v8::Isolate* isolate,
+    v8::Local<v8::Object> options) {
+  Promise<v8::Value> promise(isolate);
+  auto handle = promise.GetHandle();
+
+  int doc_type = DocumentType();
+  if (doc_type != LOK_DOCTYPE_PRESENTATION && doc_type != LOK_DOCTYPE_DRAWING) {
+    promise.RejectWithErrorMessage("Not a presentation or drawing");
+    return handle;
+  }
+
+  gin::Dictionary options_dict(isolate, options);
+  int part = -1;
+  int width = 0;
+  bool prerender = true;
+  int parts = GetNumberOfPages();
+  if (!options_dict.Get("part", &part) || part < 0 || part >= parts) {
+    promise.RejectWithErrorMessage("Invalid part");
+    return handle;
+  }
+  if (!options_dict.Get("width", &width) || width <= 0 ||
+      width > kMaxSlideWidth) {
+    promise.RejectWithErrorMessage("Invalid slide width");
+    return handle;
+  }
+  options_dict.Get("prerender", &prerender);
+
+  if (const Thumbnail* cached = slide_cache_.Get(part, width)) {
+    promise.Resolve(ThumbnailToV8(isolate, *cached, "part"));
+  } else {
+    RenderSlideInBackground(part, width, std::move(promise));
+  }
+
+  // queued after the requested slide, so they don't delay it
+  if (prerender) {
+    for (int neighbor : {part + 1, part - 1}) {
+      if (neighbor >= 0 && neighbor < parts &&
+          !slide_cache_.Get(neighbor, width)) {
+        RenderSlideInBackground(neighbor, width, absl::nullopt);
+      }
+    }
+  }
+
+  return handle;
+}
+
+void DocumentClient::RenderSlideInBackground(
+    int part,
+    int width,
+    absl::optional<Promise<v8::Value>> promise) {
+  // a prerender is already queued, the promise can wait for the next one
+  if (!slides_rendering_.emplace(part, width).second && !promise)
+    return;
+
+  auto complete = base::BindPostTask(
+      base::SequencedTaskRunnerHandle::Get(),
+      base::BindOnce(&DocumentClient::CompleteRenderSlide, GetWeakPtr(),
+                     std::move(promise), part, width,
+                     slide_cache_.Generation(part)));
+  gfx::Rect part_rect = PartRect(part);
+  document_holder_.PostBlocking(base::BindOnce(
+      [](int part, gfx::Rect part_rect, int width,
+         base::OnceCallback<void(Thumbnail)> complete,
+         DocumentHolderWithView holder) {
+        std::move(complete).Run(RenderPart(holder, part, part_rect, width));
+      },
+      part, part_rect, width, std::move(complete)));
+}
+
+void DocumentClient::CompleteRenderSlide(
+    absl::optional<Promise<v8::Value>> promise,
+    int part,
+    int width,
+    uint64_t generation,
+    Thumbnail slide) {
+  slides_rendering_.erase({part, width});
+  ++thumbnails_rendered_;
+  slide_cache_.Put(slide, generation);
+  if (!promise)
+    return;
+
+  v8::Isolate* isolate = promise->isolate();
+  v8::HandleScope handle_scope(isolate);
+  v8::MicrotasksScope microtasks_scope(isolate,
+                                       v8::MicrotasksScope::kDoNotRunMicrotasks);
+  v8::Context::Scope context_scope(promise->GetContext());
+  if (!slide.pixels) {
+    promise->RejectWithErrorMessage("Unable to render slide");
+    return;
+  }
+  promise->Resolve(ThumbnailToV8(isolate, slide, "part"));
+}
+
+v8::Local<v8::Value> DocumentClient::As(const std::string& type,
+                                        v8::Isolate* isolate) {
+  PinnedDocument doc = document_holder_.Pin();
+  if (!doc)
+    return v8::Undefined(isolate);
+  return convert::As(isolate, doc->getXComponent(), type);
+}
+
+namespace {
+// moves `container` into the backing store of an ArrayBuffer, instead of
+// copying it
+template <typename Container>
+v8::Local<v8::ArrayBuffer> AdoptAsArrayBuffer(v8::Isolate* isolate,
+                                              Container&& container) {
+  size_t byte_length =
+      container.size() * sizeof(typename Container::value_type);
+  if (byte_length == 0)
+    return v8::ArrayBuffer::New(isolate, 0);
+
+  auto* owned = new Container(std::move(container));
+  auto backing_store = v8::ArrayBuffer::NewBackingStore(
+      owned->data(), byte_length,
+      [](void*, size_t, void* owner) { delete static_cast<Container*>(owner); },
+      owned);
+  return v8::ArrayBuffer::New(isolate, std::move(backing_store));
+}
+
+v8::Local<v8::Value> DataArrayToV8(v8::Isolate* isolate, DataArray data) {
+  const size_t rows = data.rows;
+  const size_t columns = data.columns;
+  const size_t text_offsets_length = data.text_offsets.size();
+
+  // each column is a view of the same buffer
+  v8::Local<v8::ArrayBuffer> numbers_buffer =
+      AdoptAsArrayBuffer(isolate, std::move(data.numbers));
+  std::vector<v8::Local<v8::Value>> numbers;
+  for (size_t column = 0; column < columns; ++column) {
+    numbers.push_back(v8::Float64Array::New(
+        numbers_buffer, column * rows * sizeof(double), rows));
+  }
+
+  v8::Local<v8::ArrayBuffer> kinds_buffer =
+      AdoptAsArrayBuffer(isolate, std::move(data.kinds));
+  v8::Local<v8::ArrayBuffer> text_buffer =
+      AdoptAsArrayBuffer(isolate, std::move(data.text));
+  v8::Local<v8::ArrayBuffer> text_offsets_buffer =
+      AdoptAsArrayBuffer(isolate, std::move(data.text_offsets));
+
+  gin::Dictionary dict = gin::Dictionary::CreateEmpty(isolate);
+  dict.Set("rows", static_cast<uint32_t>(rows));
+  dict.Set("columns", static_cast<uint32_t>(columns));
+  dict.Set("numbers", numbers);
+  dict.Set("kinds", v8::Local<v8::Value>(v8::Uint8Array::New(
+                        kinds_buffer, 0, kinds_buffer->ByteLength())));
+  dict.Set("text", v8::Local<v8::Value>(v8::Uint8Array::New(
+                       text_buffer, 0, text_buffer->ByteLength())));
+  dict.Set("textOffsets", v8::Local<v8::Value>(v8::Uint32Array::New(
+                              text_offsets_buffer, 0, text_offsets_length)));
+  return gin::ConvertToV8(isolate, dict);
+}
+
+// `values` is an array of columns, each either a Float64Array or an array of
+// numbers, strings and empty values
+bool DataArrayFromV8(v8::Isolate* isolate,
+                     v8::Local<v8::Array> values,
+                     DataArray* out,
+                     std::string* error) {
+  v8::Local<v8::Context> context = isolate->GetCurrentContext();
+  const size_t columns = values->Length();
+  size_t rows = 0;
+  std::vector<v8::Local<v8::Value>> column_values;
+  for (size_t column = 0; column < columns; ++column) {
+    v8::Local<v8::Value> value;
+    if (!values->Get(context, column).ToLocal(&value)) {
+      *error = "invalid column";
+      return false;
+    }
+
+    size_t length;
+    if (value->IsFloat64Array()) {
+      length = value.As<v8::Float64Array>()->Length();
+    } else if (value->IsArray()) {
+      length = value.As<v8::Array>()->Length();
+    } else {
+      *error = "columns must be arrays or Float64Arrays";
+      return false;
+    }
+    if (column > 0 && length != rows) {
+      *error = "columns must be the same length";
+      return false;
+    }
+    rows = length;
+    column_values.push_back(value);
+  }
+
+  DataArray result(rows, columns);
+  using Kind = DataArray::Kind;
+  for (size_t column = 0; column < columns; ++column) {
+    v8::Local<v8::Value> column_value = column_values[column];
+    if (column_value->IsFloat64Array()) {
+      v8::Local<v8::Float64Array> typed = column_value.As<v8::Float64Array>();
+      double* column_numbers = &result.numbers[result.Index(0, column)];
+      typed->CopyContents(column_numbers, rows * sizeof(double));
+      for (size_t row = 0; row < rows; ++row) {
+        size_t index = result.Index(row, column);
+        // NaN clears the cell, the same as it reads
+        if (!std::isnan(result.numbers[index]))
+          result.kinds[index] = static_cast<uint8_t>(Kind::kNumber);
+        result.text_offsets[index + 1] = result.text.size();
+      }
+      continue;
+    }
+
+    v8::Local<v8::Array> array = column_value.As<v8::Array>();
+    for (size_t row = 0; row < rows; ++row) {
+      size_t index = result.Index(row, column);
+      v8::Local<v8::Value> value;
+      if (array->Get(context, row).ToLocal(&value)) {
+        if (value->IsNumber()) {
+          result.numbers[index] = value.As<v8::Number>()->Value();
+          result.kinds[index] = static_cast<uint8_t>(Kind::kNumber);
+        } else if (value->IsString()) {
+          std::string str;
+          gin::ConvertFromV8(isolate, value, &str);
+          result.text.append(str);
+          result.kinds[index] = static_cast<uint8_t>(Kind::kString);
+        }
+      }
+      result.text_offsets[index + 1] = result.text.size();
+    }
+  }
+
+  if (result.text.size() > std::numeric_limits<uint32_t>::max()) {
+    *error = "range text is too large";
+    return false;
+  }
+
+  *out = std::move(result);
+  return true;
+}
+
+bool DataRangeFromV8(v8::Isolate* isolate,
+                     v8::Local<v8::Object> options,
+                     DataRange* out) {
+  gin::Dictionary options_dict(isolate, options);
+  if (!options_dict.Get("range", &out->range) || out->range.empty())
+    return false;
+
+  v8::Local<v8::Value> sheet;
+  if (options_dict.Get("sheet", &sheet)) {
+    if (sheet->IsString()) {
+      gin::ConvertFromV8(isolate, sheet, &out->sheet_name);
+    } else if (sheet->IsNumber()) {
+      out->sheet_index = sheet.As<v8::Number>()->Value();
+    }
+  }
+  return true;
+}
+v8::Local<v8::Value> SearchResultToV8(v8::Isolate* isolate,
+                                      SearchResult result) {
+  size_t rects_length = result.rects.size();
+  size_t pages_length = result.pages.size();
+  size_t page_offsets_length = result.page_offsets.size();
+
+  gin::Dictionary dict = gin::Dictionary::CreateEmpty(isolate);
+  dict.Set("count", static_cast<uint32_t>(result.count));
+  dict.Set("rects", v8::Local<v8::Value>(v8::Int32Array::New(
+                        AdoptAsArrayBuffer(isolate, std::move(result.rects)),
+                        0, rects_length)));
+  dict.Set("pages", v8::Local<v8::Value>(v8::Uint32Array::New(
+                        AdoptAsArrayBuffer(isolate, std::move(result.pages)),
+                        0, pages_length)));
+  dict.Set("pageOffsets",
+           v8::Local<v8::Value>(v8::Uint32Array::New(
+               AdoptAsArrayBuffer(isolate, std::move(result.page_offsets)), 0,
+               page_offsets_length)));
+  return gin::ConvertToV8(isolate, dict);
+}
+}  // namespace
+
+v8::Local<v8::Promise> DocumentClient::GetDataArray(
+    v8::Isolate* isolate,
+    v8::Local<v8::Object> options) {
+  Promise<v8::Value> promise(isolate);
+  auto handle = promise.GetHandle();
+
+  DataRange range;
+  if (!DataRangeFromV8(isolate, options, &range)) {
+    promise.RejectWithErrorMessage("Invalid range");
+    return handle;
+  }
+
+  document_holder_.Post(base::BindOnce(
+      [](Promise<v8::Value> promise, DataRange range,
+         base::WeakPtr<OfficeClient> office,
+         DocumentHolderWithView doc_holder) {
+        DataArray data;
+        std::string error;
+        if (!ReadDataArray(doc_holder->getXComponent(), range, &data,
+                           &error)) {
+          Promise<v8::Value>::RejectPromise(std::move(promise), error);
+          return;
+        }
+
+        promise.task_runner()->PostTask(
+            FROM_HERE,
+            base::BindOnce(
+                [](Promise<v8::Value> promise, DataArray data,
+                   base::WeakPtr<OfficeClient> office) {
+                  if (!office.MaybeValid())
+                    return;
+                  v8::Isolate* isolate = promise.isolate();
+                  v8::HandleScope handle_scope(isolate);
+                  v8::MicrotasksScope microtasks_scope(
+                      isolate, v8::MicrotasksScope::kDoNotRunMicrotasks);
+                  v8::Context::Scope context_scope(promise.GetContext());
+
+                  promise.Resolve(DataArrayToV8(isolate, std::move(data)));
+                },
+                std::move(promise), std::move(data), std::move(office)));
+      },
+      std::move(promise), std::move(range), OfficeClient::GetWeakPtr()));
+
+  return handle;
+}
+
+v8::Local<v8::Promise> DocumentClient::SetDataArray(
+    v8::Isolate* isolate,
+    v8::Local<v8::Object> options) {
+  Promise<void> promise(isolate);
+  auto handle = promise.GetHandle();
+
+  DataRange range;
+  if (!DataRangeFromV8(isolate, options, &range)) {
+    promise.RejectWithErrorMessage("Invalid range");
+    return handle;
+  }
+
+  gin::Dictionary options_dict(isolate, options);
+  v8::Local<v8::Array> values;
+  DataArray data;
+  std::string error;
+  if (!options_dict.Get("values", &values)) {
+    promise.RejectWithErrorMessage("Invalid values");
+    return handle;
+  }
+  if (!DataArrayFromV8(isolate, values, &data, &error)) {
+    promise.RejectWithErrorMessage(error);
+    return handle;
+  }
+
+  document_holder_.Post(base::BindOnce(
+      [](Promise<void> promise, DataRange range, DataArray data,
+         DocumentHolderWithView doc_holder) {
+        std::string error;
+        if (!WriteDataArray(doc_holder->getXComponent(), range, data,
+                            &error)) {
+          Promise<void>::RejectPromise(std::move(promise), error);
+          return;
+        }
+        Promise<void>::ResolvePromise(std::move(promise));
+      },
+      std::move(promise), std::move(range), std::move(data)));
+
+  return handle;
+}
+
+v8::Local<v8::Promise> DocumentClient::FindAll(const std::u16string& query,
+                                               gin::Arguments* args) {
+  v8::Isolate* isolate = args->isolate();
+  Promise<v8::Value> promise(isolate);
+  auto handle = promise.GetHandle();
+
+  SearchOptions options;
+  v8::Local<v8::Object> options_object;
+  if (args->GetNext(&options_object)) {
+    gin::Dictionary options_dict(isolate, options_object);
+    options_dict.Get("matchCase", &options.match_case);
+    options_dict.Get("wholeWords", &options.whole_words);
+    uint32_t max_matches;
+    if (options_dict.Get("maxMatches", &max_matches))
+      options.max_matches = max_matches;
+  }
+
+  document_holder_.PostBlocking(base::BindOnce(
+      [](Promise<v8::Value> promise, scoped_refptr<TextSearch> text_search,
+         std::u16string query, SearchOptions options,
+         std::vector<gfx::Rect> page_rects, base::WeakPtr<OfficeClient> office,
+         DocumentHolderWithView doc_holder) {
+        SearchResult result;
+        std::string error;
+        PinnedDocument pinned = doc_holder.Pin();
+        if (!pinned) {
+          Promise<v8::Value>::RejectPromise(std::move(promise),
+                                            "document failed to reload");
+          return;
+        }
+        if (!text_search->Search(pinned.get(), query, options, page_rects,
+                                 &result, &error)) {
+          Promise<v8::Value>::RejectPromise(std::move(promise), error);
+          return;
+        }
+
+        promise.task_runner()->PostTask(
+            FROM_HERE,
+            base::BindOnce(
+                [](Promise<v8::Value> promise, SearchResult result,
+                   base::WeakPtr<OfficeClient> office) {
+                  if (!office.MaybeValid())
+                    return;
+                  v8::Isolate* isolate = promise.isolate();
+                  v8::HandleScope handle_scope(isolate);
+                  v8::MicrotasksScope microtasks_scope(
+                      isolate, v8::MicrotasksScope::kDoNotRunMicrotasks);
+                  v8::Context::Scope context_scope(promise.GetContext());
+
+                  promise.Resolve(SearchResultToV8(isolate, std::move(result)));
+                },
+                std::move(promise), std::move(result), std::move(office)));
+      },
+      std::move(promise), text_search_, query, options, page_rects_,
+      OfficeClient::GetWeakPtr()));
+
+  return handle;
+}
+
+v8::Local<v8::Value> DocumentClient::NewView(v8::Isolate* isolate) {
+  // a view can't be made without waiting on the reload, which this starts
+  if (!document_holder_.Pin()) {
+    isolate->ThrowError(gin::StringToV8(
+        isolate, "The document is reloading from hibernation, try again"));
+    return v8::Undefined(isolate);
+  }
+
+  auto* new_client = new DocumentClient(document_holder_.NewView());
+  v8::Local<v8::Object> result;
+
+  if (!new_client->GetWrapper(isolate).ToLocal(&result))
     return v8::Undefined(isolate);
 
   return result;
@@ -711,12 +2184,150 @@ void DocumentClient::ForwardEmit(int type, const std::string& payload) {
   if (itr == event_listeners_.end())
     return;
   DCHECK(isolate_);
-  for (auto& callback : itr->second) {
+
+  std::vector<SafeV8Function> immediate;
+  for (auto& listener : itr->second) {
+    if (!listener.filter().Matches(type, payload))
+      continue;
+    if (listener.batched()) {
+      listener.Queue(payload);
+      if (!event_batch_timer_.IsRunning()) {
+        event_batch_timer_.Start(
+            FROM_HERE, kEventFlushFallback,
+            base::BindOnce(&DocumentClient::FlushBatchedEvents,
+                           base::Unretained(this)));
+      }
+    } else {
+      immediate.push_back(listener.callback());
+    }
+  }
+
+  for (auto& callback : immediate) {
     V8FunctionInvoker<void(EventPayload)>::Go(isolate_, callback,
                                               {type, payload});
   }
 }
 
+void DocumentClient::FlushBatchedEvents() {
+  TRACE_EVENT0("electron", "DocumentClient::FlushBatchedEvents");
+  DCHECK(isolate_);
+
+  // taken before calling into JS, since a listener may call on or off
+  std::vector<std::tuple<int, SafeV8Function, std::vector<std::string>>>
+      batches;
+  for (auto& [type, listeners] : event_listeners_) {
+    for (auto& listener : listeners) {
+      if (listener.HasPending()) {
+        batches.emplace_back(type, listener.callback(),
+                             listener.TakePending());
+      }
+    }
+  }
+
+  v8::HandleScope handle_scope(isolate_);
+  v8::MicrotasksScope microtasks_scope(
+      isolate_, v8::MicrotasksScope::kDoNotRunMicrotasks);
+  for (auto& [type, callback, payloads] : batches) {
+    if (!callback.IsAlive())
+      continue;
+    v8::Local<v8::Context> context =
+        callback.NewHandle(isolate_)->GetCreationContextChecked();
+    v8::Context::Scope context_scope(context);
+
+    v8::Local<v8::Array> batch = v8::Array::New(isolate_, payloads.size());
+    for (size_t i = 0; i < payloads.size(); ++i) {
+      gin::Dictionary event = gin::Dictionary::CreateEmpty(isolate_);
+      event.Set("payload", lok_callback::TypedPayloadToLocalValue(
+                               isolate_, type, payloads[i]));
+      std::ignore =
+          batch->Set(context, i, gin::ConvertToV8(isolate_.get(), event));
+    }
+    V8FunctionInvoker<void(v8::Local<v8::Value>)>::Go(isolate_, callback,
+                                                      batch);
+  }
+}
+
+void DocumentClient::OnFrame() {
+  if (frame_flush_posted_ ||
+      (!event_batch_timer_.IsRunning() && !state_diff_timer_.IsRunning())) {
+    return;
+  }
+
+  // JS can't run during the frame's lifecycle update
+  frame_flush_posted_ = true;
+  base::SequencedTaskRunnerHandle::Get()->PostTask(
+      FROM_HERE,
+      base::BindOnce(&DocumentClient::FlushAfterFrame, GetWeakPtr()));
+}
+
+void DocumentClient::FlushAfterFrame() {
+  frame_flush_posted_ = false;
+  // first, since a diff can be queued for batched listeners
+  if (state_diff_timer_.IsRunning()) {
+    state_diff_timer_.Stop();
+    FlushStateDiff();
+  }
+  if (event_batch_timer_.IsRunning()) {
+    event_batch_timer_.Stop();
+    FlushBatchedEvents();
+  }
+}
+
+void DocumentClient::ScheduleStateDiff() {
+  // without a listener, changes wait for the first diff after one is added
+  if (state_diff_timer_.IsRunning() ||
+      event_listeners_.find(lok_callback::kStateDiffEvent) ==
+          event_listeners_.end()) {
+    return;
+  }
+  state_diff_timer_.Start(FROM_HERE, kEventFlushFallback,
+                          base::BindOnce(&DocumentClient::FlushStateDiff,
+                                         base::Unretained(this)));
+}
+
+void DocumentClient::FlushStateDiff() {
+  TRACE_EVENT0("electron", "DocumentClient::FlushStateDiff");
+  if (!document_state_.HasChanges())
+    return;
+  ForwardEmit(lok_callback::kStateDiffEvent, document_state_.TakeChanges());
+}
+
+void DocumentClient::SeedDocumentState() {
+  seeding_document_state_ = true;
+  auto complete = base::BindPostTask(
+      base::SequencedTaskRunnerHandle::Get(),
+      base::BindOnce(&DocumentClient::CompleteSeedDocumentState,
+                     GetWeakPtr()));
+  document_holder_.Post(base::BindOnce(
+      [](base::OnceCallback<void(uint64_t, std::string, std::string)> complete,
+         DocumentHolderWithView holder) {
+        TRACE_EVENT0("electron", "SeedDocumentState");
+        LokStrPtr comments(holder->getCommandValues(".uno:ViewAnnotations"));
+        LokStrPtr tracked_changes(
+            holder->getCommandValues(".uno:AcceptTrackedChanges"));
+        // read after the calls, which reload the document if it was unloaded
+        std::move(complete).Run(
+            holder.holder()->reload_count(),
+            comments ? std::string(comments.get()) : std::string(),
+            tracked_changes ? std::string(tracked_changes.get())
+                            : std::string());
+      },
+      std::move(complete)));
+}
+
+void DocumentClient::CompleteSeedDocumentState(uint64_t reload_count,
+                                               std::string comments,
+                                               std::string tracked_changes) {
+  seeding_document_state_ = false;
+  seeded_reload_count_ = reload_count;
+  // callbacks that arrived first are either part of the result or are
+  // reported again by it as changed
+  document_state_.ResetComments(comments);
+  document_state_.ResetTrackedChanges(tracked_changes);
+  if (document_state_.HasChanges())
+    ScheduleStateDiff();
+}
+
 v8::Local<v8::Promise> DocumentClient::SaveAs(v8::Isolate* isolate,
                                               gin::Arguments* args) {
   v8::Local<v8::Value> arguments;
@@ -774,13 +2385,20 @@ v8::Local<v8::Promise> DocumentClient::InitializeForRendering(
 						"value": "Macro User"
 					}
 				})";
-        holder->initializeForRendering(options);
+        holder.InitializeForRendering(options);
       },
       OfficeClient::GetWeakPtr()));
   return {};
 }
 
 void DocumentClient::DocumentCallback(int type, std::string payload) {
+  // the document was reloaded after hibernating, its comment and tracked
+  // change ids are LOK's new ones
+  if (!seeding_document_state_ && document_holder_ &&
+      document_holder_.holder()->reload_count() != seeded_reload_count_) {
+    SeedDocumentState();
+  }
+
   switch (static_cast<LibreOfficeKitCallbackType>(type)) {
       // internal monitors
     case LOK_CALLBACK_DOCUMENT_SIZE_CHANGED:
@@ -788,13 +2406,32 @@ void DocumentClient::DocumentCallback(int type, std::string payload) {
       ForwardEmit(type, payload);
       break;
     case LOK_CALLBACK_INVALIDATE_TILES:
-      HandleInvalidate();
+      HandleInvalidate(payload);
       ForwardEmit(type, payload);
       break;
     case LOK_CALLBACK_STATE_CHANGED:
       HandleStateChange(payload);
       ForwardEmit(type, payload);
       break;
+    case LOK_CALLBACK_SET_PART: {
+      // the payload is the part the view switched to
+      int part;
+      if (base::StringToInt(payload, &part))
+        current_part_ = part;
+      ForwardEmit(type, payload);
+      break;
+    }
+    case LOK_CALLBACK_COMMENT:
+      if (document_state_.UpdateComment(payload))
+        ScheduleStateDiff();
+      ForwardEmit(type, payload);
+      break;
+    case LOK_CALLBACK_REDLINE_TABLE_SIZE_CHANGED:
+    case LOK_CALLBACK_REDLINE_TABLE_ENTRY_MODIFIED:
+      if (document_state_.UpdateTrackedChange(payload))
+        ScheduleStateDiff();
+      ForwardEmit(type, payload);
+      break;
     default:
       ForwardEmit(type, payload);
       break;
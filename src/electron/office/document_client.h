@@ -4,21 +4,36 @@
 
 #pragma once
 
+#include <set>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 
 #include "base/atomic_ref_count.h"
 #include "base/memory/weak_ptr.h"
+#include "base/observer_list.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
 #include "base/token.h"
+#include "base/trace_event/memory_dump_provider.h"
 #include "gin/arguments.h"
 #include "gin/converter.h"
 #include "gin/wrappable.h"
+#include "office/autosave.h"
 #include "office/destroyed_observer.h"
 #include "office/document_event_observer.h"
 #include "office/document_holder.h"
+#include "office/document_state.h"
+#include "office/event_listener.h"
+#include "office/memory_budget.h"
+#include "office/pdf_export.h"
+#include "office/promise.h"
 #include "office/renderer_transferable.h"
+#include "office/search_index.h"
+#include "office/thumbnail_cache.h"
 #include "office/v8_callback.h"
+#include "third_party/abseil-cpp/absl/types/optional.h"
 #include "ui/gfx/geometry/rect.h"
 #include "ui/gfx/geometry/size.h"
 #include "v8/include/v8-persistent-handle.h"
@@ -33,7 +48,8 @@ class OfficeClient;
 
 class DocumentClient : public gin::Wrappable<DocumentClient>,
                        public DocumentEventObserver,
-                       public DestroyedObserver {
+                       public DestroyedObserver,
+                       public base::trace_event::MemoryDumpProvider {
  public:
   DocumentClient();
   ~DocumentClient() override;
@@ -51,9 +67,12 @@ class DocumentClient : public gin::Wrappable<DocumentClient>,
   const char* GetTypeName() override;
 
   // v8 EventBus
+  // options.batched delivers the events of a frame as one array,
+  // options.keys only delivers events matching one of the keys
   void On(v8::Isolate* isolate,
           const std::u16string& event_name,
-          v8::Local<v8::Function> listener_callback);
+          v8::Local<v8::Function> listener_callback,
+          gin::Arguments* args);
   void Off(const std::u16string& event_name,
            v8::Local<v8::Function> listener_callback);
   void Emit(v8::Isolate* isolate,
@@ -78,6 +97,11 @@ class DocumentClient : public gin::Wrappable<DocumentClient>,
   v8::Local<v8::Value> GetClipboard(gin::Arguments* args);
   bool SetClipboard(std::vector<v8::Local<v8::Object>> clipboard_data,
                     gin::Arguments* args);
+  // same as GetClipboard and SetClipboard, but on the document's sequence
+  v8::Local<v8::Promise> GetClipboardAsync(gin::Arguments* args);
+  v8::Local<v8::Promise> SetClipboardAsync(
+      std::vector<v8::Local<v8::Object>> clipboard_data,
+      gin::Arguments* args);
   bool Paste(const std::string& mime_type,
              const std::string& data,
              gin::Arguments* args);
@@ -86,6 +110,44 @@ class DocumentClient : public gin::Wrappable<DocumentClient>,
   v8::Local<v8::Promise> GetCommandValues(const std::string& command,
                                           gin::Arguments* args);
   v8::Local<v8::Value> As(const std::string& type, v8::Isolate* isolate);
+  // bulk reads and writes of a spreadsheet range in a single UNO call
+  v8::Local<v8::Promise> GetDataArray(v8::Isolate* isolate,
+                                      v8::Local<v8::Object> options);
+  v8::Local<v8::Promise> SetDataArray(v8::Isolate* isolate,
+                                      v8::Local<v8::Object> options);
+  v8::Local<v8::Promise> RenderPages(v8::Isolate* isolate,
+                                     v8::Local<v8::Object> options);
+  // finds every match of `query` in a text document through a native index,
+  // returning the match rects grouped by page
+  v8::Local<v8::Promise> FindAll(const std::u16string& query,
+                                 gin::Arguments* args);
+  // renders a slide of a presentation or a page of a drawing, the next and
+  // previous parts are rendered in the background
+  v8::Local<v8::Promise> RenderSlide(v8::Isolate* isolate,
+                                     v8::Local<v8::Object> options);
+  void SetHibernation(v8::Isolate* isolate, v8::Local<v8::Object> options);
+  // autosaves the document while it is modified, disabled if options isn't an
+  // object
+  void SetAutosave(v8::Isolate* isolate, v8::Local<v8::Value> options);
+  // exports the document to a PDF at `path` through a PdfExport, previews of
+  // the pages are passed to options.onPreview as they are converted
+  v8::Local<v8::Promise> ExportPdf(v8::Isolate* isolate,
+                                   const std::string& path,
+                                   gin::Arguments* args);
+  // online spelling, started once input has been idle for kSpellcheckIdle and
+  // left on while typing
+  void SetSpellcheck(bool enabled);
+  // synchronous reads of the native DocumentState, with no command the value
+  // of every reported command
+  v8::Local<v8::Value> GetState(gin::Arguments* args);
+  v8::Local<v8::Value> GetComments(v8::Isolate* isolate);
+  v8::Local<v8::Value> GetTrackedChanges(v8::Isolate* isolate);
+  bool IsHibernated() const;
+  // the bytes held by the document and each of its renderers
+  v8::Local<v8::Value> GetMemoryUsage(v8::Isolate* isolate);
+  // reclaims memory whenever the document is over options.maxBytes, disabled
+  // if options isn't an object
+  void SetMemoryBudget(v8::Isolate* isolate, v8::Local<v8::Value> options);
   // }
 
   // DocumentEventObserver
@@ -94,6 +156,10 @@ class DocumentClient : public gin::Wrappable<DocumentClient>,
   // DestroyedObserver
   void OnDestroyed() override;
 
+  // base::trace_event::MemoryDumpProvider
+  bool OnMemoryDump(const base::trace_event::MemoryDumpArgs& args,
+                    base::trace_event::ProcessMemoryDump* pmd) override;
+
   gfx::Size DocumentSizeTwips();
 
   // returns true if this is the first mount for the document
@@ -105,7 +171,47 @@ class DocumentClient : public gin::Wrappable<DocumentClient>,
                                RendererTransferable&& renderer_transferable);
   RendererTransferable GetRestoredRenderer(const base::Token& restore_key);
 
+  // the document has unsaved changes
+  bool IsModified() const;
+  // identifies the document and its state for an exported renderer
+  DocumentStamp Stamp() const;
+
+  // input was sent to the document by a renderer
+  void RecordInput();
+  // a renderer of the document is updating a frame, batched events and state
+  // diffs are delivered once it's done
+  void OnFrame();
+  // spelling is enabled, even if LOK hasn't started it yet
+  bool IsSpellcheckEnabled() const { return spellcheck_enabled_; }
+  // LOK was asked to spell, so invalidations may be squiggles
+  bool IsSpellcheckOnline() const { return spellcheck_online_; }
+  // input is queued for the document, or was sent within kInputSettle and LOK
+  // may still be invalidating for it
+  bool HasPendingInput() const;
+
+  // pages and slides painted by RenderPages, RenderSlide and PDF previews,
+  // cached results aren't counted
+  size_t thumbnails_rendered() const { return thumbnails_rendered_; }
+
+  // Hibernation {
+  // a renderer became visible (active) or was hidden or unmounted (inactive),
+  // the document hibernates after it has no active renderers for
+  // HibernateDelay()
+  void SetRendererActive(bool active);
+  // how long a renderer or the document can be idle before it hibernates
+  base::TimeDelta HibernateDelay() const;
+  // }
+
+  // Memory accounting {
+  // renderers report their memory and give it up when over the budget
+  void AddMemoryReclaimer(MemoryReclaimer* reclaimer);
+  void RemoveMemoryReclaimer(MemoryReclaimer* reclaimer);
+  DocumentMemoryUsage MemoryUsage();
+  // }
+
   int GetNumberOfPages() const;
+  // the LOK_DOCTYPE_*, kept so that it's known while the document is unloaded
+  int DocumentType() const { return document_type_; }
 
   // Editing State {
   bool CanUndo();
@@ -124,15 +230,79 @@ class DocumentClient : public gin::Wrappable<DocumentClient>,
   void HandleStateChange(const std::string& payload);
   void HandleUnoCommandResult(const std::string& payload);
   void HandleDocSizeChanged();
-  void HandleInvalidate();
+  void HandleInvalidate(const std::string& payload);
 
   void RefreshSize();
 
   void EmitReady(v8::Isolate* isolate, v8::Global<v8::Context> context);
   void ForwardEmit(int type, const std::string& payload);
+  void FlushBatchedEvents();
+  void FlushAfterFrame();
+  // emits the changes to document_state_ as a state_diff event
+  void ScheduleStateDiff();
+  void FlushStateDiff();
+  // fills the comment and tracked change tables, which are then kept up to
+  // date by callbacks. seeded again by the first callback after a reload
+  void SeedDocumentState();
+  void CompleteSeedDocumentState(uint64_t reload_count,
+                                 std::string comments,
+                                 std::string tracked_changes);
 
   v8::Local<v8::Promise> InitializeForRendering(v8::Isolate* isolate);
 
+  void Hibernate();
+  // `done` is run with whether the document is unloaded
+  void Unload(DocumentHolder::UnloadStorage storage,
+              base::OnceCallback<void(bool)> done);
+  // applies the steps PlanReclaim chooses for the current usage
+  void EnforceMemoryBudget();
+  void OnBudgetUnloaded(bool unloaded);
+
+  void StartSpellcheckWhenIdle();
+  void SetSpellOnline(bool enabled);
+  void SerializeForAutosave(
+      const std::string& format,
+      base::OnceCallback<void(Autosave::Serialized)> done);
+  void ReportAutosaveProgress(const Autosave::Progress& progress);
+  // the thumbnails of renderPages and PDF previews, text documents have pages
+  // and the others have parts
+  ThumbnailCache& PageCache();
+  size_t PageCount();
+  // the parts of a presentation share the size of the current one, unless LOK
+  // reports the rect of each part; painting falls back to it when the model
+  // has no size for the part
+  gfx::Rect PartRect(int part) const;
+  // `page_rects` is empty if the previews are of parts of `part_rect`
+  void WritePdf(const std::string& path,
+                const std::string& filter_options,
+                int width,
+                const std::vector<gfx::Rect>& page_rects,
+                const gfx::Rect& part_rect,
+                std::vector<int> pages,
+                base::OnceCallback<void(bool)> exported,
+                base::RepeatingCallback<void(PagePaint)> painted);
+  // `generations` are those of the pages when the export started, a `cached`
+  // preview came from the cache
+  void HandlePdfPreview(const std::vector<uint64_t>& generations,
+                        const Thumbnail& preview,
+                        bool cached);
+  void ReportPdfExportProgress(const PdfExport::Progress& progress);
+  void CompletePdfExport(Promise<bool> promise, bool success);
+
+  void CompleteRenderPages(Promise<v8::Value> promise,
+                           std::vector<Thumbnail> thumbnails,
+                           std::vector<ThumbnailRequest> requests,
+                           std::vector<Thumbnail> rendered);
+  // renders `part` into `slide_cache_` and resolves `promise` if it is set
+  void RenderSlideInBackground(int part,
+                               int width,
+                               absl::optional<Promise<v8::Value>> promise);
+  void CompleteRenderSlide(absl::optional<Promise<v8::Value>> promise,
+                           int part,
+                           int width,
+                           uint64_t generation,
+                           Thumbnail slide);
+
   // has a
   DocumentHolderWithView document_holder_;
 
@@ -140,23 +310,86 @@ class DocumentClient : public gin::Wrappable<DocumentClient>,
   long document_width_in_twips_;
 
   std::vector<gfx::Rect> page_rects_;
+  // follows LOK_CALLBACK_SET_PART, so invalidations don't block on LOK
+  int current_part_ = 0;
 
   // holds state changes until the document is mounted
   std::vector<std::string> state_change_buffer_;
 
   bool is_ready_;
+  uint64_t invalidation_count_ = 0;
   std::unordered_map<base::Token, RendererTransferable, base::TokenHash>
       tile_buffers_to_restore_;
   // this doesn't really need to be atomic since all access should remain on the
   // same renderer thread, but it makes the intention of its use clearer
   base::AtomicRefCount mount_counter_;
 
-  std::unordered_map<int, std::vector<SafeV8Function>> event_listeners_;
+  std::unordered_map<int, std::vector<EventListener>> event_listeners_;
+  // batched listeners and state diffs are flushed after the next frame of a
+  // renderer, or after this long when no renderer is producing frames
+  static constexpr base::TimeDelta kEventFlushFallback =
+      base::Milliseconds(50);
+  base::OneShotTimer event_batch_timer_;
+  bool frame_flush_posted_ = false;
   // used to track what has a registered observer
   std::unordered_set<int> event_types_registered_;
 
-  bool can_undo_ = false;
-  bool can_redo_ = false;
+  // every STATE_CHANGED command, comment and tracked change
+  DocumentState document_state_;
+  bool seeding_document_state_ = false;
+  // the DocumentHolder::reload_count() the tables were seeded at
+  uint64_t seeded_reload_count_ = 0;
+  base::OneShotTimer state_diff_timer_;
+
+  static constexpr base::TimeDelta kDefaultHibernateDelay = base::Minutes(1);
+  int active_renderers_ = 0;
+  base::TimeDelta hibernate_delay_ = kDefaultHibernateDelay;
+  // when set, the document is also unloaded from LOK while hibernating
+  absl::optional<DocumentHolder::UnloadStorage> unload_storage_;
+  base::OneShotTimer hibernate_timer_;
+  int document_type_ = -1;
+
+  base::ObserverList<MemoryReclaimer> memory_reclaimers_;
+  absl::optional<size_t> memory_budget_;
+  // usage grows with painting rather than at any one call, so the budget is
+  // checked periodically
+  static constexpr base::TimeDelta kMemoryBudgetInterval = base::Seconds(1);
+  base::RepeatingTimer memory_budget_timer_;
+  // LOK refuses to unload a document with other views, so after it refuses
+  // the budget waits longer each time before it unloads again
+  static constexpr base::TimeDelta kMaxUnloadBackoff = base::Minutes(5);
+  bool budget_unloading_ = false;
+  base::TimeDelta budget_unload_backoff_;
+  base::TimeTicks budget_unload_retry_;
+
+  std::unique_ptr<Autosave> autosave_;
+  absl::optional<SafeV8Function> autosave_progress_;
+
+  // only one export runs at a time
+  std::unique_ptr<PdfExport> pdf_export_;
+  absl::optional<SafeV8Function> pdf_export_preview_;
+  absl::optional<SafeV8Function> pdf_export_progress_;
+
+  base::TimeTicks last_input_time_;
+  // LOK's first spelling pass competes with painting for the document's
+  // thread, so it waits until the user pauses
+  static constexpr base::TimeDelta kSpellcheckIdle = base::Seconds(1);
+  bool spellcheck_enabled_ = false;
+  // .uno:SpellOnline was posted as true
+  bool spellcheck_online_ = false;
+  base::OneShotTimer spellcheck_timer_;
+  static constexpr base::TimeDelta kInputSettle = base::Milliseconds(250);
+
+  // page thumbnails from RenderPages, invalidated per page
+  ThumbnailCache thumbnail_cache_;
+  // the paragraph index used by FindAll, refreshed after edits
+  scoped_refptr<TextSearch> text_search_ = base::MakeRefCounted<TextSearch>();
+
+  // slides from RenderSlide, keyed by part instead of page
+  ThumbnailCache slide_cache_;
+  // the part and width of slides that are being rendered
+  std::set<std::pair<int, int>> slides_rendering_;
+  size_t thumbnails_rendered_ = 0;
 
   raw_ptr<v8::Isolate> isolate_ = nullptr;
 
@@ -4,12 +4,52 @@
 
 #pragma once
 
+#include <atomic>
+#include <string>
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_refptr.h"
 #include "base/observer_list_types.h"
+#include "base/time/time.h"
+#include "base/trace_event/trace_event.h"
 
 namespace electron::office {
+
+// A LOK callback that has been queued for the observers of a document event.
+// Each observer's notification holds a reference, so the callback stays
+// pending until every observer has handled it.
+class PendingDocumentCallback
+    : public base::RefCountedThreadSafe<PendingDocumentCallback> {
+ public:
+  explicit PendingDocumentCallback(std::atomic<int>* pending_count)
+      : pending_count_(pending_count), queued_time_(base::TimeTicks::Now()) {
+    pending_count_->fetch_add(1, std::memory_order_relaxed);
+  }
+
+  base::TimeTicks queued_time() const { return queued_time_; }
+
+ private:
+  friend class base::RefCountedThreadSafe<PendingDocumentCallback>;
+  ~PendingDocumentCallback() {
+    pending_count_->fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  std::atomic<int>* pending_count_;
+  const base::TimeTicks queued_time_;
+};
+
 class DocumentEventObserver : public base::CheckedObserver {
  public:
   virtual void DocumentCallback(int type, std::string payload) = 0;
+
+  // used by OfficeInstance to track the dispatch of queued callbacks
+  void DispatchDocumentCallback(int type,
+                                std::string payload,
+                                scoped_refptr<PendingDocumentCallback> pending) {
+    TRACE_EVENT2("electron", "DocumentEventObserver::DocumentCallback",
+                 "type", type, "queued_ms",
+                 (base::TimeTicks::Now() - pending->queued_time())
+                     .InMillisecondsF());
+    DocumentCallback(type, std::move(payload));
+  }
 };
 }  // namespace electron::office
-
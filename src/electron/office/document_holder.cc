@@ -4,14 +4,22 @@
 #include "office/document_holder.h"
 #include <vector>
 #include "LibreOfficeKit/LibreOfficeKit.hxx"
+#include "LibreOfficeKit/LibreOfficeKitEnums.h"
 #include "base/bind.h"
 #include "base/check.h"
+#include "base/files/file_util.h"
 #include "base/logging.h"
 #include "base/memory/scoped_refptr.h"
+#include "base/process/memory.h"
+#include "base/strings/utf_string_conversions.h"
 #include "base/task/task_traits.h"
 #include "base/task/thread_pool.h"
+#include "base/threading/scoped_blocking_call.h"
 #include "base/threading/sequenced_task_runner_handle.h"
+#include "base/trace_event/trace_event.h"
+#include "office/lok_callback.h"
 #include "office/office_instance.h"
+#include "third_party/zlib/google/compression_utils.h"
 
 namespace electron::office {
 
@@ -20,15 +28,334 @@ DocumentHolder::DocumentHolder(lok::Document* owned_document,
     : base::RefCountedDeleteOnSequence<DocumentHolder>(
           base::SequencedTaskRunnerHandle::Get()),
       path_(path),
-      doc_(owned_document) {}
+      doc_(owned_document),
+      has_document_(owned_document != nullptr),
+      reload_task_runner_(base::ThreadPool::CreateSequencedTaskRunner(
+          {base::TaskPriority::USER_BLOCKING, base::MayBlock()})),
+      reload_done_(&unload_lock_),
+      input_queue_(base::MakeRefCounted<InputQueue>()) {}
+
+DocumentHolder::~DocumentHolder() {
+  if (!blob_path_.empty())
+    base::DeleteFile(blob_path_);
+}
+
+namespace {
+void* UncheckedAlloc(size_t size) {
+  void* ptr;
+  return base::UncheckedMalloc(size, &ptr) ? ptr : nullptr;
+}
+
+// the original filter may not round-trip everything (ex: a .docx or .csv), the
+// native format does
+const char* NativeFormat(int doc_type) {
+  switch (doc_type) {
+    case LOK_DOCTYPE_TEXT:
+      return "odt";
+    case LOK_DOCTYPE_SPREADSHEET:
+      return "ods";
+    case LOK_DOCTYPE_PRESENTATION:
+      return "odp";
+    case LOK_DOCTYPE_DRAWING:
+      return "odg";
+    default:
+      return nullptr;
+  }
+}
+}  // namespace
+
+std::string DocumentHolder::SaveCompressed(int view_id) {
+  char* output = nullptr;
+  doc_->setView(view_id);
+  size_t size = doc_->saveToMemory(&output, UncheckedAlloc,
+                                   NativeFormat(doc_->getDocumentType()));
+  if (!output || size == 0) {
+    LOG(ERROR) << "unable to save the document for unloading";
+    return {};
+  }
+
+  std::string compressed;
+  bool compressed_ok = compression::GzipCompress(
+      base::span<const uint8_t>(reinterpret_cast<uint8_t*>(output), size),
+      &compressed);
+  base::UncheckedFree(output);
+  if (!compressed_ok)
+    return {};
+  return compressed;
+}
+
+bool DocumentHolder::Unload(UnloadStorage storage, bool modified) {
+  TRACE_EVENT0("electron", "DocumentHolder::Unload");
+  base::ScopedBlockingCall scoped_blocking_call(FROM_HERE,
+                                                base::BlockingType::MAY_BLOCK);
+  int view_id;
+  uint64_t generation;
+  {
+    base::AutoLock lock(unload_lock_);
+    if (unloaded_ || unloading_ || !doc_ || pins_ > 0 ||
+        !run_when_loaded_.empty())
+      return false;
+
+    // other views hold their own state (selection, cursor, etc.) that can't be
+    // restored from the saved document
+    if (doc_->getViewsCount() != 1)
+      return false;
+    doc_->getViewIds(&view_id, 1);
+    unloading_ = true;
+    generation = access_generation_;
+  }
+
+  // saved without the lock, so that calls through the document don't wait on
+  // the save, doc_ is only reset below
+  std::string compressed = SaveCompressed(view_id);
+
+  base::AutoLock lock(unload_lock_);
+  unloading_ = false;
+  if (compressed.empty())
+    return false;
+  // the saved document may be missing a change made while it was saved
+  if (pins_ > 0 || access_generation_ != generation)
+    return false;
+
+  if (storage == UnloadStorage::kDisk) {
+    if ((blob_path_.empty() && !base::CreateTemporaryFile(&blob_path_)) ||
+        !base::WriteFile(blob_path_, compressed)) {
+      LOG(ERROR) << "unable to write the unloaded document to disk";
+      return false;
+    }
+  } else {
+    blob_ = std::move(compressed);
+    blob_bytes_ = blob_.size();
+  }
+
+  // keep the original ID, since it's what every DocumentHolderWithView holds
+  if (original_view_id_ == -1 || view_id != reloaded_view_id_)
+    original_view_id_ = view_id;
+
+  reload_modified_ = modified;
+  reload_failed_ = false;
+  unloaded_ = true;
+  doc_.reset();
+  return true;
+}
+
+bool DocumentHolder::IsUnloaded() const {
+  return unloaded_;
+}
+
+size_t DocumentHolder::UnloadedByteSize() const {
+  return blob_bytes_;
+}
+
+std::string DocumentHolder::ReadBlob() const {
+  // only an unload writes the blob, which can't happen while it's unloaded
+  if (blob_path_.empty())
+    return blob_;
+
+  std::string result;
+  if (!base::ReadFileToString(blob_path_, &result)) {
+    LOG(ERROR) << "unable to read the unloaded document from disk";
+  }
+  return result;
+}
+
+void DocumentHolder::ReleaseBlob() {
+  // the file is reused by the next unload and deleted with the holder
+  blob_.clear();
+  blob_.shrink_to_fit();
+  blob_bytes_ = 0;
+}
+
+lok::Document* DocumentHolder::Pin(int view_id) {
+  base::AutoLock lock(unload_lock_);
+  ++pins_;
+  ++access_generation_;
+  if (unloaded_) {
+    ScheduleReload();
+    // the renderer never waits on a reload, the call is skipped instead
+    if (owning_task_runner()->RunsTasksInCurrentSequence())
+      return nullptr;
+    while (unloaded_ && reload_scheduled_)
+      reload_done_.Wait();
+  }
+  if (doc_ && view_id != -1)
+    doc_->setView(ResolveView(view_id));
+  return doc_.get();
+}
+
+void DocumentHolder::Unpin() {
+  base::AutoLock lock(unload_lock_);
+  DCHECK_GT(pins_, 0);
+  --pins_;
+}
+
+void DocumentHolder::ScheduleReload() {
+  // a failed reload isn't retried, since it would fail the same way
+  if (reload_scheduled_ || reload_failed_)
+    return;
+  reload_scheduled_ = true;
+  reload_task_runner_->PostTask(
+      FROM_HERE,
+      base::BindOnce(&DocumentHolder::Reload, base::WrapRefCounted(this)));
+}
+
+void DocumentHolder::Reload() {
+  TRACE_EVENT0("electron", "DocumentHolder::Reload");
+  base::ScopedBlockingCall scoped_blocking_call(FROM_HERE,
+                                                base::BlockingType::MAY_BLOCK);
+  DCHECK(OfficeInstance::IsValid());
+  std::unique_ptr<lok::Document> doc;
+  std::string data;
+  if (compression::GzipUncompress(ReadBlob(), &data) && !data.empty()) {
+    doc.reset(OfficeInstance::Get()->GetOffice()->loadFromMemory(data.data(),
+                                                                 data.size()));
+  }
+
+  bool loaded = !!doc;
+  {
+    base::AutoLock lock(unload_lock_);
+    reload_scheduled_ = false;
+    if (loaded) {
+      int view_id;
+      if (doc->getViewsCount() == 0) {
+        view_id = doc->createView();
+      } else {
+        doc->getViewIds(&view_id, 1);
+      }
+      reloaded_view_id_ = view_id;
+      doc->setView(view_id);
+      // only one view can be unloaded, so it's the only callback
+      doc->registerCallback(
+          &OfficeInstance::HandleDocumentCallback,
+          new DocumentCallbackContext((size_t)this, original_view_id_,
+                                      OfficeInstance::Get()));
+      if (!rendering_options_.empty())
+        doc->initializeForRendering(rendering_options_.c_str());
+      if (reload_modified_) {
+        doc->postUnoCommand(
+            ".uno:ModifiedStatus",
+            R"({"ModifiedStatus":{"type":"boolean","value":true}})", false);
+      }
+      doc_ = std::move(doc);
+      ReleaseBlob();
+      ++reload_count_;
+      unloaded_ = false;
+    } else {
+      reload_failed_ = true;
+      // the work waiting on the document can't run, input batches are
+      // discarded as their drains are dropped
+      run_when_loaded_.clear();
+    }
+    reload_done_.Broadcast();
+  }
 
-DocumentHolder::~DocumentHolder() = default;
+  if (loaded) {
+    owning_task_runner()->PostTask(
+        FROM_HERE, base::BindOnce(&DocumentHolder::RunLoadedTasks,
+                                  base::WrapRefCounted(this)));
+    return;
+  }
+
+  LOG(ERROR) << "unable to reload the unloaded document";
+  DocumentCallbackContext context((size_t)this, original_view_id_,
+                                  OfficeInstance::Get());
+  OfficeInstance::HandleDocumentCallback(lok_callback::kReloadFailedEvent, "",
+                                         &context);
+}
+
+void DocumentHolder::RunWhenLoaded(base::OnceClosure closure) {
+  {
+    base::AutoLock lock(unload_lock_);
+    // queued behind earlier work so that it still runs in order
+    if (unloaded_ || !run_when_loaded_.empty()) {
+      if (reload_failed_)
+        return;
+      run_when_loaded_.push_back(std::move(closure));
+      if (unloaded_)
+        ScheduleReload();
+      return;
+    }
+    ++pins_;
+  }
+  std::move(closure).Run();
+  Unpin();
+}
+
+void DocumentHolder::RunLoadedTasks() {
+  std::vector<base::OnceClosure> tasks;
+  {
+    base::AutoLock lock(unload_lock_);
+    tasks.swap(run_when_loaded_);
+    ++pins_;
+  }
+  for (base::OnceClosure& task : tasks)
+    std::move(task).Run();
+  Unpin();
+}
+
+namespace {
+bool IsPrintable(char16_t c) {
+  return c >= 0x20 && c != 0x7f;
+}
+}  // namespace
+
+void DocumentHolder::DrainInput(base::ScopedClosureRunner discard_if_dropped) {
+  discard_if_dropped.ReplaceClosure(base::DoNothing());
+  std::vector<InputEvent> events = input_queue_->Take();
+  TRACE_EVENT1("electron", "DocumentHolder::DrainInput", "events",
+               events.size());
+  PinnedDocument doc(this, -1);
+  if (!doc)
+    return;
+
+  for (const InputEvent& event : events) {
+    doc->setView(ResolveView(event.view_id));
+    switch (event.kind) {
+      case InputEvent::Kind::kMouse:
+        doc->postMouseEvent(event.type, event.x, event.y, event.count,
+                             event.buttons, event.modifiers);
+        break;
+      case InputEvent::Kind::kKey:
+        // LOK has no key repeat, so repeated text is inserted at once
+        if (event.type == LOK_KEYEVENT_KEYINPUT && event.repeat > 1 &&
+            IsPrintable(event.text)) {
+          std::string text =
+              base::UTF16ToUTF8(std::u16string(event.repeat, event.text));
+          doc->postWindowExtTextInputEvent(0, LOK_EXT_TEXTINPUT,
+                                           text.c_str());
+          doc->postWindowExtTextInputEvent(0, LOK_EXT_TEXTINPUT_END,
+                                           text.c_str());
+          break;
+        }
+        // navigation and deletion have no batched equivalent
+        for (int i = 0; i < event.repeat; ++i) {
+          doc->postKeyEvent(event.type, event.text, event.key_code);
+        }
+        break;
+    }
+  }
+}
+
+PinnedDocument::PinnedDocument(DocumentHolder* holder, int view_id)
+    : holder_(holder), doc_(holder->Pin(view_id)) {}
+
+PinnedDocument::~PinnedDocument() {
+  holder_->Unpin();
+}
+
+int DocumentHolder::ResolveView(int view_id) const {
+  return view_id == original_view_id_ && reloaded_view_id_ != -1
+             ? reloaded_view_id_.load()
+             : view_id;
+}
 
 // holder constructor
 DocumentHolderWithView::DocumentHolderWithView(
     const scoped_refptr<DocumentHolder>& holder)
     : holder_(holder) {
-  auto& owned_document = holder_->doc_;
+  PinnedDocument owned_document(holder_.get(), -1);
+  // callers check IsUnloaded first
+  CHECK(owned_document);
   int count = owned_document->getViewsCount();
   if (count == 0) {
     view_id_ = owned_document->createView();
@@ -102,25 +429,21 @@ int DocumentHolderWithView::ViewId() const {
 
 void DocumentHolderWithView::SetAsCurrentView() const {
   CHECK(view_id_ > -1);
-  holder_->doc_->setView(view_id_);
+  PinnedDocument pinned(holder_.get(), view_id_);
 }
 
-lok::Document& DocumentHolderWithView::operator*() const {
+PinnedDocument DocumentHolderWithView::operator->() const {
   DCHECK(holder_);
-  SetAsCurrentView();
-
-  return *holder_->doc_;
+  CHECK(view_id_ > -1);
+  return PinnedDocument(holder_.get(), view_id_);
 }
 
-lok::Document* DocumentHolderWithView::operator->() const {
-  DCHECK(holder_);
-
-  SetAsCurrentView();
-  return holder_->doc_.get();
+PinnedDocument DocumentHolderWithView::Pin() const {
+  return operator->();
 }
 
 DocumentHolderWithView::operator bool() const {
-  return holder_ && holder_->doc_;
+  return holder_ && holder_->has_document_;
 }
 
 bool DocumentHolderWithView::operator==(
@@ -139,7 +462,12 @@ DocumentHolderWithView::~DocumentHolderWithView() {
   if (!deregisters_callback_)
     return;
 
-  SetAsCurrentView();
+  // an unloaded document has no callbacks to deregister
+  base::AutoLock lock(holder_->unload_lock_);
+  if (holder_->unloaded_ || !holder_->doc_)
+    return;
+
+  holder_->doc_->setView(holder_->ResolveView(view_id_));
   holder_->doc_->registerCallback(nullptr, nullptr);
 }
 
@@ -154,25 +482,64 @@ const std::string& DocumentHolderWithView::Path() const {
 void DocumentHolderWithView::Post(
     base::OnceCallback<void(DocumentHolderWithView holder)> callback,
     const base::Location& from_here) const {
+  holder_->input_queue_->Seal();
   holder_->owning_task_runner()->PostTask(
-      from_here, base::BindOnce(std::move(callback), *this));
+      from_here,
+      base::BindOnce(&DocumentHolder::RunWhenLoaded, holder_,
+                     base::BindOnce(std::move(callback), *this)));
 }
 
 void DocumentHolderWithView::Post(
     base::RepeatingCallback<void(DocumentHolderWithView holder)> callback,
     const base::Location& from_here) const {
+  holder_->input_queue_->Seal();
   holder_->owning_task_runner()->PostTask(
-      from_here, base::BindOnce(std::move(callback), *this));
+      from_here,
+      base::BindOnce(&DocumentHolder::RunWhenLoaded, holder_,
+                     base::BindOnce(std::move(callback), *this)));
 }
 
 void DocumentHolderWithView::PostBlocking(
     base::OnceCallback<void(DocumentHolderWithView holder)> callback,
     const base::Location& from_here) const {
+  // may wait on the reload of an unloaded document
   base::ThreadPool::PostTask(
-      FROM_HERE, {base::TaskPriority::USER_VISIBLE, base::MayBlock()},
+      FROM_HERE,
+      {base::TaskPriority::USER_VISIBLE, base::MayBlock(),
+       base::WithBaseSyncPrimitives()},
       base::BindOnce(std::move(callback), *this));
 }
 
+void DocumentHolderWithView::InitializeForRendering(
+    const std::string& options) const {
+  {
+    base::AutoLock lock(holder_->unload_lock_);
+    holder_->rendering_options_ = options;
+  }
+  // otherwise applied by the reload
+  if (PinnedDocument doc = Pin())
+    doc->initializeForRendering(options.c_str());
+}
+
+void DocumentHolderWithView::PostInput(InputEvent event) const {
+  event.view_id = view_id_;
+  if (!holder_->input_queue_->Push(std::move(event)))
+    return;
+
+  holder_->owning_task_runner()->PostTask(
+      FROM_HERE,
+      base::BindOnce(
+          &DocumentHolder::RunWhenLoaded, holder_,
+          base::BindOnce(&DocumentHolder::DrainInput, holder_,
+                         base::ScopedClosureRunner(base::BindOnce(
+                             base::IgnoreResult(&InputQueue::Take),
+                             holder_->input_queue_)))));
+}
+
+bool DocumentHolderWithView::HasPendingInput() const {
+  return holder_ && holder_->input_queue_->HasPending();
+}
+
 void DocumentHolderWithView::AddDocumentObserver(
     int event_id,
     DocumentEventObserver* observer) {
@@ -200,7 +567,8 @@ void DocumentHolderWithView::RemoveDocumentObservers() {
 }
 
 size_t DocumentHolderWithView::PtrToId() {
-  return holder_ ? (size_t)holder_->doc_.get() : 0;
+  // the holder outlives an unload of the document, so it's a stable ID
+  return (size_t)holder_.get();
 }
 
 }  // namespace electron::office
@@ -4,12 +4,22 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <string>
+#include <vector>
 #include "base/callback_forward.h"
+#include "base/callback_helpers.h"
+#include "base/files/file_path.h"
 #include "base/memory/ref_counted_delete_on_sequence.h"
 #include "base/memory/scoped_refptr.h"
+#include "base/synchronization/condition_variable.h"
+#include "base/synchronization/lock.h"
 #include "base/task/sequenced_task_runner.h"
+#include "base/thread_annotations.h"
+#include "base/token.h"
 #include "office/document_event_observer.h"
+#include "office/input_queue.h"
 
 namespace lok {
 class Document;
@@ -22,15 +32,119 @@ class DocumentHolder : public base::RefCountedDeleteOnSequence<DocumentHolder> {
   explicit DocumentHolder(lok::Document* owned_document,
                           const std::string& path);
 
+  enum class UnloadStorage {
+    kMemory,
+    kDisk,
+  };
+
+  // Serializes the document to a compressed ODF blob and unloads it from LOK.
+  // The next access through a DocumentHolderWithView schedules a reload on the
+  // holder's own sequence, with its rendering options and `modified` flag
+  // restored. Undo history isn't kept. Blocks, so it should be called with
+  // MayBlock. Returns false if the document has more than one view, can't be
+  // saved, or was accessed while it was being saved.
+  bool Unload(UnloadStorage storage, bool modified);
+  bool IsUnloaded() const;
+  // the compressed document held in memory while unloaded, 0 if it's on disk
+  size_t UnloadedByteSize() const;
+  // unique to this document, kept through an unload
+  const base::Token& token() const { return token_; }
+  // the times the document was reloaded after an unload, LOK's ids for its
+  // comments and tracked changes may differ after each
+  uint64_t reload_count() const { return reload_count_; }
+
  private:
+  // keeps the document loaded until Unpin, setting the current view if
+  // `view_id` isn't -1. An unloaded document is reloaded on
+  // `reload_task_runner_`: the owning sequence gets null instead of waiting on
+  // the reload, any other sequence blocks until it's done
+  lok::Document* Pin(int view_id);
+  void Unpin();
+  void ScheduleReload() EXCLUSIVE_LOCKS_REQUIRED(unload_lock_);
+  void Reload();
+  // runs `closure` on the owning sequence with the document pinned, after a
+  // reload if it's unloaded. Dropped if the reload fails
+  void RunWhenLoaded(base::OnceClosure closure);
+  void RunLoadedTasks();
+  // the document saved as ODF and gzip compressed, empty on failure
+  std::string SaveCompressed(int view_id);
+  // a view ID from before an unload maps to the view of the reloaded document
+  int ResolveView(int view_id) const;
+  // the blob is only released once the document is reloaded from it
+  std::string ReadBlob() const;
+  void ReleaseBlob() EXCLUSIVE_LOCKS_REQUIRED(unload_lock_);
+  // posts the oldest batch of input to LOK, a dropped drain discards its batch
+  // so that the batches after it stay paired with their drains
+  void DrainInput(base::ScopedClosureRunner discard_if_dropped);
+
   const std::string path_;
+  const base::Token token_ = base::Token::CreateRandom();
   std::unique_ptr<lok::Document> doc_;
+  // false for a holder made from a failed load
+  const bool has_document_;
+  const scoped_refptr<base::SequencedTaskRunner> reload_task_runner_;
+
+  // guards doc_ and the blob while unloading or reloading, only held briefly:
+  // never while the document is saved, decompressed or loaded
+  base::Lock unload_lock_;
+  // signaled when a reload completes or fails
+  base::ConditionVariable reload_done_;
+  std::atomic<bool> unloaded_ = false;
+  // the blob is kept, but the document isn't loaded from it again
+  std::atomic<bool> reload_failed_ = false;
+  bool unloading_ GUARDED_BY(unload_lock_) = false;
+  bool reload_scheduled_ GUARDED_BY(unload_lock_) = false;
+  // work posted to the owning sequence while the document was unloaded, in
+  // order
+  std::vector<base::OnceClosure> run_when_loaded_ GUARDED_BY(unload_lock_);
+  // the calls through the document that are in progress, it isn't unloaded
+  // while any are
+  int pins_ GUARDED_BY(unload_lock_) = 0;
+  // incremented by every pin, so that an unload can tell if the document was
+  // used while it was saved
+  uint64_t access_generation_ GUARDED_BY(unload_lock_) = 0;
+  // state that doesn't survive saving the document, applied on reload
+  std::string rendering_options_ GUARDED_BY(unload_lock_);
+  bool reload_modified_ GUARDED_BY(unload_lock_) = false;
+  // gzip compressed document, either in memory or in a temporary file
+  std::string blob_;
+  base::FilePath blob_path_;
+  std::atomic<size_t> blob_bytes_ = 0;
+  std::atomic<int> original_view_id_ = -1;
+  std::atomic<int> reloaded_view_id_ = -1;
+  std::atomic<uint64_t> reload_count_ = 0;
+
+  // shared by every view, so that input from each is drained in order
+  const scoped_refptr<InputQueue> input_queue_;
+
   friend class base::RefCountedDeleteOnSequence<DocumentHolder>;
   friend class base::DeleteHelper<DocumentHolder>;
   friend class DocumentHolderWithView;
+  friend class PinnedDocument;
   ~DocumentHolder();
 };
 
+// Keeps the document loaded while it's held. Returned by
+// DocumentHolderWithView::operator-> so that an unload can't free the document
+// during a call through it.
+class PinnedDocument {
+ public:
+  PinnedDocument(DocumentHolder* holder, int view_id);
+  ~PinnedDocument();
+
+  // no copy
+  PinnedDocument(const PinnedDocument&) = delete;
+  PinnedDocument& operator=(const PinnedDocument&) = delete;
+
+  lok::Document* operator->() const { return doc_; }
+  lok::Document* get() const { return doc_; }
+  explicit operator bool() const { return doc_ != nullptr; }
+
+ private:
+  DocumentHolder* const holder_;
+  lok::Document* const doc_;
+};
+
 // A thread-safe document holder that deletes an lok::Document only when it no
 // longer has references
 class DocumentHolderWithView {
@@ -52,8 +166,12 @@ class DocumentHolderWithView {
   DocumentHolderWithView();
   ~DocumentHolderWithView();
 
-  lok::Document& operator*() const;
-  lok::Document* operator->() const;
+  // the document stays loaded until the end of the full expression. On the
+  // owning sequence, the pinned document is null while it's unloaded
+  PinnedDocument operator->() const;
+  // the document stays loaded and the view current for several calls
+  PinnedDocument Pin() const;
+  // doesn't lock, a hibernated document is still held
   explicit operator bool() const;
   bool operator==(const DocumentHolderWithView& other) const;
   bool operator!=(const DocumentHolderWithView& other) const;
@@ -68,6 +186,8 @@ class DocumentHolderWithView {
    */
   void SetAsCurrentView() const;
 
+  // Posted work runs after the input that was queued before it and before the
+  // input that's queued after it, after a reload if the document is unloaded
   void Post(base::OnceCallback<void(DocumentHolderWithView holder)> callback,
             const base::Location& from_here = FROM_HERE) const;
   void Post(
@@ -80,6 +200,14 @@ class DocumentHolderWithView {
       base::OnceCallback<void(DocumentHolderWithView holder)> callback,
       const base::Location& from_here = FROM_HERE) const;
 
+  // the options are applied again if the document is unloaded and reloaded
+  void InitializeForRendering(const std::string& options) const;
+
+  // queues input for this view, see InputQueue
+  void PostInput(InputEvent event) const;
+  // input for any view of the document is waiting to be drained
+  bool HasPendingInput() const;
+
   const std::string& Path() const;
 
   void AddDocumentObserver(int event_id, DocumentEventObserver* observer);
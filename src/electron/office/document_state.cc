@@ -0,0 +1,243 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "office/document_state.h"
+
+#include <utility>
+#include "LibreOfficeKit/LibreOfficeKitEnums.h"
+#include "base/json/json_reader.h"
+#include "base/json/json_writer.h"
+#include "base/strings/string_number_conversions.h"
+#include "office/event_listener.h"
+#include "third_party/abseil-cpp/absl/types/optional.h"
+
+namespace electron::office {
+
+namespace {
+// LOK reports ids as strings, but getCommandValues may have them as numbers
+std::string IdOf(const base::Value::Dict& entry, const char* id_key) {
+  const base::Value* id = entry.Find(id_key);
+  if (!id)
+    return {};
+  if (id->is_string())
+    return id->GetString();
+  if (id->is_int())
+    return base::NumberToString(id->GetInt());
+  return {};
+}
+
+std::string WriteJSON(base::Value value) {
+  std::string json;
+  base::JSONWriter::Write(value, &json);
+  return json;
+}
+}  // namespace
+
+DocumentState::Table::Table(const char* id_key) : id_key(id_key) {}
+DocumentState::Table::~Table() = default;
+
+bool DocumentState::Table::Apply(const std::string& action,
+                                 base::Value::Dict entry) {
+  std::string id = IdOf(entry, id_key);
+  if (id.empty())
+    return false;
+
+  if (action == "Remove") {
+    if (!entries.erase(id))
+      return false;
+    changed.erase(id);
+    removed.insert(std::move(id));
+    return true;
+  }
+
+  auto it = entries.find(id);
+  if (it == entries.end()) {
+    entries.emplace(id, std::move(entry));
+  } else if (action == "Add") {
+    it->second = std::move(entry);
+  } else {
+    // a modification may only carry the fields that changed
+    base::Value::Dict merged = it->second.Clone();
+    merged.Merge(std::move(entry));
+    if (merged == it->second)
+      return false;
+    it->second = std::move(merged);
+  }
+  removed.erase(id);
+  changed.insert(std::move(id));
+  return true;
+}
+
+void DocumentState::Table::Reset(const base::Value::List& list) {
+  std::map<std::string, base::Value::Dict, StateIdLess> previous =
+      std::move(entries);
+  entries.clear();
+
+  for (const base::Value& item : list) {
+    if (!item.is_dict())
+      continue;
+    std::string id = IdOf(item.GetDict(), id_key);
+    if (id.empty())
+      continue;
+
+    auto it = previous.find(id);
+    if (it == previous.end() || it->second != item.GetDict()) {
+      removed.erase(id);
+      changed.insert(id);
+    }
+    if (it != previous.end())
+      previous.erase(it);
+    entries.emplace(std::move(id), item.GetDict().Clone());
+  }
+
+  // whatever is left is no longer in the document
+  for (auto& [id, entry] : previous) {
+    changed.erase(id);
+    removed.insert(id);
+  }
+}
+
+std::string DocumentState::Table::ToJSON() const {
+  base::Value::List list;
+  for (const auto& [id, entry] : entries) {
+    list.Append(entry.Clone());
+  }
+  return WriteJSON(base::Value(std::move(list)));
+}
+
+base::Value::Dict DocumentState::Table::TakeChanges() {
+  base::Value::List changed_list;
+  for (const auto& id : changed) {
+    auto it = entries.find(id);
+    if (it != entries.end())
+      changed_list.Append(it->second.Clone());
+  }
+  base::Value::List removed_list;
+  for (const auto& id : removed) {
+    removed_list.Append(id);
+  }
+  changed.clear();
+  removed.clear();
+
+  base::Value::Dict result;
+  result.Set("changed", base::Value(std::move(changed_list)));
+  result.Set("removed", base::Value(std::move(removed_list)));
+  return result;
+}
+
+DocumentState::DocumentState() = default;
+DocumentState::~DocumentState() = default;
+
+bool DocumentState::UpdateState(std::string_view payload) {
+  if (payload.empty())
+    return false;
+
+  std::string_view command =
+      EventFilter::Key(LOK_CALLBACK_STATE_CHANGED, payload);
+  const bool is_json = payload.front() == '{';
+  // JSON without a command name has nothing to key it by
+  if (command.empty() || (is_json && command.size() == payload.size()))
+    return false;
+
+  std::string_view value;
+  if (is_json) {
+    value = payload;
+  } else if (command.size() < payload.size()) {
+    value = payload.substr(command.size() + 1);
+  }
+
+  auto [it, inserted] = states_.try_emplace(std::string(command));
+  if (!inserted && it->second == value)
+    return false;
+  it->second = std::string(value);
+  changed_states_.insert(it->first);
+  return true;
+}
+
+bool DocumentState::UpdateComment(std::string_view payload) {
+  return UpdateTable(comments_, payload, "comment");
+}
+
+bool DocumentState::UpdateTrackedChange(std::string_view payload) {
+  return UpdateTable(tracked_changes_, payload, "redline");
+}
+
+void DocumentState::ResetComments(std::string_view command_values) {
+  ResetTable(comments_, command_values, "comments");
+}
+
+void DocumentState::ResetTrackedChanges(std::string_view command_values) {
+  ResetTable(tracked_changes_, command_values, "redlines");
+}
+
+const std::string* DocumentState::State(const std::string& command) const {
+  auto it = states_.find(command);
+  return it == states_.end() ? nullptr : &it->second;
+}
+
+std::string DocumentState::CommentsJSON() const {
+  return comments_.ToJSON();
+}
+
+std::string DocumentState::TrackedChangesJSON() const {
+  return tracked_changes_.ToJSON();
+}
+
+bool DocumentState::HasChanges() const {
+  return !changed_states_.empty() || comments_.HasChanges() ||
+         tracked_changes_.HasChanges();
+}
+
+std::string DocumentState::TakeChanges() {
+  base::Value::Dict result;
+
+  if (!changed_states_.empty()) {
+    base::Value::Dict state;
+    for (const auto& command : changed_states_) {
+      const std::string& value = states_[command];
+      absl::optional<base::Value> json;
+      if (!value.empty() && value.front() == '{')
+        json = base::JSONReader::Read(value);
+      state.Set(command, json ? std::move(*json) : base::Value(value));
+    }
+    changed_states_.clear();
+    result.Set("state", base::Value(std::move(state)));
+  }
+
+  if (comments_.HasChanges())
+    result.Set("comments", base::Value(comments_.TakeChanges()));
+  if (tracked_changes_.HasChanges())
+    result.Set("trackedChanges", base::Value(tracked_changes_.TakeChanges()));
+
+  return WriteJSON(base::Value(std::move(result)));
+}
+
+bool DocumentState::UpdateTable(Table& table,
+                                std::string_view payload,
+                                const char* root_key) {
+  absl::optional<base::Value> value = base::JSONReader::Read(payload);
+  if (!value || !value->is_dict())
+    return false;
+  base::Value::Dict* entry = value->GetDict().FindDict(root_key);
+  if (!entry)
+    return false;
+
+  absl::optional<base::Value> action = entry->Extract("action");
+  return table.Apply(
+      action && action->is_string() ? action->GetString() : std::string(),
+      std::move(*entry));
+}
+
+void DocumentState::ResetTable(Table& table,
+                               std::string_view command_values,
+                               const char* list_key) {
+  absl::optional<base::Value> value = base::JSONReader::Read(command_values);
+  if (!value || !value->is_dict())
+    return;
+  const base::Value::List* list = value->GetDict().FindList(list_key);
+  if (list)
+    table.Reset(*list);
+}
+
+}  // namespace electron::office
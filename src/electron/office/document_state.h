@@ -0,0 +1,106 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include "base/values.h"
+
+namespace electron::office {
+
+// orders numeric ids numerically, any other id still has a stable order
+struct StateIdLess {
+  bool operator()(const std::string& a, const std::string& b) const {
+    if (a.size() != b.size())
+      return a.size() < b.size();
+    return a < b;
+  }
+};
+
+// The state of a document as reported by LOK's callbacks, so that reads don't
+// go through getCommandValues. Keeps the value of every STATE_CHANGED command
+// and the comment and tracked change tables, updated incrementally, along with
+// what changed since the changes were last taken.
+class DocumentState {
+ public:
+  DocumentState();
+  ~DocumentState();
+
+  // no copy
+  DocumentState(const DocumentState&) = delete;
+  DocumentState& operator=(const DocumentState&) = delete;
+
+  // applies a STATE_CHANGED payload, returns true if the value of its command
+  // changed
+  bool UpdateState(std::string_view payload);
+  // applies a COMMENT payload, ex: {"comment":{"action":"Add","id":"1",...}}
+  bool UpdateComment(std::string_view payload);
+  // applies a REDLINE_TABLE_SIZE_CHANGED or REDLINE_TABLE_ENTRY_MODIFIED
+  // payload, ex: {"redline":{"action":"Remove","index":"1",...}}
+  bool UpdateTrackedChange(std::string_view payload);
+
+  // replaces a table from the getCommandValues result of .uno:ViewAnnotations
+  // or .uno:AcceptTrackedChanges, only the entries that differ from the table
+  // are reported as changed or removed
+  void ResetComments(std::string_view command_values);
+  void ResetTrackedChanges(std::string_view command_values);
+
+  // the value after the "=" of a command, or the whole payload of a JSON state
+  // change, null if the command hasn't been reported
+  const std::string* State(const std::string& command) const;
+  const std::map<std::string, std::string>& states() const { return states_; }
+
+  // JSON arrays of the entries, ordered by id
+  std::string CommentsJSON() const;
+  std::string TrackedChangesJSON() const;
+  size_t comment_count() const { return comments_.entries.size(); }
+  size_t tracked_change_count() const {
+    return tracked_changes_.entries.size();
+  }
+
+  bool HasChanges() const;
+  // Returns the changes since the last call as JSON and clears them, ex:
+  // {"state":{".uno:Bold":"true"},
+  //  "comments":{"changed":[{"id":"1",...}],"removed":["2"]}}
+  // where only the parts that changed are present.
+  std::string TakeChanges();
+
+ private:
+  struct Table {
+    explicit Table(const char* id_key);
+    ~Table();
+
+    // the field of an entry holding its id
+    const char* id_key;
+
+    std::map<std::string, base::Value::Dict, StateIdLess> entries;
+    std::set<std::string, StateIdLess> changed;
+    std::set<std::string, StateIdLess> removed;
+
+    // `action` is Add, Modify or Remove, others are treated as Modify
+    bool Apply(const std::string& action, base::Value::Dict entry);
+    void Reset(const base::Value::List& list);
+    std::string ToJSON() const;
+    bool HasChanges() const { return !changed.empty() || !removed.empty(); }
+    base::Value::Dict TakeChanges();
+  };
+
+  bool UpdateTable(Table& table,
+                   std::string_view payload,
+                   const char* root_key);
+  void ResetTable(Table& table,
+                  std::string_view command_values,
+                  const char* list_key);
+
+  std::map<std::string, std::string> states_;
+  std::set<std::string> changed_states_;
+
+  Table comments_{"id"};
+  Table tracked_changes_{"index"};
+};
+
+}  // namespace electron::office
@@ -0,0 +1,91 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "document_state.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace electron::office {
+
+TEST(DocumentStateTest, TracksStateChanges) {
+  DocumentState state;
+  EXPECT_TRUE(state.UpdateState(".uno:Undo=enabled"));
+  EXPECT_TRUE(state.UpdateState(".uno:Bold=true"));
+  // the same value isn't a change
+  EXPECT_FALSE(state.UpdateState(".uno:Bold=true"));
+  EXPECT_TRUE(
+      state.UpdateState(R"({"commandName":".uno:Color","state":"255"})"));
+  EXPECT_FALSE(state.UpdateState(R"({"state":"255"})"));
+
+  ASSERT_TRUE(state.State(".uno:Undo"));
+  EXPECT_EQ(*state.State(".uno:Undo"), "enabled");
+  EXPECT_EQ(*state.State(".uno:Color"),
+            R"({"commandName":".uno:Color","state":"255"})");
+  EXPECT_EQ(state.State(".uno:Italic"), nullptr);
+  EXPECT_EQ(state.states().size(), size_t(3));
+
+  EXPECT_EQ(state.TakeChanges(),
+            R"({"state":{".uno:Bold":"true",)"
+            R"(".uno:Color":{"commandName":".uno:Color","state":"255"},)"
+            R"(".uno:Undo":"enabled"}})");
+  EXPECT_FALSE(state.HasChanges());
+
+  EXPECT_TRUE(state.UpdateState(".uno:Undo=disabled"));
+  EXPECT_EQ(state.TakeChanges(), R"({"state":{".uno:Undo":"disabled"}})");
+}
+
+TEST(DocumentStateTest, AppliesCommentActions) {
+  DocumentState state;
+  EXPECT_TRUE(state.UpdateComment(
+      R"({"comment":{"action":"Add","id":"2","text":"b"}})"));
+  EXPECT_TRUE(state.UpdateComment(
+      R"({"comment":{"action":"Add","id":"10","text":"c"}})"));
+  EXPECT_TRUE(state.UpdateComment(
+      R"({"comment":{"action":"Add","id":"1","text":"a"}})"));
+  EXPECT_EQ(state.comment_count(), size_t(3));
+  // ordered by id, without the action
+  EXPECT_EQ(state.CommentsJSON(),
+            R"([{"id":"1","text":"a"},{"id":"2","text":"b"},)"
+            R"({"id":"10","text":"c"}])");
+  state.TakeChanges();
+
+  // a modification only replaces the fields it has
+  EXPECT_TRUE(state.UpdateComment(
+      R"({"comment":{"action":"Modify","id":"2","resolved":"true"}})"));
+  EXPECT_FALSE(state.UpdateComment(
+      R"({"comment":{"action":"Modify","id":"2","text":"b"}})"));
+  EXPECT_TRUE(
+      state.UpdateComment(R"({"comment":{"action":"Remove","id":"1"}})"));
+  EXPECT_FALSE(
+      state.UpdateComment(R"({"comment":{"action":"Remove","id":"7"}})"));
+  EXPECT_FALSE(state.UpdateComment("not json"));
+
+  EXPECT_EQ(state.TakeChanges(),
+            R"({"comments":{"changed":[{"id":"2","resolved":"true",)"
+            R"("text":"b"}],"removed":["1"]}})");
+}
+
+TEST(DocumentStateTest, ResetReportsOnlyDifferences) {
+  DocumentState state;
+  state.UpdateTrackedChange(
+      R"({"redline":{"action":"Add","index":"1","type":"Insert"}})");
+  state.UpdateTrackedChange(
+      R"({"redline":{"action":"Add","index":"2","type":"Delete"}})");
+  state.TakeChanges();
+
+  // numeric ids are accepted, 2 is unchanged and 1 is gone
+  state.ResetTrackedChanges(
+      R"({"redlines":[{"index":"2","type":"Delete"},)"
+      R"({"index":3,"type":"Format"}]})");
+  EXPECT_EQ(state.tracked_change_count(), size_t(2));
+  EXPECT_EQ(state.TakeChanges(),
+            R"({"trackedChanges":{"changed":[{"index":3,"type":"Format"}],)"
+            R"("removed":["1"]}})");
+
+  // an unexpected result leaves the table alone
+  state.ResetTrackedChanges(R"({"comments":[]})");
+  EXPECT_EQ(state.tracked_change_count(), size_t(2));
+  EXPECT_FALSE(state.HasChanges());
+}
+
+}  // namespace electron::office
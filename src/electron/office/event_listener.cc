@@ -0,0 +1,74 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "office/event_listener.h"
+
+#include <algorithm>
+#include "LibreOfficeKit/LibreOfficeKitEnums.h"
+
+namespace electron::office {
+
+EventFilter::EventFilter() = default;
+EventFilter::EventFilter(std::vector<std::string> keys)
+    : keys_(std::move(keys)) {}
+EventFilter::EventFilter(const EventFilter& other) = default;
+EventFilter& EventFilter::operator=(const EventFilter& other) = default;
+EventFilter::~EventFilter() = default;
+
+bool EventFilter::Matches(int type, std::string_view payload) const {
+  if (keys_.empty())
+    return true;
+
+  std::string_view key = Key(type, payload);
+  return std::any_of(keys_.begin(), keys_.end(),
+                     [key](const std::string& k) { return k == key; });
+}
+
+// static
+std::string_view EventFilter::Key(int type, std::string_view payload) {
+  if (type != LOK_CALLBACK_STATE_CHANGED)
+    return payload;
+
+  // JSON state changes carry the command in "commandName"
+  if (!payload.empty() && payload.front() == '{') {
+    static constexpr std::string_view command_name = "\"commandName\"";
+    size_t pos = payload.find(command_name);
+    if (pos == std::string_view::npos)
+      return payload;
+    size_t colon = payload.find(':', pos + command_name.size());
+    if (colon == std::string_view::npos)
+      return payload;
+    size_t start = payload.find('"', colon + 1);
+    if (start == std::string_view::npos)
+      return payload;
+    size_t end = payload.find('"', start + 1);
+    if (end == std::string_view::npos)
+      return payload;
+    return payload.substr(start + 1, end - start - 1);
+  }
+
+  return payload.substr(0, payload.find('='));
+}
+
+EventListener::EventListener(SafeV8Function callback,
+                             bool batched,
+                             EventFilter filter)
+    : callback_(std::move(callback)),
+      batched_(batched),
+      filter_(std::move(filter)) {}
+EventListener::EventListener(const EventListener& other) = default;
+EventListener& EventListener::operator=(const EventListener& other) = default;
+EventListener::~EventListener() = default;
+
+void EventListener::Queue(std::string payload) {
+  pending_.emplace_back(std::move(payload));
+}
+
+std::vector<std::string> EventListener::TakePending() {
+  std::vector<std::string> pending;
+  pending.swap(pending_);
+  return pending;
+}
+
+}  // namespace electron::office
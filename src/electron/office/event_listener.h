@@ -0,0 +1,65 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "office/v8_callback.h"
+
+namespace electron::office {
+
+// Drops events before they reach V8, so that a listener only pays for the
+// events it wants.
+class EventFilter {
+ public:
+  EventFilter();
+  // an empty list of keys matches every event
+  explicit EventFilter(std::vector<std::string> keys);
+  EventFilter(const EventFilter& other);
+  EventFilter& operator=(const EventFilter& other);
+  ~EventFilter();
+
+  bool Matches(int type, std::string_view payload) const;
+
+  // the command of a STATE_CHANGED payload, ex: ".uno:Bold" for both
+  // ".uno:Bold=true" and {"commandName":".uno:Bold",...}, otherwise the whole
+  // payload
+  static std::string_view Key(int type, std::string_view payload);
+
+ private:
+  std::vector<std::string> keys_;
+};
+
+// A JS listener for a single event type. Batched listeners receive the
+// payloads queued since the last flush as one array instead of a call per
+// event.
+class EventListener {
+ public:
+  EventListener(SafeV8Function callback, bool batched, EventFilter filter);
+  EventListener(const EventListener& other);
+  EventListener& operator=(const EventListener& other);
+  ~EventListener();
+
+  const SafeV8Function& callback() const { return callback_; }
+  bool batched() const { return batched_; }
+  const EventFilter& filter() const { return filter_; }
+
+  void Queue(std::string payload);
+  std::vector<std::string> TakePending();
+  bool HasPending() const { return !pending_.empty(); }
+
+  bool operator==(const v8::Local<v8::Function>& other) const {
+    return callback_ == other;
+  }
+
+ private:
+  SafeV8Function callback_;
+  bool batched_;
+  EventFilter filter_;
+  std::vector<std::string> pending_;
+};
+
+}  // namespace electron::office
@@ -0,0 +1,40 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "event_listener.h"
+#include "LibreOfficeKit/LibreOfficeKitEnums.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace electron::office {
+
+TEST(EventFilterTest, StateChangedKey) {
+  EXPECT_EQ(EventFilter::Key(LOK_CALLBACK_STATE_CHANGED, ".uno:Bold=true"),
+            ".uno:Bold");
+  EXPECT_EQ(EventFilter::Key(LOK_CALLBACK_STATE_CHANGED,
+                             R"({"commandName": ".uno:Color", "state": "0"})"),
+            ".uno:Color");
+  EXPECT_EQ(EventFilter::Key(LOK_CALLBACK_STATE_CHANGED, ".uno:Undo"),
+            ".uno:Undo");
+  // malformed JSON is its own key
+  EXPECT_EQ(EventFilter::Key(LOK_CALLBACK_STATE_CHANGED, R"({"commandName"})"),
+            R"({"commandName"})");
+  EXPECT_EQ(EventFilter::Key(LOK_CALLBACK_INVALIDATE_TILES, "EMPTY, 0"),
+            "EMPTY, 0");
+}
+
+TEST(EventFilterTest, MatchesKeys) {
+  EventFilter all;
+  EXPECT_TRUE(all.Matches(LOK_CALLBACK_STATE_CHANGED, ".uno:Italic=false"));
+
+  EventFilter filter({".uno:Bold", ".uno:Italic"});
+  EXPECT_TRUE(filter.Matches(LOK_CALLBACK_STATE_CHANGED, ".uno:Bold=true"));
+  EXPECT_TRUE(filter.Matches(LOK_CALLBACK_STATE_CHANGED,
+                             R"({"commandName":".uno:Italic","state":"true"})"));
+  EXPECT_FALSE(
+      filter.Matches(LOK_CALLBACK_STATE_CHANGED, ".uno:Underline=true"));
+  // a key is matched exactly, not as a prefix
+  EXPECT_FALSE(filter.Matches(LOK_CALLBACK_STATE_CHANGED, ".uno:BoldX=true"));
+}
+
+}  // namespace electron::office
@@ -0,0 +1,112 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "office/input_queue.h"
+
+#include "LibreOfficeKit/LibreOfficeKitEnums.h"
+
+namespace electron::office {
+
+// static
+InputEvent InputEvent::Mouse(int type,
+                             int x,
+                             int y,
+                             int count,
+                             int buttons,
+                             int modifiers) {
+  InputEvent event{Kind::kMouse, type};
+  event.x = x;
+  event.y = y;
+  event.count = count;
+  event.buttons = buttons;
+  event.modifiers = modifiers;
+  return event;
+}
+
+// static
+InputEvent InputEvent::Key(int type, char16_t text, int key_code) {
+  InputEvent event{Kind::kKey, type};
+  event.text = text;
+  event.key_code = key_code;
+  return event;
+}
+
+namespace {
+bool IsMouseMove(const InputEvent& event) {
+  return event.kind == InputEvent::Kind::kMouse &&
+         event.type == LOK_MOUSEEVENT_MOUSEMOVE;
+}
+
+bool IsKeyInput(const InputEvent& event) {
+  return event.kind == InputEvent::Kind::kKey &&
+         event.type == LOK_KEYEVENT_KEYINPUT;
+}
+}  // namespace
+
+InputQueue::InputQueue() = default;
+InputQueue::~InputQueue() = default;
+
+bool InputQueue::Push(InputEvent event) {
+  base::AutoLock auto_lock(lock_);
+
+  if (!accepting_) {
+    batches_.emplace_back();
+    batches_.back().emplace_back(std::move(event));
+    accepting_ = true;
+    return true;
+  }
+
+  std::vector<InputEvent>& batch = batches_.back();
+  InputEvent& last = batch.back();
+  if (last.view_id == event.view_id) {
+    // a move only supersedes a move with the same buttons held
+    if (IsMouseMove(event) && IsMouseMove(last) &&
+        last.buttons == event.buttons && last.modifiers == event.modifiers) {
+      last.x = event.x;
+      last.y = event.y;
+      ++coalesced_count_;
+      return false;
+    }
+
+    // key repeat is sent as a single batch
+    if (IsKeyInput(event) && IsKeyInput(last) && last.text == event.text &&
+        last.key_code == event.key_code) {
+      ++last.repeat;
+      ++coalesced_count_;
+      return false;
+    }
+  }
+
+  batch.emplace_back(std::move(event));
+  return false;
+}
+
+void InputQueue::Seal() {
+  base::AutoLock auto_lock(lock_);
+  accepting_ = false;
+}
+
+std::vector<InputEvent> InputQueue::Take() {
+  base::AutoLock auto_lock(lock_);
+  if (batches_.empty())
+    return {};
+
+  std::vector<InputEvent> result = std::move(batches_.front());
+  batches_.pop_front();
+  if (batches_.empty())
+    accepting_ = false;
+  return result;
+}
+
+bool InputQueue::HasPending() const {
+  base::AutoLock auto_lock(lock_);
+  return !batches_.empty();
+}
+
+size_t InputQueue::coalesced_count() const {
+  base::AutoLock auto_lock(lock_);
+  return coalesced_count_;
+}
+
+}  // namespace electron::office
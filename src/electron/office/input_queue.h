@@ -0,0 +1,87 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <deque>
+#include <vector>
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/synchronization/lock.h"
+#include "base/thread_annotations.h"
+
+namespace electron::office {
+
+struct InputEvent {
+  enum class Kind { kMouse, kKey };
+
+  static InputEvent Mouse(int type,
+                          int x,
+                          int y,
+                          int count,
+                          int buttons,
+                          int modifiers);
+  static InputEvent Key(int type, char16_t text, int key_code);
+
+  Kind kind;
+  // LibreOfficeKitMouseEventType or LibreOfficeKitKeyEventType
+  int type;
+  // the view that receives the event
+  int view_id = -1;
+
+  // mouse, position in twips
+  int x = 0;
+  int y = 0;
+  int count = 0;
+  int buttons = 0;
+  int modifiers = 0;
+
+  // key
+  char16_t text = 0;
+  int key_code = 0;
+  // the number of times the key is repeated
+  int repeat = 1;
+};
+
+// Input events for every view of a single document, in order.
+//
+// Events are pushed on the renderer thread and drained on the document's
+// sequence in batches, one drain per batch. While LOK is busy, consecutive
+// mouse moves of a view are coalesced to the latest position and repeated key
+// input is batched. Button down/up and key up events are never coalesced, so
+// their ordering is preserved. A batch is sealed when other work is posted to
+// the document, so input that follows the work is drained after it.
+class InputQueue : public base::RefCountedThreadSafe<InputQueue> {
+ public:
+  InputQueue();
+
+  // no copy
+  InputQueue(const InputQueue&) = delete;
+  InputQueue& operator=(const InputQueue&) = delete;
+
+  // returns true if the event started a batch and a drain should be scheduled
+  bool Push(InputEvent event);
+  // the next push starts a new batch
+  void Seal();
+  // takes the oldest batch, each drain takes exactly one
+  std::vector<InputEvent> Take();
+
+  // there's a batch that hasn't been drained yet
+  bool HasPending() const;
+
+  // the number of events that were merged into a pending event
+  size_t coalesced_count() const;
+
+ private:
+  friend class base::RefCountedThreadSafe<InputQueue>;
+  ~InputQueue();
+
+  mutable base::Lock lock_;
+  std::deque<std::vector<InputEvent>> batches_ GUARDED_BY(lock_);
+  // the last batch accepts events until it's sealed or drained
+  bool accepting_ GUARDED_BY(lock_) = false;
+  size_t coalesced_count_ GUARDED_BY(lock_) = 0;
+};
+
+}  // namespace electron::office
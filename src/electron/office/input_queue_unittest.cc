@@ -0,0 +1,121 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "input_queue.h"
+#include "LibreOfficeKit/LibreOfficeKitEnums.h"
+#include "base/memory/scoped_refptr.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace electron::office {
+
+TEST(InputQueueTest, SchedulesOneDrain) {
+  auto queue = base::MakeRefCounted<InputQueue>();
+  EXPECT_TRUE(queue->Push(InputEvent::Mouse(LOK_MOUSEEVENT_MOUSEBUTTONDOWN, 0,
+                                            0, 1, 1, 0)));
+  EXPECT_FALSE(queue->Push(
+      InputEvent::Mouse(LOK_MOUSEEVENT_MOUSEBUTTONUP, 0, 0, 1, 1, 0)));
+  EXPECT_TRUE(queue->HasPending());
+  EXPECT_EQ(queue->Take().size(), size_t(2));
+  EXPECT_FALSE(queue->HasPending());
+
+  // once taken, the next push schedules another drain
+  EXPECT_TRUE(
+      queue->Push(InputEvent::Key(LOK_KEYEVENT_KEYINPUT, u'a', 0)));
+}
+
+TEST(InputQueueTest, CoalescesMouseMoves) {
+  auto queue = base::MakeRefCounted<InputQueue>();
+  queue->Push(
+      InputEvent::Mouse(LOK_MOUSEEVENT_MOUSEBUTTONDOWN, 0, 0, 1, 1, 0));
+  for (int i = 1; i <= 10; ++i) {
+    queue->Push(
+        InputEvent::Mouse(LOK_MOUSEEVENT_MOUSEMOVE, i, i * 2, 1, 1, 0));
+  }
+  queue->Push(InputEvent::Mouse(LOK_MOUSEEVENT_MOUSEBUTTONUP, 10, 20, 1, 1, 0));
+
+  auto events = queue->Take();
+  ASSERT_EQ(events.size(), size_t(3));
+  EXPECT_EQ(events[0].type, LOK_MOUSEEVENT_MOUSEBUTTONDOWN);
+  EXPECT_EQ(events[1].type, LOK_MOUSEEVENT_MOUSEMOVE);
+  EXPECT_EQ(events[1].x, 10);
+  EXPECT_EQ(events[1].y, 20);
+  EXPECT_EQ(events[2].type, LOK_MOUSEEVENT_MOUSEBUTTONUP);
+  EXPECT_EQ(queue->coalesced_count(), size_t(9));
+}
+
+TEST(InputQueueTest, PreservesOrderingAcrossButtons) {
+  auto queue = base::MakeRefCounted<InputQueue>();
+  queue->Push(InputEvent::Mouse(LOK_MOUSEEVENT_MOUSEMOVE, 1, 1, 1, 1, 0));
+  queue->Push(InputEvent::Mouse(LOK_MOUSEEVENT_MOUSEBUTTONUP, 1, 1, 1, 1, 0));
+  queue->Push(InputEvent::Mouse(LOK_MOUSEEVENT_MOUSEMOVE, 2, 2, 1, 1, 0));
+  // different buttons held
+  queue->Push(InputEvent::Mouse(LOK_MOUSEEVENT_MOUSEMOVE, 3, 3, 1, 4, 0));
+
+  auto events = queue->Take();
+  ASSERT_EQ(events.size(), size_t(4));
+  EXPECT_EQ(events[1].type, LOK_MOUSEEVENT_MOUSEBUTTONUP);
+  EXPECT_EQ(events[2].x, 2);
+  EXPECT_EQ(events[3].x, 3);
+}
+
+TEST(InputQueueTest, BatchesKeyRepeat) {
+  auto queue = base::MakeRefCounted<InputQueue>();
+  for (int i = 0; i < 5; ++i) {
+    queue->Push(InputEvent::Key(LOK_KEYEVENT_KEYINPUT, u'a', 0));
+  }
+  queue->Push(InputEvent::Key(LOK_KEYEVENT_KEYINPUT, u'b', 0));
+  queue->Push(InputEvent::Key(LOK_KEYEVENT_KEYUP, u'b', 0));
+  queue->Push(InputEvent::Key(LOK_KEYEVENT_KEYUP, u'b', 0));
+
+  auto events = queue->Take();
+  ASSERT_EQ(events.size(), size_t(4));
+  EXPECT_EQ(events[0].text, u'a');
+  EXPECT_EQ(events[0].repeat, 5);
+  EXPECT_EQ(events[1].text, u'b');
+  EXPECT_EQ(events[1].repeat, 1);
+  // key up is never batched
+  EXPECT_EQ(events[2].repeat, 1);
+  EXPECT_EQ(events[3].repeat, 1);
+}
+
+TEST(InputQueueTest, SealStartsANewBatch) {
+  auto queue = base::MakeRefCounted<InputQueue>();
+  EXPECT_TRUE(queue->Push(InputEvent::Key(LOK_KEYEVENT_KEYINPUT, u'a', 0)));
+  // work posted to the document in between
+  queue->Seal();
+  EXPECT_TRUE(queue->Push(InputEvent::Key(LOK_KEYEVENT_KEYINPUT, u'a', 0)));
+  EXPECT_FALSE(queue->Push(InputEvent::Key(LOK_KEYEVENT_KEYUP, u'a', 0)));
+
+  // each drain takes one batch, so the work runs between them
+  auto first = queue->Take();
+  ASSERT_EQ(first.size(), size_t(1));
+  EXPECT_EQ(first[0].repeat, 1);
+  EXPECT_EQ(queue->Take().size(), size_t(2));
+  EXPECT_TRUE(queue->Take().empty());
+  EXPECT_TRUE(queue->Push(InputEvent::Key(LOK_KEYEVENT_KEYINPUT, u'b', 0)));
+}
+
+TEST(InputQueueTest, CoalescesOnlyWithinAView) {
+  auto queue = base::MakeRefCounted<InputQueue>();
+  InputEvent first =
+      InputEvent::Mouse(LOK_MOUSEEVENT_MOUSEMOVE, 1, 1, 1, 1, 0);
+  first.view_id = 0;
+  InputEvent second =
+      InputEvent::Mouse(LOK_MOUSEEVENT_MOUSEMOVE, 2, 2, 1, 1, 0);
+  second.view_id = 1;
+  InputEvent third =
+      InputEvent::Mouse(LOK_MOUSEEVENT_MOUSEMOVE, 3, 3, 1, 1, 0);
+  third.view_id = 1;
+  queue->Push(first);
+  queue->Push(second);
+  queue->Push(third);
+
+  auto events = queue->Take();
+  ASSERT_EQ(events.size(), size_t(2));
+  EXPECT_EQ(events[0].view_id, 0);
+  EXPECT_EQ(events[1].view_id, 1);
+  EXPECT_EQ(events[1].x, 3);
+}
+
+}  // namespace electron::office
@@ -0,0 +1,133 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "office/invalidation_tracker.h"
+
+#include <algorithm>
+
+namespace electron::office {
+
+InvalidatedPages::InvalidatedPages() = default;
+InvalidatedPages::InvalidatedPages(const InvalidatedPages& other) = default;
+InvalidatedPages& InvalidatedPages::operator=(const InvalidatedPages& other) =
+    default;
+InvalidatedPages::~InvalidatedPages() = default;
+
+InvalidationTracker::InvalidationTracker() = default;
+InvalidationTracker::~InvalidationTracker() = default;
+
+void InvalidationTracker::InvalidatePage(int page) {
+  if (page < 0)
+    return;
+  if (all_ || !pages_.insert(page).second)
+    ++collapsed_;
+}
+
+void InvalidationTracker::InvalidateAll() {
+  if (all_)
+    ++collapsed_;
+  all_ = true;
+  // every page is already covered
+  collapsed_ += pages_.size() + rects_.size();
+  pages_.clear();
+  rects_.clear();
+}
+
+void InvalidationTracker::InvalidateRect(const gfx::Rect& rect_twips) {
+  if (rect_twips.IsEmpty())
+    return;
+  if (all_) {
+    ++collapsed_;
+    return;
+  }
+
+  for (gfx::Rect& rect : rects_) {
+    if (rect.Contains(rect_twips)) {
+      ++collapsed_;
+      return;
+    }
+    if (rect_twips.Contains(rect)) {
+      ++collapsed_;
+      rect = rect_twips;
+      return;
+    }
+  }
+
+  if (rects_.size() < kMaxRects) {
+    rects_.push_back(rect_twips);
+    return;
+  }
+
+  // too many to track individually, a few extra tiles are repainted instead
+  gfx::Rect bounds = rect_twips;
+  for (const gfx::Rect& rect : rects_) {
+    bounds.Union(rect);
+  }
+  collapsed_ += rects_.size();
+  rects_ = {bounds};
+}
+
+InvalidatedPages InvalidationTracker::Take(
+    const std::vector<gfx::Rect>& page_rects_twips,
+    int first_visible,
+    int last_visible) {
+  InvalidatedPages result;
+  const int page_count = static_cast<int>(page_rects_twips.size());
+  result.all = all_ || (!pages_.empty() && *pages_.rbegin() >= page_count);
+
+  int first_paint = -1;
+  int last_paint = -1;
+  if (first_visible >= 0 && last_visible >= first_visible) {
+    first_paint = std::max(0, first_visible - kPrefetchPages);
+    last_paint = std::min(page_count - 1, last_visible + kPrefetchPages);
+  }
+
+  auto is_invalid = [&](int page) {
+    return result.all || pages_.count(page) != 0;
+  };
+
+  // merge consecutive pages, the gap between them is invalidated with them
+  // but it's only background
+  auto append_runs = [&](int first, int last, std::vector<gfx::Rect>& runs) {
+    for (int page = first; page <= last; ++page) {
+      if (!is_invalid(page) || page_rects_twips[page].IsEmpty())
+        continue;
+      if (!runs.empty() && page > first && is_invalid(page - 1) &&
+          !page_rects_twips[page - 1].IsEmpty()) {
+        runs.back().Union(page_rects_twips[page]);
+      } else {
+        runs.push_back(page_rects_twips[page]);
+      }
+    }
+  };
+
+  if (!result.all)
+    append_runs(0, page_count - 1, result.invalid_rects_twips);
+  if (first_paint >= 0)
+    append_runs(first_paint, last_paint, result.paint_rects_twips);
+
+  if (!result.all) {
+    gfx::Rect paint_bounds;
+    for (int page = first_paint; page >= 0 && page <= last_paint; ++page) {
+      paint_bounds.Union(page_rects_twips[page]);
+    }
+    for (const gfx::Rect& rect : rects_) {
+      result.invalid_rects_twips.push_back(rect);
+      gfx::Rect paint_rect = gfx::IntersectRects(rect, paint_bounds);
+      if (!paint_rect.IsEmpty())
+        result.paint_rects_twips.push_back(paint_rect);
+    }
+  }
+
+  Clear();
+  return result;
+}
+
+void InvalidationTracker::Clear() {
+  all_ = false;
+  pages_.clear();
+  rects_.clear();
+}
+
+}  // namespace electron::office
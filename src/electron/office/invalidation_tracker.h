@@ -0,0 +1,81 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <set>
+#include <vector>
+#include "ui/gfx/geometry/rect.h"
+
+namespace electron::office {
+
+// the pages invalidated within a frame
+struct InvalidatedPages {
+  // every page is invalid, not only those in `invalid_rects_twips`
+  bool all = false;
+  // runs of consecutive invalid pages followed by the invalid rects, the tiles
+  // in them should be invalidated
+  std::vector<gfx::Rect> invalid_rects_twips;
+  // the parts of those that are on visible or prefetched pages, these should be
+  // repainted
+  std::vector<gfx::Rect> paint_rects_twips;
+
+  InvalidatedPages();
+  InvalidatedPages(const InvalidatedPages& other);
+  InvalidatedPages& operator=(const InvalidatedPages& other);
+  ~InvalidatedPages();
+
+  bool empty() const { return !all && invalid_rects_twips.empty(); }
+};
+
+// Collects the full page invalidations ("EMPTY, <page>") and full document
+// invalidations ("EMPTY") that LOK issues, so that they can be applied once per
+// frame. LOK issues one for every page and then another for the whole
+// document after most edits, which would otherwise repaint the view N+1 times.
+// Rects can be collected too, for invalidations that can wait longer than a
+// frame, ex: the results of online spelling.
+class InvalidationTracker {
+ public:
+  // pages before and after the visible pages that are repainted
+  static constexpr int kPrefetchPages = 1;
+  // pending rects past this are merged into their bounds
+  static constexpr size_t kMaxRects = 64;
+
+  InvalidationTracker();
+  ~InvalidationTracker();
+
+  // no copy
+  InvalidationTracker(const InvalidationTracker&) = delete;
+  InvalidationTracker& operator=(const InvalidationTracker&) = delete;
+
+  void InvalidatePage(int page);
+  void InvalidateAll();
+  void InvalidateRect(const gfx::Rect& rect_twips);
+
+  bool HasPending() const {
+    return all_ || !pages_.empty() || !rects_.empty();
+  }
+  // invalidations that were dropped because they were already pending
+  size_t collapsed() const { return collapsed_; }
+
+  // Maps the pending pages to their rects in `page_rects_twips` and clears
+  // them. `first_visible` and `last_visible` are the visible pages, or -1 if
+  // unknown in which case nothing is repainted. A page outside of
+  // `page_rects_twips` means the page rects are stale, so every page is
+  // invalid.
+  InvalidatedPages Take(const std::vector<gfx::Rect>& page_rects_twips,
+                        int first_visible,
+                        int last_visible);
+
+  void Clear();
+
+ private:
+  bool all_ = false;
+  std::set<int> pages_;
+  std::vector<gfx::Rect> rects_;
+  size_t collapsed_ = 0;
+};
+
+}  // namespace electron::office
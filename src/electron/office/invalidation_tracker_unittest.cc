@@ -0,0 +1,127 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "invalidation_tracker.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace electron::office {
+
+namespace {
+std::vector<gfx::Rect> MakePages(int count) {
+  std::vector<gfx::Rect> pages;
+  for (int i = 0; i < count; ++i) {
+    pages.emplace_back(0, i * 1500, 1000, 1400);
+  }
+  return pages;
+}
+}  // namespace
+
+TEST(InvalidationTrackerTest, CollapsesDuplicatesWithinAFrame) {
+  InvalidationTracker tracker;
+  EXPECT_FALSE(tracker.HasPending());
+
+  tracker.InvalidatePage(2);
+  tracker.InvalidatePage(2);
+  tracker.InvalidatePage(2);
+  EXPECT_TRUE(tracker.HasPending());
+  EXPECT_EQ(tracker.collapsed(), size_t(2));
+
+  auto pages = MakePages(5);
+  InvalidatedPages result = tracker.Take(pages, 0, 0);
+  EXPECT_FALSE(result.all);
+  ASSERT_EQ(result.invalid_rects_twips.size(), size_t(1));
+  EXPECT_EQ(result.invalid_rects_twips[0], pages[2]);
+  EXPECT_FALSE(tracker.HasPending());
+}
+
+TEST(InvalidationTrackerTest, FullInvalidationCoversPages) {
+  InvalidationTracker tracker;
+  // LOK issues one for every page, then one for the document
+  for (int page = 0; page < 4; ++page) {
+    tracker.InvalidatePage(page);
+  }
+  tracker.InvalidateAll();
+  tracker.InvalidatePage(1);
+  EXPECT_EQ(tracker.collapsed(), size_t(5));
+
+  auto pages = MakePages(4);
+  InvalidatedPages result = tracker.Take(pages, 1, 1);
+  EXPECT_TRUE(result.all);
+  EXPECT_TRUE(result.invalid_rects_twips.empty());
+  // the visible page and one page on either side
+  ASSERT_EQ(result.paint_rects_twips.size(), size_t(1));
+  EXPECT_EQ(result.paint_rects_twips[0],
+            gfx::UnionRects(pages[0], pages[2]));
+}
+
+TEST(InvalidationTrackerTest, OnlyPaintsVisibleAndPrefetchedPages) {
+  InvalidationTracker tracker;
+  tracker.InvalidatePage(0);
+  tracker.InvalidatePage(4);
+  tracker.InvalidatePage(5);
+  tracker.InvalidatePage(9);
+
+  auto pages = MakePages(10);
+  InvalidatedPages result = tracker.Take(pages, 5, 5);
+  ASSERT_EQ(result.invalid_rects_twips.size(), size_t(3));
+  EXPECT_EQ(result.invalid_rects_twips[0], pages[0]);
+  EXPECT_EQ(result.invalid_rects_twips[1], gfx::UnionRects(pages[4], pages[5]));
+  EXPECT_EQ(result.invalid_rects_twips[2], pages[9]);
+  ASSERT_EQ(result.paint_rects_twips.size(), size_t(1));
+  EXPECT_EQ(result.paint_rects_twips[0], gfx::UnionRects(pages[4], pages[5]));
+}
+
+TEST(InvalidationTrackerTest, UnknownVisiblePagesPaintNothing) {
+  InvalidationTracker tracker;
+  tracker.InvalidatePage(1);
+  InvalidatedPages result = tracker.Take(MakePages(3), -1, -1);
+  EXPECT_EQ(result.invalid_rects_twips.size(), size_t(1));
+  EXPECT_TRUE(result.paint_rects_twips.empty());
+}
+
+TEST(InvalidationTrackerTest, StalePageRectsInvalidateEverything) {
+  InvalidationTracker tracker;
+  tracker.InvalidatePage(7);
+  InvalidatedPages result = tracker.Take(MakePages(3), 0, 0);
+  EXPECT_TRUE(result.all);
+  EXPECT_EQ(result.paint_rects_twips.size(), size_t(1));
+}
+
+TEST(InvalidationTrackerTest, RectsOnlyPaintWithinVisiblePages) {
+  InvalidationTracker tracker;
+  // a word on page 1, a paragraph containing it, and a word on page 8
+  tracker.InvalidateRect(gfx::Rect(100, 1600, 200, 100));
+  tracker.InvalidateRect(gfx::Rect(0, 1500, 1000, 500));
+  tracker.InvalidateRect(gfx::Rect(100, 1700, 200, 100));
+  tracker.InvalidateRect(gfx::Rect(100, 12100, 200, 100));
+  tracker.InvalidateRect(gfx::Rect());
+  EXPECT_EQ(tracker.collapsed(), size_t(2));
+
+  auto pages = MakePages(10);
+  InvalidatedPages result = tracker.Take(pages, 0, 0);
+  EXPECT_FALSE(result.all);
+  ASSERT_EQ(result.invalid_rects_twips.size(), size_t(2));
+  EXPECT_EQ(result.invalid_rects_twips[0], gfx::Rect(0, 1500, 1000, 500));
+  EXPECT_EQ(result.invalid_rects_twips[1], gfx::Rect(100, 12100, 200, 100));
+  // page 8 is neither visible nor prefetched
+  ASSERT_EQ(result.paint_rects_twips.size(), size_t(1));
+  EXPECT_EQ(result.paint_rects_twips[0], gfx::Rect(0, 1500, 1000, 500));
+  EXPECT_FALSE(tracker.HasPending());
+}
+
+TEST(InvalidationTrackerTest, ManyRectsMergeIntoTheirBounds) {
+  InvalidationTracker tracker;
+  const int count = static_cast<int>(InvalidationTracker::kMaxRects) + 1;
+  for (int i = 0; i < count; ++i) {
+    tracker.InvalidateRect(gfx::Rect(0, i * 20, 10, 10));
+  }
+
+  InvalidatedPages result = tracker.Take(MakePages(3), -1, -1);
+  ASSERT_EQ(result.invalid_rects_twips.size(), size_t(1));
+  EXPECT_EQ(result.invalid_rects_twips[0],
+            gfx::Rect(0, 0, 10, (count - 1) * 20 + 10));
+  EXPECT_TRUE(result.paint_rects_twips.empty());
+}
+
+}  // namespace electron::office
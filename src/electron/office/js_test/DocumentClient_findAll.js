@@ -0,0 +1,19 @@
+libreoffice.loadDocument('private:factory/swriter').then(async (x) => {
+  assert(x != null);
+
+  const text = x.as('text.XTextDocument').getText();
+  text.setString('The contract\nthe end, THE END');
+
+  const all = await x.findAll('the');
+  assert(all.count === 3);
+  assert(all.rects.length === 3 * 4);
+  assert(all.pages.length === 1 && all.pages[0] === 0);
+  assert(Array.from(all.pageOffsets).join() === '0,3');
+
+  const matchCase = await x.findAll('the', { matchCase: true });
+  assert(matchCase.count === 1);
+
+  const limited = await x.findAll('the', { maxMatches: 1 });
+  assert(limited.count === 3);
+  assert(limited.rects.length === 4);
+});
@@ -0,0 +1,29 @@
+libreoffice.loadDocument('private:factory/scalc').then(async (x) => {
+  assert(x != null);
+
+  await x.setDataArray({
+    range: 'A1:B3',
+    values: [new Float64Array([1, 2.5, NaN]), ['one', 2, null]],
+  });
+
+  const data = await x.getDataArray({ sheet: 0, range: 'A1:B3' });
+  assert(data.rows === 3);
+  assert(data.columns === 2);
+  assert(data.numbers.length === 2);
+  assert(data.numbers[0][0] === 1 && data.numbers[0][1] === 2.5);
+  assert(Number.isNaN(data.numbers[0][2]));
+  assert(data.numbers[1][1] === 2);
+  assert(Array.from(data.kinds).join() === '1,1,0,2,1,0');
+
+  const decoder = new TextDecoder();
+  const text = (i) =>
+    decoder.decode(data.text.subarray(data.textOffsets[i], data.textOffsets[i + 1]));
+  assert(text(3) === 'one');
+  assert(text(0) === '');
+
+  let rejected = false;
+  await x
+    .setDataArray({ range: 'A1:A2', values: [[1, 2, 3]] })
+    .catch(() => (rejected = true));
+  assert(rejected);
+});
@@ -0,0 +1,30 @@
+libreoffice.loadDocument('private:factory/simpress').then(async (x) => {
+  assert(x != null);
+
+  const slide = await x.renderSlide({ part: 0, width: 320 });
+  assert(slide.part === 0);
+  assert(slide.width === 320);
+  assert(slide.height > 0);
+  assert(slide.data.length === slide.width * slide.height * 4);
+
+  // cached slides resolve with the same pixels
+  const cached = await x.renderSlide({ part: 0, width: 320 });
+  assert(cached.height === slide.height);
+
+  let caught = false;
+  try {
+    x.renderSlide({ part: 100, width: 320 });
+  } catch {
+    caught = true;
+  }
+  assert(caught);
+
+  const writer = await libreoffice.loadDocument('private:factory/swriter');
+  caught = false;
+  try {
+    writer.renderSlide({ part: 0, width: 320 });
+  } catch {
+    caught = true;
+  }
+  assert(caught);
+});
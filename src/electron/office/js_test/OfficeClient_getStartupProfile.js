@@ -0,0 +1,14 @@
+async function testOfficeClientGetStartupProfile() {
+  // LibreOffice has loaded once a document has
+  const docClient = await libreoffice.loadDocument('private:factory/swriter');
+  assert(docClient != null);
+
+  const profile = libreoffice.getStartupProfile();
+  const lokInit = profile.phases.find((phase) => phase.name === 'lokInit');
+  assert(lokInit != null && lokInit.durationMs > 0);
+  assert(profile.totalMs >= lokInit.durationMs);
+  assert(profile.prefetch.files >= 0 && profile.prefetch.bytes >= 0);
+  assert(Array.isArray(profile.filesRead));
+}
+
+testOfficeClientGetStartupProfile();
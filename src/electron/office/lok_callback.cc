@@ -12,7 +12,9 @@
 
 #include "LibreOfficeKit/LibreOfficeKitEnums.h"
 #include "base/logging.h"
+#include "base/strings/string_number_conversions.h"
 #include "gin/converter.h"
+#include "gin/dictionary.h"
 #include "ui/gfx/geometry/rect.h"
 #include "v8-primitive.h"
 #include "v8/include/v8-exception.h"
@@ -202,7 +204,9 @@ int EventStringToType(const std::u16string& eventString) {
       {u"color_palettes", LOK_CALLBACK_COLOR_PALETTES},
       {u"document_password_reset", LOK_CALLBACK_DOCUMENT_PASSWORD_RESET},
       {u"a11y_focused_cell_changed", LOK_CALLBACK_A11Y_FOCUSED_CELL_CHANGED},
-      {u"ready", 300}  // this is a special event internal to ELOK
+      {u"ready", kReadyEvent},
+      {u"state_diff", kStateDiffEvent},
+      {u"reload_failed", kReloadFailedEvent},
   };
 
   auto it = EventStringToTypeMap.find(eventString);
@@ -213,6 +217,8 @@ int EventStringToType(const std::u16string& eventString) {
 }
 
 bool IsTypeJSON(int type) {
+  if (type == kStateDiffEvent)
+    return true;
   switch (static_cast<LibreOfficeKitCallbackType>(type)) {
     case LOK_CALLBACK_INVALIDATE_VISIBLE_CURSOR:  // INVALIDATE_VISIBLE_CURSOR
                                                   // may also be CSV
@@ -391,6 +397,29 @@ v8::Local<v8::Value> PayloadToLocalValue(v8::Isolate* isolate,
   return ParseJSON(isolate, string);
 }
 
+v8::Local<v8::Value> TypedPayloadToLocalValue(v8::Isolate* isolate,
+                                              int type,
+                                              const std::string& payload) {
+  size_t equals = payload.find('=');
+  if (type != LOK_CALLBACK_STATE_CHANGED || payload.empty() ||
+      payload.front() == '{' || equals == std::string::npos) {
+    return PayloadToLocalValue(isolate, type, payload.c_str());
+  }
+
+  std::string value = payload.substr(equals + 1);
+  gin::Dictionary dict = gin::Dictionary::CreateEmpty(isolate);
+  dict.Set("commandId", payload.substr(0, equals));
+  double number;
+  if (value == "true" || value == "false") {
+    dict.Set("value", value == "true");
+  } else if (base::StringToDouble(value, &number)) {
+    dict.Set("value", number);
+  } else {
+    dict.Set("value", value);
+  }
+  return gin::ConvertToV8(isolate, dict);
+}
+
 /* Remaining odd/string types:
     case LOK_CALLBACK_MOUSE_POINTER:
     case LOK_CALLBACK_STATUS_INDICATOR_START:
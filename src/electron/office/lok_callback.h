@@ -12,6 +12,13 @@
 
 namespace electron::office::lok_callback {
 
+// events internal to ELOK, past the range of LOK's callback types
+constexpr int kReadyEvent = 300;
+// the JSON changes of a DocumentState, see DocumentState::TakeChanges
+constexpr int kStateDiffEvent = 301;
+// an unloaded document couldn't be loaded again, see DocumentHolder::Reload
+constexpr int kReloadFailedEvent = 302;
+
 std::string TypeToEventString(int type);
 int EventStringToType(const std::u16string& event_string);
 bool IsTypeJSON(int type);
@@ -36,6 +43,12 @@ v8::Local<v8::Value> ParseJSON(v8::Isolate* isolate,
 v8::Local<v8::Value> PayloadToLocalValue(v8::Isolate* isolate,
                                          int type,
                                          const char* payload);
+// same as PayloadToLocalValue, except that a STATE_CHANGED payload like
+// ".uno:Bold=true" becomes {commandId: ".uno:Bold", value: true}, the value is
+// a boolean or number when it parses as one
+v8::Local<v8::Value> TypedPayloadToLocalValue(v8::Isolate* isolate,
+                                              int type,
+                                              const std::string& payload);
 
 constexpr float kTwipPerPx = 15.0f;
 inline float PixelToTwip(float in, float zoom) {
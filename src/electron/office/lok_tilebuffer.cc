@@ -3,12 +3,19 @@
 // found in the LICENSE file.
 
 #include "electron/office/lok_tilebuffer.h"
+
+#include <algorithm>
+#include <cstring>
 #include "LibreOfficeKit/LibreOfficeKit.hxx"
+#include "LibreOfficeKit/LibreOfficeKitEnums.h"
 #include "base/auto_reset.h"
 #include "base/check.h"
+#include "base/containers/flat_set.h"
 #include "base/logging.h"
 #include "base/memory/aligned_memory.h"
 #include "base/threading/sequenced_task_runner_handle.h"
+#include "base/time/time.h"
+#include "base/trace_event/trace_event.h"
 #include "cc/paint/paint_canvas.h"
 #include "cc/paint/paint_image.h"
 #include "cc/paint/paint_image_builder.h"
@@ -29,17 +36,69 @@
 // #define TILEBUFFER_DEBUG_PAINT
 
 namespace electron::office {
-TileBuffer::TileBuffer()
+
+namespace {
+// tiles and mips are 32-bit rasters
+size_t ImageByteSize(const cc::PaintImage& image) {
+  return static_cast<size_t>(image.width()) * image.height() * 4;
+}
+
+// halves `image`, a linear filter at exactly half the size averages each 2x2
+// block of pixels
+cc::PaintImage Downsample(const cc::PaintImage& image) {
+  sk_sp<SkImage> source = image.GetSwSkImage();
+  if (!source)
+    return {};
+
+  SkBitmap bitmap;
+  const SkImageInfo info = source->imageInfo().makeWH(
+      std::max(1, source->width() / 2), std::max(1, source->height() / 2));
+  if (!bitmap.tryAllocPixels(info) ||
+      !source->scalePixels(bitmap.pixmap(),
+                           SkSamplingOptions(SkFilterMode::kLinear))) {
+    return {};
+  }
+  bitmap.setImmutable();
+  return cc::PaintImageBuilder::WithDefault()
+      .set_id(cc::PaintImage::GetNextId())
+      .set_image(bitmap.asImage(), cc::PaintImage::GetNextContentId())
+      .TakePaintImage();
+}
+}  // namespace
+TileBuffer::TileBuffer(int tile_size_px)
     : base::RefCountedDeleteOnSequence<TileBuffer>(
           base::SequencedTaskRunnerHandle::Get()),
+      tile_size_px_(tile_size_px),
       valid_tile_(0),
-      active_context_hash_(0) {
-  pool_buffer_ =
-      std::shared_ptr<uint8_t[]>(static_cast<uint8_t*>(base::AlignedAlloc(
-                                     kPoolAllocatedSize, kPoolAligned)),
-                                 base::AlignedFreeDeleter{});
+      active_context_hash_(0),
+      buffer_stride_(TileByteSize(tile_size_px)),
+      pool_size_(kPoolAllocatedSize / buffer_stride_ - 1),
+      pool_index_to_tile_index_(pool_size_, kInvalidTileIndex),
+      pool_paint_images_(pool_size_) {
+  DCHECK(IsValidTileSize(tile_size_px));
+  AcquirePool();
+}
+
+// static
+bool TileBuffer::IsValidTileSize(int tile_size_px) {
+  return tile_size_px == 256 || tile_size_px == 512 || tile_size_px == 1024;
+}
+
+// static
+int TileBuffer::ChooseTileSize(float device_scale, int document_type) {
+  int tile_size_px = kTileSizePx;
+  // keeps the number of tiles per viewport close to that of a 1x display
+  if (device_scale > 2.5f) {
+    tile_size_px = 1024;
+  } else if (device_scale > 1.5f) {
+    tile_size_px = 512;
+  }
 
-  std::fill_n(pool_index_to_tile_index_, kPoolSize, kInvalidTileIndex);
+  // cell edits invalidate small rects, which would repaint the whole tile
+  if (document_type == LOK_DOCTYPE_SPREADSHEET)
+    tile_size_px = std::min(tile_size_px, 512);
+
+  return tile_size_px;
 }
 
 Snapshot::Snapshot(std::vector<cc::PaintImage> tiles_,
@@ -57,6 +116,48 @@ Snapshot::Snapshot(std::vector<cc::PaintImage> tiles_,
       row_end(row_end_),
       scroll_y_position(scroll_y_position) {}
 
+// static
+int Snapshot::MipLevel(float ratio) {
+  int level = 0;
+  while (level < kMaxMipLevels && ratio * (1 << (level + 1)) <= 1.0f)
+    ++level;
+  return level;
+}
+
+// static
+std::vector<std::vector<cc::PaintImage>> Snapshot::BuildMips(
+    std::vector<cc::PaintImage> source,
+    int levels) {
+  std::vector<std::vector<cc::PaintImage>> result;
+  for (int level = 0; level < levels; ++level) {
+    TRACE_EVENT1("electron", "Snapshot::BuildMips", "level", level + 1);
+    std::vector<cc::PaintImage> mip;
+    mip.reserve(source.size());
+    for (const cc::PaintImage& tile : source) {
+      cc::PaintImage half = Downsample(tile);
+      if (!half)
+        return result;
+      mip.emplace_back(std::move(half));
+    }
+    source = mip;
+    result.emplace_back(std::move(mip));
+  }
+  return result;
+}
+
+size_t Snapshot::ByteSize() const {
+  auto image_bytes = [](const std::vector<cc::PaintImage>& images) {
+    size_t bytes = 0;
+    for (const cc::PaintImage& image : images)
+      bytes += ImageByteSize(image);
+    return bytes;
+  };
+  size_t bytes = image_bytes(tiles);
+  for (const std::vector<cc::PaintImage>& mip : mips)
+    bytes += image_bytes(mip);
+  return bytes;
+}
+
 Snapshot::Snapshot() = default;
 Snapshot::~Snapshot() = default;
 Snapshot::Snapshot(const Snapshot& other) = default;
@@ -66,7 +167,72 @@ Snapshot::Snapshot(Snapshot&& other) noexcept = default;
 
 TileBuffer::~TileBuffer() = default;
 
+std::shared_ptr<uint8_t[]> TileBuffer::AcquirePool() {
+  base::AutoLock lock(pool_lock_);
+  if (!pool_buffer_) {
+    TRACE_EVENT0("electron", "TileBuffer::AcquirePool");
+    pool_buffer_ =
+        std::shared_ptr<uint8_t[]>(static_cast<uint8_t*>(base::AlignedAlloc(
+                                       kPoolAllocatedSize, kPoolAligned)),
+                                   base::AlignedFreeDeleter{});
+  }
+  return pool_buffer_;
+}
+
+void TileBuffer::ReleasePool() {
+  TRACE_EVENT0("electron", "TileBuffer::ReleasePool");
+  base::AutoLock lock(pool_lock_);
+  valid_tile_.Clear();
+  std::fill(pool_index_to_tile_index_.begin(),
+            pool_index_to_tile_index_.end(), kInvalidTileIndex);
+  std::fill(pool_paint_images_.begin(), pool_paint_images_.end(),
+            cc::PaintImage());
+  pool_buffer_.reset();
+}
+
+bool TileBuffer::IsPoolReleased() {
+  base::AutoLock lock(pool_lock_);
+  return !pool_buffer_;
+}
+
+size_t TileBuffer::PoolByteSize() {
+  base::AutoLock lock(pool_lock_);
+  return pool_buffer_ ? kPoolAllocatedSize : 0;
+}
+
+size_t TileBuffer::TileImageByteSize() {
+  base::AutoLock lock(pool_lock_);
+  size_t images = std::count_if(
+      pool_paint_images_.begin(), pool_paint_images_.end(),
+      [](const cc::PaintImage& image) { return static_cast<bool>(image); });
+  return images * buffer_stride_;
+}
+
+size_t TileBuffer::SnapshotByteSize(const Snapshot& snapshot) {
+  // the snapshot holds the same paint images as the pool until they're
+  // repainted, so each is counted once
+  base::flat_set<cc::PaintImage::Id> shared;
+  {
+    base::AutoLock lock(pool_lock_);
+    for (const cc::PaintImage& image : pool_paint_images_) {
+      if (image)
+        shared.insert(image.stable_id());
+    }
+  }
+
+  size_t bytes = snapshot.ByteSize();
+  for (const cc::PaintImage& tile : snapshot.tiles) {
+    if (tile && shared.contains(tile.stable_id()))
+      bytes -= ImageByteSize(tile);
+  }
+  return bytes;
+}
+
 void TileBuffer::Resize(long width_twips, long height_twips, float scale) {
+  // the stats describe the tiles at one scale, a new tile size gets a new
+  // buffer
+  if (scale != scale_)
+    stats_.Reset();
   doc_width_twips_ = width_twips;
   doc_height_twips_ = height_twips;
   scale_ = scale;
@@ -74,11 +240,13 @@ void TileBuffer::Resize(long width_twips, long height_twips, float scale) {
   doc_width_scaled_px_ = lok_callback::TwipToPixel(doc_width_twips_, scale_);
   doc_height_scaled_px_ = lok_callback::TwipToPixel(doc_height_twips_, scale_);
 
-  columns_ = std::ceil(static_cast<double>(doc_width_scaled_px_) / kTileSizePx);
-  rows_ = std::ceil(static_cast<double>(doc_height_scaled_px_) / kTileSizePx);
+  columns_ =
+      std::ceil(static_cast<double>(doc_width_scaled_px_) / tile_size_px_);
+  rows_ = std::ceil(static_cast<double>(doc_height_scaled_px_) / tile_size_px_);
 
   valid_tile_ = AtomicBitset(columns_ * rows_ + 1);
-  std::fill_n(pool_index_to_tile_index_, kPoolSize, kInvalidTileIndex);
+  std::fill(pool_index_to_tile_index_.begin(),
+            pool_index_to_tile_index_.end(), kInvalidTileIndex);
 }
 
 void TileBuffer::Resize(long width_twips, long height_twips) {
@@ -97,17 +265,18 @@ void TileBuffer::ResetScale(float scale) {
   }
 }
 
-bool TileBuffer::PaintTile(CancelFlagPtr cancel_flag,
-                           DocumentHolderWithView document,
-                           unsigned int tile_index,
-                           std::size_t context_hash) {
-  static const SkImageInfo image_info_ = SkImageInfo::Make(
-      kTileSizePx, kTileSizePx, kBGRA_8888_SkColorType, kPremul_SkAlphaType);
+TileBuffer::PaintResult TileBuffer::PaintTile(CancelFlagPtr cancel_flag,
+                                              DocumentHolderWithView document,
+                                              unsigned int tile_index,
+                                              std::size_t context_hash) {
+  TRACE_EVENT1("electron", "TileBuffer::PaintTile", "tile_index",
+               tile_index);
   size_t pool_index;
   const unsigned int max = columns_ * rows_ - 1;
   if (const std::size_t ah = active_context_hash_; ah != context_hash) {
     valid_tile_.Clear();
-    return false;
+    stats_.RecordTilesCancelled();
+    return PaintResult::kCancelled;
   }
 
   if (tile_index > max) {
@@ -117,7 +286,13 @@ bool TileBuffer::PaintTile(CancelFlagPtr cancel_flag,
                << " ch: " << context_hash;
     LOG(ERROR) << "BAD CONTEXT CLEAR != " << std::hex << context_hash;
     valid_tile_.Clear();
-    return false;
+    stats_.RecordTilesFailed();
+    return PaintResult::kFailed;
+  }
+
+  if (CancelFlag::IsCancelled(cancel_flag)) {
+    stats_.RecordTilesCancelled();
+    return PaintResult::kCancelled;
   }
 
   if (!TileToPoolIndex(tile_index, &pool_index)) {
@@ -125,45 +300,108 @@ bool TileBuffer::PaintTile(CancelFlagPtr cancel_flag,
     pool_index_to_tile_index_[pool_index] = tile_index;
   }
 
-  if (!CancelFlag::IsCancelled(cancel_flag) &&
-      tile_index < valid_tile_.Size() && !valid_tile_[tile_index]) {
-    std::pair<int, int> coord = IndexToCoord(tile_index);
-    int column = coord.first;
-    int row = coord.second;
-    uint8_t* buffer = GetPoolBuffer(pool_index);
-    std::fill_n(reinterpret_cast<uint32_t*>(buffer),
-                kBufferStride / sizeof(uint32_t), SK_ColorTRANSPARENT);
-    document->paintTile(buffer, kTileSizePx, kTileSizePx,
-                        lok_callback::PixelToTwip(kTileSizePx * column, scale_),
-                        lok_callback::PixelToTwip(kTileSizePx * row, scale_),
-                        lok_callback::PixelToTwip(kTileSizePx, scale_),
-                        lok_callback::PixelToTwip(kTileSizePx, scale_));
-
-    if (const std::size_t ah = active_context_hash_; ah != context_hash) {
-      valid_tile_.Clear();
-      return false;
-    }
-    sk_sp<SkImage> image = SkImage::MakeRasterData(
-        image_info_,
-        SkData::MakeWithCopy(GetPoolBuffer(pool_index), kBufferStride),
-        kTileSizePx * kBytesPerPx);
-    pool_paint_images_[pool_index] =
-        cc::PaintImageBuilder::WithDefault()
-            .set_id(cc::PaintImage::GetNextId())
-            .set_image(image, cc::PaintImage::GetNextContentId())
-            .TakePaintImage();
-
-    // because valid_tile is critical to render, check after rasterization
-    if (const std::size_t ah = active_context_hash_; ah != context_hash) {
-      valid_tile_.Clear();
-      return false;
+  if (tile_index >= valid_tile_.Size()) {
+    stats_.RecordTilesFailed();
+    return PaintResult::kFailed;
+  }
+  if (valid_tile_[tile_index])
+    return PaintResult::kValid;
+
+  std::pair<int, int> coord = IndexToCoord(tile_index);
+  int column = coord.first;
+  int row = coord.second;
+  std::shared_ptr<uint8_t[]> pool = AcquirePool();
+  uint8_t* buffer = &pool[pool_index * buffer_stride_];
+  std::fill_n(reinterpret_cast<uint32_t*>(buffer),
+              buffer_stride_ / sizeof(uint32_t), SK_ColorTRANSPARENT);
+  base::TimeTicks paint_start = base::TimeTicks::Now();
+  document->paintTile(buffer, tile_size_px_, tile_size_px_,
+                      lok_callback::PixelToTwip(tile_size_px_ * column, scale_),
+                      lok_callback::PixelToTwip(tile_size_px_ * row, scale_),
+                      lok_callback::PixelToTwip(tile_size_px_, scale_),
+                      lok_callback::PixelToTwip(tile_size_px_, scale_));
+  base::TimeDelta paint_time = base::TimeTicks::Now() - paint_start;
+
+  if (const std::size_t ah = active_context_hash_; ah != context_hash) {
+    valid_tile_.Clear();
+    stats_.RecordTilesCancelled();
+    return PaintResult::kCancelled;
+  }
+  StorePaintImage(pool_index, buffer);
+
+  // because valid_tile is critical to render, check after rasterization
+  if (const std::size_t ah = active_context_hash_; ah != context_hash) {
+    valid_tile_.Clear();
+    stats_.RecordTilesCancelled();
+    return PaintResult::kCancelled;
+  }
+
+  valid_tile_.Set(tile_index);
+  // only a tile that became valid counts as painted
+  stats_.RecordTilePainted(paint_time);
+  return PaintResult::kPainted;
+}
+
+void TileBuffer::StorePaintImage(size_t pool_index, const uint8_t* buffer) {
+  const SkImageInfo image_info =
+      SkImageInfo::Make(tile_size_px_, tile_size_px_, kBGRA_8888_SkColorType,
+                        kPremul_SkAlphaType);
+  sk_sp<SkImage> image =
+      SkImage::MakeRasterData(image_info,
+                              SkData::MakeWithCopy(buffer, buffer_stride_),
+                              tile_size_px_ * kBytesPerPx);
+  base::AutoLock lock(pool_lock_);
+  pool_paint_images_[pool_index] =
+      cc::PaintImageBuilder::WithDefault()
+          .set_id(cc::PaintImage::GetNextId())
+          .set_image(image, cc::PaintImage::GetNextContentId())
+          .TakePaintImage();
+}
+
+std::vector<unsigned int> TileBuffer::ValidTiles() {
+  std::vector<unsigned int> tiles;
+  base::AutoLock lock(pool_lock_);
+  if (!pool_buffer_)
+    return tiles;
+
+  for (size_t pool_index = 0; pool_index < pool_size_; ++pool_index) {
+    unsigned int tile_index = pool_index_to_tile_index_[pool_index];
+    if (tile_index != kInvalidTileIndex && tile_index < valid_tile_.Size() &&
+        valid_tile_[tile_index]) {
+      tiles.push_back(tile_index);
     }
+  }
+  return tiles;
+}
+
+bool TileBuffer::CopyTile(unsigned int tile_index, uint8_t* out) {
+  size_t pool_index;
+  base::AutoLock lock(pool_lock_);
+  if (!pool_buffer_ || !TileToPoolIndex(tile_index, &pool_index) ||
+      tile_index >= valid_tile_.Size() || !valid_tile_[tile_index]) {
+    return false;
+  }
+
+  std::memcpy(out, &pool_buffer_[pool_index * buffer_stride_], buffer_stride_);
+  return true;
+}
 
-    valid_tile_.Set(tile_index);
-    return true;
+bool TileBuffer::ImportTile(unsigned int tile_index, const uint8_t* pixels) {
+  if (tile_index >= columns_ * rows_)
+    return false;
+
+  size_t pool_index;
+  if (!TileToPoolIndex(tile_index, &pool_index)) {
+    InvalidatePoolTile(pool_index);
+    pool_index_to_tile_index_[pool_index] = tile_index;
   }
 
-  return tile_index < valid_tile_.Size() && valid_tile_[tile_index];
+  std::shared_ptr<uint8_t[]> pool = AcquirePool();
+  uint8_t* buffer = &pool[pool_index * buffer_stride_];
+  std::memcpy(buffer, pixels, buffer_stride_);
+  StorePaintImage(pool_index, buffer);
+  valid_tile_.Set(tile_index);
+  return true;
 }
 
 void TileBuffer::InvalidateTile(unsigned int column, unsigned int row) {
@@ -189,7 +427,7 @@ gfx::Rect TileRect(const gfx::RectF& target,
 TileRange TileBuffer::InvalidateTilesInRect(const gfx::RectF& rect,
                                             bool dry_run) {
   auto tile_rect =
-      TileRect(rect, doc_width_scaled_px_, doc_height_scaled_px_, kTileSizePx);
+      TileRect(rect, doc_width_scaled_px_, doc_height_scaled_px_, tile_size_px_);
   DCHECK(tile_rect.x() >= 0);
   DCHECK(tile_rect.y() >= 0);
   DCHECK(tile_rect.width() >= 0);
@@ -230,9 +468,9 @@ std::vector<TileRange> TileBuffer::InvalidRangesRemaining(
 TileBuffer::RowLimit TileBuffer::LimitRange(int y_pos,
                                             unsigned int view_height) {
   unsigned int start_row = y_pos < 0 ? 0 :
-      std::floor((double)y_pos / (double)TileBuffer::kTileSizePx);
-  unsigned int end_row = start_row + std::ceil((double)view_height /
-                                               (double)TileBuffer::kTileSizePx);
+      std::floor((double)y_pos / (double)tile_size_px_);
+  unsigned int end_row =
+      start_row + std::ceil((double)view_height / (double)tile_size_px_);
   return {start_row, std::max(start_row, end_row)};
 }
 
@@ -261,10 +499,8 @@ std::vector<TileRange> TileBuffer::ClipRanges(std::vector<TileRange> ranges,
   return clipped_ranges;
 }
 
-TileRange TileBuffer::NextScrollTileRange(int next_y_pos,
-                                          unsigned int view_height) {
-  next_y_pos = std::max(0, next_y_pos - (int)view_height);
-  auto row_limit = LimitRange(next_y_pos, view_height * 3);
+TileRange TileBuffer::BandTileRange(int y_pos, unsigned int height) {
+  auto row_limit = LimitRange(std::max(0, y_pos), height);
   unsigned int start_row = row_limit.start > 0 ? row_limit.start : 0;
   unsigned int end_row = row_limit.end;
 
@@ -276,10 +512,16 @@ TileRange TileBuffer::NextScrollTileRange(int next_y_pos,
   return {std::min(index_start, limit), std::min(index_end, limit)};
 }
 
+gfx::Rect TileBuffer::TileBounds(unsigned int tile_index) {
+  auto [column, row] = IndexToCoord(tile_index);
+  return gfx::Rect(tile_size_px_ * column, tile_size_px_ * row, tile_size_px_,
+                   tile_size_px_);
+}
+
 TileRange TileBuffer::InvalidateTilesInTwipRect(const gfx::Rect& rect_twips) {
   auto tile_rect = TileRect(std::move(gfx::RectF(rect_twips)), doc_width_twips_,
                             doc_height_twips_,
-                            lok_callback::PixelToTwip(kTileSizePx, scale_));
+                            lok_callback::PixelToTwip(tile_size_px_, scale_));
   DCHECK(tile_rect.x() >= 0);
   DCHECK(tile_rect.y() >= 0);
   DCHECK(tile_rect.width() >= 0);
@@ -312,6 +554,7 @@ std::vector<TileRange> TileBuffer::PaintToCanvas(CancelFlagPtr cancel_flag,
                                                  float total_scale,
                                                  bool scale_pending,
                                                  bool scrolling) {
+  TRACE_EVENT0("electron", "TileBuffer::PaintToCanvas");
   base::AutoReset<bool> auto_reset_in_paint(&in_paint_, true);
   cc::PaintFlags flags;
   flags.setBlendMode(SkBlendMode::kSrc);
@@ -320,7 +563,7 @@ std::vector<TileRange> TileBuffer::PaintToCanvas(CancelFlagPtr cancel_flag,
   auto offset_rect = gfx::RectF(rect);
   offset_rect.Offset(0, y_pos_);
   gfx::Rect tile_rect = TileRect(offset_rect, doc_width_scaled_px_,
-                                 doc_height_scaled_px_, kTileSizePx);
+                                 doc_height_scaled_px_, tile_size_px_);
 
   DCHECK(tile_rect.x() >= 0);
   DCHECK(tile_rect.y() >= 0);
@@ -342,7 +585,9 @@ std::vector<TileRange> TileBuffer::PaintToCanvas(CancelFlagPtr cancel_flag,
       unsigned int tile_index = CoordToIndex(column, row);
       size_t pool_index;
 
-      if (!TileToPoolIndex(tile_index, &pool_index)) {
+      bool resident = TileToPoolIndex(tile_index, &pool_index);
+      stats_.RecordPoolLookup(resident);
+      if (!resident) {
         if (missing_ranges.empty() ||
             missing_ranges.back().index_end + 1 != tile_index) {
           missing_ranges.emplace_back(tile_index, tile_index);
@@ -360,9 +605,9 @@ std::vector<TileRange> TileBuffer::PaintToCanvas(CancelFlagPtr cancel_flag,
       cc::PaintFlags debugPaint;
       debugPaint.setColor(SK_ColorRED);
       debugPaint.setStrokeWidth(1);
-      SkRect debugRect{(float)kTileSizePx * column, (float)kTileSizePx * row,
-                       (float)kTileSizePx * (column + 1),
-                       (float)kTileSizePx * (row + 1)};
+      SkRect debugRect{(float)tile_size_px_ * column, (float)tile_size_px_ * row,
+                       (float)tile_size_px_ * (column + 1),
+                       (float)tile_size_px_ * (row + 1)};
 
       SkFont font;
       font.setScaleX(0.5);
@@ -383,6 +628,7 @@ std::vector<TileRange> TileBuffer::PaintToCanvas(CancelFlagPtr cancel_flag,
     }
   }
 
+  const unsigned int visible_row_end = row_end;
   if (last_good_row != -1) {
     row_end = last_good_row;
   }
@@ -401,16 +647,16 @@ std::vector<TileRange> TileBuffer::PaintToCanvas(CancelFlagPtr cancel_flag,
         if (!TileToPoolIndex(tile_index, &pool_index)) {
           return missing_ranges;
         }
-        canvas->drawImage(pool_paint_images_[pool_index], kTileSizePx * column,
-                          kTileSizePx * row,
+        canvas->drawImage(pool_paint_images_[pool_index],
+                          tile_size_px_ * column, tile_size_px_ * row,
                           SkSamplingOptions(SkFilterMode::kLinear), &flags);
 #ifdef TILEBUFFER_DEBUG_PAINT
         cc::PaintFlags debugPaint;
         debugPaint.setColor(SK_ColorBLUE);
         debugPaint.setStrokeWidth(1);
-        SkRect debugRect{(float)kTileSizePx * column, (float)kTileSizePx * row,
-                         (float)kTileSizePx * (column + 1),
-                         (float)kTileSizePx * (row + 1)};
+        SkRect debugRect{(float)tile_size_px_ * column, (float)tile_size_px_ * row,
+                         (float)tile_size_px_ * (column + 1),
+                         (float)tile_size_px_ * (row + 1)};
 
         SkFont font;
         font.setScaleX(0.5);
@@ -434,32 +680,110 @@ std::vector<TileRange> TileBuffer::PaintToCanvas(CancelFlagPtr cancel_flag,
     return missing_ranges;
   }
 
-  // there are missing tiles, paint the snapshot (unless it isn't set)
-  if (snapshot.tiles.empty()) {
+  // there are missing tiles, they're filled with a placeholder under the
+  // snapshot so that they're never blank where the snapshot doesn't reach
+  if (!scale_pending) {
+    cc::PaintFlags placeholder_flags;
+    placeholder_flags.setColor(kPlaceholderColor);
+    for (const TileRange& range : missing_ranges) {
+      for (unsigned int index = range.index_start; index <= range.index_end;
+           ++index) {
+        auto [column, row] = IndexToCoord(index);
+        canvas->drawRect(
+            SkRect::MakeXYWH(tile_size_px_ * column, tile_size_px_ * row,
+                             tile_size_px_, tile_size_px_),
+            placeholder_flags);
+      }
+    }
+  }
+
+  // then the snapshot (unless it isn't set) under the tiles that are already
+  // painted
+  if (!snapshot.tiles.empty() &&
+      !PaintSnapshot(cancel_flag, canvas, snapshot, total_scale, flags)) {
+    return missing_ranges;
+  }
+
+  // until the scale is reset, the tiles are at the scale of the snapshot
+  if (scale_pending)
     return missing_ranges;
+
+  // tiles at the new scale replace the snapshot as they're painted, rather
+  // than once all of them are
+  for (unsigned int row = row_start; row < visible_row_end; ++row) {
+    for (unsigned int column = column_start; column < column_end; ++column) {
+      if (CancelFlag::IsCancelled(cancel_flag)) {
+        return missing_ranges;
+      }
+
+      // a tile that is resident but not valid is still being painted and its
+      // pool slot holds the image of whichever tile had it before
+      const unsigned int tile_index = CoordToIndex(column, row);
+      size_t pool_index;
+      cc::PaintImage image;
+      {
+        base::AutoLock lock(pool_lock_);
+        if (!TileToPoolIndex(tile_index, &pool_index) ||
+            tile_index >= valid_tile_.Size() || !valid_tile_[tile_index]) {
+          continue;
+        }
+        image = pool_paint_images_[pool_index];
+      }
+      canvas->drawImage(image, tile_size_px_ * column, tile_size_px_ * row,
+                        SkSamplingOptions(SkFilterMode::kLinear), &flags);
+    }
   }
 
+  return missing_ranges;
+}
+
+bool TileBuffer::PaintSnapshot(CancelFlagPtr cancel_flag,
+                               cc::PaintCanvas* canvas,
+                               const Snapshot& snapshot,
+                               float total_scale,
+                               const cc::PaintFlags& flags) {
+  cc::PaintCanvasAutoRestore auto_restore(canvas, true);
+  const float ratio = total_scale / snapshot.scale;
+  // zooming out draws the smallest mip level that is still larger than the
+  // target, so that the linear filter doesn't skip pixels. until that level is
+  // built the closest one is drawn. zooming in upsamples with a cubic filter,
+  // which is sharper than linear
+  const int mip_level = std::min(Snapshot::MipLevel(ratio),
+                                 static_cast<int>(snapshot.mips.size()));
+  const std::vector<cc::PaintImage>& tiles =
+      mip_level == 0 ? snapshot.tiles : snapshot.mips[mip_level - 1];
+  const SkSamplingOptions sampling =
+      ratio > 1.0f ? SkSamplingOptions(SkCubicResampler::Mitchell())
+                   : SkSamplingOptions(SkFilterMode::kLinear);
+
   // this seems redundant, but it's to adjust for scale without an offset that
   // causes jiggling
   canvas->translate(0, y_pos_);
-  canvas->scale(total_scale / snapshot.scale);
+  canvas->scale(ratio);
   canvas->translate(0, -y_pos_);
-  std::vector<cc::PaintImage>::const_iterator it = snapshot.tiles.cbegin();
+  const int snapshot_tile_size_px =
+      snapshot.tile_size_px > 0 ? snapshot.tile_size_px : tile_size_px_;
+  std::vector<cc::PaintImage>::const_iterator it = tiles.cbegin();
   for (unsigned int row = snapshot.row_start; row < snapshot.row_end; ++row) {
     for (unsigned int column = snapshot.column_start;
          column < snapshot.column_end; ++column) {
       if (CancelFlag::IsCancelled(cancel_flag)) {
-        return missing_ranges;
+        return false;
       }
-      canvas->drawImage(*it++, kTileSizePx * column, kTileSizePx * row,
-                        SkSamplingOptions(SkFilterMode::kLinear), &flags);
+      const cc::PaintImage& tile = *it++;
+      canvas->drawImageRect(
+          tile, SkRect::MakeIWH(tile.width(), tile.height()),
+          SkRect::MakeXYWH(snapshot_tile_size_px * column,
+                           snapshot_tile_size_px * row, snapshot_tile_size_px,
+                           snapshot_tile_size_px),
+          sampling, &flags, SkCanvas::kFast_SrcRectConstraint);
 #ifdef TILEBUFFER_DEBUG_PAINT
       cc::PaintFlags debugPaint;
       debugPaint.setColor(SK_ColorBLUE);
       debugPaint.setStrokeWidth(1);
-      SkRect debugRect{(float)kTileSizePx * column, (float)kTileSizePx * row,
-                       (float)kTileSizePx * (column + 1),
-                       (float)kTileSizePx * (row + 1)};
+      SkRect debugRect{(float)tile_size_px_ * column, (float)tile_size_px_ * row,
+                       (float)tile_size_px_ * (column + 1),
+                       (float)tile_size_px_ * (row + 1)};
       std::string coord;
       coord += std::to_string(column);
       coord += "x";
@@ -483,7 +807,7 @@ std::vector<TileRange> TileBuffer::PaintToCanvas(CancelFlagPtr cancel_flag,
     }
   }
 
-  return missing_ranges;
+  return true;
 }
 
 bool TileRange::operator==(const TileRange& rhs) const {
@@ -530,14 +854,21 @@ bool TileBuffer::IsEmpty() {
   return rows_ == 0 || columns_ == 0;
 }
 
+int TileBuffer::PoolHeightPx() const {
+  if (columns_ == 0)
+    return 0;
+  return static_cast<int>(pool_size_ / columns_) * tile_size_px_;
+}
+
 Snapshot TileBuffer::MakeSnapshot(CancelFlagPtr cancel_flag,
                                   const gfx::Rect& rect) {
+  TRACE_EVENT0("electron", "TileBuffer::MakeSnapshot");
   std::vector<cc::PaintImage> tiles;
 
   auto offset_rect = gfx::RectF(rect);
   offset_rect.Offset(0, y_pos_);
   gfx::Rect tile_rect = TileRect(offset_rect, doc_width_scaled_px_,
-                                 doc_height_scaled_px_, kTileSizePx);
+                                 doc_height_scaled_px_, tile_size_px_);
 
   DCHECK(tile_rect.x() >= 0);
   DCHECK(tile_rect.y() >= 0);
@@ -565,8 +896,10 @@ Snapshot TileBuffer::MakeSnapshot(CancelFlagPtr cancel_flag,
     }
   }
 
-  return Snapshot(std::move(tiles), scale_, column_start, column_end, row_start,
-                  row_end, y_pos_);
+  Snapshot snapshot(std::move(tiles), scale_, column_start, column_end,
+                    row_start, row_end, y_pos_);
+  snapshot.tile_size_px = tile_size_px_;
+  return snapshot;
 }
 
 }  // namespace electron::office
@@ -6,13 +6,17 @@
 
 #include <vector>
 #include "base/memory/ref_counted_delete_on_sequence.h"
+#include "base/synchronization/lock.h"
 #include "base/memory/scoped_refptr.h"
 #include "base/memory/weak_ptr.h"
 #include "cc/paint/paint_canvas.h"
+#include "cc/paint/paint_flags.h"
+#include "cc/paint/paint_image.h"
 #include "office/atomic_bitset.h"
 #include "office/cancellation_flag.h"
 #include "office/document_holder.h"
 #include "office/lok_callback.h"
+#include "office/render_stats.h"
 #include "third_party/skia/include/core/SkBitmap.h"
 #include "third_party/skia/include/core/SkCanvas.h"
 #include "ui/gfx/geometry/rect.h"
@@ -55,6 +59,23 @@ struct Snapshot {
   unsigned int row_start = 0;
   unsigned int row_end = 0;
   unsigned int scroll_y_position = 0;
+  // the tile size of the buffer the snapshot was made from
+  int tile_size_px = 0;
+  // the tiles downsampled by 2, 4, etc. so that zooming out doesn't alias,
+  // these are built off the main thread by BuildMips and appended once ready
+  std::vector<std::vector<cc::PaintImage>> mips;
+  static constexpr int kMaxMipLevels = 3;
+
+  // the mip level for drawing the snapshot at `ratio` of its scale, 0 for the
+  // tiles themselves
+  static int MipLevel(float ratio);
+  // halves `source` `levels` times, each level from the one before. stops
+  // early if a tile can't be downsampled
+  static std::vector<std::vector<cc::PaintImage>> BuildMips(
+      std::vector<cc::PaintImage> source,
+      int levels);
+  // the pixels of the tiles and mip levels
+  size_t ByteSize() const;
 
   Snapshot(std::vector<cc::PaintImage> tiles_,
            float scale_,
@@ -77,8 +98,17 @@ struct Snapshot {
 
 class TileBuffer : public base::RefCountedDeleteOnSequence<TileBuffer> {
  public:
+  // the default and smallest tile size
   static constexpr int kTileSizePx = 256;
-  static constexpr int kTileSizeTwips = kTileSizePx * lok_callback::kTwipPerPx;
+  static constexpr int kMaxTileSizePx = 1024;
+
+  // Chooses the tile size for a device scale and LibreOfficeKitDocumentType.
+  // Each tile is a separate paintTile call with a fixed overhead, so larger
+  // tiles pay off where a viewport is made of many device pixels, except in
+  // spreadsheets where small cell edits would repaint a large tile.
+  static int ChooseTileSize(float device_scale, int document_type);
+  // true for 256, 512 and 1024
+  static bool IsValidTileSize(int tile_size_px);
 
   // no copy
   TileBuffer(const TileBuffer& other) = delete;
@@ -90,8 +120,11 @@ class TileBuffer : public base::RefCountedDeleteOnSequence<TileBuffer> {
   TileRange InvalidateTilesInRect(const gfx::RectF& rect, bool dry_run = false);
   // returns the TileRange of invalidated tiles in the rect
   TileRange InvalidateTilesInTwipRect(const gfx::Rect& rect_twips);
-  // returns the TileRange of tiles for a predicted scroll range
-  TileRange NextScrollTileRange(int next_y_pos, unsigned int view_height);
+  // returns the TileRange of the rows in a band of `height` px at `y_pos`,
+  // clamped to the document
+  TileRange BandTileRange(int y_pos, unsigned int height);
+  // the bounds of a tile, in device pixels relative to the top of the document
+  gfx::Rect TileBounds(unsigned int tile_index);
   void InvalidateAllTiles();
   std::vector<TileRange> PaintToCanvas(CancelFlagPtr cancel_flag,
                                        cc::PaintCanvas* canvas,
@@ -101,10 +134,21 @@ class TileBuffer : public base::RefCountedDeleteOnSequence<TileBuffer> {
                                        bool scale_pending,
                                        bool scrolling);
   Snapshot MakeSnapshot(CancelFlagPtr cancel_flag, const gfx::Rect& rect);
-  bool PaintTile(CancelFlagPtr cancel_flag,
-                 DocumentHolderWithView document,
-                 unsigned int tile_index,
-                 std::size_t context_hash);
+  // how a tile ended up after PaintTile, every result but kValid is counted
+  // once in stats()
+  enum class PaintResult {
+    // rasterized by LOK
+    kPainted,
+    // already valid, nothing was painted
+    kValid,
+    kCancelled,
+    // outside of the buffer
+    kFailed,
+  };
+  PaintResult PaintTile(CancelFlagPtr cancel_flag,
+                        DocumentHolderWithView document,
+                        unsigned int tile_index,
+                        std::size_t context_hash);
   void SetYPosition(float y);
   void Resize(long width_twips, long heigh_twips);
   void Resize(long width_twips, long heigh_twips, float scale);
@@ -116,9 +160,45 @@ class TileBuffer : public base::RefCountedDeleteOnSequence<TileBuffer> {
                                     TileRange range_limit);
 
   void SetActiveContext(std::size_t active_context_hash);
-  TileBuffer();
+  explicit TileBuffer(int tile_size_px = kTileSizePx);
   bool IsEmpty();
 
+  // frees the tile pool and invalidates every tile, the pool is allocated again
+  // by the next tile that is painted
+  void ReleasePool();
+  bool IsPoolReleased();
+
+  // Memory accounting {
+  // the allocated size of the pool, 0 while it's released
+  size_t PoolByteSize();
+  // the paint images of the valid tiles, which copy the pixels of the pool
+  size_t TileImageByteSize();
+  // the size of `snapshot` without the tiles that are still paint images of
+  // this buffer, which are counted by TileImageByteSize
+  size_t SnapshotByteSize(const Snapshot& snapshot);
+  // }
+
+  // for moving the painted tiles to another process {
+  long doc_width_twips() const { return doc_width_twips_; }
+  long doc_height_twips() const { return doc_height_twips_; }
+  float scale() const { return scale_; }
+  int tile_size_px() const { return tile_size_px_; }
+  // the height of the rows that fit in the tile pool at once, tiles further
+  // apart than this share a pool index
+  int PoolHeightPx() const;
+  size_t TileByteSize() const { return buffer_stride_; }
+  static size_t TileByteSize(int tile_size_px) {
+    return static_cast<size_t>(tile_size_px) * tile_size_px * kBytesPerPx;
+  }
+  std::vector<unsigned int> ValidTiles();
+  // copies the pixels of a valid tile to `out`, which must be TileByteSize()
+  bool CopyTile(unsigned int tile_index, uint8_t* out);
+  // copies `pixels` into the pool as `tile_index`, marking it valid
+  bool ImportTile(unsigned int tile_index, const uint8_t* pixels);
+  // }
+
+  RenderStats& stats() { return stats_; }
+
  private:
   friend class base::RefCountedDeleteOnSequence<TileBuffer>;
   friend class base::DeleteHelper<TileBuffer>;
@@ -142,7 +222,7 @@ class TileBuffer : public base::RefCountedDeleteOnSequence<TileBuffer> {
 
   unsigned long NextPoolIndex() {
     return current_pool_index_.fetch_add(1, std::memory_order_relaxed) %
-           kPoolSize;
+           pool_size_;
   }
 
   void InvalidatePoolTile(size_t pool_index) {
@@ -156,14 +236,23 @@ class TileBuffer : public base::RefCountedDeleteOnSequence<TileBuffer> {
     pool_index_to_tile_index_[pool_index] = kInvalidTileIndex;
   }
 
-  uint8_t* GetPoolBuffer(size_t pool_index) {
-    return &pool_buffer_[pool_index * kBufferStride];
-  }
+  // draws the tiles of `snapshot` at `total_scale` from the closest mip level
+  // that is built, returns false if cancelled
+  bool PaintSnapshot(CancelFlagPtr cancel_flag,
+                     cc::PaintCanvas* canvas,
+                     const Snapshot& snapshot,
+                     float total_scale,
+                     const cc::PaintFlags& flags);
+
+  // returns the pool, allocating it if it was released
+  std::shared_ptr<uint8_t[]> AcquirePool();
+  // makes the paint image of the tile at `pool_index` from its pixels
+  void StorePaintImage(size_t pool_index, const uint8_t* buffer);
 
   // returns true if the tile resides in the pool, false otherwise
   bool TileToPoolIndex(unsigned int tile_index, size_t* pool_index) {
-    size_t result = *pool_index = tile_index % kPoolSize;
-    return result < kPoolSize &&
+    size_t result = *pool_index = tile_index % pool_size_;
+    return result < pool_size_ &&
            pool_index_to_tile_index_[result] == tile_index;
   }
 
@@ -174,6 +263,8 @@ class TileBuffer : public base::RefCountedDeleteOnSequence<TileBuffer> {
 
   RowLimit LimitRange(int y_pos, unsigned int view_height);
 
+  const int tile_size_px_;
+
   unsigned int columns_ = 0;
   unsigned int rows_ = 0;
   float scale_ = 1.0f;
@@ -196,21 +287,28 @@ class TileBuffer : public base::RefCountedDeleteOnSequence<TileBuffer> {
   static constexpr size_t kPoolAllocatedSize = 256 * 1024 * 1024;
   static constexpr size_t kPoolAligned = 4096;
   static constexpr size_t kBytesPerPx = 4;  // both color types are 32-bit
+  // drawn for a missing tile that the snapshot doesn't cover
+  static constexpr SkColor kPlaceholderColor = SK_ColorWHITE;
   static constexpr unsigned int kInvalidTileIndex =
       std::numeric_limits<unsigned int>::max();
 
+  // guards pool_buffer_ and pool_paint_images_ against ReleasePool
+  base::Lock pool_lock_;
   std::shared_ptr<uint8_t[]> pool_buffer_ = nullptr;
-  static constexpr size_t kBufferStride =
-      kTileSizePx * kTileSizePx * kBytesPerPx;
-  static constexpr size_t kPoolSize = kPoolAllocatedSize / kBufferStride - 1;
+  // the byte size of a tile and the number of tiles in the pool
+  const size_t buffer_stride_;
+  const size_t pool_size_;
 
-  unsigned int pool_index_to_tile_index_[kPoolSize];
-  std::array<cc::PaintImage, kPoolSize> pool_paint_images_;
+  std::vector<unsigned int> pool_index_to_tile_index_;
+  std::vector<cc::PaintImage> pool_paint_images_;
 
   std::atomic<unsigned long long> current_pool_index_ = 0;
 
   // scroll position
   int y_pos_ = 0;
   bool in_paint_ = false;
+
+  // lives with the tile buffer so that stats survive a renderer remount
+  RenderStats stats_;
 };
 }  // namespace electron::office
@@ -5,14 +5,50 @@
 #include "office/lok_tilebuffer.h"
 #include "office_client.h"
 
+#include <vector>
+#include "base/memory/scoped_refptr.h"
+#include "base/test/task_environment.h"
+#include "cc/paint/skia_paint_canvas.h"
 #include "gin/converter.h"
+#include "office/cancellation_flag.h"
+#include "office/lok_callback.h"
 #include "office/test/office_test.h"
 #include "testing/gtest/include/gtest/gtest.h"
+#include "third_party/skia/include/core/SkBitmap.h"
+#include "third_party/skia/include/core/SkCanvas.h"
 
 namespace electron::office {
 
 using TileBufferTest = OfficeTest;
 
+namespace {
+constexpr int kTile = TileBuffer::kTileSizePx;
+
+// a row of `columns` tiles at a scale of 1
+scoped_refptr<TileBuffer> MakeRow(unsigned int columns) {
+  auto buffer = base::MakeRefCounted<TileBuffer>();
+  buffer->Resize(lok_callback::PixelToTwip(kTile * columns, 1.0f),
+                 lok_callback::PixelToTwip(kTile, 1.0f), 1.0f);
+  return buffer;
+}
+
+void ImportColor(TileBuffer* buffer, unsigned int tile_index, SkColor color) {
+  std::vector<uint32_t> pixels(kTile * kTile, color);
+  ASSERT_TRUE(buffer->ImportTile(
+      tile_index, reinterpret_cast<const uint8_t*>(pixels.data())));
+}
+
+SkColor ColorAt(const SkBitmap& bitmap, unsigned int column, float scale) {
+  return bitmap.getColor((kTile * column + kTile / 2) * scale,
+                         kTile / 2 * scale);
+}
+}  // namespace
+
+class TileBufferPaintTest : public ::testing::Test {
+ protected:
+  base::test::TaskEnvironment task_environment_;
+};
+
 TEST_F(TileBufferTest, SingleEventHandler) {
 }
 
@@ -56,4 +92,147 @@ TEST(TileBufferUtilityTest, TileCount) {
   EXPECT_EQ(TileCount(multi), size_t(6 + 15 + 1));
 }
 
+TEST_F(TileBufferPaintTest, SkipsTilesThatAreStillPainting) {
+  scoped_refptr<TileBuffer> buffer = MakeRow(3);
+  ImportColor(buffer.get(), 0, SK_ColorBLUE);
+  // resident in the pool, but invalidated and not yet painted again
+  ImportColor(buffer.get(), 1, SK_ColorRED);
+  buffer->InvalidateTile(1);
+  // tile 2 is missing, so the tiles are drawn as they're painted
+
+  SkBitmap bitmap;
+  bitmap.allocN32Pixels(kTile * 3, kTile);
+  bitmap.eraseColor(SK_ColorGREEN);
+  SkCanvas sk_canvas(bitmap);
+  cc::SkiaPaintCanvas canvas(&sk_canvas);
+
+  std::vector<TileRange> missing = buffer->PaintToCanvas(
+      CancelFlag::Create(), &canvas, Snapshot(), gfx::Rect(kTile * 3, kTile),
+      1.0f, false, false);
+  EXPECT_EQ(missing, std::vector<TileRange>{TileRange(2, 2)});
+
+  EXPECT_EQ(ColorAt(bitmap, 0, 1.0f), SK_ColorBLUE);
+  // the pool's image isn't drawn until the tile is valid again
+  EXPECT_EQ(ColorAt(bitmap, 1, 1.0f), SK_ColorGREEN);
+  EXPECT_EQ(ColorAt(bitmap, 2, 1.0f), SK_ColorWHITE);
+}
+
+TEST_F(TileBufferPaintTest, PresentsValidTilesOverTheSnapshot) {
+  scoped_refptr<TileBuffer> buffer = MakeRow(3);
+  for (unsigned int tile = 0; tile < 3; ++tile)
+    ImportColor(buffer.get(), tile, SK_ColorRED);
+  Snapshot snapshot =
+      buffer->MakeSnapshot(CancelFlag::Create(), gfx::Rect(kTile * 3, kTile));
+
+  // an edit repaints the row, of which only the first tile is painted so far
+  buffer->Resize(buffer->doc_width_twips(), buffer->doc_height_twips(), 1.0f);
+  ImportColor(buffer.get(), 0, SK_ColorBLUE);
+
+  SkBitmap bitmap;
+  bitmap.allocN32Pixels(kTile * 3, kTile);
+  bitmap.eraseColor(SK_ColorGREEN);
+  SkCanvas sk_canvas(bitmap);
+  cc::SkiaPaintCanvas canvas(&sk_canvas);
+
+  std::vector<TileRange> missing = buffer->PaintToCanvas(
+      CancelFlag::Create(), &canvas, snapshot, gfx::Rect(kTile * 3, kTile),
+      1.0f, false, false);
+  EXPECT_EQ(missing, std::vector<TileRange>{TileRange(1, 2)});
+  EXPECT_EQ(ColorAt(bitmap, 0, 1.0f), SK_ColorBLUE);
+  EXPECT_EQ(ColorAt(bitmap, 1, 1.0f), SK_ColorRED);
+  EXPECT_EQ(ColorAt(bitmap, 2, 1.0f), SK_ColorRED);
+}
+
+TEST_F(TileBufferPaintTest, TileBounds) {
+  scoped_refptr<TileBuffer> buffer = MakeRow(3);
+  EXPECT_EQ(buffer->TileBounds(0), gfx::Rect(0, 0, kTile, kTile));
+  EXPECT_EQ(buffer->TileBounds(2), gfx::Rect(kTile * 2, 0, kTile, kTile));
+}
+
+TEST_F(TileBufferPaintTest, ResetsStatsAtANewScale) {
+  scoped_refptr<TileBuffer> buffer = MakeRow(3);
+  buffer->stats().RecordPoolLookup(true);
+
+  // an edit resizes the buffer at the same scale
+  buffer->Resize(buffer->doc_width_twips(), buffer->doc_height_twips(), 1.0f);
+  EXPECT_EQ(buffer->stats().pool_hits(), uint64_t(1));
+
+  buffer->ResetScale(2.0f);
+  EXPECT_EQ(buffer->stats().pool_hits(), uint64_t(0));
+}
+
+TEST_F(TileBufferPaintTest, SnapshotByteSizeCountsSharedTilesOnce) {
+  scoped_refptr<TileBuffer> buffer = MakeRow(2);
+  ImportColor(buffer.get(), 0, SK_ColorBLUE);
+  ImportColor(buffer.get(), 1, SK_ColorRED);
+  Snapshot snapshot =
+      buffer->MakeSnapshot(CancelFlag::Create(), gfx::Rect(kTile * 2, kTile));
+  const size_t tile_bytes = TileBuffer::TileByteSize(kTile);
+  EXPECT_EQ(snapshot.ByteSize(), tile_bytes * 2);
+
+  // both tiles are still the buffer's paint images
+  EXPECT_EQ(buffer->SnapshotByteSize(snapshot), size_t(0));
+
+  // a repainted tile leaves the snapshot with the only copy of the old one
+  ImportColor(buffer.get(), 0, SK_ColorGREEN);
+  EXPECT_EQ(buffer->SnapshotByteSize(snapshot), tile_bytes);
+}
+
+TEST(SnapshotTest, MipLevel) {
+  EXPECT_EQ(Snapshot::MipLevel(2.0f), 0);
+  EXPECT_EQ(Snapshot::MipLevel(1.0f), 0);
+  EXPECT_EQ(Snapshot::MipLevel(0.6f), 0);
+  EXPECT_EQ(Snapshot::MipLevel(0.5f), 1);
+  EXPECT_EQ(Snapshot::MipLevel(0.25f), 2);
+  EXPECT_EQ(Snapshot::MipLevel(0.01f), Snapshot::kMaxMipLevels);
+}
+
+TEST_F(TileBufferPaintTest, BuildsMipsFromTheLevelBefore) {
+  scoped_refptr<TileBuffer> buffer = MakeRow(2);
+  ImportColor(buffer.get(), 0, SK_ColorBLUE);
+  ImportColor(buffer.get(), 1, SK_ColorRED);
+  Snapshot snapshot =
+      buffer->MakeSnapshot(CancelFlag::Create(), gfx::Rect(kTile * 2, kTile));
+  ASSERT_EQ(snapshot.tiles.size(), size_t(2));
+
+  std::vector<std::vector<cc::PaintImage>> mips =
+      Snapshot::BuildMips(snapshot.tiles, 2);
+  ASSERT_EQ(mips.size(), size_t(2));
+  for (size_t level = 0; level < mips.size(); ++level) {
+    ASSERT_EQ(mips[level].size(), size_t(2));
+    EXPECT_EQ(mips[level][0].width(), kTile >> (level + 1));
+    EXPECT_EQ(mips[level][1].height(), kTile >> (level + 1));
+  }
+}
+
+TEST_F(TileBufferPaintTest, DrawsTheSnapshotBeforeItsMipsAreBuilt) {
+  scoped_refptr<TileBuffer> buffer = MakeRow(2);
+  ImportColor(buffer.get(), 0, SK_ColorBLUE);
+  ImportColor(buffer.get(), 1, SK_ColorRED);
+  Snapshot snapshot =
+      buffer->MakeSnapshot(CancelFlag::Create(), gfx::Rect(kTile * 2, kTile));
+
+  SkBitmap bitmap;
+  bitmap.allocN32Pixels(kTile * 2, kTile);
+  SkCanvas sk_canvas(bitmap);
+  cc::SkiaPaintCanvas canvas(&sk_canvas);
+
+  // painting never builds the mips, the tiles are drawn instead
+  bitmap.eraseColor(SK_ColorGREEN);
+  buffer->PaintToCanvas(CancelFlag::Create(), &canvas, snapshot,
+                        gfx::Rect(kTile * 2, kTile), 0.25f, true, false);
+  EXPECT_TRUE(snapshot.mips.empty());
+  EXPECT_EQ(ColorAt(bitmap, 0, 0.25f), SK_ColorBLUE);
+  EXPECT_EQ(ColorAt(bitmap, 1, 0.25f), SK_ColorRED);
+
+  // and the built levels once they're appended
+  snapshot.mips =
+      Snapshot::BuildMips(snapshot.tiles, Snapshot::MipLevel(0.25f));
+  bitmap.eraseColor(SK_ColorGREEN);
+  buffer->PaintToCanvas(CancelFlag::Create(), &canvas, snapshot,
+                        gfx::Rect(kTile * 2, kTile), 0.25f, true, false);
+  EXPECT_EQ(ColorAt(bitmap, 0, 0.25f), SK_ColorBLUE);
+  EXPECT_EQ(ColorAt(bitmap, 1, 0.25f), SK_ColorRED);
+}
+
 }  // namespace electron::office
@@ -0,0 +1,67 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "office/memory_budget.h"
+
+#include <algorithm>
+
+namespace electron::office {
+
+DocumentMemoryUsage::DocumentMemoryUsage() = default;
+DocumentMemoryUsage::~DocumentMemoryUsage() = default;
+DocumentMemoryUsage::DocumentMemoryUsage(const DocumentMemoryUsage&) = default;
+DocumentMemoryUsage& DocumentMemoryUsage::operator=(
+    const DocumentMemoryUsage&) = default;
+
+size_t DocumentMemoryUsage::Total() const {
+  size_t total = thumbnail_bytes + unloaded_bytes;
+  for (const ViewMemoryUsage& view : views)
+    total += view.Total();
+  return total;
+}
+
+bool DocumentMemoryUsage::HasVisibleView() const {
+  return std::any_of(views.begin(), views.end(),
+                     [](const ViewMemoryUsage& view) { return view.visible; });
+}
+
+std::vector<ReclaimStep> PlanReclaim(const DocumentMemoryUsage& usage,
+                                     size_t budget_bytes) {
+  std::vector<ReclaimStep> steps;
+  size_t total = usage.Total();
+  if (total <= budget_bytes)
+    return steps;
+
+  size_t hidden_tiles = 0;
+  size_t hidden_snapshots = 0;
+  for (const ViewMemoryUsage& view : usage.views) {
+    if (view.visible)
+      continue;
+    hidden_tiles += view.tile_pool_bytes + view.tile_bytes;
+    hidden_snapshots += view.snapshot_bytes;
+  }
+
+  if (hidden_tiles > 0) {
+    steps.push_back(ReclaimStep::kEvictTiles);
+    total -= hidden_tiles;
+    if (total <= budget_bytes)
+      return steps;
+  }
+
+  if (hidden_snapshots > 0) {
+    steps.push_back(ReclaimStep::kReleaseSnapshots);
+    total -= hidden_snapshots;
+    if (total <= budget_bytes)
+      return steps;
+  }
+
+  // LOK's own memory isn't accounted for, so hibernating is worthwhile even
+  // when only the thumbnails would be freed
+  if (!usage.hibernated && !usage.unload_blocked && !usage.HasVisibleView())
+    steps.push_back(ReclaimStep::kHibernate);
+
+  return steps;
+}
+
+}  // namespace electron::office
@@ -0,0 +1,78 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "base/observer_list_types.h"
+
+namespace electron::office {
+
+// the memory held by one renderer of a document
+struct ViewMemoryUsage {
+  // the tile pool, allocated as a whole by the first painted tile
+  size_t tile_pool_bytes = 0;
+  // the paint images of the valid tiles, which copy the pool's pixels
+  size_t tile_bytes = 0;
+  // the snapshot and its mip levels, without the snapshot's tiles that are
+  // still shared with the paint images and so are counted in tile_bytes
+  size_t snapshot_bytes = 0;
+  bool visible = false;
+  // unmounted and waiting to be remounted
+  bool restorable = false;
+
+  size_t Total() const {
+    return tile_pool_bytes + tile_bytes + snapshot_bytes;
+  }
+};
+
+struct DocumentMemoryUsage {
+  std::vector<ViewMemoryUsage> views;
+  // page thumbnails and slides
+  size_t thumbnail_bytes = 0;
+  // the compressed document held in memory while it's unloaded
+  size_t unloaded_bytes = 0;
+  bool hibernated = false;
+  // an unload is already running or LOK refused one recently
+  bool unload_blocked = false;
+
+  size_t Total() const;
+  bool HasVisibleView() const;
+
+  DocumentMemoryUsage();
+  ~DocumentMemoryUsage();
+  DocumentMemoryUsage(const DocumentMemoryUsage&);
+  DocumentMemoryUsage& operator=(const DocumentMemoryUsage&);
+};
+
+// ordered from the cheapest to undo to the most expensive
+enum class ReclaimStep {
+  // frees the tile pools and paint images of hidden renderers, which are
+  // repainted once visible, the images shared with a snapshot are only freed
+  // once it's released too
+  kEvictTiles,
+  // frees the snapshots of hidden renderers, which cover missing tiles
+  kReleaseSnapshots,
+  // clears the thumbnails and unloads the document from LOK
+  kHibernate,
+};
+
+// Chooses the steps that bring `usage` within `budget_bytes`, in order and
+// stopping at the first step that is estimated to meet the budget. Steps that
+// wouldn't free anything are skipped, as is hibernating while the unload is
+// blocked. Visible renderers are never reclaimed, so the budget may still be
+// exceeded after every step.
+std::vector<ReclaimStep> PlanReclaim(const DocumentMemoryUsage& usage,
+                                     size_t budget_bytes);
+
+// a renderer of a document that reports and gives up its memory
+class MemoryReclaimer : public base::CheckedObserver {
+ public:
+  virtual ViewMemoryUsage GetMemoryUsage() = 0;
+  virtual void EvictTiles() = 0;
+  virtual void ReleaseSnapshot() = 0;
+};
+
+}  // namespace electron::office
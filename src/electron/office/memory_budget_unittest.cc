@@ -0,0 +1,72 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "memory_budget.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace electron::office {
+
+namespace {
+ViewMemoryUsage MakeView(size_t pool, size_t snapshot, bool visible) {
+  ViewMemoryUsage view;
+  view.tile_pool_bytes = pool;
+  view.snapshot_bytes = snapshot;
+  view.visible = visible;
+  return view;
+}
+}  // namespace
+
+TEST(MemoryBudgetTest, WithinBudgetReclaimsNothing) {
+  DocumentMemoryUsage usage;
+  usage.views.push_back(MakeView(100, 10, false));
+  usage.thumbnail_bytes = 5;
+  EXPECT_EQ(usage.Total(), size_t(115));
+  EXPECT_TRUE(PlanReclaim(usage, 115).empty());
+}
+
+TEST(MemoryBudgetTest, StopsAtTheFirstStepThatFits) {
+  DocumentMemoryUsage usage;
+  usage.views.push_back(MakeView(100, 10, true));
+  usage.views.push_back(MakeView(100, 10, false));
+
+  EXPECT_EQ(PlanReclaim(usage, 150),
+            std::vector<ReclaimStep>{ReclaimStep::kEvictTiles});
+  EXPECT_EQ(PlanReclaim(usage, 110),
+            (std::vector<ReclaimStep>{ReclaimStep::kEvictTiles,
+                                      ReclaimStep::kReleaseSnapshots}));
+  // a visible renderer is never reclaimed or hibernated
+  EXPECT_EQ(PlanReclaim(usage, 0),
+            (std::vector<ReclaimStep>{ReclaimStep::kEvictTiles,
+                                      ReclaimStep::kReleaseSnapshots}));
+}
+
+TEST(MemoryBudgetTest, SkipsStepsThatFreeNothing) {
+  DocumentMemoryUsage usage;
+  // already evicted
+  usage.views.push_back(MakeView(0, 10, false));
+  usage.thumbnail_bytes = 50;
+
+  EXPECT_EQ(PlanReclaim(usage, 50),
+            std::vector<ReclaimStep>{ReclaimStep::kReleaseSnapshots});
+  EXPECT_EQ(PlanReclaim(usage, 10),
+            (std::vector<ReclaimStep>{ReclaimStep::kReleaseSnapshots,
+                                      ReclaimStep::kHibernate}));
+
+  usage.hibernated = true;
+  EXPECT_EQ(PlanReclaim(usage, 10),
+            std::vector<ReclaimStep>{ReclaimStep::kReleaseSnapshots});
+}
+
+TEST(MemoryBudgetTest, DoesNotHibernateWhileUnloadIsBlocked) {
+  DocumentMemoryUsage usage;
+  usage.views.push_back(MakeView(0, 10, false));
+  usage.thumbnail_bytes = 50;
+  usage.unload_blocked = true;
+
+  // the snapshots are still released
+  EXPECT_EQ(PlanReclaim(usage, 10),
+            std::vector<ReclaimStep>{ReclaimStep::kReleaseSnapshots});
+}
+
+}  // namespace electron::office
@@ -4,6 +4,7 @@
 
 #include "office/office_client.h"
 
+#include <algorithm>
 #include <memory>
 #include <string>
 
@@ -20,14 +21,20 @@
 #include "base/task/thread_pool.h"
 #include "base/threading/sequenced_task_runner_handle.h"
 #include "base/token.h"
+#include "build/build_config.h"
 #include "gin/converter.h"
+#include "gin/dictionary.h"
+#include "gin/function_template.h"
 #include "gin/handle.h"
 #include "gin/object_template_builder.h"
 #include "gin/per_isolate_data.h"
+#include "office/conversion_batch.h"
 #include "office/document_client.h"
 #include "office/document_holder.h"
+#include "office/process_converter.h"
 #include "office/office_instance.h"
 #include "office/promise.h"
+#include "office/startup_prefetch.h"
 #include "unov8.hxx"
 #include "v8/include/v8-function.h"
 #include "v8/include/v8-isolate.h"
@@ -151,6 +158,8 @@ gin::ObjectTemplateBuilder OfficeClient::GetObjectTemplateBuilder(
 			.SetMethod("getLastError", &OfficeClient::GetLastError)
       .SetMethod("loadDocumentFromArrayBuffer",
                  &OfficeClient::LoadDocumentFromArrayBuffer)
+      .SetMethod("convertBatch", &OfficeClient::ConvertBatch)
+      .SetMethod("getStartupProfile", &OfficeClient::GetStartupProfile)
       .SetMethod("__handleBeforeUnload", &OfficeClient::HandleBeforeUnload);
 }
 
@@ -162,6 +171,37 @@ lok::Office* OfficeClient::GetOffice() const {
   return office_;
 }
 
+v8::Local<v8::Value> OfficeClient::GetStartupProfile(v8::Isolate* isolate) {
+  StartupProfile profile = OfficeInstance::Get()->GetStartupProfile();
+
+  std::vector<v8::Local<v8::Value>> phases;
+  base::TimeDelta total;
+  for (const StartupPhase& phase : profile.phases) {
+    gin::Dictionary phase_dict = gin::Dictionary::CreateEmpty(isolate);
+    phase_dict.Set("name", phase.name);
+    phase_dict.Set("durationMs", phase.duration.InMillisecondsF());
+    phases.push_back(gin::ConvertToV8(isolate, phase_dict));
+    total += phase.duration;
+  }
+
+  gin::Dictionary prefetch = gin::Dictionary::CreateEmpty(isolate);
+  prefetch.Set("files", static_cast<uint32_t>(profile.prefetch.files));
+  prefetch.Set("bytes", static_cast<double>(profile.prefetch.bytes));
+  prefetch.Set("durationMs", profile.prefetch.duration.InMillisecondsF());
+
+  std::vector<std::string> files_read;
+  for (const auto& file : profile.files_read) {
+    files_read.push_back(file.AsUTF8Unsafe());
+  }
+
+  gin::Dictionary dict = gin::Dictionary::CreateEmpty(isolate);
+  dict.Set("phases", phases);
+  dict.Set("totalMs", total.InMillisecondsF());
+  dict.Set("prefetch", prefetch);
+  dict.Set("filesRead", files_read);
+  return gin::ConvertToV8(isolate, dict);
+}
+
 std::string OfficeClient::GetLastError() {
   if (!GetOffice()) {
     return std::string();
@@ -336,6 +376,238 @@ v8::Local<v8::Promise> OfficeClient::SetDocumentPasswordAsync(
 }
 */
 
+namespace {
+const char* ConversionStatusToString(ConversionResult::Status status) {
+  switch (status) {
+    case ConversionResult::Status::kPending:
+      return "pending";
+    case ConversionResult::Status::kSucceeded:
+      return "succeeded";
+    case ConversionResult::Status::kFailed:
+      return "failed";
+    case ConversionResult::Status::kTimedOut:
+      return "timedOut";
+    case ConversionResult::Status::kCancelled:
+      return "cancelled";
+  }
+  NOTREACHED();
+  return "";
+}
+
+v8::Local<v8::Value> ConversionResultToV8(v8::Isolate* isolate,
+                                          const ConversionResult& result) {
+  gin::Dictionary dict = gin::Dictionary::CreateEmpty(isolate);
+  dict.Set("index", static_cast<uint32_t>(result.index));
+  dict.Set("status", ConversionStatusToString(result.status));
+  if (!result.error.empty())
+    dict.Set("error", result.error);
+  dict.Set("elapsedMs", result.elapsed.InMillisecondsF());
+  dict.Set("bytesRead", static_cast<double>(result.bytes_read));
+  dict.Set("bytesWritten", static_cast<double>(result.bytes_written));
+  return gin::ConvertToV8(isolate, dict);
+}
+
+v8::Local<v8::Value> ConversionStatsToV8(v8::Isolate* isolate,
+                                         const ConversionStats& stats) {
+  gin::Dictionary dict = gin::Dictionary::CreateEmpty(isolate);
+  dict.Set("succeeded", static_cast<uint32_t>(stats.succeeded));
+  dict.Set("failed", static_cast<uint32_t>(stats.failed));
+  dict.Set("timedOut", static_cast<uint32_t>(stats.timed_out));
+  dict.Set("cancelled", static_cast<uint32_t>(stats.cancelled));
+  dict.Set("bytesRead", static_cast<double>(stats.bytes_read));
+  dict.Set("bytesWritten", static_cast<double>(stats.bytes_written));
+  dict.Set("elapsedMs", stats.elapsed.InMillisecondsF());
+  dict.Set("jobsPerSecond", stats.Throughput());
+  return gin::ConvertToV8(isolate, dict);
+}
+}  // namespace
+
+namespace {
+#if BUILDFLAG(IS_WIN)
+constexpr base::FilePath::CharType kWorkerExecutable[] =
+    FILE_PATH_LITERAL("soffice.exe");
+#else
+constexpr base::FilePath::CharType kWorkerExecutable[] =
+    FILE_PATH_LITERAL("soffice");
+#endif
+}  // namespace
+
+v8::Local<v8::Value> OfficeClient::ConvertBatch(gin::Arguments* args) {
+  v8::Isolate* isolate = args->isolate();
+  v8::Local<v8::Context> context = isolate->GetCurrentContext();
+
+  std::vector<v8::Local<v8::Object>> job_objects;
+  if (!args->GetNext(&job_objects)) {
+    args->ThrowTypeError("missing jobs");
+    return {};
+  }
+
+  std::vector<ConversionJob> jobs;
+  jobs.reserve(job_objects.size());
+  for (auto& job_object : job_objects) {
+    gin::Dictionary job_dict(isolate, job_object);
+    std::string input;
+    std::string output;
+    if (!job_dict.Get("input", &input) || !job_dict.Get("output", &output)) {
+      args->ThrowTypeError("each job requires an input and output path");
+      return {};
+    }
+    ConversionJob& job = jobs.emplace_back();
+    job.input = base::FilePath::FromUTF8Unsafe(input);
+    job.output = base::FilePath::FromUTF8Unsafe(output);
+    job_dict.Get("format", &job.format);
+    job_dict.Get("filterOptions", &job.filter_options);
+  }
+
+  size_t concurrency = ConversionBatch::kDefaultConcurrency;
+  base::TimeDelta timeout;
+  ConversionBatch::ProgressCallback progress;
+  int processes = 0;
+  v8::Local<v8::Object> options;
+  if (args->GetNext(&options)) {
+    gin::Dictionary options_dict(isolate, options);
+    int max_concurrency;
+    bool has_concurrency =
+        options_dict.Get("concurrency", &max_concurrency) &&
+        max_concurrency > 0;
+    if (has_concurrency)
+      concurrency = max_concurrency;
+    // each worker process converts one document at a time, a job past that
+    // would only wait for a worker
+    if (options_dict.Get("processes", &processes) && processes > 0) {
+      concurrency = has_concurrency
+                        ? std::min<size_t>(concurrency, processes)
+                        : processes;
+    }
+    double timeout_ms;
+    if (options_dict.Get("timeoutMs", &timeout_ms) && timeout_ms > 0) {
+      timeout = base::Milliseconds(timeout_ms);
+    }
+    v8::Local<v8::Function> on_progress;
+    if (options_dict.Get("onProgress", &on_progress)) {
+      progress = base::BindRepeating(&OfficeClient::OnBatchProgress,
+                                     weak_factory_.GetWeakPtr(), isolate,
+                                     SafeV8Function(isolate, on_progress));
+    }
+  }
+
+  Promise<v8::Value> promise(isolate);
+  v8::Local<v8::Promise> done = promise.GetHandle();
+  int id = next_batch_id_++;
+  ConversionBatch::Converter converter = base::BindRepeating(&ConvertWithLok);
+  if (processes > 0) {
+    // the converter is kept between batches, so its worker profiles are
+    // reused
+    if (!process_converter_ ||
+        process_converter_->size() != size_t(processes)) {
+      process_converter_ = base::MakeRefCounted<ProcessConverter>(
+          OfficeInstance::ProgramPath().Append(kWorkerExecutable), processes);
+    }
+    converter =
+        base::BindRepeating(&ProcessConverter::Convert, process_converter_);
+  }
+
+  batches_[id] = std::make_unique<ConversionBatch>(
+      std::move(jobs), concurrency, timeout, std::move(converter),
+      std::move(progress),
+      base::BindOnce(&OfficeClient::OnBatchDone, weak_factory_.GetWeakPtr(),
+                     id, std::move(promise)));
+
+  // worker processes don't need LOK in this process
+  if (processes > 0 || loaded_.is_signaled()) {
+    StartBatch(id);
+  } else {
+    loaded_.Post(FROM_HERE,
+                 base::BindOnce(&OfficeClient::StartBatch,
+                                weak_factory_.GetWeakPtr(), id));
+  }
+
+  gin::Dictionary batch = gin::Dictionary::CreateEmpty(isolate);
+  batch.Set("done", v8::Local<v8::Value>(done));
+  batch.Set("cancel", gin::CreateFunctionTemplate(
+                          isolate, base::BindRepeating(
+                                       &OfficeClient::CancelBatch,
+                                       weak_factory_.GetWeakPtr(), id))
+                          ->GetFunction(context)
+                          .ToLocalChecked());
+  batch.Set("getStats",
+            gin::CreateFunctionTemplate(
+                isolate, base::BindRepeating(&OfficeClient::GetBatchStats,
+                                             weak_factory_.GetWeakPtr(), id))
+                ->GetFunction(context)
+                .ToLocalChecked());
+  return gin::ConvertToV8(isolate, batch);
+}
+
+void OfficeClient::StartBatch(int id) {
+  auto it = batches_.find(id);
+  if (it != batches_.end())
+    it->second->Start();
+}
+
+void OfficeClient::CancelBatch(int id) {
+  auto it = batches_.find(id);
+  if (it != batches_.end())
+    it->second->Cancel();
+}
+
+// static
+v8::Local<v8::Value> OfficeClient::GetBatchStats(
+    base::WeakPtr<OfficeClient> client,
+    int id,
+    v8::Isolate* isolate) {
+  if (!client)
+    return v8::Undefined(isolate);
+  auto it = client->batches_.find(id);
+  if (it == client->batches_.end())
+    return v8::Undefined(isolate);
+  return ConversionStatsToV8(isolate, it->second->Stats());
+}
+
+void OfficeClient::OnBatchProgress(v8::Isolate* isolate,
+                                   SafeV8Function callback,
+                                   const ConversionResult& result) {
+  if (!callback.IsAlive())
+    return;
+  v8::HandleScope handle_scope(isolate);
+  v8::MicrotasksScope microtasks_scope(
+      isolate, v8::MicrotasksScope::kDoNotRunMicrotasks);
+  v8::Context::Scope context_scope(
+      callback.NewHandle(isolate)->GetCreationContextChecked());
+  V8FunctionInvoker<void(v8::Local<v8::Value>)>::Go(
+      isolate, callback, ConversionResultToV8(isolate, result));
+}
+
+void OfficeClient::OnBatchDone(int id,
+                               Promise<v8::Value> promise,
+                               const ConversionStats& stats,
+                               const std::vector<ConversionResult>& results) {
+  v8::Isolate* isolate = promise.isolate();
+  v8::HandleScope handle_scope(isolate);
+  v8::MicrotasksScope microtasks_scope(
+      isolate, v8::MicrotasksScope::kDoNotRunMicrotasks);
+  v8::Context::Scope context_scope(promise.GetContext());
+
+  std::vector<v8::Local<v8::Value>> v8_results;
+  v8_results.reserve(results.size());
+  for (const auto& result : results) {
+    v8_results.push_back(ConversionResultToV8(isolate, result));
+  }
+  gin::Dictionary dict(isolate,
+                       ConversionStatsToV8(isolate, stats).As<v8::Object>());
+  dict.Set("results", v8_results);
+  promise.Resolve(gin::ConvertToV8(isolate, dict));
+
+  // the batch is still on the stack, so release it afterwards
+  task_runner_->PostTask(FROM_HERE,
+                         base::BindOnce(
+                             [](base::WeakPtr<OfficeClient> client, int id) {
+                               if (client)
+                                 client->batches_.erase(id);
+                             },
+                             weak_factory_.GetWeakPtr(), id));
+}
+
 base::WeakPtr<OfficeClient> OfficeClient::GetWeakPtr() {
   if (!lazy_tls->Get())
     return {};
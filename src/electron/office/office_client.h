@@ -4,12 +4,18 @@
 
 #pragma once
 
+#include <map>
+#include <memory>
+#include <vector>
 #include "base/memory/scoped_refptr.h"
 #include "base/memory/weak_ptr.h"
 #include "base/one_shot_event.h"
 #include "base/task/sequenced_task_runner.h"
+#include "gin/arguments.h"
 #include "gin/handle.h"
 #include "gin/wrappable.h"
+#include "office/promise.h"
+#include "office/v8_callback.h"
 #include "office_load_observer.h"
 #include "v8/include/v8-isolate.h"
 #include "v8/include/v8-local-handle.h"
@@ -25,6 +31,10 @@ namespace electron::office {
 
 class EventBus;
 class DocumentClient;
+class ConversionBatch;
+class ProcessConverter;
+struct ConversionResult;
+struct ConversionStats;
 
 class OfficeClient : public gin::Wrappable<OfficeClient>,
                      public OfficeLoadObserver {
@@ -69,9 +79,24 @@ class OfficeClient : public gin::Wrappable<OfficeClient>,
   v8::Local<v8::Promise> LoadDocumentFromArrayBuffer(
       v8::Isolate* isolate,
       v8::Local<v8::ArrayBuffer> array_buffer);
+  v8::Local<v8::Value> ConvertBatch(gin::Arguments* args);
+  v8::Local<v8::Value> GetStartupProfile(v8::Isolate* isolate);
   // }
 
  private:
+  void StartBatch(int id);
+  void CancelBatch(int id);
+  static v8::Local<v8::Value> GetBatchStats(base::WeakPtr<OfficeClient> client,
+                                            int id,
+                                            v8::Isolate* isolate);
+  void OnBatchProgress(v8::Isolate* isolate,
+                       SafeV8Function callback,
+                       const ConversionResult& result);
+  void OnBatchDone(int id,
+                   Promise<v8::Value> promise,
+                   const ConversionStats& stats,
+                   const std::vector<ConversionResult>& results);
+
   lok::Office* office_ = nullptr;
 
   v8::Global<v8::Context> context_;
@@ -79,6 +104,11 @@ class OfficeClient : public gin::Wrappable<OfficeClient>,
   base::OneShotEvent loaded_;
   scoped_refptr<base::SequencedTaskRunner> task_runner_;
 
+  std::map<int, std::unique_ptr<ConversionBatch>> batches_;
+  // converts in worker processes for batches with `processes` set
+  scoped_refptr<ProcessConverter> process_converter_;
+  int next_batch_id_ = 0;
+
   base::WeakPtrFactory<OfficeClient> weak_factory_{this};
 };
 
@@ -5,6 +5,7 @@
 #include "office_instance.h"
 
 #include <memory>
+#include <set>
 #include "LibreOfficeKit/LibreOfficeKit.hxx"
 #include "base/bind.h"
 #include "base/files/file_path.h"
@@ -14,6 +15,7 @@
 #include "base/path_service.h"
 #include "base/task/task_traits.h"
 #include "base/task/thread_pool.h"
+#include "base/trace_event/trace_event.h"
 
 #include "base/logging.h"
 #include "office/document_holder.h"
@@ -40,8 +42,14 @@ void OfficeInstance::Create() {
     return;
   once = true;
 
+  // the prefetch runs alongside LOK's initialization, the files it warms in
+  // time save a read from disk and the rest are read by LOK as usual
   base::ThreadPool::PostTask(
-      FROM_HERE, {base::TaskPriority::USER_BLOCKING},
+      FROM_HERE, {base::MayBlock(), base::TaskPriority::USER_BLOCKING},
+      base::BindOnce(&OfficeInstance::Prefetch,
+                     get_instance().weak_factory_.GetWeakPtr()));
+  base::ThreadPool::PostTask(
+      FROM_HERE, {base::MayBlock(), base::TaskPriority::USER_BLOCKING},
       base::BindOnce(&OfficeInstance::Initialize,
                      get_instance().weak_factory_.GetWeakPtr()));
 }
@@ -58,24 +66,92 @@ OfficeInstance::OfficeInstance()
 // to base::NoDestructor
 OfficeInstance::~OfficeInstance() = default;
 
-void OfficeInstance::Initialize() {
+base::FilePath OfficeInstance::ProgramPath() {
   base::FilePath module_path;
   if (!base::PathService::Get(base::DIR_MODULE, &module_path)) {
     NOTREACHED();
   }
 
-  base::FilePath libreoffice_path =
-      module_path.Append(FILE_PATH_LITERAL("libreofficekit"))
-          .Append(FILE_PATH_LITERAL("program"));
+  return module_path.Append(FILE_PATH_LITERAL("libreofficekit"))
+      .Append(FILE_PATH_LITERAL("program"));
+}
 
-  if (!unset_)
+void OfficeInstance::Initialize() {
+  TRACE_EVENT0("electron", "OfficeInstance::Initialize");
+  base::FilePath libreoffice_path = ProgramPath();
+  StartupTrace trace;
+
+  if (!unset_) {
+    TRACE_EVENT0("electron", "OfficeInstance::Initialize::LoadLibrary");
+    trace.StartPhase("loadLibrary");
+    PreloadLibrary(libreoffice_path);
+  }
+  if (!unset_) {
+    TRACE_EVENT0("electron", "OfficeInstance::Initialize::LokInit");
+    trace.StartPhase("lokInit");
     instance_.reset(lok::lok_cpp_init(libreoffice_path.AsUTF8Unsafe().c_str()));
-  if (!unset_)
+  }
+  if (!unset_) {
+    trace.StartPhase("optionalFeatures");
     instance_->setOptionalFeatures(
         LibreOfficeKitOptionalFeatures::LOK_FEATURE_NO_TILED_ANNOTATIONS);
-  if (!unset_)
+  }
+  trace.Finish();
+  {
+    base::AutoLock lock(startup_lock_);
+    startup_profile_.phases = trace.phases();
+  }
+
+  if (!unset_) {
     loaded_observers_->Notify(FROM_HERE, &OfficeLoadObserver::OnLoaded,
                               instance_.get());
+    base::ThreadPool::PostTask(
+        FROM_HERE, {base::MayBlock(), base::TaskPriority::BEST_EFFORT},
+        base::BindOnce(&OfficeInstance::RecordFilesRead,
+                       weak_factory_.GetWeakPtr()));
+  }
+}
+
+void OfficeInstance::Prefetch() {
+  TRACE_EVENT0("electron", "OfficeInstance::Prefetch");
+  base::FilePath install_dir = ProgramPath().DirName();
+  PrefetchStats stats = PrefetchFiles(
+      ReadPrefetchManifest(PrefetchManifestPath(install_dir), install_dir));
+
+  base::AutoLock lock(startup_lock_);
+  startup_profile_.prefetch = stats;
+}
+
+void OfficeInstance::RecordFilesRead() {
+  base::FilePath install_dir = ProgramPath().DirName();
+  // the libraries in the order they were mapped, then the configuration, which
+  // is read with read() and can't be seen in the mappings
+  std::vector<base::FilePath> files = MappedFilesUnder(install_dir);
+  std::set<base::FilePath> mapped(files.begin(), files.end());
+  for (auto& file : StartupConfigFiles(install_dir)) {
+    if (!mapped.count(file))
+      files.push_back(std::move(file));
+  }
+  // nothing was found, keep the previous manifest
+  if (!files.empty() &&
+      !WritePrefetchManifest(PrefetchManifestPath(install_dir), install_dir,
+                             files)) {
+    LOG(ERROR) << "unable to write the prefetch manifest";
+  }
+
+  std::vector<base::FilePath> relative_files;
+  for (const auto& file : files) {
+    base::FilePath relative;
+    if (install_dir.AppendRelativePath(file, &relative))
+      relative_files.push_back(std::move(relative));
+  }
+  base::AutoLock lock(startup_lock_);
+  startup_profile_.files_read = std::move(relative_files);
+}
+
+StartupProfile OfficeInstance::GetStartupProfile() const {
+  base::AutoLock lock(startup_lock_);
+  return startup_profile_;
 }
 
 bool OfficeInstance::IsValid() {
@@ -87,6 +163,10 @@ void OfficeInstance::Unset() {
   Get()->instance_.reset(nullptr);
 }
 
+lok::Office* OfficeInstance::GetOffice() const {
+  return instance_.get();
+}
+
 void OfficeInstance::AddLoadObserver(OfficeLoadObserver* observer) {
   if (instance_) {
     observer->OnLoaded(instance_.get());
@@ -122,8 +202,17 @@ void OfficeInstance::HandleDocumentCallback(int type,
 #ifdef DEBUG_EVENTS
   LOG(ERROR) << lokCallbackTypeToString(type) << " " << payload;
 #endif
-  it->second->Notify(FROM_HERE, &DocumentEventObserver::DocumentCallback, type,
-                     std::string(payload));
+  auto pending = base::MakeRefCounted<PendingDocumentCallback>(
+      &office_instance->pending_callbacks_);
+  TRACE_COUNTER1("electron", "PendingDocumentCallbacks",
+                 office_instance->pending_callbacks_.load());
+  it->second->Notify(FROM_HERE,
+                     &DocumentEventObserver::DispatchDocumentCallback, type,
+                     std::string(payload), std::move(pending));
+}
+
+int OfficeInstance::PendingCallbackCount() const {
+  return pending_callbacks_.load(std::memory_order_relaxed);
 }
 
 void OfficeInstance::AddDocumentObserver(DocumentEventId id,
@@ -6,10 +6,14 @@
 
 #include <unordered_map>
 #include <atomic>
+#include "base/files/file_path.h"
 #include "base/hash/hash.h"
 #include "base/observer_list_threadsafe.h"
+#include "base/synchronization/lock.h"
+#include "base/thread_annotations.h"
 #include "document_event_observer.h"
 #include "office/destroyed_observer.h"
+#include "office/startup_prefetch.h"
 #include "office_load_observer.h"
 
 namespace lok {
@@ -58,6 +62,11 @@ class OfficeInstance {
   static OfficeInstance* Get();
   static bool IsValid();
   static void Unset();
+  // the program directory of the bundled LibreOffice
+  static base::FilePath ProgramPath();
+
+  // null until LOK is loaded
+  lok::Office* GetOffice() const;
 
   void AddLoadObserver(OfficeLoadObserver* observer);
   void RemoveLoadObserver(OfficeLoadObserver* observer);
@@ -76,6 +85,12 @@ class OfficeInstance {
   void RemoveDestroyedObserver(DestroyedObserver* observer);
 	void HandleClientDestroyed();
 
+  // the number of LOK callbacks queued for observers but not yet handled
+  int PendingCallbackCount() const;
+
+  // the phases of loading LOK and the files it read
+  StartupProfile GetStartupProfile() const;
+
   // disable copy
   OfficeInstance(const OfficeInstance&) = delete;
   OfficeInstance& operator=(const OfficeInstance&) = delete;
@@ -84,7 +99,17 @@ class OfficeInstance {
   std::unique_ptr<lok::Office> instance_;
 	std::atomic<bool> unset_ = false;
 	std::atomic<bool> destroying_ = false;
+  // mutable because it's updated from the static LOK callback
+  mutable std::atomic<int> pending_callbacks_ = 0;
   void Initialize();
+  // warms the files recorded by the previous launch while LOK loads
+  void Prefetch();
+  // records the libraries LOK mapped and the configuration it reads while
+  // starting, for the next launch to prefetch
+  void RecordFilesRead();
+
+  mutable base::Lock startup_lock_;
+  StartupProfile startup_profile_ GUARDED_BY(startup_lock_);
 
   using OfficeLoadObserverList =
       base::ObserverListThreadSafe<OfficeLoadObserver>;
@@ -15,8 +15,10 @@
 #include "base/memory/weak_ptr.h"
 #include "base/no_destructor.h"
 #include "base/task/sequenced_task_runner.h"
+#include "base/task/thread_pool.h"
 #include "base/time/time.h"
 #include "base/timer/timer.h"
+#include "base/trace_event/trace_event.h"
 #include "cc/paint/paint_canvas.h"
 #include "content/public/renderer/render_frame.h"
 #include "gin/arguments.h"
@@ -27,12 +29,14 @@
 #include "include/core/SkColor.h"
 #include "office/cancellation_flag.h"
 #include "office/document_client.h"
+#include "office/input_queue.h"
 #include "office/lok_callback.h"
 #include "office/lok_tilebuffer.h"
 #include "office/office_client.h"
 #include "office/office_instance.h"
 #include "office/office_keys.h"
 #include "office/paint_manager.h"
+#include "office/renderer_transferable.h"
 #include "shell/common/gin_converters/gfx_converter.h"
 #include "third_party/blink/public/common/input/web_coalesced_input_event.h"
 #include "third_party/blink/public/common/input/web_input_event.h"
@@ -48,6 +52,7 @@
 #include "ui/gfx/geometry/rect_f.h"
 #include "ui/gfx/geometry/size.h"
 #include "ui/gfx/geometry/skia_conversions.h"
+#include "v8/include/v8-array-buffer.h"
 #include "v8/include/v8-isolate.h"
 #include "v8/include/v8-local-handle.h"
 #include "v8/include/v8-object.h"
@@ -81,12 +86,21 @@ OfficeWebPlugin::OfficeWebPlugin(blink::WebPluginParams /*params*/,
 
 bool OfficeWebPlugin::Initialize(blink::WebPluginContainer* container) {
   container_ = container;
-  return container::Initialize(container);
+  if (!container::Initialize(container))
+    return false;
+
+  tile_layer_ = std::make_unique<office::TileLayer>(this, container);
+  return true;
 }
 
 void OfficeWebPlugin::Destroy() {
   paint_manager_->OnDestroy();
+  caret_blink_timer_.Stop();
+  hibernate_timer_.Stop();
+  tile_layer_.reset();
+  SetRendererActive(false);
   if (document_client_.MaybeValid()) {
+    document_client_->RemoveMemoryReclaimer(this);
     document_client_->Unmount();
     document_client_->MarkRendererWillRemount(
         std::move(restore_key_),
@@ -139,6 +153,12 @@ v8::Local<v8::Object> OfficeWebPlugin::V8ScriptableObject(
             .SetMethod("debounceUpdates",
                        base::BindRepeating(&OfficeWebPlugin::DebounceUpdates,
                                            base::Unretained(this)))
+            .SetMethod("getRenderStats",
+                       base::BindRepeating(&OfficeWebPlugin::GetRenderStats,
+                                           base::Unretained(this)))
+            .SetMethod("exportRenderer",
+                       base::BindRepeating(&OfficeWebPlugin::ExportRenderer,
+                                           base::Unretained(this)))
             .SetProperty(
                 "documentSize",
                 base::BindRepeating(&OfficeWebPlugin::GetDocumentCSSPixelSize,
@@ -167,7 +187,10 @@ bool OfficeWebPlugin::SupportsKeyboardFocus() const {
 }
 
 void OfficeWebPlugin::UpdateAllLifecyclePhases(
-    blink::DocumentUpdateReason reason) {}
+    blink::DocumentUpdateReason reason) {
+  if (document_client_)
+    document_client_->OnFrame();
+}
 
 void OfficeWebPlugin::UpdateSnapshot(const office::Snapshot snapshot) {
   if (snapshot.tiles.empty())
@@ -175,7 +198,42 @@ void OfficeWebPlugin::UpdateSnapshot(const office::Snapshot snapshot) {
   snapshot_ = std::move(snapshot);
 }
 
+void OfficeWebPlugin::BuildSnapshotMips() {
+  if (building_mips_ || snapshot_.tiles.empty())
+    return;
+  const size_t built = snapshot_.mips.size();
+  const int level = office::Snapshot::MipLevel(TotalScale() / snapshot_.scale);
+  if (static_cast<size_t>(level) <= built)
+    return;
+
+  building_mips_ = true;
+  base::ThreadPool::PostTaskAndReplyWithResult(
+      FROM_HERE, {base::TaskPriority::USER_BLOCKING},
+      base::BindOnce(&office::Snapshot::BuildMips,
+                     built == 0 ? snapshot_.tiles : snapshot_.mips.back(),
+                     level - static_cast<int>(built)),
+      base::BindOnce(&OfficeWebPlugin::OnSnapshotMipsBuilt, GetWeakPtr(),
+                     snapshot_.tiles, built));
+}
+
+void OfficeWebPlugin::OnSnapshotMipsBuilt(
+    std::vector<cc::PaintImage> tiles,
+    size_t built,
+    std::vector<std::vector<cc::PaintImage>> mips) {
+  building_mips_ = false;
+  // the snapshot was replaced or released in the meantime
+  if (mips.empty() || snapshot_.tiles != tiles ||
+      snapshot_.mips.size() != built) {
+    return;
+  }
+
+  for (std::vector<cc::PaintImage>& mip : mips)
+    snapshot_.mips.emplace_back(std::move(mip));
+  InvalidatePluginContainer();
+}
+
 void OfficeWebPlugin::Paint(cc::PaintCanvas* canvas, const gfx::Rect& rect) {
+  TRACE_EVENT0("electron", "OfficeWebPlugin::Paint");
   base::AutoReset<bool> auto_reset_in_paint(&in_paint_, true);
   if (!visible_) {
     return;
@@ -195,16 +253,34 @@ void OfficeWebPlugin::Paint(cc::PaintCanvas* canvas, const gfx::Rect& rect) {
     return;
   }
 
+  // every tile is repainted when the plugin is visible again
+  if (tiles_hibernated_) {
+    return;
+  }
+
   if (!plugin_rect_.origin().IsOrigin())
     canvas->translate(plugin_rect_.x(), plugin_rect_.y());
 
-  gfx::Rect size(invalidate_rect.width(), invalidate_rect.height());
+  PaintTiles(canvas,
+             gfx::Rect(invalidate_rect.width(), invalidate_rect.height()));
+}
+
+void OfficeWebPlugin::PaintTiles(cc::PaintCanvas* canvas,
+                                 const gfx::Rect& rect) {
   std::vector<office::TileRange> missing =
-      tile_buffer_->PaintToCanvas(paint_cancel_flag_, canvas, snapshot_, size,
+      tile_buffer_->PaintToCanvas(paint_cancel_flag_, canvas, snapshot_, rect,
                                   TotalScale(), scale_pending_, scrolling_);
+  // the snapshot was drawn, at a different scale when zooming
+  if (scale_pending_ || (!missing.empty() && !scrolling_))
+    BuildSnapshotMips();
 
   if (missing.size() == 0 && take_snapshot_ && !scrolling_) {
-    UpdateSnapshot(tile_buffer_->MakeSnapshot(paint_cancel_flag_, size));
+    office::Snapshot snapshot =
+        tile_buffer_->MakeSnapshot(paint_cancel_flag_, rect);
+    // a tile layer band is made from the band's origin, the remount restores
+    // the scroll position instead
+    snapshot.scroll_y_position = scroll_y_position_;
+    UpdateSnapshot(std::move(snapshot));
     take_snapshot_ = false;
   }
   if (update_debounce_timer_ && !scrolling_)
@@ -217,14 +293,74 @@ void OfficeWebPlugin::Paint(cc::PaintCanvas* canvas, const gfx::Rect& rect) {
     ScheduleAvailableAreaPaint();
     first_paint_ = false;
   } else {
-    if (!paint_manager_->ScheduleNextPaint(missing) && missing.size() != 0) {
-      ScheduleAvailableAreaPaint();
-    }
+    ScheduleAfterPaint(std::move(missing));
     first_paint_ = false;
   }
   scrolling_ = false;
 }
 
+void OfficeWebPlugin::ScheduleAfterPaint(
+    std::vector<office::TileRange> missing) {
+  // while tiles are still being painted, this only presents the ones that
+  // are ready and the rest are scheduled once the task completes
+  if (!paint_manager_->IsPainting() &&
+      !paint_manager_->ScheduleNextPaint(missing)) {
+    if (missing.size() != 0) {
+      ScheduleAvailableAreaPaint();
+    } else {
+      SchedulePrefetchPaint();
+    }
+  }
+}
+
+void OfficeWebPlugin::PaintTileLayer(cc::PaintCanvas* canvas,
+                                     const gfx::Rect& band) {
+  base::AutoReset<bool> auto_reset_in_paint(&in_paint_, true);
+  if (!visible_ || !document_ || !tile_buffer_ || tile_buffer_->IsEmpty())
+    return;
+
+  // the band is recorded from its own origin, the layer offset accounts for
+  // the difference to the scroll position
+  tile_buffer_->SetYPosition(band.y());
+  PaintTiles(canvas, gfx::Rect(band.size()));
+  tile_buffer_->SetYPosition(scroll_y_position_);
+}
+
+gfx::Rect OfficeWebPlugin::TileLayerBand() {
+  int view_height = plugin_rect_.height();
+  int doc_height = GetDocumentPixelSize().height();
+  int band_y = std::max(0, scroll_y_position_ - view_height);
+  int band_bottom = std::min(std::max(doc_height, view_height),
+                             scroll_y_position_ + view_height * 3);
+  return gfx::Rect(0, band_y, plugin_rect_.width(),
+                   std::max(0, band_bottom - band_y));
+}
+
+void OfficeWebPlugin::UpdateTileLayer(bool force) {
+  if (!tile_layer_ || !document_)
+    return;
+
+  gfx::Rect view(0, scroll_y_position_, plugin_rect_.width(),
+                 plugin_rect_.height());
+  bool full = force || first_paint_ || scale_pending_ ||
+              !tile_layer_->Covers(view);
+
+  if (full || tile_layer_stale_) {
+    gfx::Rect damage = full ? gfx::Rect() : tile_layer_damage_;
+    tile_layer_stale_ = false;
+    tile_layer_damage_ = gfx::Rect();
+    // the painted tiles are outside of the band, so it isn't recorded again
+    if (!tile_layer_->Record(TileLayerBand(), damage))
+      ScheduleMissingTiles();
+  }
+
+  if (overlay_scale_ != TotalScale())
+    UpdateOverlay();
+
+  // applied by the compositor, no paint is necessary when only this changes
+  tile_layer_->ScrollTo(scroll_y_position_);
+}
+
 void OfficeWebPlugin::UpdateGeometry(const gfx::Rect& window_rect,
                                      const gfx::Rect& clip_rect,
                                      const gfx::Rect& unobscured_rect,
@@ -261,10 +397,73 @@ void OfficeWebPlugin::UpdateFocus(bool focused,
   }
 
   has_focus_ = focused;
+  UpdateOverlay();
 }
 
 void OfficeWebPlugin::UpdateVisibility(bool visibility) {
+  bool changed = visible_ != visibility;
   visible_ = visibility;
+  if (!changed)
+    return;
+
+  SetRendererActive(visible_);
+  if (visible_) {
+    hibernate_timer_.Stop();
+    if (tiles_hibernated_) {
+      tiles_hibernated_ = false;
+      if (document_ && !tile_buffer_->IsEmpty())
+        ScheduleAvailableAreaPaint();
+    }
+  } else if (document_client_.MaybeValid()) {
+    hibernate_timer_.Start(
+        FROM_HERE, document_client_->HibernateDelay(),
+        base::BindOnce(&OfficeWebPlugin::HibernateTiles, GetWeakPtr()));
+  }
+  UpdateTileLayer(true);
+}
+
+void OfficeWebPlugin::SetRendererActive(bool active) {
+  if (renderer_active_ == active)
+    return;
+  renderer_active_ = active;
+  if (document_client_.MaybeValid())
+    document_client_->SetRendererActive(active);
+}
+
+void OfficeWebPlugin::HibernateTiles() {
+  if (visible_ || !tile_buffer_)
+    return;
+  TRACE_EVENT0("electron", "OfficeWebPlugin::HibernateTiles");
+  paint_manager_->ClearTasks();
+  tile_buffer_->ReleasePool();
+  tiles_hibernated_ = true;
+}
+
+office::ViewMemoryUsage OfficeWebPlugin::GetMemoryUsage() {
+  office::ViewMemoryUsage usage;
+  usage.visible = visible_;
+  if (tile_buffer_) {
+    usage.tile_pool_bytes = tile_buffer_->PoolByteSize();
+    usage.tile_bytes = tile_buffer_->TileImageByteSize();
+    usage.snapshot_bytes = tile_buffer_->SnapshotByteSize(snapshot_);
+  } else {
+    usage.snapshot_bytes = snapshot_.ByteSize();
+  }
+  return usage;
+}
+
+void OfficeWebPlugin::EvictTiles() {
+  if (visible_)
+    return;
+  hibernate_timer_.Stop();
+  HibernateTiles();
+}
+
+void OfficeWebPlugin::ReleaseSnapshot() {
+  if (visible_)
+    return;
+  snapshot_ = office::Snapshot();
+  take_snapshot_ = true;
 }
 
 namespace {
@@ -414,11 +613,7 @@ blink::WebInputEventResult OfficeWebPlugin::HandleKeyEvent(
 
   int lok_key_code = office::DOMKeyCodeToLOKKeyCode(event.dom_code, modifiers);
 
-  document_.Post(base::BindOnce(
-      [](LibreOfficeKitKeyEventType key_event, char16_t text, int lok_key_code,
-         DocumentHolderWithView holder) {
-        holder->postKeyEvent(key_event, text, lok_key_code);
-      },
+  PostInputEvent(office::InputEvent::Key(
       type == blink::WebInputEvent::Type::kKeyUp ? LOK_KEYEVENT_KEYUP
                                                  : LOK_KEYEVENT_KEYINPUT,
       event.text[0], lok_key_code));
@@ -469,14 +664,8 @@ bool OfficeWebPlugin::HandleMouseEvent(blink::WebInputEvent::Type type,
     buttons |= 4;
 
   if (buttons > 0) {
-    document_.Post(base::BindOnce(
-        [](LibreOfficeKitMouseEventType event_type, gfx::Point pos,
-           int clickCount, int buttons, int modifiers,
-           DocumentHolderWithView holder) {
-          holder->postMouseEvent(event_type, pos.x(), pos.y(), clickCount,
-                                 buttons, modifiers);
-        },
-        event_type, std::move(pos), clickCount, buttons,
+    PostInputEvent(office::InputEvent::Mouse(
+        event_type, pos.x(), pos.y(), clickCount, buttons,
         office::EventModifiersToLOKModifiers(modifiers)));
     return true;
   }
@@ -484,6 +673,12 @@ bool OfficeWebPlugin::HandleMouseEvent(blink::WebInputEvent::Type type,
   return false;
 }
 
+void OfficeWebPlugin::PostInputEvent(office::InputEvent event) {
+  if (document_client_)
+    document_client_->RecordInput();
+  document_.PostInput(std::move(event));
+}
+
 void OfficeWebPlugin::DidReceiveResponse(
     const blink::WebURLResponse& response) {}
 
@@ -515,11 +710,32 @@ content::RenderFrame* OfficeWebPlugin::render_frame() const {
 OfficeWebPlugin::~OfficeWebPlugin() = default;
 
 void OfficeWebPlugin::InvalidateWeakContainer() {
-  if (!in_paint_) {
+  if (in_paint_)
+    return;
+
+  if (tile_layer_) {
+    UpdateTileLayer();
+  } else {
     container::Invalidate(container_);
   }
 }
 
+void OfficeWebPlugin::OnTilesPainted(const gfx::Rect& rect) {
+  tile_layer_stale_ = true;
+  tile_layer_damage_.Union(rect);
+}
+
+void OfficeWebPlugin::ScheduleMissingTiles() {
+  if (!document_ || !tile_buffer_ || tile_buffer_->IsEmpty() || in_paint_)
+    return;
+
+  // what a paint of the view would find missing, without drawing it
+  std::vector<office::TileRange> missing =
+      tile_buffer_->InvalidRangesRemaining({tile_buffer_->BandTileRange(
+          scroll_y_position_, plugin_rect_.height())});
+  ScheduleAfterPaint(std::move(missing));
+}
+
 void OfficeWebPlugin::InvalidatePluginContainer() {
   if (container_) {
     task_runner_->PostTask(
@@ -534,7 +750,11 @@ void OfficeWebPlugin::OnGeometryChanged(double old_zoom,
     return;
 
   if (viewport_zoom_ != old_zoom || device_scale_ != old_device_scale) {
-    tile_buffer_->ResetScale(TotalScale());
+    // a replaced tile buffer is already at the total scale
+    if (device_scale_ == old_device_scale || !UpdateTileSize())
+      tile_buffer_->ResetScale(TotalScale());
+    scroll_predictor_.Reset();
+    pending_prefetch_.clear();
   }
 
   available_area_ = gfx::Rect(plugin_rect_.size());
@@ -553,6 +773,31 @@ void OfficeWebPlugin::OnGeometryChanged(double old_zoom,
       available_area_, office::lok_callback::kTwipPerPx);
 }
 
+bool OfficeWebPlugin::UpdateTileSize() {
+  if (!document_ || !document_client_.MaybeValid())
+    return false;
+
+  int tile_size_px = tile_size_px_ > 0
+                         ? tile_size_px_
+                         : office::TileBuffer::ChooseTileSize(
+                               device_scale_, document_client_->DocumentType());
+  if (tile_size_px == tile_buffer_->tile_size_px())
+    return false;
+
+  TRACE_EVENT1("electron", "OfficeWebPlugin::UpdateTileSize",
+               "tile_size_px", tile_size_px);
+  // tasks that are still painting hold the previous buffer, the snapshot is
+  // kept to be scaled until the new tiles are painted
+  paint_manager_->ClearTasks();
+  auto size = document_client_->DocumentSizeTwips();
+  tile_buffer_ = base::MakeRefCounted<office::TileBuffer>(tile_size_px);
+  tile_buffer_->SetYPosition(scroll_y_position_);
+  tile_buffer_->Resize(size.width(), size.height(), TotalScale());
+  if (tiles_hibernated_)
+    tile_buffer_->ReleasePool();
+  return true;
+}
+
 std::vector<gfx::Rect> OfficeWebPlugin::PageRects() {
   std::vector<gfx::Rect> result;
 
@@ -588,6 +833,49 @@ gfx::Size OfficeWebPlugin::GetDocumentPixelSize() {
   return gfx::Size(ceil(TwipToPx(size.width())), ceil(TwipToPx(size.height())));
 }
 
+namespace {
+v8::Local<v8::Value> HistogramToV8(v8::Isolate* isolate,
+                                   const office::LatencyHistogram& histogram) {
+  std::vector<double> buckets_ms;
+  for (int64_t bound_us : office::LatencyHistogram::kBucketUpperBoundsUs) {
+    buckets_ms.push_back(bound_us / 1000.0);
+  }
+  auto counts = histogram.Counts();
+  uint64_t count = histogram.Count();
+
+  gin::Dictionary dict = gin::Dictionary::CreateEmpty(isolate);
+  dict.Set("bucketsMs", buckets_ms);
+  dict.Set("counts", std::vector<uint64_t>(counts.begin(), counts.end()));
+  dict.Set("count", count);
+  dict.Set("meanMs",
+           count == 0 ? 0.0 : histogram.Total().InMillisecondsF() / count);
+  return gin::ConvertToV8(isolate, dict);
+}
+}  // namespace
+
+v8::Local<v8::Value> OfficeWebPlugin::GetRenderStats(v8::Isolate* isolate) {
+  if (!tile_buffer_)
+    return v8::Undefined(isolate);
+
+  const office::RenderStats& stats = tile_buffer_->stats();
+  auto* inst = office::OfficeInstance::Get();
+
+  gin::Dictionary dict = gin::Dictionary::CreateEmpty(isolate);
+  dict.Set("tileSizePx", tile_buffer_->tile_size_px());
+  dict.Set("tilesPainted", stats.tiles_painted());
+  dict.Set("tilesCancelled", stats.tiles_cancelled());
+  dict.Set("tilesFailed", stats.tiles_failed());
+  dict.Set("poolHits", stats.pool_hits());
+  dict.Set("poolMisses", stats.pool_misses());
+  dict.Set("poolHitRate", stats.PoolHitRate());
+  dict.Set("invalidationsDeferred", stats.invalidations_deferred());
+  dict.Set("tilePaintLatency",
+           HistogramToV8(isolate, stats.tile_paint_latency()));
+  dict.Set("frameLatency", HistogramToV8(isolate, stats.frame_latency()));
+  dict.Set("callbackQueueDepth", inst ? inst->PendingCallbackCount() : 0);
+  return gin::ConvertToV8(isolate, dict);
+}
+
 gfx::Size OfficeWebPlugin::GetDocumentCSSPixelSize() {
   if (!document_client_.MaybeValid())
     return {};
@@ -626,43 +914,68 @@ void OfficeWebPlugin::OnViewportChanged(
   }
 }
 
+namespace {
+// full page invalidations within this interval are applied together
+constexpr base::TimeDelta kInvalidationFrameInterval = base::Milliseconds(16);
+// background invalidations are batched this long and wait for pending paints,
+// but not for more than the max delay
+constexpr base::TimeDelta kBackgroundInvalidationInterval =
+    base::Milliseconds(250);
+constexpr base::TimeDelta kBackgroundInvalidationMaxDelay = base::Seconds(2);
+
+// INVALIDATE_VISIBLE_CURSOR is either CSV or JSON with a rectangle key
+gfx::Rect ParseCursorRect(const std::string& payload) {
+  std::string_view payload_sv(payload);
+  size_t rectangle = payload_sv.find("\"rectangle\"");
+  if (rectangle != std::string_view::npos)
+    payload_sv.remove_prefix(rectangle);
+  std::string_view::const_iterator start = payload_sv.begin();
+  return office::lok_callback::ParseRect(start, payload_sv.end());
+}
+
+// the edit being typed invalidates the caret's line, the rest of the rects
+// invalidated while typing are mostly squiggles
+bool IsOnCaretLine(const gfx::Rect& dirty_rect,
+                   const std::string& cursor_payload) {
+  gfx::Rect caret = ParseCursorRect(cursor_payload);
+  if (caret.IsEmpty())
+    return true;
+  return dirty_rect.y() < caret.bottom() && caret.y() < dirty_rect.bottom();
+}
+}  // namespace
+
 void OfficeWebPlugin::HandleInvalidateTiles(std::string payload) {
   // not mounted
   if (!document_) {
     return;
   }
 
+  // every tile is repainted when the plugin is visible again
+  if (tiles_hibernated_) {
+    return;
+  }
+
   std::string_view payload_sv(payload);
 
   // TODO: handle non-text document types for parts
   if (payload_sv.substr(0, 5) == "EMPTY") {
+    // LOK issues a full invalidation for every page ("EMPTY, #") and then the
+    // whole document ("EMPTY"), these are collapsed and applied once per frame
     auto num_payload = payload_sv.substr(5);
-    // if there is a page number, skip every invalidation that isn't the last
-    // visible page this allows earlier paints on large documents
-    if (!num_payload.empty()) {
+    if (num_payload.empty()) {
+      invalidation_tracker_.InvalidateAll();
+    } else {
       std::string_view::const_iterator start = num_payload.begin();
       auto num = office::lok_callback::ParseCSV(start, payload_sv.end());
-      if (num.empty()) {
-        return;
-      } else if ((int)num[0] != last_intersect_) {
+      if (num.empty())
         return;
-      }
+      invalidation_tracker_.InvalidatePage(static_cast<int>(num[0]));
     }
 
-    base::TimeTicks now = base::TimeTicks::Now();
-    if (last_full_invalidation_time_.is_null() ||
-        (now - last_full_invalidation_time_) > base::Milliseconds(10)) {
-      task_runner_->PostTask(
-          FROM_HERE,
-          base::BindOnce(&OfficeWebPlugin::TryResumePaint, GetWeakPtr()));
-
-      ScheduleAvailableAreaPaint();
-      last_full_invalidation_time_ = now;
+    if (!invalidation_timer_.IsRunning()) {
+      invalidation_timer_.Start(FROM_HERE, kInvalidationFrameInterval, this,
+                                &OfficeWebPlugin::FlushPageInvalidations);
     }
-    // weirdly, LOK seems to be issuing a full tile invalidation FOR EVERY PAGE,
-    // then the whole document skip those page invalidations which are of the
-    // form "EMPTY, #, #" rendering was getting N+1 full document re-renders
-    // where N=number of pages, that's bad
   } else if (payload_sv.substr(0, 5) != "EMPTY") {
     std::string_view::const_iterator start = payload_sv.begin();
     gfx::Rect dirty_rect =
@@ -671,6 +984,25 @@ void OfficeWebPlugin::HandleInvalidateTiles(std::string payload) {
     if (dirty_rect.IsEmpty())
       return;
 
+    // online spelling stays on while typing, its squiggles off of the caret's
+    // line wait behind the paints of the edit the user is waiting on
+    if (document_client_.MaybeValid() &&
+        document_client_->IsSpellcheckOnline() &&
+        document_client_->HasPendingInput() &&
+        !IsOnCaretLine(dirty_rect, last_cursor_rect_)) {
+      if (tile_buffer_)
+        tile_buffer_->stats().RecordInvalidationDeferred();
+      if (!background_invalidation_tracker_.HasPending())
+        background_invalidation_since_ = base::TimeTicks::Now();
+      background_invalidation_tracker_.InvalidateRect(dirty_rect);
+      if (!background_invalidation_timer_.IsRunning()) {
+        background_invalidation_timer_.Start(
+            FROM_HERE, kBackgroundInvalidationInterval, this,
+            &OfficeWebPlugin::FlushBackgroundInvalidations);
+      }
+      return;
+    }
+
     gfx::RectF offset_area(available_area_);
     offset_area.Offset(0, scroll_y_position_);
     auto view_height = offset_area.height();
@@ -694,6 +1026,74 @@ void OfficeWebPlugin::HandleInvalidateTiles(std::string payload) {
   }
 }
 
+void OfficeWebPlugin::FlushPageInvalidations() {
+  TRACE_EVENT1("electron", "OfficeWebPlugin::FlushPageInvalidations",
+               "collapsed", invalidation_tracker_.collapsed());
+  ApplyInvalidations(invalidation_tracker_);
+}
+
+void OfficeWebPlugin::FlushBackgroundInvalidations() {
+  TRACE_EVENT1("electron",
+               "OfficeWebPlugin::FlushBackgroundInvalidations", "collapsed",
+               background_invalidation_tracker_.collapsed());
+  // input and the tiles the user is waiting on go first
+  bool busy = (paint_manager_ && paint_manager_->HasPendingPaint()) ||
+              (document_client_.MaybeValid() &&
+               document_client_->HasPendingInput());
+  if (busy &&
+      base::TimeTicks::Now() - background_invalidation_since_ <
+          kBackgroundInvalidationMaxDelay) {
+    background_invalidation_timer_.Start(
+        FROM_HERE, kBackgroundInvalidationInterval, this,
+        &OfficeWebPlugin::FlushBackgroundInvalidations);
+    return;
+  }
+  ApplyInvalidations(background_invalidation_tracker_);
+}
+
+void OfficeWebPlugin::ApplyInvalidations(office::InvalidationTracker& tracker) {
+  if (!document_ || !document_client_.MaybeValid() || tiles_hibernated_ ||
+      !tile_buffer_ || tile_buffer_->IsEmpty()) {
+    tracker.Clear();
+    return;
+  }
+
+  office::InvalidatedPages pages = tracker.Take(
+      document_client_->PageRects(), first_intersect_, last_intersect_);
+  if (pages.empty())
+    return;
+
+  task_runner_->PostTask(
+      FROM_HERE,
+      base::BindOnce(&OfficeWebPlugin::TryResumePaint, GetWeakPtr()));
+
+  if (pages.all)
+    tile_buffer_->InvalidateAllTiles();
+  for (const gfx::Rect& rect : pages.invalid_rects_twips) {
+    tile_buffer_->InvalidateTilesInTwipRect(rect);
+  }
+
+  // the visible pages aren't known yet, so fall back to the visible area
+  if (pages.paint_rects_twips.empty()) {
+    if (pages.all || first_intersect_ == -1)
+      ScheduleAvailableAreaPaint(false);
+    return;
+  }
+
+  // tiles were already invalidated above, this only maps the pages to tiles
+  std::vector<office::TileRange> ranges;
+  for (const gfx::Rect& rect : pages.paint_rects_twips) {
+    ranges.emplace_back(tile_buffer_->InvalidateTilesInTwipRect(rect));
+  }
+
+  gfx::RectF offset_area(available_area_);
+  offset_area.Offset(0, scroll_y_position_);
+  take_snapshot_ = true;
+  paint_manager_->SchedulePaint(document_, scroll_y_position_,
+                                offset_area.height(), TotalScale(), false,
+                                office::SimplifyRanges(std::move(ranges)));
+}
+
 float OfficeWebPlugin::TotalScale() {
   return zoom_ * device_scale_ * viewport_zoom_;
 }
@@ -724,6 +1124,9 @@ void OfficeWebPlugin::SetZoom(float zoom) {
   old_zoom_ = zoom_;
   scroll_y_position_ = zoom / zoom_ * scroll_y_position_;
   zoom_ = zoom;
+  // the samples and prefetched tiles are at the previous scale
+  scroll_predictor_.Reset();
+  pending_prefetch_.clear();
 
   if (!document_)
     return;
@@ -788,19 +1191,93 @@ void OfficeWebPlugin::UpdateScroll(int64_t y_position) {
 
   float scaled_y = std::clamp((float)y_position, 0.0f, max_y) * device_scale_;
   scroll_y_position_ = scaled_y;
+  const int scaled_view_height = view_height * device_scale_;
 
-  // TODO: paint PRIOR not ahead for scroll up
+  // the viewport is painted first, the predicted landing follows once it is
   office::TileRange range =
-      tile_buffer_->NextScrollTileRange(scroll_y_position_, view_height);
+      tile_buffer_->BandTileRange(scroll_y_position_, scaled_view_height);
   tile_buffer_->SetYPosition(scaled_y);
   paint_manager_->ResumePaint(false);
-  // TODO: schedule paint _ahead_ / _prior_ to scroll position
   paint_manager_->SchedulePaint(document_, scroll_y_position_,
-                                view_height * device_scale_, TotalScale(),
-                                false, {range});
+                                scaled_view_height, TotalScale(), false,
+                                {range});
+  UpdateScrollPrefetch(scaled_view_height);
   UpdateIntersectingPages();
   scrolling_ = true;
   take_snapshot_ = true;
+
+  // tiles that are already recorded are scrolled by the compositor, otherwise
+  // the layer is recorded again once the paint completes
+  if (tile_layer_ &&
+      tile_layer_->Covers(gfx::Rect(0, scroll_y_position_,
+                                    plugin_rect_.width(),
+                                    plugin_rect_.height()))) {
+    tile_layer_->ScrollTo(scroll_y_position_);
+  }
+}
+
+namespace {
+// the most that is prefetched around a scroll, in view heights
+constexpr int kMaxPrefetchViews = 4;
+}  // namespace
+
+void OfficeWebPlugin::UpdateScrollPrefetch(int view_height) {
+  scroll_predictor_.AddSample(scroll_y_position_, base::TimeTicks::Now());
+
+  // the cached page rects are in CSS px
+  const float page_scale = device_scale_ * viewport_zoom_;
+  std::vector<gfx::Rect> page_rects;
+  page_rects.reserve(page_rects_cached_.size());
+  for (const gfx::Rect& rect : page_rects_cached_) {
+    page_rects.push_back(gfx::ScaleToEnclosingRect(rect, page_scale));
+  }
+
+  // half of the pool is left to the tiles around the viewport, and the landing
+  // is never so far that its tiles would share pool indices with the viewport
+  const int pool_height = tile_buffer_->PoolHeightPx();
+  office::ScrollPrediction prediction = scroll_predictor_.Predict(
+      view_height, GetDocumentPixelSize().height(), page_rects,
+      std::min(kMaxPrefetchViews * view_height, pool_height / 2),
+      std::max(0, pool_height - 2 * view_height));
+  TRACE_EVENT2("electron", "OfficeWebPlugin::UpdateScrollPrefetch",
+               "velocity", prediction.velocity, "landing_y",
+               prediction.landing_y);
+
+  pending_prefetch_.clear();
+  if (prediction.prefetch.empty())
+    return;
+
+  int top = prediction.prefetch.front().y;
+  int bottom = prediction.prefetch.front().bottom();
+  for (const office::ScrollBand& band : prediction.prefetch) {
+    pending_prefetch_.push_back(
+        tile_buffer_->BandTileRange(band.y, band.height));
+    top = std::min(top, band.y);
+    bottom = std::max(bottom, band.bottom());
+  }
+  pending_prefetch_extent_ = {top, bottom - top};
+}
+
+void OfficeWebPlugin::SchedulePrefetchPaint() {
+  if (pending_prefetch_.empty() || !document_ || tiles_hibernated_ ||
+      !tile_buffer_ || tile_buffer_->IsEmpty()) {
+    return;
+  }
+
+  // tiles that are still valid from earlier paints are skipped
+  std::vector<office::TileRange> ranges =
+      tile_buffer_->InvalidRangesRemaining(std::move(pending_prefetch_));
+  pending_prefetch_.clear();
+  if (ranges.empty())
+    return;
+
+  TRACE_EVENT1("electron", "OfficeWebPlugin::SchedulePrefetchPaint",
+               "tiles", office::TileCount(ranges));
+  // the viewport of the next scroll is at another position, which cancels what
+  // is left of this in favor of the new prediction
+  paint_manager_->SchedulePaint(document_, pending_prefetch_extent_.y,
+                                pending_prefetch_extent_.height, TotalScale(),
+                                false, std::move(ranges));
 }
 
 std::string OfficeWebPlugin::RenderDocument(
@@ -812,6 +1289,10 @@ std::string OfficeWebPlugin::RenderDocument(
     return {};
   }
   absl::optional<base::Token> maybe_restore_key;
+  // from another renderer, through restoreFrom
+  office::RendererTransferable exported_transferable;
+  // a tile size only applies to the document it was rendered with
+  tile_size_px_ = 0;
 
   v8::Local<v8::Object> options;
   if (args->GetNext(&options)) {
@@ -827,10 +1308,35 @@ std::string OfficeWebPlugin::RenderDocument(
       disable_input_ = disable_input;
     }
 
+    int tile_size_px;
+    if (options_dict.Get("tileSize", &tile_size_px)) {
+      tile_size_px_ =
+          office::TileBuffer::IsValidTileSize(tile_size_px) ? tile_size_px : 0;
+    }
+
     std::string restore_key;
     if (options_dict.Get("restoreKey", &restore_key)) {
       maybe_restore_key = base::Token::FromString(restore_key);
     }
+
+    v8::Local<v8::Value> restore_from;
+    if (options_dict.Get("restoreFrom", &restore_from) &&
+        restore_from->IsArrayBufferView()) {
+      auto view = restore_from.As<v8::ArrayBufferView>();
+      auto backing_store = view->Buffer()->GetBackingStore();
+      exported_transferable = office::RendererTransferable::Deserialize(
+          base::make_span(
+              static_cast<const uint8_t*>(backing_store->Data()) +
+                  view->ByteOffset(),
+              view->ByteLength()),
+          client->Stamp());
+    } else if (!restore_from.IsEmpty() && restore_from->IsArrayBuffer()) {
+      auto backing_store = restore_from.As<v8::ArrayBuffer>()->GetBackingStore();
+      exported_transferable = office::RendererTransferable::Deserialize(
+          base::make_span(static_cast<const uint8_t*>(backing_store->Data()),
+                          backing_store->ByteLength()),
+          client->Stamp());
+    }
   }
 
   bool needs_reset = document_ && document_ != client->GetDocument();
@@ -841,10 +1347,17 @@ std::string OfficeWebPlugin::RenderDocument(
   if (needs_reset && document_client_.MaybeValid()) {
     document_client_->Unmount();
   }
-  bool needs_restore = !document_ && maybe_restore_key.has_value();
-
+  bool has_exported = exported_transferable.tile_buffer &&
+                      !exported_transferable.tile_buffer->IsEmpty();
+  bool needs_restore =
+      !document_ && (maybe_restore_key.has_value() || has_exported);
+
+  SetRendererActive(false);
+  if (document_client_.MaybeValid())
+    document_client_->RemoveMemoryReclaimer(this);
   document_ = client->GetDocument();
   document_client_ = client->GetWeakPtr();
+  client->AddMemoryReclaimer(this);
 
   if (!document_) {
     LOG(ERROR) << "document not held in client";
@@ -857,26 +1370,17 @@ std::string OfficeWebPlugin::RenderDocument(
   }
 
   if (needs_restore) {
-    auto transferable = client->GetRestoredRenderer(maybe_restore_key.value());
-    if (transferable.tile_buffer && !transferable.tile_buffer->IsEmpty()) {
-      tile_buffer_ = std::move(transferable.tile_buffer);
-    }
-    snapshot_ = std::move(transferable.snapshot);
-    if (transferable.paint_manager) {
-      paint_manager_ = std::make_unique<office::PaintManager>(
-          this, std::move(transferable.paint_manager));
-    }
-    first_paint_ = false;
-    page_rects_cached_ = std::move(transferable.page_rects);
-    first_intersect_ = transferable.first_intersect;
-    last_intersect_ = transferable.last_intersect;
-    last_cursor_rect_ = std::move(transferable.last_cursor_rect);
-    if (transferable.zoom > 0) {
-      zoom_ = transferable.zoom;
-    }
+    office::RendererTransferable transferable;
+    if (maybe_restore_key.has_value())
+      transferable = client->GetRestoredRenderer(maybe_restore_key.value());
+    // a renderer from this process takes precedence over an exported one
+    if (!transferable.tile_buffer && has_exported)
+      transferable = std::move(exported_transferable);
+    RestoreRenderer(std::move(transferable));
   }
 
   client->Mount(isolate);
+  SetRendererActive(visible_);
   if (needs_restore) {
     scroll_y_position_ = snapshot_.scroll_y_position;
   } else {
@@ -887,7 +1391,8 @@ std::string OfficeWebPlugin::RenderDocument(
       zoom_ = 1.0f;
     }
     tile_buffer_->SetYPosition(0);
-    tile_buffer_->Resize(size.width(), size.height(), TotalScale());
+    if (!UpdateTileSize())
+      tile_buffer_->Resize(size.width(), size.height(), TotalScale());
   }
 
   if (needs_reset) {
@@ -901,12 +1406,16 @@ std::string OfficeWebPlugin::RenderDocument(
   }
 
   if (!needs_restore) {
-    document_->resetSelection();
+    if (office::PinnedDocument doc = document_.Pin())
+      doc->resetSelection();
   }
 
   document_.AddDocumentObserver(LOK_CALLBACK_DOCUMENT_SIZE_CHANGED, this);
   document_.AddDocumentObserver(LOK_CALLBACK_INVALIDATE_TILES, this);
   document_.AddDocumentObserver(LOK_CALLBACK_INVALIDATE_VISIBLE_CURSOR, this);
+  document_.AddDocumentObserver(LOK_CALLBACK_CURSOR_VISIBLE, this);
+  document_.AddDocumentObserver(LOK_CALLBACK_TEXT_SELECTION, this);
+  document_.AddDocumentObserver(LOK_CALLBACK_CELL_CURSOR, this);
   registered_observers_ = true;
 
   if (needs_reset) {
@@ -930,6 +1439,56 @@ std::string OfficeWebPlugin::RenderDocument(
   return restore_key_.ToString();
 }
 
+void OfficeWebPlugin::RestoreRenderer(
+    office::RendererTransferable transferable) {
+  if (transferable.tile_buffer && !transferable.tile_buffer->IsEmpty()) {
+    tile_buffer_ = std::move(transferable.tile_buffer);
+  }
+  snapshot_ = std::move(transferable.snapshot);
+  if (transferable.paint_manager) {
+    paint_manager_ = std::make_unique<office::PaintManager>(
+        this, std::move(transferable.paint_manager));
+  }
+  first_paint_ = false;
+  page_rects_cached_ = std::move(transferable.page_rects);
+  first_intersect_ = transferable.first_intersect;
+  last_intersect_ = transferable.last_intersect;
+  last_cursor_rect_ = std::move(transferable.last_cursor_rect);
+  if (transferable.zoom > 0) {
+    zoom_ = transferable.zoom;
+  }
+}
+
+v8::Local<v8::Value> OfficeWebPlugin::ExportRenderer(v8::Isolate* isolate) {
+  if (!document_ || !tile_buffer_ || tile_buffer_->IsEmpty())
+    return v8::Undefined(isolate);
+
+  // shares the tile buffer, the live renderer keeps painting into it
+  office::RendererTransferable transferable(
+      scoped_refptr<office::TileBuffer>(tile_buffer_), nullptr,
+      office::Snapshot({}, 0.0f, 0, 0, 0, 0, scroll_y_position_),
+      page_rects_cached_, first_intersect_, last_intersect_,
+      std::string(last_cursor_rect_), zoom_);
+  office::DocumentStamp stamp;
+  if (document_client_)
+    stamp = document_client_->Stamp();
+  auto serialized = std::make_unique<std::vector<uint8_t>>(
+      transferable.Serialize(stamp));
+  if (serialized->empty())
+    return v8::Undefined(isolate);
+
+  // the ArrayBuffer adopts the bytes instead of copying them
+  void* data = serialized->data();
+  size_t size = serialized->size();
+  auto backing_store = v8::ArrayBuffer::NewBackingStore(
+      data, size,
+      [](void*, size_t, void* bytes) {
+        delete static_cast<std::vector<uint8_t>*>(bytes);
+      },
+      serialized.release());
+  return v8::ArrayBuffer::New(isolate, std::move(backing_store));
+}
+
 void OfficeWebPlugin::ScheduleAvailableAreaPaint(bool invalidate) {
   gfx::RectF offset_area(available_area_);
   offset_area.Offset(0, scroll_y_position_);
@@ -1002,10 +1561,11 @@ void OfficeWebPlugin::DebouncedResumePaint() {
 void OfficeWebPlugin::DocumentCallback(int type, std::string payload) {
   switch (type) {
     case LOK_CALLBACK_DOCUMENT_SIZE_CHANGED: {
-      if (!document_)
+      office::PinnedDocument doc = document_.Pin();
+      if (!doc)
         return;
       long width, height;
-      document_->getDocumentSize(&width, &height);
+      doc->getDocumentSize(&width, &height);
       tile_buffer_->Resize(width, height);
       break;
     }
@@ -1014,12 +1574,103 @@ void OfficeWebPlugin::DocumentCallback(int type, std::string payload) {
       break;
     }
     case LOK_CALLBACK_INVALIDATE_VISIBLE_CURSOR: {
-      if (!payload.empty()) {
-        last_cursor_rect_ = std::move(payload);
-      }
+      HandleCursorInvalidated(std::move(payload));
+      break;
+    }
+    case LOK_CALLBACK_CURSOR_VISIBLE: {
+      HandleCursorVisible(std::move(payload));
+      break;
+    }
+    case LOK_CALLBACK_TEXT_SELECTION: {
+      HandleTextSelection(std::move(payload));
+      break;
+    }
+    case LOK_CALLBACK_CELL_CURSOR: {
+      HandleCellCursor(std::move(payload));
       break;
     }
   }
 }
 
+void OfficeWebPlugin::HandleCursorInvalidated(std::string payload) {
+  if (payload.empty())
+    return;
+  last_cursor_rect_ = std::move(payload);
+  UpdateOverlay();
+}
+
+void OfficeWebPlugin::HandleCursorVisible(std::string payload) {
+  cursor_visible_ = payload == "true";
+  UpdateOverlay();
+}
+
+void OfficeWebPlugin::HandleTextSelection(std::string payload) {
+  std::string_view payload_sv(payload);
+  std::string_view::const_iterator start = payload_sv.begin();
+  text_selection_twips_ =
+      office::lok_callback::ParseMultipleRects(start, payload_sv.end(), 1);
+  UpdateOverlay();
+}
+
+void OfficeWebPlugin::HandleCellCursor(std::string payload) {
+  std::string_view payload_sv(payload);
+  if (payload_sv.substr(0, 5) == "EMPTY") {
+    cell_cursor_twips_ = gfx::Rect();
+  } else {
+    std::string_view::const_iterator start = payload_sv.begin();
+    cell_cursor_twips_ =
+        office::lok_callback::ParseRect(start, payload_sv.end());
+  }
+  UpdateOverlay();
+}
+
+namespace {
+gfx::Rect TwipRectToPx(const gfx::Rect& rect, float scale) {
+  return gfx::ScaleToEnclosingRect(rect,
+                                   scale / office::lok_callback::kTwipPerPx);
+}
+
+constexpr base::TimeDelta kCaretBlinkInterval = base::Milliseconds(500);
+}  // namespace
+
+void OfficeWebPlugin::UpdateOverlay() {
+  if (!tile_layer_ || !document_)
+    return;
+
+  float scale = TotalScale();
+  overlay_scale_ = scale;
+
+  office::TileLayer::Overlay overlay;
+  if (cursor_visible_ && has_focus_ && !last_cursor_rect_.empty()) {
+    overlay.caret = TwipRectToPx(ParseCursorRect(last_cursor_rect_), scale);
+    // LOK can report a zero-width caret
+    overlay.caret.set_width(
+        std::max(overlay.caret.width(),
+                 static_cast<int>(std::ceil(device_scale_))));
+  }
+  for (const gfx::Rect& rect : text_selection_twips_) {
+    overlay.selection.emplace_back(TwipRectToPx(rect, scale));
+  }
+  if (!cell_cursor_twips_.IsEmpty())
+    overlay.cell_cursor = TwipRectToPx(cell_cursor_twips_, scale);
+
+  tile_layer_->SetOverlay(overlay);
+
+  // the caret stays solid while it moves, then blinks
+  caret_blink_visible_ = true;
+  if (overlay.caret.IsEmpty()) {
+    caret_blink_timer_.Stop();
+  } else {
+    caret_blink_timer_.Start(FROM_HERE, kCaretBlinkInterval, this,
+                             &OfficeWebPlugin::BlinkCaret);
+  }
+}
+
+void OfficeWebPlugin::BlinkCaret() {
+  if (!tile_layer_)
+    return;
+  caret_blink_visible_ = !caret_blink_visible_;
+  tile_layer_->SetCaretVisible(caret_blink_visible_);
+}
+
 }  // namespace electron
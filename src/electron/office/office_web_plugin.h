@@ -20,9 +20,14 @@
 #include "office/document_client.h"
 #include "office/document_event_observer.h"
 #include "office/document_holder.h"
+#include "office/input_queue.h"
+#include "office/invalidation_tracker.h"
 #include "office/lok_tilebuffer.h"
+#include "office/memory_budget.h"
 #include "office/office_client.h"
 #include "office/paint_manager.h"
+#include "office/scroll_predictor.h"
+#include "office/tile_layer.h"
 #include "third_party/blink/public/common/input/web_keyboard_event.h"
 #include "third_party/blink/public/platform/web_input_event_result.h"
 #include "third_party/blink/public/web/web_plugin.h"
@@ -60,9 +65,11 @@ blink::WebPlugin* CreateInternalPlugin(blink::WebPluginParams params,
 }  // namespace office
 
 class OfficeWebPlugin : public blink::WebPlugin,
+                        public office::TileLayer::Client,
                         public office::PaintManager::Client,
                         public office::DocumentEventObserver,
-                        public office::DestroyedObserver {
+                        public office::DestroyedObserver,
+                        public office::MemoryReclaimer {
  public:
   OfficeWebPlugin(blink::WebPluginParams /*params*/,
                   content::RenderFrame* render_frame);
@@ -158,17 +165,33 @@ class OfficeWebPlugin : public blink::WebPlugin,
 
   // } blink::WebPlugin
 
+  // TileLayer::Client
+  void PaintTileLayer(cc::PaintCanvas* canvas, const gfx::Rect& band) override;
+
   // PaintManager::Client
   void InvalidatePluginContainer() override;
+  void OnTilesPainted(const gfx::Rect& rect) override;
+  void ScheduleMissingTiles() override;
   base::WeakPtr<office::PaintManager::Client> GetWeakClient() override;
   scoped_refptr<office::TileBuffer> GetTileBuffer() override;
 
   content::RenderFrame* render_frame() const;
+  // nullptr before Initialize
+  const office::TileLayer* tile_layer() const { return tile_layer_.get(); }
+  office::DocumentClient* document_client() const {
+    return document_client_.get();
+  }
 
   void TriggerFullRerender();
   void ScheduleAvailableAreaPaint(bool invalidate = true);
   base::WeakPtr<OfficeWebPlugin> GetWeakPtr();
   void UpdateSnapshot(const office::Snapshot snapshot);
+  // downsamples the snapshot on the thread pool for drawing it at the total
+  // scale, painting draws the closest level that is built until then
+  void BuildSnapshotMips();
+  void OnSnapshotMipsBuilt(std::vector<cc::PaintImage> tiles,
+                           size_t built,
+                           std::vector<std::vector<cc::PaintImage>> mips);
 
   // DocumentEventObserver
   void DocumentCallback(int type, std::string payload) override;
@@ -176,6 +199,11 @@ class OfficeWebPlugin : public blink::WebPlugin,
   // DestroyedObserver
   void OnDestroyed() override;
 
+  // MemoryReclaimer, only a hidden renderer gives up its tiles or snapshot
+  office::ViewMemoryUsage GetMemoryUsage() override;
+  void EvictTiles() override;
+  void ReleaseSnapshot() override;
+
  private:
   // call `Destroy()` instead.
   ~OfficeWebPlugin() override;
@@ -186,17 +214,40 @@ class OfficeWebPlugin : public blink::WebPlugin,
                         int modifiers,
                         int clickCount,
                         ui::Cursor* cursor);
+  // queues the event for the document, coalescing it if LOK is busy
+  void PostInputEvent(office::InputEvent event);
 
   // Updates the available area
   void OnGeometryChanged(double old_zoom, float old_device_scale);
 
+  // replaces the tile buffer if the device scale or document type calls for
+  // another tile size, returns true if it was replaced
+  bool UpdateTileSize();
+
   // Computes document width/height in device pixels, based on the total scale
   gfx::Size GetDocumentPixelSize();
 
+  // paints the tiles within rect, offset by the tile buffer's y position
+  void PaintTiles(cc::PaintCanvas* canvas, const gfx::Rect& rect);
+  // schedules the `missing` tiles of a paint, unless a task is still painting
+  void ScheduleAfterPaint(std::vector<office::TileRange> missing);
+
+  // the area of the document recorded into the tile layer, the view plus one
+  // view height behind and two ahead, in device pixels
+  gfx::Rect TileLayerBand();
+  // re-records the tile layer if the recorded band no longer covers the view
+  // or a paint presented new tiles, otherwise only scrolls the layer
+  void UpdateTileLayer(bool force = false);
+
   void OnViewportChanged(const gfx::Rect& plugin_rect_in_css_pixel,
                          float new_device_scale);
 
   void UpdateScroll(int64_t y_position);
+  // predicts where the viewport will land from the recent scrolls and keeps
+  // the tiles to paint there once the viewport is painted
+  void UpdateScrollPrefetch(int view_height);
+  // schedules the pending prefetch if nothing else is being painted
+  void SchedulePrefetchPaint();
 
   float TwipToPx(float in);
   float TotalScale();
@@ -212,19 +263,50 @@ class OfficeWebPlugin : public blink::WebPlugin,
   // updates the first and last intersecting page number within view
   void UpdateIntersectingPages();
 
+  // adopts the tiles and state of a renderer that was unmounted or exported
+  void RestoreRenderer(office::RendererTransferable transferable);
+
   // renders the document in the plugin and assigns a unique key
   std::string RenderDocument(v8::Isolate* isolate,
                              gin::Handle<office::DocumentClient> client,
                              gin::Arguments* args);
   // debounces the renders at the specified interval
   void DebounceUpdates(int interval);
+  // counters and latency histograms for the render pipeline
+  v8::Local<v8::Value> GetRenderStats(v8::Isolate* isolate);
+  // the painted tiles, page rects and scroll state with the document's stamp,
+  // for renderDocument's restoreFrom in another window
+  v8::Local<v8::Value> ExportRenderer(v8::Isolate* isolate);
 
   // }
 
   // LOK event handlers {
   void HandleInvalidateTiles(std::string payload);
+  // applies the full page invalidations collected within the last frame,
+  // repainting only the visible and prefetched pages
+  void FlushPageInvalidations();
+  // applies the batched invalidations of background work, like online
+  // spelling, once no input or paint is pending
+  void FlushBackgroundInvalidations();
+  void ApplyInvalidations(office::InvalidationTracker& tracker);
   void HandleDocumentSizeChanged(std::string payload);
   void HandleCursorInvalidated(std::string payload);
+  void HandleCursorVisible(std::string payload);
+  void HandleTextSelection(std::string payload);
+  void HandleCellCursor(std::string payload);
+  // }
+
+  // converts the caret, text selection and cell cursor to device pixels and
+  // draws them over the tiles
+  void UpdateOverlay();
+  void BlinkCaret();
+
+  // Hibernation {
+  // reports whether this renderer is visible to the document client
+  void SetRendererActive(bool active);
+  // releases the tile pool after being hidden for the document's hibernate
+  // delay, the tiles are repainted once visible again
+  void HibernateTiles();
   // }
 
   void DebouncedResumePaint();
@@ -263,14 +345,27 @@ class OfficeWebPlugin : public blink::WebPlugin,
   // process of zooming the plugin so that flickering doesn't occur while
   // zooming.
   bool stop_scrolling_ = false;
+  office::ScrollPredictor scroll_predictor_;
+  // painted after the viewport, replaced by every scroll so that a stale
+  // prediction isn't painted
+  std::vector<office::TileRange> pending_prefetch_;
+  office::ScrollBand pending_prefetch_extent_;
   // }
 
   // UI State {
   // current cursor
   ui::mojom::CursorType cursor_type_ = ui::mojom::CursorType::kPointer;
-  bool has_focus_;
+  bool has_focus_ = false;
   std::string last_cursor_rect_;
   base::TimeTicks last_css_cursor_time_ = base::TimeTicks();
+  bool cursor_visible_ = true;
+  std::vector<gfx::Rect> text_selection_twips_;
+  // empty if there is no cell cursor
+  gfx::Rect cell_cursor_twips_;
+  base::RepeatingTimer caret_blink_timer_;
+  bool caret_blink_visible_ = true;
+  // the total scale the overlay was last converted at
+  float overlay_scale_ = 0.0f;
   // }
 
   // owned by
@@ -285,20 +380,39 @@ class OfficeWebPlugin : public blink::WebPlugin,
   std::unique_ptr<office::PaintManager> paint_manager_;
   bool take_snapshot_ = true;
   office::Snapshot snapshot_;
+  bool building_mips_ = false;
   bool scrolling_ = false;
+  std::unique_ptr<office::TileLayer> tile_layer_;
+  // tiles were painted since the tile layer was last recorded
+  bool tile_layer_stale_ = false;
+  // the tiles that were painted since, only these are rastered again
+  gfx::Rect tile_layer_damage_;
   std::vector<gfx::Rect> page_rects_cached_;
   int first_intersect_ = -1;
   int last_intersect_ = -1;
   base::Token restore_key_;
 
   bool visible_ = true;
+  bool renderer_active_ = false;
+  bool tiles_hibernated_ = false;
+  base::OneShotTimer hibernate_timer_;
   bool disable_input_ = false;
+  // the tile size from renderDocument, 0 chooses it by device scale and
+  // document type
+  int tile_size_px_ = 0;
   bool doomed_ = false;
   bool registered_observers_ = false;
 
   scoped_refptr<base::SequencedTaskRunner> task_runner_;
   office::CancelFlagPtr paint_cancel_flag_;
-  base::TimeTicks last_full_invalidation_time_ = base::TimeTicks();
+  // full page invalidations are collapsed and applied once per frame
+  office::InvalidationTracker invalidation_tracker_;
+  base::OneShotTimer invalidation_timer_;
+  // rect invalidations off of the caret's line while typing with online
+  // spelling, applied after the input and visible paints
+  office::InvalidationTracker background_invalidation_tracker_;
+  base::OneShotTimer background_invalidation_timer_;
+  base::TimeTicks background_invalidation_since_;
 
   v8::Global<v8::ObjectTemplate> v8_template_;
   v8::Global<v8::Object> v8_object_;
@@ -4,17 +4,17 @@
 
 #include "paint_manager.h"
 
+#include <algorithm>
 #include <memory>
 
 #include "base/barrier_closure.h"
 #include "base/task/bind_post_task.h"
 #include "base/logging.h"
+#include "base/threading/sequenced_task_runner_handle.h"
 #include "base/time/time.h"
+#include "base/trace_event/trace_event.h"
 #include "office/cancellation_flag.h"
 
-// Uncomment to log paint manager events
-// #define DEBUG_PAINT_MANAGER
-
 namespace electron::office {
 
 PaintManager::Task::Task(DocumentHolderWithView document,
@@ -41,19 +41,29 @@ std::size_t PaintManager::Task::ContextHash() const noexcept {
 
 PaintManager::PaintManager(Client* client)
     : task_runner_(base::ThreadPool::CreateTaskRunner(
-          {base::TaskPriority::USER_VISIBLE})),
+          // a paint waits on the reload of a hibernated document
+          {base::TaskPriority::USER_VISIBLE,
+           base::WithBaseSyncPrimitives()})),
       client_(client),
       current_task_(nullptr),
       next_task_(nullptr),
-      cancel_invalidate_(CancelFlag::Create()) {}
+      cancel_invalidate_(CancelFlag::Create()),
+      client_task_runner_(base::SequencedTaskRunnerHandle::Get()) {}
 
 PaintManager::PaintManager(Client* client, std::unique_ptr<PaintManager> other)
     : task_runner_(base::ThreadPool::CreateTaskRunner(
-          {base::TaskPriority::USER_VISIBLE})),
+          {base::TaskPriority::USER_VISIBLE,
+           base::WithBaseSyncPrimitives()})),
       client_(client),
       current_task_(std::move(other->current_task_)),
       next_task_(std::move(other->next_task_)),
-      cancel_invalidate_(CancelFlag::Create()) {}
+      cancel_invalidate_(CancelFlag::Create()),
+      client_task_runner_(base::SequencedTaskRunnerHandle::Get()) {
+  // the progress of the task was reported to the other manager, so it is
+  // posted again by the next paint
+  if (current_task_)
+    current_task_->posted_ = false;
+}
 
 PaintManager::PaintManager() = default;
 PaintManager::~PaintManager() {
@@ -66,6 +76,8 @@ void PaintManager::SchedulePaint(DocumentHolderWithView document,
                                  float scale,
                                  bool full_paint,
                                  std::vector<TileRange> tile_ranges_) {
+  TRACE_EVENT2("electron", "PaintManager::SchedulePaint", "y_pos",
+               y_pos, "full_paint", full_paint);
   // nothing scheduled, start immediately
   if (!current_task_) {
     current_task_ = std::make_unique<Task>(document, y_pos, view_height, scale,
@@ -104,19 +116,23 @@ bool PaintManager::Task::CanMergeWith(Task& other) {
 std::unique_ptr<PaintManager::Task> PaintManager::Task::MergeWith(
     Task& other,
     office::TileBuffer& tile_buffer) {
+  TRACE_EVENT0("electron", "PaintManager::Task::MergeWith");
   auto clipped_ranges = tile_buffer.ClipRanges(
       tile_ranges_, tile_buffer.LimitIndex(other.y_pos_, other.view_height_));
   clipped_ranges.insert(clipped_ranges.end(), other.tile_ranges_.begin(),
                         other.tile_ranges_.end());
 
-  return std::make_unique<Task>(
+  auto result = std::make_unique<Task>(
       other.document_, other.y_pos_, other.view_height_, other.scale_,
       full_paint_ || other.full_paint_, SimplifyRanges(clipped_ranges));
+  result->scheduled_time_ = std::min(scheduled_time_, other.scheduled_time_);
+  return result;
 }
 
 std::unique_ptr<PaintManager::Task> PaintManager::Task::MergeWith(
     std::vector<TileRange> tile_ranges,
     office::TileBuffer& tile_buffer) {
+  TRACE_EVENT0("electron", "PaintManager::Task::MergeWith");
   auto limit = tile_buffer.LimitIndex(y_pos_, view_height_);
 
   std::vector<TileRange> tile_ranges_joined(tile_ranges_);
@@ -125,9 +141,11 @@ std::unique_ptr<PaintManager::Task> PaintManager::Task::MergeWith(
 
   auto clipped_ranges = tile_buffer.ClipRanges(tile_ranges_joined, limit);
 
-  return std::make_unique<Task>(document_, y_pos_, view_height_, scale_,
-                                full_paint_ || full_paint_,
-                                SimplifyRanges(clipped_ranges));
+  auto result = std::make_unique<Task>(document_, y_pos_, view_height_, scale_,
+                                       full_paint_ || full_paint_,
+                                       SimplifyRanges(clipped_ranges));
+  result->scheduled_time_ = scheduled_time_;
+  return result;
 }
 
 // this duplicates a lot of the above and is generally a hacky mess to get
@@ -170,6 +188,8 @@ bool PaintManager::ScheduleNextPaint(std::vector<TileRange> tile_ranges_) {
       // LOG(ERROR) << "NOT SAME TASK";
       // y-pos are different, so assume scrolling and not an in-place update
       if (current_task_->y_pos_ != next_task_->y_pos_) {
+        TRACE_EVENT_INSTANT0("electron", "PaintManager::CancelTask",
+                             TRACE_EVENT_SCOPE_THREAD);
         CancelFlag::Set(current_task_->skip_paint_flag_);
         CancelFlag::Set(current_task_->skip_invalidation_flag_);
       }
@@ -196,12 +216,14 @@ void PaintManager::PostCurrentTask() {
   if (skip_render_ || !current_task_ || CancelFlag::IsCancelled(cancel_invalidate_))
     return;
 
+  TRACE_EVENT1("electron", "PaintManager::PostCurrentTask", "scale",
+               current_task_->scale_);
   std::size_t hash = 0;
+  // the frame of a task posted before the stats are reset isn't recorded
+  uint64_t stats_generation = 0;
   if (auto tile_buffer = client_->GetTileBuffer()) {
     hash = current_task_->ContextHash();
-#ifdef DEBUG_PAINT_MANAGER
-    LOG(ERROR) << "PCT " << current_task_->scale_ << " @ " << std::hex << hash;
-#endif
+    stats_generation = tile_buffer->stats().generation();
 
     if (tile_buffer->IsEmpty()) {
       return;
@@ -211,21 +233,83 @@ void PaintManager::PostCurrentTask() {
   }
   auto simplified_ranges = SimplifyRanges(current_task_->tile_ranges_);
   auto tile_count = TileCount(simplified_ranges);
+  current_task_->posted_ = true;
+  current_task_->completed_ = false;
   base::RepeatingClosure completed = base::BarrierClosure(
       tile_count,
       base::BindPostTask(task_runner_,
-      base::BindOnce([](CancelFlagPtr task_cancel_flag, CancelFlagPtr manager_cancel_flag, Client* client) {
+      base::BindOnce([](CancelFlagPtr task_cancel_flag, CancelFlagPtr manager_cancel_flag, base::OnceClosure on_completed, scoped_refptr<office::TileBuffer> tile_buffer, base::TimeTicks scheduled_time, uint64_t stats_generation) {
         if (!CancelFlag::IsCancelled(manager_cancel_flag) && !CancelFlag::IsCancelled(task_cancel_flag)) {
-          client->InvalidatePluginContainer();
+          if (tile_buffer)
+            tile_buffer->stats().RecordFrame(base::TimeTicks::Now() - scheduled_time, stats_generation);
+          std::move(on_completed).Run();
         }
-      }, current_task_->skip_invalidation_flag_, cancel_invalidate_, base::Unretained(client_))));
+      }, current_task_->skip_invalidation_flag_, cancel_invalidate_,
+      base::BindPostTask(client_task_runner_, base::BindOnce(&PaintManager::OnTaskCompleted, weak_factory_.GetWeakPtr(), current_task_->skip_invalidation_flag_)),
+      client_->GetTileBuffer(), current_task_->scheduled_time_,
+      stats_generation)));
+  TilePaintedCallback painted = base::BindPostTask(
+      client_task_runner_,
+      base::BindRepeating(&PaintManager::OnTilePainted,
+                          weak_factory_.GetWeakPtr(),
+                          current_task_->skip_invalidation_flag_));
   for (auto& it : simplified_ranges) {
     task_runner_->PostTask(
-        FROM_HERE,
-        base::BindOnce(&PaintManager::PaintTileRange, client_->GetTileBuffer(),
-                       current_task_->skip_paint_flag_,
-                       current_task_->document_, it, hash, completed));
+        FROM_HERE, base::BindOnce(&PaintManager::PaintTileRange,
+                                  client_->GetTileBuffer(),
+                                  current_task_->skip_paint_flag_,
+                                  current_task_->document_, it, hash, painted,
+                                  completed));
+  }
+}
+
+void PaintManager::OnTilePainted(CancelFlagPtr task_flag,
+                                 unsigned int tile_index) {
+  if (CancelFlag::IsCancelled(task_flag) ||
+      CancelFlag::IsCancelled(cancel_invalidate_)) {
+    return;
   }
+  if (scoped_refptr<TileBuffer> tile_buffer = client_->GetTileBuffer())
+    painted_rect_.Union(tile_buffer->TileBounds(tile_index));
+  if (progress_timer_.IsRunning())
+    return;
+
+  base::TimeDelta wait = std::max(
+      base::TimeDelta(),
+      last_progress_time_ + kProgressInterval - base::TimeTicks::Now());
+  progress_timer_.Start(FROM_HERE, wait,
+                        base::BindOnce(&PaintManager::InvalidateProgress,
+                                       base::Unretained(this)));
+}
+
+void PaintManager::InvalidateProgress() {
+  TRACE_EVENT0("electron", "PaintManager::InvalidateProgress");
+  last_progress_time_ = base::TimeTicks::Now();
+  NotifyTilesPainted();
+  client_->InvalidatePluginContainer();
+}
+
+void PaintManager::NotifyTilesPainted() {
+  if (painted_rect_.IsEmpty())
+    return;
+  client_->OnTilesPainted(painted_rect_);
+  painted_rect_ = gfx::Rect();
+}
+
+void PaintManager::OnTaskCompleted(CancelFlagPtr task_flag) {
+  if (current_task_ && current_task_->skip_invalidation_flag_ == task_flag)
+    current_task_->completed_ = true;
+  // the completed paint includes any progress that is still pending
+  progress_timer_.Stop();
+  last_progress_time_ = base::TimeTicks::Now();
+  // every painted tile was already presented, invalidating again would only
+  // draw them twice
+  if (painted_rect_.IsEmpty()) {
+    client_->ScheduleMissingTiles();
+    return;
+  }
+  NotifyTilesPainted();
+  client_->InvalidatePluginContainer();
 }
 
 void PaintManager::PaintTileRange(scoped_refptr<office::TileBuffer> tile_buffer,
@@ -233,38 +317,66 @@ void PaintManager::PaintTileRange(scoped_refptr<office::TileBuffer> tile_buffer,
                                   DocumentHolderWithView document,
                                   TileRange it,
                                   std::size_t context_hash,
+                                  const TilePaintedCallback& painted,
                                   const base::RepeatingClosure& completed) {
-#ifdef DEBUG_PAINT_MANAGER
-  LOG(ERROR) << "PTR " << it.index_start << " - " << it.index_end
-             << " CH: " << std::hex << context_hash;
-#endif
+  TRACE_EVENT2("electron", "PaintManager::PaintTileRange",
+               "index_start", it.index_start, "index_end", it.index_end);
 
   for (unsigned int tile_index = it.index_start; tile_index <= it.index_end;
        ++tile_index) {
-    if (!PaintTile(tile_buffer, cancel_flag, document, tile_index, context_hash,
-                   completed))
-      break;
+    TileBuffer::PaintResult result =
+        PaintTile(tile_buffer, cancel_flag, document, tile_index, context_hash,
+                  painted, completed);
+    if (result != TileBuffer::PaintResult::kCancelled &&
+        result != TileBuffer::PaintResult::kFailed) {
+      continue;
+    }
+
+    // the rest of the range is abandoned for the same reason, but still
+    // counts towards the completion so that the missing tiles are scheduled
+    // again
+    size_t abandoned = it.index_end - tile_index;
+    if (abandoned > 0) {
+      if (result == TileBuffer::PaintResult::kFailed) {
+        tile_buffer->stats().RecordTilesFailed(abandoned);
+      } else {
+        tile_buffer->stats().RecordTilesCancelled(abandoned);
+      }
+    }
+    for (size_t i = 0; i < abandoned; ++i) {
+      completed.Run();
+    }
+    break;
   }
 }
 
-bool PaintManager::PaintTile(scoped_refptr<office::TileBuffer> tile_buffer,
-                             CancelFlagPtr cancel_flag,
-                             DocumentHolderWithView document,
-                             unsigned int tile_index,
-                             std::size_t context_hash,
-                             const base::RepeatingClosure& completed) {
-  bool res =
+TileBuffer::PaintResult PaintManager::PaintTile(
+    scoped_refptr<office::TileBuffer> tile_buffer,
+    CancelFlagPtr cancel_flag,
+    DocumentHolderWithView document,
+    unsigned int tile_index,
+    std::size_t context_hash,
+    const TilePaintedCallback& painted,
+    const base::RepeatingClosure& completed) {
+  TileBuffer::PaintResult result =
       tile_buffer->PaintTile(cancel_flag, document, tile_index, context_hash);
+  if (result == TileBuffer::PaintResult::kPainted)
+    painted.Run(tile_index);
   completed.Run();
-  return res;
+  return result;
 }
 
 
 void PaintManager::OnDestroy() {
   CancelFlag::CancelAndReset(cancel_invalidate_);
+  progress_timer_.Stop();
 }
 
 void PaintManager::ClearTasks() {
+  if (current_task_ || next_task_) {
+    TRACE_EVENT_INSTANT0("electron", "PaintManager::ClearTasks",
+                         TRACE_EVENT_SCOPE_THREAD);
+  }
   if (current_task_) {
     CancelFlag::Set(current_task_->skip_paint_flag_);
     CancelFlag::Set(current_task_->skip_invalidation_flag_);
@@ -5,15 +5,19 @@
 #pragma once
 
 #include <vector>
+#include "base/callback.h"
 #include "base/memory/scoped_refptr.h"
 #include "base/memory/weak_ptr.h"
 #include "base/task/task_runner.h"
 #include "base/task/task_traits.h"
+#include "base/task/sequenced_task_runner.h"
 #include "base/task/thread_pool.h"
 #include "base/time/time.h"
+#include "base/timer/timer.h"
 #include "office/cancellation_flag.h"
 #include "office/document_holder.h"
 #include "office/lok_tilebuffer.h"
+#include "ui/gfx/geometry/rect.h"
 
 namespace electron::office {
 
@@ -22,6 +26,12 @@ class PaintManager {
   class Client {
    public:
     virtual void InvalidatePluginContainer() = 0;
+    // the tiles within `rect` were painted since the last invalidation, called
+    // before it. `rect` is in device pixels relative to the top of the document
+    virtual void OnTilesPainted(const gfx::Rect& rect) = 0;
+    // a task completed after its tiles were presented, so there's nothing to
+    // invalidate, but the tiles that are still missing have to be scheduled
+    virtual void ScheduleMissingTiles() = 0;
     virtual base::WeakPtr<Client> GetWeakClient() = 0;
     virtual scoped_refptr<office::TileBuffer> GetTileBuffer() = 0;
   };
@@ -53,6 +63,15 @@ class PaintManager {
   void PausePaint();
   void ResumePaint(bool paint_next = true);
 
+  // tiles are being painted or are scheduled to be
+  bool HasPendingPaint() const { return current_task_ || next_task_; }
+  // the current task was posted and some of its tiles haven't been painted,
+  // the container is invalidated as they are and once all of them are
+  bool IsPainting() const {
+    return current_task_ && current_task_->posted_ &&
+           !current_task_->completed_;
+  }
+
  private:
   PaintManager();
 
@@ -81,6 +100,10 @@ class PaintManager {
     const std::vector<TileRange> tile_ranges_;
     const CancelFlagPtr skip_paint_flag_;
     const CancelFlagPtr skip_invalidation_flag_;
+    // the earliest time that any of the merged work was scheduled
+    base::TimeTicks scheduled_time_ = base::TimeTicks::Now();
+    bool posted_ = false;
+    bool completed_ = false;
 
     bool CanMergeWith(Task& other);
 
@@ -92,18 +115,31 @@ class PaintManager {
                                     office::TileBuffer& tile_buffer);
   };
 
+  // runs with the index of each tile that is painted
+  using TilePaintedCallback = base::RepeatingCallback<void(unsigned int)>;
+
   void PostCurrentTask();
-  static bool PaintTile(scoped_refptr<office::TileBuffer> tile_buffer,
-                        CancelFlagPtr cancel_flag,
-                        DocumentHolderWithView document,
-                        unsigned int tile_index,
-                        std::size_t context_hash,
-                        const base::RepeatingClosure& completed);
+  // a tile of the task with `task_flag` was painted, the progress is presented
+  // at most once per frame
+  void OnTilePainted(CancelFlagPtr task_flag, unsigned int tile_index);
+  void InvalidateProgress();
+  // tells the client that tiles were painted, if any were since the last time
+  void NotifyTilesPainted();
+  void OnTaskCompleted(CancelFlagPtr task_flag);
+  static TileBuffer::PaintResult PaintTile(
+      scoped_refptr<office::TileBuffer> tile_buffer,
+      CancelFlagPtr cancel_flag,
+      DocumentHolderWithView document,
+      unsigned int tile_index,
+      std::size_t context_hash,
+      const TilePaintedCallback& painted,
+      const base::RepeatingClosure& completed);
   static void PaintTileRange(scoped_refptr<office::TileBuffer> tile_buffer,
                              CancelFlagPtr cancel_flag,
                              DocumentHolderWithView document,
                              TileRange range,
                              std::size_t context_hash,
+                             const TilePaintedCallback& painted,
                              const base::RepeatingClosure& completed);
 
   const scoped_refptr<base::TaskRunner> task_runner_;
@@ -114,6 +150,17 @@ class PaintManager {
   std::unique_ptr<Task> next_task_ = nullptr;
   base::TimeTicks last_paint_time_ = {};
   CancelFlagPtr cancel_invalidate_;
+
+  // about one frame, progress is presented at most this often
+  static constexpr base::TimeDelta kProgressInterval = base::Milliseconds(16);
+  scoped_refptr<base::SequencedTaskRunner> client_task_runner_;
+  base::TimeTicks last_progress_time_;
+  base::OneShotTimer progress_timer_;
+  // the tiles painted since the client was last told of them, only these are
+  // rastered again when the progress is presented
+  gfx::Rect painted_rect_;
+
+  base::WeakPtrFactory<PaintManager> weak_factory_{this};
 };
 
 }  // namespace electron::office
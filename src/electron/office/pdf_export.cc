@@ -0,0 +1,138 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "office/pdf_export.h"
+
+#include <iterator>
+#include <utility>
+#include "base/bind.h"
+#include "base/task/bind_post_task.h"
+#include "base/task/task_traits.h"
+#include "base/task/thread_pool.h"
+#include "base/threading/sequenced_task_runner_handle.h"
+#include "base/trace_event/trace_event.h"
+
+namespace electron::office {
+
+PdfExport::PdfExport(std::vector<int> preview_pages,
+                     Exporter exporter,
+                     PreviewCallback preview,
+                     ProgressCallback progress,
+                     DoneCallback done)
+    : preview_pages_(std::move(preview_pages)),
+      exporter_(std::move(exporter)),
+      preview_callback_(std::move(preview)),
+      progress_callback_(std::move(progress)),
+      done_(std::move(done)) {
+  progress_.preview_count = static_cast<int>(preview_pages_.size());
+}
+
+PdfExport::~PdfExport() = default;
+
+void PdfExport::AddCachedPreviews(std::vector<Thumbnail> previews) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  progress_.preview_count += static_cast<int>(previews.size());
+  cached_previews_.insert(cached_previews_.end(),
+                          std::make_move_iterator(previews.begin()),
+                          std::make_move_iterator(previews.end()));
+}
+
+void PdfExport::Start() {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  TRACE_EVENT_NESTABLE_ASYNC_BEGIN1("electron", "PdfExport", this,
+                                    "previews", progress_.preview_count);
+  ReportProgress();
+  scoped_refptr<base::SequencedTaskRunner> task_runner =
+      base::SequencedTaskRunnerHandle::Get();
+  // ahead of the result of the export, which is posted once LOK writes it
+  if (!cached_previews_.empty()) {
+    task_runner->PostTask(FROM_HERE,
+                          base::BindOnce(&PdfExport::ReportCachedPreviews,
+                                         weak_factory_.GetWeakPtr()));
+  }
+  // both are posted from the exporter's sequence, so the paints arrive after
+  // the result of the export and in order
+  std::move(exporter_).Run(
+      preview_pages_,
+      base::BindPostTask(
+          task_runner,
+          base::BindOnce(&PdfExport::OnExported, weak_factory_.GetWeakPtr(),
+                         base::TimeTicks::Now())),
+      base::BindPostTask(task_runner,
+                         base::BindRepeating(&PdfExport::OnPainted,
+                                             weak_factory_.GetWeakPtr())));
+}
+
+void PdfExport::ReportCachedPreviews() {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  std::vector<Thumbnail> previews = std::move(cached_previews_);
+  cached_previews_.clear();
+  for (const Thumbnail& preview : previews) {
+    ++progress_.previews_done;
+    if (preview_callback_)
+      preview_callback_.Run(preview, true);
+  }
+  ReportProgress();
+  MaybeFinish();
+}
+
+void PdfExport::OnExported(base::TimeTicks start, bool success) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  exported_ = true;
+  success_ = success;
+  progress_.export_time = base::TimeTicks::Now() - start;
+  if (success_ && progress_.preview_count > 0) {
+    progress_.phase = Phase::kPreviews;
+    ReportProgress();
+  }
+  MaybeFinish();
+}
+
+void PdfExport::OnPainted(PagePaint paint) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  ++pages_painted_;
+  ++conversions_pending_;
+  base::ThreadPool::PostTaskAndReplyWithResult(
+      FROM_HERE, {base::TaskPriority::USER_VISIBLE},
+      base::BindOnce(
+          [](PagePaint paint) {
+            TRACE_EVENT1("electron", "PdfExport::Convert", "page",
+                         paint.page);
+            return ToThumbnail(paint);
+          },
+          std::move(paint)),
+      base::BindOnce(&PdfExport::OnConverted, weak_factory_.GetWeakPtr()));
+}
+
+void PdfExport::OnConverted(Thumbnail thumbnail) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  --conversions_pending_;
+  ++progress_.previews_done;
+  if (thumbnail.pixels && preview_callback_)
+    preview_callback_.Run(thumbnail, false);
+  ReportProgress();
+  MaybeFinish();
+}
+
+void PdfExport::MaybeFinish() {
+  // the previews aren't painted if the PDF wasn't written
+  if (!exported_ || conversions_pending_ > 0 || !cached_previews_.empty() ||
+      !done_ || (success_ && pages_painted_ < preview_pages_.size())) {
+    return;
+  }
+
+  progress_.phase = success_ ? Phase::kDone : Phase::kFailed;
+  ReportProgress();
+  TRACE_EVENT_NESTABLE_ASYNC_END1("electron", "PdfExport", this,
+                                  "success", success_);
+  // may delete this
+  std::move(done_).Run(success_);
+}
+
+void PdfExport::ReportProgress() {
+  if (progress_callback_)
+    progress_callback_.Run(progress_);
+}
+
+}  // namespace electron::office
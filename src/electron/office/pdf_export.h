@@ -0,0 +1,93 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <vector>
+#include "base/callback.h"
+#include "base/memory/weak_ptr.h"
+#include "base/sequence_checker.h"
+#include "base/time/time.h"
+#include "office/thumbnail_cache.h"
+
+namespace electron::office {
+
+// Exports a document to PDF along with low resolution previews of its pages.
+// The PDF is written and the previews are painted in one task off of the
+// renderer, the previews right after the PDF so that the export isn't delayed
+// by them. Nothing else is queued for the document in between, but input is
+// still handled on the renderer while the task runs, so a preview may not
+// match the PDF if the document is edited during the export. Each preview is
+// converted on the thread pool while the next page paints, and is reported as
+// soon as it is converted.
+class PdfExport {
+ public:
+  enum class Phase { kExporting, kPreviews, kDone, kFailed };
+
+  struct Progress {
+    Phase phase = Phase::kExporting;
+    int previews_done = 0;
+    int preview_count = 0;
+    // how long LOK took to write the PDF
+    base::TimeDelta export_time;
+  };
+
+  // writes the PDF off of the renderer and then, if it was written, paints
+  // `pages` in order in the same task. `exported` and then `painted` for each
+  // page are run on that task's sequence.
+  using Exporter = base::OnceCallback<void(
+      std::vector<int> pages,
+      base::OnceCallback<void(bool success)> exported,
+      base::RepeatingCallback<void(PagePaint paint)> painted)>;
+  // `cached` previews were passed to AddCachedPreviews rather than painted
+  using PreviewCallback =
+      base::RepeatingCallback<void(const Thumbnail& preview, bool cached)>;
+  using ProgressCallback = base::RepeatingCallback<void(const Progress&)>;
+  using DoneCallback = base::OnceCallback<void(bool success)>;
+
+  // `preview_pages` are painted in order after the PDF is written
+  PdfExport(std::vector<int> preview_pages,
+            Exporter exporter,
+            PreviewCallback preview,
+            ProgressCallback progress,
+            DoneCallback done);
+  ~PdfExport();
+
+  // no copy
+  PdfExport(const PdfExport&) = delete;
+  PdfExport& operator=(const PdfExport&) = delete;
+
+  // previews that don't need painting, reported right after Start returns
+  // and counted in the progress with the painted ones
+  void AddCachedPreviews(std::vector<Thumbnail> previews);
+  void Start();
+
+  const Progress& progress() const { return progress_; }
+
+ private:
+  void ReportCachedPreviews();
+  void OnExported(base::TimeTicks start, bool success);
+  void OnPainted(PagePaint paint);
+  void OnConverted(Thumbnail thumbnail);
+  void MaybeFinish();
+  void ReportProgress();
+
+  const std::vector<int> preview_pages_;
+  std::vector<Thumbnail> cached_previews_;
+  Exporter exporter_;
+  PreviewCallback preview_callback_;
+  ProgressCallback progress_callback_;
+  DoneCallback done_;
+
+  size_t pages_painted_ = 0;
+  int conversions_pending_ = 0;
+  bool exported_ = false;
+  bool success_ = false;
+  Progress progress_;
+
+  SEQUENCE_CHECKER(sequence_checker_);
+  base::WeakPtrFactory<PdfExport> weak_factory_{this};
+};
+
+}  // namespace electron::office
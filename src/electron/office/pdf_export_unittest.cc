@@ -0,0 +1,185 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "pdf_export.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "base/memory/ref_counted_memory.h"
+#include "base/test/bind.h"
+#include "base/test/task_environment.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "third_party/abseil-cpp/absl/types/optional.h"
+
+namespace electron::office {
+
+namespace {
+PagePaint MakePaint(int page) {
+  PagePaint paint;
+  paint.page = page;
+  paint.width = 4;
+  paint.height = 2;
+  paint.bgra.assign(4 * 4 * 2, 255);
+  return paint;
+}
+}  // namespace
+
+class PdfExportTest : public ::testing::Test {
+ protected:
+  base::test::TaskEnvironment task_environment_;
+};
+
+namespace {
+// paints every page in the exporter's task, as the document client does
+PdfExport::Exporter MakeExporter(std::vector<std::string>* document,
+                                 bool success) {
+  return base::BindLambdaForTesting(
+      [document, success](std::vector<int> pages,
+                          base::OnceCallback<void(bool)> exported,
+                          base::RepeatingCallback<void(PagePaint)> painted) {
+        document->push_back("export");
+        std::move(exported).Run(success);
+        if (!success)
+          return;
+        for (int page : pages) {
+          document->push_back("paint " + std::to_string(page));
+          // a negative page couldn't be painted and has no preview
+          painted.Run(page < 0 ? PagePaint() : MakePaint(page));
+        }
+      });
+}
+}  // namespace
+
+TEST_F(PdfExportTest, PaintsPreviewsAfterExporting) {
+  // the order of the work in the exporter's task
+  std::vector<std::string> document;
+  std::vector<int> previews;
+  std::vector<PdfExport::Progress> progress;
+  absl::optional<bool> result;
+
+  PdfExport job(
+      {2, 0, 1}, MakeExporter(&document, true),
+      base::BindLambdaForTesting([&](const Thumbnail& thumbnail, bool) {
+        previews.push_back(thumbnail.page);
+      }),
+      base::BindLambdaForTesting(
+          [&](const PdfExport::Progress& p) { progress.push_back(p); }),
+      base::BindLambdaForTesting([&](bool success) { result = success; }));
+  job.Start();
+  task_environment_.RunUntilIdle();
+
+  EXPECT_EQ(document, (std::vector<std::string>{"export", "paint 2",
+                                                "paint 0", "paint 1"}));
+  // conversions may finish in any order
+  std::sort(previews.begin(), previews.end());
+  EXPECT_EQ(previews, (std::vector<int>{0, 1, 2}));
+  ASSERT_TRUE(result);
+  EXPECT_TRUE(*result);
+
+  ASSERT_FALSE(progress.empty());
+  EXPECT_EQ(progress.front().phase, PdfExport::Phase::kExporting);
+  EXPECT_TRUE(std::any_of(progress.begin(), progress.end(),
+                          [](const PdfExport::Progress& p) {
+                            return p.phase == PdfExport::Phase::kPreviews;
+                          }));
+  EXPECT_EQ(progress.back().phase, PdfExport::Phase::kDone);
+  EXPECT_EQ(progress.back().previews_done, 3);
+  EXPECT_EQ(progress.back().preview_count, 3);
+}
+
+TEST_F(PdfExportTest, FinishesOnceEveryPreviewIsConverted) {
+  std::vector<std::string> document;
+  int previews = 0;
+  absl::optional<bool> result;
+
+  PdfExport job(
+      {0, -1}, MakeExporter(&document, true),
+      base::BindLambdaForTesting([&](const Thumbnail&, bool) { ++previews; }),
+      PdfExport::ProgressCallback(),
+      base::BindLambdaForTesting([&](bool success) { result = success; }));
+  job.Start();
+  task_environment_.RunUntilIdle();
+
+  EXPECT_EQ(previews, 1);
+  ASSERT_TRUE(result);
+  EXPECT_TRUE(*result);
+  EXPECT_EQ(job.progress().previews_done, 2);
+}
+
+TEST_F(PdfExportTest, CountsCachedPreviews) {
+  std::vector<std::string> document;
+  std::vector<int> cached;
+  std::vector<int> painted;
+  std::vector<PdfExport::Progress> progress;
+  absl::optional<bool> result;
+
+  PdfExport job(
+      {1}, MakeExporter(&document, true),
+      base::BindLambdaForTesting([&](const Thumbnail& thumbnail, bool hit) {
+        (hit ? cached : painted).push_back(thumbnail.page);
+      }),
+      base::BindLambdaForTesting(
+          [&](const PdfExport::Progress& p) { progress.push_back(p); }),
+      base::BindLambdaForTesting([&](bool success) { result = success; }));
+  std::vector<Thumbnail> previews;
+  previews.emplace_back(0, 4, 2, base::MakeRefCounted<base::RefCountedBytes>(
+                                     std::vector<unsigned char>(4 * 4 * 2)));
+  job.AddCachedPreviews(std::move(previews));
+  job.Start();
+  task_environment_.RunUntilIdle();
+
+  // only the pages missing from the cache are painted
+  EXPECT_EQ(document, (std::vector<std::string>{"export", "paint 1"}));
+  EXPECT_EQ(cached, std::vector<int>{0});
+  EXPECT_EQ(painted, std::vector<int>{1});
+  ASSERT_TRUE(result);
+  EXPECT_TRUE(*result);
+  ASSERT_FALSE(progress.empty());
+  EXPECT_EQ(progress.front().preview_count, 2);
+  EXPECT_EQ(progress.back().phase, PdfExport::Phase::kDone);
+  EXPECT_EQ(progress.back().previews_done, 2);
+  EXPECT_EQ(progress.back().preview_count, 2);
+}
+
+TEST_F(PdfExportTest, ReportsAFailedExport) {
+  std::vector<std::string> document;
+  int previews = 0;
+  absl::optional<bool> result;
+
+  PdfExport job(
+      {0}, MakeExporter(&document, false),
+      base::BindLambdaForTesting([&](const Thumbnail&, bool) { ++previews; }),
+      PdfExport::ProgressCallback(),
+      base::BindLambdaForTesting([&](bool success) { result = success; }));
+  job.Start();
+  task_environment_.RunUntilIdle();
+
+  // the previews of a PDF that wasn't written aren't painted
+  EXPECT_EQ(document, std::vector<std::string>{"export"});
+  EXPECT_EQ(previews, 0);
+  ASSERT_TRUE(result);
+  EXPECT_FALSE(*result);
+  EXPECT_EQ(job.progress().phase, PdfExport::Phase::kFailed);
+  EXPECT_EQ(job.progress().previews_done, 0);
+}
+
+TEST_F(PdfExportTest, ExportsWithoutPreviews) {
+  std::vector<std::string> document;
+  absl::optional<bool> result;
+
+  PdfExport job({}, MakeExporter(&document, true),
+                PdfExport::PreviewCallback(), PdfExport::ProgressCallback(),
+                base::BindLambdaForTesting(
+                    [&](bool success) { result = success; }));
+  job.Start();
+  task_environment_.RunUntilIdle();
+
+  EXPECT_EQ(document, std::vector<std::string>{"export"});
+  ASSERT_TRUE(result);
+  EXPECT_TRUE(*result);
+  EXPECT_EQ(job.progress().phase, PdfExport::Phase::kDone);
+}
+
+}  // namespace electron::office
@@ -0,0 +1,53 @@
+async function testAutosave() {
+  const x = await loadEmptyDoc();
+  assert(x != null);
+
+  await x.initializeForRendering();
+  getEmbed().renderDocument(x);
+  await ready(x);
+
+  const url = tempFileURL('.odt');
+  /** @type LibreOffice.AutosaveProgress[] */
+  const progress = [];
+  /** @type {(p: LibreOffice.AutosaveProgress) => void} */
+  let settle = () => {};
+  const nextSave = () =>
+    new Promise((resolve) => {
+      settle = resolve;
+    });
+  const done = nextSave();
+  x.setAutosave({
+    path: decodeURIComponent(new URL(url).pathname),
+    intervalMs: 10,
+    idleMs: 10,
+    onProgress: (p) => {
+      progress.push(p);
+      if (p.phase === 'done' || p.phase === 'failed') settle(p);
+    },
+  });
+
+  // nothing is saved until the document is modified
+  await new Promise((resolve) => setTimeout(resolve, 50));
+  assert(progress.length === 0);
+
+  sendKeyEvent(KeyEventType.Press, 'a');
+  const result = await done;
+  assert(result.phase === 'done');
+  assert(result.bytesWritten === result.totalBytes);
+  assert(result.totalBytes > 0);
+  assert(progress[0].phase === 'serializing');
+  assert(fileURLExists(url));
+
+  // the document stays modified, later edits are saved again
+  const second = nextSave();
+  const saves = progress.length;
+  sendKeyEvent(KeyEventType.Press, 'b');
+  const secondResult = await second;
+  assert(secondResult.phase === 'done');
+  assert(progress[saves].phase === 'serializing');
+  assert(fileURLExists(url));
+
+  x.setAutosave(null);
+}
+
+testAutosave();
@@ -0,0 +1,54 @@
+async function testBatchedEvents() {
+  const x = await loadEmptyDoc();
+  assert(x != null);
+
+  let immediateCalls = 0;
+  /** @type any[] */
+  const batches = [];
+  x.on('state_changed', () => {
+    immediateCalls++;
+  });
+  x.on('state_changed', (events) => batches.push(events), { batched: true });
+  /** @type string[] */
+  const boldStates = [];
+  x.on(
+    'state_changed',
+    ({ payload }) => boldStates.push(payload),
+    { keys: ['.uno:Bold'] }
+  );
+
+  await x.initializeForRendering();
+  getEmbed().renderDocument(x);
+  await ready(x);
+
+  x.postUnoCommand('.uno:Bold');
+  sendKeyEvent(KeyEventType.Press, 'a');
+  await idle();
+
+  // without frames, batches are flushed by a fallback timer
+  const batchedCount = () =>
+    batches.reduce((sum, events) => sum + events.length, 0);
+  for (let i = 0; i < 50 && batchedCount() < immediateCalls; ++i) {
+    await new Promise((resolve) => setTimeout(resolve, 20));
+  }
+
+  // every event arrives, but in fewer calls
+  const batchedEvents = batchedCount();
+  assert(batches.length > 0);
+  assert(batches.every((events) => Array.isArray(events)));
+  assert(batches.length < immediateCalls);
+  assert(batchedEvents === immediateCalls);
+
+  // key=value states are typed
+  const bold = batches
+    .flat()
+    .map(({ payload }) => payload)
+    .find((payload) => payload.commandId === '.uno:Bold');
+  assert(bold != null && typeof bold.value === 'boolean');
+
+  // only the filtered key arrives
+  assert(boldStates.length > 0);
+  assert(boldStates.every((payload) => JSON.stringify(payload).includes('.uno:Bold')));
+}
+
+testBatchedEvents();
@@ -106,6 +106,21 @@ async function testClipboard() {
   assert(buf2.byteLength === testPng.byteLength);
   const bufArray2 = new Uint8Array(buf2);
   assert(bufArray2.every((b, idx) => b == testPng[idx]));
+
+  // the async variants should round trip the same way
+  assert(
+    await x.setClipboardAsync([{
+      mimeType: 'image/png',
+      buffer: testPng.buffer
+    }])
+  );
+  const pngContent3 = await x.getClipboardAsync(['image/png']);
+  assert(pngContent3.length === 1);
+  assert(pngContent3[0].mimeType === 'image/png');
+  const bufArray3 = new Uint8Array(pngContent3[0].buffer);
+  assert(bufArray3.byteLength === testPng.byteLength);
+  assert(bufArray3.every((b, idx) => b == testPng[idx]));
+  assert((await x.setClipboardAsync([])) === false);
 }
 
 testClipboard();
@@ -0,0 +1,56 @@
+async function testConvertBatch() {
+  const x = await loadEmptyDoc();
+  assert(x != null);
+
+  const docxURL = tempFileURL('.docx');
+  assert(await x.saveAs(docxURL));
+  const input = decodeURIComponent(new URL(docxURL).pathname);
+
+  const outputs = [tempFileURL('.pdf'), tempFileURL('.odt')];
+  const progress = [];
+  const batch = libreoffice.convertBatch(
+    [
+      { input, output: decodeURIComponent(new URL(outputs[0]).pathname), format: 'pdf' },
+      { input, output: decodeURIComponent(new URL(outputs[1]).pathname), format: 'odt' },
+      { input: input + '.missing', output: input + '.never' },
+    ],
+    { concurrency: 2, onProgress: (result) => progress.push(result) }
+  );
+  assert(batch.getStats() != null);
+
+  const result = await batch.done;
+  assert(result.succeeded === 2);
+  assert(result.failed === 1);
+  assert(result.results[2].status === 'failed');
+  assert(result.bytesWritten > 0);
+  assert(progress.length === 3);
+  assert(fileURLExists(outputs[0]));
+  assert(fileURLExists(outputs[1]));
+
+  // cancelling before the next job starts
+  const cancelled = libreoffice.convertBatch(
+    [
+      { input, output: input + '.1.pdf', format: 'pdf' },
+      { input, output: input + '.2.pdf', format: 'pdf' },
+    ],
+    { concurrency: 1 }
+  );
+  cancelled.cancel();
+  const cancelledResult = await cancelled.done;
+  assert(cancelledResult.cancelled >= 1);
+
+  // converting in worker processes
+  const pooledOutputs = [tempFileURL('.pdf'), tempFileURL('.pdf')];
+  const pooled = libreoffice.convertBatch(
+    pooledOutputs.map((url) => ({
+      input,
+      output: decodeURIComponent(new URL(url).pathname),
+    })),
+    { processes: 2 }
+  );
+  const pooledResult = await pooled.done;
+  assert(pooledResult.succeeded === 2);
+  assert(pooledOutputs.every((url) => fileURLExists(url)));
+}
+
+testConvertBatch();
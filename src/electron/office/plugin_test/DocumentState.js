@@ -0,0 +1,55 @@
+async function testDocumentState() {
+  const x = await loadEmptyDoc();
+  assert(x != null);
+
+  /** @type {Array<any>} */
+  const diffs = [];
+  let resolveComment;
+  const commentPromise = new Promise((resolve) => (resolveComment = resolve));
+  x.on('state_diff', ({ payload }) => {
+    diffs.push(payload);
+    if (payload.comments && payload.comments.changed.length > 0)
+      resolveComment();
+  });
+
+  await x.initializeForRendering();
+  getEmbed().renderDocument(x);
+  await ready(x);
+
+  assert(x.getState('.uno:NotACommand') === undefined);
+  assert(Array.isArray(x.getComments()));
+  assert(Array.isArray(x.getTrackedChanges()));
+
+  sendKeyEvent(KeyEventType.Press, 'a');
+  await idle();
+  await painted();
+  assert(x.getState('.uno:Undo') === 'enabled');
+  assert(canUndo());
+  assert(typeof x.getState() === 'object');
+
+  const testComment = 'This is a comment';
+  x.postUnoCommand('.uno:InsertAnnotation', {
+    Text: {
+      type: 'string',
+      value: testComment,
+    },
+  });
+  await commentPromise;
+
+  // the same table as getCommandValues, without querying it
+  const comments = x.getComments();
+  log(JSON.stringify(comments));
+  assert(comments.length === 1);
+  assert(comments[0].text === testComment);
+  const { comments: queried } = await x.getCommandValues(
+    '.uno:ViewAnnotations'
+  );
+  assert(queried.length === comments.length);
+  assert(String(queried[0].id) === String(comments[0].id));
+
+  // a diff only has the parts that changed
+  assert(diffs.some((diff) => diff.state && '.uno:Undo' in diff.state));
+  assert(diffs.every((diff) => Object.keys(diff).length > 0));
+}
+
+testDocumentState();
@@ -0,0 +1,52 @@
+async function testExportPdf() {
+  const x = await loadEmptyDoc();
+  assert(x != null);
+
+  await x.initializeForRendering();
+  getEmbed().renderDocument(x);
+  await ready(x);
+  await painted();
+
+  /** @type {Array<any>} */
+  const previews = [];
+  /** @type {Array<any>} */
+  const progress = [];
+  const pdfURL = tempFileURL('.pdf');
+  const exported = await x.exportPdf(pdfURL, {
+    previewWidth: 120,
+    onPreview: (preview) => previews.push(preview),
+    onProgress: (p) => progress.push(p),
+  });
+  assert(exported);
+  assert(fileURLExists(pdfURL));
+
+  // every preview arrives before the export is done, after the PDF is written
+  assert(previews.length === getEmbed().pageRects.length);
+  assert(previews[0].page === 0);
+  assert(!previews[0].stale);
+  assert(previews[0].width === 120);
+  assert(previews[0].data.length === 120 * previews[0].height * 4);
+  assert(progress[0].phase === 'exporting');
+  const previewing = progress.findIndex((p) => p.phase === 'previews');
+  assert(previewing > 0);
+  assert(progress[previewing].exportMs > 0);
+  assert(progress[progress.length - 1].phase === 'done');
+
+  // the previews were cached, so they aren't painted again
+  const rendered = thumbnailsRendered();
+  const thumbnails = await x.renderPages({ pages: [0], width: 120 });
+  assert(thumbnails[0].height === previews[0].height);
+  assert(thumbnailsRendered() === rendered);
+  const again = [];
+  const cachedProgress = [];
+  const exportedAgain = await x.exportPdf(tempFileURL('.pdf'), {
+    previewWidth: 120,
+    onPreview: (preview) => again.push(preview),
+    onProgress: (p) => cachedProgress.push(p),
+  });
+  assert(exportedAgain);
+  assert(again.length === previews.length);
+  assert(cachedProgress[cachedProgress.length - 1].previewCount === 0);
+}
+
+testExportPdf();
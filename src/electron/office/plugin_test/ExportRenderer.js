@@ -0,0 +1,49 @@
+async function testExportRenderer() {
+  const x = await loadEmptyDoc();
+  assert(x != null);
+
+  await x.initializeForRendering();
+  getEmbed().renderDocument(x);
+  await ready(x);
+
+  sendKeyEvent(KeyEventType.Press, 'a');
+  await idle();
+  await painted();
+
+  const exported = getEmbed().exportRenderer();
+  assert(exported instanceof ArrayBuffer);
+  assert(exported.byteLength > 0);
+  const pageRects = getEmbed().pageRects;
+
+  // another window would receive a copy of the buffer through IPC
+  const received = exported.slice(0);
+  remountEmbed();
+  await idle();
+  getEmbed().renderDocument(x, { restoreFrom: received });
+  assert(
+    JSON.stringify(getEmbed().pageRects) === JSON.stringify(pageRects)
+  );
+  await painted();
+  // the restored tiles are shown instead of being painted again
+  assert((getEmbed().getRenderStats()?.tilesPainted ?? 0) === 0);
+
+  // an export from before an edit is stale
+  const stale = getEmbed().exportRenderer();
+  assert(stale instanceof ArrayBuffer);
+  sendKeyEvent(KeyEventType.Press, 'b');
+  await idle();
+  await painted();
+  remountEmbed();
+  await idle();
+  getEmbed().renderDocument(x, { restoreFrom: stale });
+  await painted();
+  assert(getEmbed().getRenderStats().tilesPainted > 0);
+
+  // an invalid buffer renders from scratch
+  remountEmbed();
+  await idle();
+  getEmbed().renderDocument(x, { restoreFrom: new ArrayBuffer(16) });
+  await painted();
+}
+
+testExportRenderer();
@@ -0,0 +1,82 @@
+async function testHibernation() {
+  const x = await loadEmptyDoc();
+  assert(x != null);
+
+  await x.initializeForRendering();
+  x.setHibernation({ idleMs: 0, unload: 'memory' });
+
+  const restoreKey = getEmbed().renderDocument(x, {
+    restoreKey: undefined,
+  });
+  await ready(x);
+
+  sendKeyEvent(KeyEventType.Press, 'a');
+  await idle();
+  await painted();
+  assert(!x.isHibernated);
+
+  x.postUnoCommand('.uno:InsertAnnotation', {
+    Text: {
+      type: 'string',
+      value: 'kept through hibernation',
+    },
+  });
+  await idle();
+
+  remountEmbed();
+  await new Promise((resolve) => setTimeout(resolve, 50));
+  await idle();
+  assert(x.isHibernated);
+
+  getEmbed().renderDocument(x, {
+    restoreKey,
+  });
+  await painted();
+  assert(!x.isHibernated);
+
+  // the reloaded document has new comment ids, the table is seeded again
+  const { comments: queried } = await x.getCommandValues(
+    '.uno:ViewAnnotations'
+  );
+  assert(queried.length === 1);
+  const seeded = () => {
+    const comments = x.getComments();
+    return (
+      comments.length === 1 && String(comments[0].id) === String(queried[0].id)
+    );
+  };
+  for (let i = 0; i < 20 && !seeded(); ++i) await idle();
+  const comments = x.getComments();
+  log(JSON.stringify(comments));
+  assert(comments.length === 1);
+  assert(String(comments[0].id) === String(queried[0].id));
+
+  const buffer = await x.saveToMemory();
+  assert(buffer != null && buffer.byteLength > 0);
+}
+
+// a document that's never rendered hibernates too, and a command posted while
+// it's unloaded reloads it instead of being skipped
+async function testHibernationWithoutRenderer() {
+  const x = await loadEmptyDoc();
+  assert(x != null);
+
+  x.setHibernation({ idleMs: 0, unload: 'memory' });
+  for (let i = 0; i < 20 && !x.isHibernated; ++i) {
+    await new Promise((resolve) => setTimeout(resolve, 10));
+  }
+  assert(x.isHibernated);
+
+  let modified = false;
+  x.on('state_changed', ({ payload }) => {
+    if (payload === '.uno:ModifiedStatus=true') modified = true;
+  });
+  x.postUnoCommand('.uno:InsertText', {
+    Text: { type: 'string', value: 'typed while hibernated' },
+  });
+  for (let i = 0; i < 50 && (x.isHibernated || !modified); ++i) await idle();
+  assert(!x.isHibernated);
+  assert(modified);
+}
+
+testHibernation().then(testHibernationWithoutRenderer);
@@ -0,0 +1,56 @@
+async function testMemoryBudget() {
+  const x = await loadEmptyDoc();
+  assert(x != null);
+
+  await x.initializeForRendering();
+  const restoreKey = getEmbed().renderDocument(x, {
+    restoreKey: undefined,
+  });
+  await ready(x);
+
+  sendKeyEvent(KeyEventType.Press, 'a');
+  await idle();
+  await painted();
+
+  let usage = x.getMemoryUsage();
+  log(JSON.stringify(usage));
+  assert(usage.views.length === 1);
+  assert(usage.views[0].visible);
+  assert(usage.views[0].tilePoolBytes > 0);
+  assert(usage.views[0].tileBytes > 0);
+  assert(usage.totalBytes >= usage.views[0].tilePoolBytes);
+
+  // a visible renderer is never reclaimed
+  x.setMemoryBudget({ maxBytes: 0 });
+  assert(x.getMemoryUsage().views[0].tilePoolBytes > 0);
+  assert(!x.isHibernated);
+
+  // the unmounted renderer is held for its restore key, setting the budget
+  // again enforces it without waiting for the periodic check
+  remountEmbed();
+  x.setMemoryBudget({ maxBytes: 0 });
+  for (let i = 0; i < 100 && !x.isHibernated; ++i) {
+    await new Promise((resolve) => setTimeout(resolve, 10));
+  }
+  await idle();
+
+  usage = x.getMemoryUsage();
+  log(JSON.stringify(usage));
+  assert(usage.budgetBytes === 0);
+  assert(usage.views.every((view) => view.tilePoolBytes === 0));
+  assert(usage.views.every((view) => view.snapshotBytes === 0));
+  assert(x.isHibernated);
+  assert(usage.unloadedBytes > 0);
+
+  x.setMemoryBudget(null);
+  assert(x.getMemoryUsage().budgetBytes === undefined);
+
+  getEmbed().renderDocument(x, {
+    restoreKey,
+  });
+  await painted();
+  assert(!x.isHibernated);
+  assert(x.getMemoryUsage().views[0].tilePoolBytes > 0);
+}
+
+testMemoryBudget();
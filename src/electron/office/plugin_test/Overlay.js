@@ -0,0 +1,59 @@
+/** resolves once the plugin has handled the next `event` of the document */
+async function next(doc, event) {
+  await new Promise((resolve) => {
+    const listener = () => {
+      doc.off(event, listener);
+      resolve();
+    };
+    doc.on(event, listener);
+  });
+  await idle();
+}
+
+function isEmpty(rect) {
+  return rect.width <= 0 || rect.height <= 0;
+}
+
+async function testOverlay() {
+  const x = await loadEmptyDoc();
+  assert(x != null);
+
+  await x.initializeForRendering();
+  getEmbed().renderDocument(x);
+  await ready(x);
+  await painted();
+  updateFocus(true);
+
+  let cursor = next(x, 'invalidate_visible_cursor');
+  sendKeyEvent(KeyEventType.Press, 'a');
+  sendKeyEvent(KeyEventType.Press, 'b');
+  await cursor;
+
+  // the caret is drawn natively while the embed has focus
+  let overlay = getOverlay();
+  log(JSON.stringify(overlay));
+  assert(!isEmpty(overlay.caret));
+  assert(overlay.selection.length === 0);
+  const caretX = overlay.caret.x;
+
+  let selection = next(x, 'text_selection');
+  sendKeyEvent(KeyEventType.Press, 'shift+left');
+  await selection;
+  overlay = getOverlay();
+  assert(overlay.selection.length > 0);
+  assert(overlay.selection.every((rect) => !isEmpty(rect)));
+  // a writer document has no cell cursor
+  assert(isEmpty(overlay.cellCursor));
+
+  selection = next(x, 'text_selection');
+  sendKeyEvent(KeyEventType.Press, 'right');
+  await selection;
+  overlay = getOverlay();
+  assert(overlay.selection.length === 0);
+  assert(overlay.caret.x >= caretX);
+
+  updateFocus(false);
+  assert(isEmpty(getOverlay().caret));
+}
+
+testOverlay();
@@ -0,0 +1,42 @@
+/** resolves once a paint and everything it prefetched has been presented */
+async function settled() {
+  let painted = -1;
+  while (painted !== getEmbed().getRenderStats().tilesPainted) {
+    painted = getEmbed().getRenderStats().tilesPainted;
+    await idle();
+    await new Promise((resolve) => setTimeout(resolve, 100));
+  }
+}
+
+async function testProgressivePaint() {
+  const x = await loadEmptyDoc();
+  assert(x != null);
+
+  const xText = x.as('text.XTextDocument').getText();
+  xText.setString('The quick brown fox jumps over the lazy dog. '.repeat(400));
+
+  await x.initializeForRendering();
+  getEmbed().renderDocument(x);
+  await ready(x);
+  await painted();
+  await settled();
+
+  // zooming in repaints every tile in view, which takes more than a frame
+  const tilesBefore = getEmbed().getRenderStats().tilesPainted;
+  const invalidationsBefore = invalidationCount();
+  getEmbed().setZoom(4);
+  await painted();
+  const firstPresent = getEmbed().getRenderStats().tilesPainted - tilesBefore;
+  await settled();
+
+  const tiles = getEmbed().getRenderStats().tilesPainted - tilesBefore;
+  const invalidations = invalidationCount() - invalidationsBefore;
+  log(`first present: ${firstPresent} of ${tiles} tiles`);
+  log(`presents: ${invalidations}`);
+  assert(tiles > 0);
+  // every present after the zoom shows at least one tile that wasn't shown,
+  // the completion of a task doesn't present the same tiles again
+  assert(invalidations <= tiles + 1);
+}
+
+testProgressivePaint();
@@ -0,0 +1,35 @@
+async function testRenderPages() {
+  const x = await loadEmptyDoc();
+  assert(x != null);
+
+  await x.initializeForRendering();
+
+  getEmbed().renderDocument(x);
+  await ready(x);
+  await painted();
+
+  const thumbnails = await x.renderPages({ pages: [0], width: 120 });
+  assert(thumbnails.length === 1);
+  const thumbnail = thumbnails[0];
+  assert(thumbnail != null);
+  assert(thumbnail.page === 0);
+  assert(thumbnail.width === 120);
+  assert(thumbnail.height > 0);
+  assert(thumbnail.data.length === thumbnail.width * thumbnail.height * 4);
+
+  // cached, so it isn't painted again
+  const rendered = thumbnailsRendered();
+  assert(rendered >= 1);
+  const pixel = thumbnail.data[0];
+  thumbnail.data.fill(pixel ^ 0xff);
+  const cached = await x.renderPages({ pages: [0], width: 120 });
+  assert(thumbnailsRendered() === rendered);
+  assert(cached[0].data !== thumbnail.data);
+  // writing to a result doesn't change the cache
+  assert(cached[0].data[0] === pixel);
+
+  const missing = await x.renderPages({ pages: [9999], width: 120 });
+  assert(missing.length === 1 && missing[0] === undefined);
+}
+
+testRenderPages();
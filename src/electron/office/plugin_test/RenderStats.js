@@ -0,0 +1,24 @@
+async function testRenderStats() {
+  const x = await loadEmptyDoc();
+  assert(x != null);
+
+  await x.initializeForRendering();
+
+  getEmbed().renderDocument(x);
+  await ready(x);
+  await painted();
+
+  const stats = getEmbed().getRenderStats();
+  assert(stats != null);
+  assert(stats.tilesPainted > 0);
+  assert(stats.tilesFailed === 0);
+  assert(stats.tilePaintLatency.count === stats.tilesPainted);
+  assert(
+    stats.tilePaintLatency.counts.length ===
+      stats.tilePaintLatency.bucketsMs.length + 1
+  );
+  assert(stats.poolHitRate >= 0 && stats.poolHitRate <= 1);
+  assert(stats.callbackQueueDepth >= 0);
+}
+
+testRenderStats();
@@ -0,0 +1,60 @@
+async function testSpellcheck() {
+  const x = await loadEmptyDoc();
+  assert(x != null);
+
+  await x.initializeForRendering();
+  getEmbed().renderDocument(x);
+  await ready(x);
+  await painted();
+
+  const xText = x.as('text.XTextDocument').getText();
+  xText.setString('teh qiuck brwon fox');
+  await painted();
+
+  let resolveOnline;
+  let switchedOff = false;
+  const online = new Promise((resolve) => (resolveOnline = resolve));
+  x.on(
+    'state_changed',
+    ({ payload }) => {
+      if (payload.includes('.uno:SpellOnline=true')) resolveOnline();
+      if (payload.includes('.uno:SpellOnline=false')) switchedOff = true;
+    },
+    { keys: ['.uno:SpellOnline'] }
+  );
+
+  x.setSpellcheck(true);
+  // spelling waits for input to be idle before it starts
+  const before = getEmbed().getRenderStats().tilesPainted;
+  await online;
+  let after = before;
+  for (let i = 0; i < 10 && after <= before; ++i) {
+    await painted();
+    after = getEmbed().getRenderStats().tilesPainted;
+  }
+  log(`tiles repainted for spelling: ${after - before}`);
+  assert(after > before);
+
+  // misspellings far from the caret are marked while typing, their squiggles
+  // wait behind the typed text instead of spelling being switched off
+  xText.setString('ok' + '\n'.repeat(20) + 'teh qiuck brwon fox jmups');
+  x.postUnoCommand('.uno:GoToStartOfDoc');
+  const deferredBefore = getEmbed().getRenderStats().invalidationsDeferred;
+  for (let i = 0; i < 10; ++i) {
+    sendKeyEvent(KeyEventType.Press, 'a');
+    await idle();
+  }
+  let deferred = deferredBefore;
+  for (let i = 0; i < 10 && deferred <= deferredBefore; ++i) {
+    await painted();
+    deferred = getEmbed().getRenderStats().invalidationsDeferred;
+  }
+  log(`squiggle invalidations deferred: ${deferred - deferredBefore}`);
+  assert(deferred > deferredBefore);
+  assert(!switchedOff);
+  assert(getEmbed().getRenderStats().tilesPainted > after);
+
+  x.setSpellcheck(false);
+}
+
+testSpellcheck();
@@ -0,0 +1,31 @@
+/** resolves once a paint and everything it prefetched has been presented */
+async function settled() {
+  let painted = -1;
+  while (painted !== getEmbed().getRenderStats().tilesPainted) {
+    painted = getEmbed().getRenderStats().tilesPainted;
+    await idle();
+    await new Promise((resolve) => setTimeout(resolve, 100));
+  }
+}
+
+async function testTileLayerScroll() {
+  const x = await loadEmptyDoc();
+  assert(x != null);
+
+  await x.initializeForRendering();
+  getEmbed().renderDocument(x);
+  await ready(x);
+  await painted();
+  await settled();
+
+  // the tiles under the view are already painted and within the band, so the
+  // compositor moves the layer without recording it again
+  const recorded = invalidationCount();
+  getEmbed().updateScroll(32);
+  await settled();
+  getEmbed().updateScroll(0);
+  await settled();
+  assert(invalidationCount() === recorded);
+}
+
+testTileLayerScroll();
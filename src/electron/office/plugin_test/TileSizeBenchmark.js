@@ -0,0 +1,88 @@
+// paints the first viewport of the same multi-page document with each tile
+// size on a 2x display and records the time spent by LibreOffice painting tiles
+
+// a document with headings, long paragraphs, lists and tables over several
+// pages, saved so that each run loads it fresh
+async function createFixture() {
+  const x = await loadEmptyDoc();
+  assert(x != null);
+
+  const paragraph =
+    '<p>Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do ' +
+    'eiusmod tempor incididunt ut labore et dolore magna aliqua. Ut enim ad ' +
+    'minim veniam, quis nostrud exercitation ullamco laboris nisi ut aliquip ' +
+    'ex ea commodo consequat. <b>Duis aute irure</b> dolor in reprehenderit ' +
+    'in voluptate velit esse cillum dolore eu fugiat nulla pariatur.</p>';
+  const list = '<ul><li>First</li><li>Second</li><li>Third</li></ul>';
+  const table =
+    '<table border="1">' +
+    '<tr><th>Quarter</th><th>Revenue</th><th>Cost</th></tr>' +
+    '<tr><td>Q1</td><td>1,200</td><td>800</td></tr>'.repeat(6) +
+    '</table>';
+  let html = '<html><body>';
+  for (let section = 1; section <= 8; ++section) {
+    html += `<h1>Section ${section}</h1>`;
+    html += paragraph.repeat(4) + list + table + paragraph.repeat(2);
+  }
+  html += '</body></html>';
+  x.paste('text/html', html);
+
+  const url = tempFileURL('.odt');
+  assert(await x.saveAs(url));
+  return url;
+}
+
+async function paintViewport(url, tileSize) {
+  remountEmbed();
+  setDeviceScale(2);
+  resizeEmbed(1280, 800);
+
+  const x = await libreoffice.loadDocument(url);
+  assert(x != null);
+  await x.initializeForRendering();
+
+  const start = Date.now();
+  getEmbed().renderDocument(x, { tileSize });
+  await ready(x);
+  await painted();
+  const elapsedMs = Date.now() - start;
+  assert(getEmbed().pageRects.length > 1);
+
+  const stats = getEmbed().getRenderStats();
+  assert(stats != null);
+  return { stats, elapsedMs };
+}
+
+async function testTileSizeBenchmark() {
+  const url = await createFixture();
+
+  for (const tileSize of [256, 512, 1024]) {
+    const { stats, elapsedMs } = await paintViewport(url, tileSize);
+    assert(stats.tileSizePx === tileSize);
+    assert(stats.tilesPainted > 0);
+
+    const story = `tile_size_${tileSize}`;
+    const paintMs = stats.tilePaintLatency.meanMs * stats.tilePaintLatency.count;
+    recordResult('TileSizeBenchmark.paint', story, paintMs, 'ms');
+    recordResult('TileSizeBenchmark.tiles', story, stats.tilesPainted, 'count');
+    recordResult('TileSizeBenchmark.first_paint', story, elapsedMs, 'ms');
+  }
+
+  // without a tile size, it's chosen by the device scale, even if the last
+  // render set one
+  remountEmbed();
+  setDeviceScale(3);
+  resizeEmbed(1280, 800);
+  const x = await libreoffice.loadDocument(url);
+  await x.initializeForRendering();
+  getEmbed().renderDocument(x, { tileSize: 256 });
+  await ready(x);
+  await painted();
+  assert(getEmbed().getRenderStats().tileSizePx === 256);
+
+  getEmbed().renderDocument(x);
+  await painted();
+  assert(getEmbed().getRenderStats().tileSizePx === 1024);
+}
+
+testTileSizeBenchmark();
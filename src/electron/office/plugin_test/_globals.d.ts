@@ -19,6 +19,8 @@ declare enum MouseButton {
 
 // the majority of these mimic the interactions of OfficeWebPlugin with Chromium
 declare function resizeEmbed(width: number, height: number): void;
+declare function setDeviceScale(scale: number): void;
+declare function log(value: any): void;
 declare function updateFocus(focused: boolean, fromScript?: boolean): void;
 /** resolves when an invalidation event is emitted */
 declare function invalidate(doc: LibreOffice.DocumentClient): Promise<void>;
@@ -50,5 +52,27 @@ declare function tempFileURL(extension: string): string;
 declare function fileURLExists(): boolean;
 /** resolves when the plugin paints */
 declare function painted(): Promise<void>;
+type OverlayRect = { x: number; y: number; width: number; height: number };
+/** the caret, text selection and cell cursor drawn over the tiles, in device
+ * pixels relative to the top of the document */
+declare function getOverlay(): {
+  caret: OverlayRect;
+  selection: OverlayRect[];
+  cellCursor: OverlayRect;
+};
+/** how many pages and slides the rendered document painted for renderPages,
+ * renderSlide and PDF previews, cached results aren't counted */
+declare function thumbnailsRendered(): number;
+/** how many times the plugin invalidated its container or recorded its tile
+ * layer */
+declare function invalidationCount(): number;
+/** prints a perf result line, `*RESULT metric: story= value units`, that
+ * is collected with the rest of the test output */
+declare function recordResult(
+  metric: string,
+  story: string,
+  value: number,
+  units: string
+): void;
 /** destroyes the current embed and replaces it with a new one */
 declare function remountEmbed(): void;
@@ -0,0 +1,234 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "office/process_converter.h"
+
+#include <algorithm>
+#include "base/bind.h"
+#include "base/callback_helpers.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/logging.h"
+#include "base/process/launch.h"
+#include "base/process/process.h"
+#include "base/task/thread_pool.h"
+#include "base/trace_event/trace_event.h"
+#include "build/build_config.h"
+
+#if BUILDFLAG(IS_WIN)
+#include <windows.h>
+
+#include "base/win/scoped_handle.h"
+#else
+#include <signal.h>
+#endif
+
+namespace electron::office {
+
+namespace {
+// how often a running worker checks if its job was cancelled
+constexpr base::TimeDelta kCancelPollInterval = base::Milliseconds(100);
+
+std::string FileURL(const base::FilePath& path) {
+#if BUILDFLAG(IS_WIN)
+  std::string url = "file:///" + path.AsUTF8Unsafe();
+  std::replace(url.begin(), url.end(), '\\', '/');
+  return url;
+#else
+  return "file://" + path.AsUTF8Unsafe();
+#endif
+}
+
+// the extension of the converted file, ex: "pdf" for "pdf:writer_pdf_Export"
+std::string OutputExtension(const ConversionJob& job) {
+  std::string extension = job.format.substr(0, job.format.find(':'));
+  if (extension.empty()) {
+    extension = job.output.FinalExtension().empty()
+                    ? std::string()
+                    : job.output.FinalExtension().substr(1);
+  }
+  return extension;
+}
+
+ConversionResult Finish(ConversionResult result,
+                        ConversionResult::Status status,
+                        base::TimeTicks start,
+                        std::string error = {}) {
+  result.status = status;
+  result.error = std::move(error);
+  result.elapsed = base::TimeTicks::Now() - start;
+  return result;
+}
+}  // namespace
+
+base::CommandLine ConvertCommandLine(const base::FilePath& program,
+                                     const base::FilePath& profile,
+                                     const base::FilePath& out_dir,
+                                     const ConversionJob& job) {
+  // a format with a filter name is passed through, ex: "pdf:writer_pdf_Export"
+  std::string convert_to =
+      job.format.find(':') != std::string::npos ? job.format
+                                                : OutputExtension(job);
+  if (!job.filter_options.empty())
+    convert_to += ":" + job.filter_options;
+
+  base::CommandLine command(program);
+  command.AppendArg("--headless");
+  command.AppendArg("--invisible");
+  command.AppendArg("--nologo");
+  command.AppendArg("--nodefault");
+  command.AppendArg("--norestore");
+  command.AppendArg("--nolockcheck");
+  // without a profile of its own, the process hands the job to whichever
+  // worker started first and exits
+  command.AppendArg("-env:UserInstallation=" + FileURL(profile));
+  command.AppendArg("--convert-to");
+  command.AppendArg(convert_to);
+  command.AppendArg("--outdir");
+  command.AppendArgPath(out_dir);
+  command.AppendArgPath(job.input);
+  return command;
+}
+
+ProcessConverter::ProcessConverter(base::FilePath program, size_t workers)
+    : program_(std::move(program)),
+      released_(&lock_),
+      busy_(std::max<size_t>(workers, 1), false),
+      profiles_(busy_.size()) {}
+
+ProcessConverter::~ProcessConverter() {
+  base::AutoLock lock(lock_);
+  for (auto& profile : profiles_) {
+    if (profile.empty())
+      continue;
+    base::ThreadPool::PostTask(
+        FROM_HERE, {base::MayBlock(), base::TaskPriority::BEST_EFFORT},
+        base::GetDeletePathRecursivelyCallback(profile));
+  }
+}
+
+bool ProcessConverter::AcquireWorker(const CancelFlagPtr& cancel_flag,
+                                     size_t* worker) {
+  base::AutoLock lock(lock_);
+  while (true) {
+    auto free = std::find(busy_.begin(), busy_.end(), false);
+    if (free != busy_.end()) {
+      *free = true;
+      *worker = std::distance(busy_.begin(), free);
+      return true;
+    }
+    if (CancelFlag::IsCancelled(cancel_flag))
+      return false;
+    // a cancelled job doesn't signal, so the wait is bounded
+    released_.TimedWait(kCancelPollInterval);
+  }
+}
+
+void ProcessConverter::ReleaseWorker(size_t worker) {
+  base::AutoLock lock(lock_);
+  DCHECK(busy_[worker]);
+  busy_[worker] = false;
+  released_.Signal();
+}
+
+bool ProcessConverter::IsBusy(size_t worker) {
+  base::AutoLock lock(lock_);
+  return busy_[worker];
+}
+
+bool ProcessConverter::EnsureProfile(size_t worker, base::FilePath* profile) {
+  base::AutoLock lock(lock_);
+  if (profiles_[worker].empty() &&
+      !base::CreateNewTempDirectory(FILE_PATH_LITERAL("lok_worker"),
+                                    &profiles_[worker])) {
+    return false;
+  }
+  *profile = profiles_[worker];
+  return true;
+}
+
+ConversionResult ProcessConverter::Convert(const ConversionJob& job,
+                                           CancelFlagPtr cancel_flag) {
+  using Status = ConversionResult::Status;
+  TRACE_EVENT0("electron", "ProcessConverter::Convert");
+  base::TimeTicks start = base::TimeTicks::Now();
+  ConversionResult result;
+
+  int64_t input_size = 0;
+  if (!base::GetFileSize(job.input, &input_size))
+    return Finish(result, Status::kFailed, start, "unable to read input");
+  result.bytes_read = input_size;
+
+  if (!job.filter_options.empty() && job.format.find(':') == std::string::npos) {
+    return Finish(result, Status::kFailed, start,
+                  "filter options require a filter name in the format, ex: "
+                  "pdf:writer_pdf_Export");
+  }
+  if (CancelFlag::IsCancelled(cancel_flag))
+    return Finish(result, Status::kCancelled, start);
+
+  size_t worker;
+  if (!AcquireWorker(cancel_flag, &worker))
+    return Finish(result, Status::kCancelled, start);
+  base::ScopedClosureRunner release(base::BindOnce(
+      &ProcessConverter::ReleaseWorker, base::Unretained(this), worker));
+  TRACE_EVENT1("electron", "ProcessConverter::Convert::Worker", "worker",
+               worker);
+
+  base::FilePath profile;
+  base::ScopedTempDir out_dir;
+  if (!EnsureProfile(worker, &profile) || !out_dir.CreateUniqueTempDir())
+    return Finish(result, Status::kFailed, start, "unable to create worker");
+
+  // soffice is a launcher for the office process, which would outlive it and
+  // keep the profile locked, so the worker gets a process group or job of its
+  // own and is killed as a whole
+  base::LaunchOptions options;
+#if BUILDFLAG(IS_WIN)
+  base::win::ScopedHandle job_object(::CreateJobObject(nullptr, nullptr));
+  if (!job_object.is_valid())
+    return Finish(result, Status::kFailed, start, "unable to create worker");
+  options.job_handle = job_object.get();
+#else
+  options.new_process_group = true;
+#endif
+  base::Process process = base::LaunchProcess(
+      ConvertCommandLine(program_, profile, out_dir.GetPath(), job),
+      options);
+  if (!process.IsValid())
+    return Finish(result, Status::kFailed, start, "unable to launch worker");
+
+  int exit_code = -1;
+  while (!process.WaitForExitWithTimeout(kCancelPollInterval, &exit_code)) {
+    if (CancelFlag::IsCancelled(cancel_flag)) {
+#if BUILDFLAG(IS_WIN)
+      ::TerminateJobObject(job_object.get(), 1);
+#else
+      ::kill(-process.Pid(), SIGKILL);
+#endif
+      process.WaitForExit(&exit_code);
+      return Finish(result, Status::kCancelled, start);
+    }
+  }
+  if (exit_code != 0) {
+    return Finish(result, Status::kFailed, start,
+                  "worker exited with " + std::to_string(exit_code));
+  }
+
+  // the converted file is named after the input
+  base::FilePath converted = out_dir.GetPath().Append(
+      job.input.BaseName().RemoveFinalExtension().AddExtensionASCII(
+          OutputExtension(job)));
+  if (!base::Move(converted, job.output) &&
+      !base::CopyFile(converted, job.output)) {
+    return Finish(result, Status::kFailed, start, "unable to write output");
+  }
+
+  int64_t output_size = 0;
+  if (base::GetFileSize(job.output, &output_size))
+    result.bytes_written = output_size;
+  return Finish(result, Status::kSucceeded, start);
+}
+
+}  // namespace electron::office
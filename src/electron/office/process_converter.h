@@ -0,0 +1,73 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <vector>
+#include "base/command_line.h"
+#include "base/files/file_path.h"
+#include "base/memory/ref_counted.h"
+#include "base/synchronization/condition_variable.h"
+#include "base/synchronization/lock.h"
+#include "base/thread_annotations.h"
+#include "office/cancellation_flag.h"
+#include "office/conversion_batch.h"
+
+namespace electron::office {
+
+// Builds the command line that converts `job` in a headless LibreOffice
+// process using the user profile at `profile`, writing to `out_dir`.
+base::CommandLine ConvertCommandLine(const base::FilePath& program,
+                                     const base::FilePath& profile,
+                                     const base::FilePath& out_dir,
+                                     const ConversionJob& job);
+
+// Converts documents in headless LibreOffice processes, at most `workers` at
+// a time. LOK holds one global lock per process, so documents converted
+// in-process are serialized behind it; converting out of process scales with
+// cores. Each conversion launches a new soffice --convert-to process, so it
+// pays for the office startup; no process is kept warm between jobs. A worker
+// is a slot with its own user profile, which can't be shared by two running
+// processes, so it converts one document at a time. Profiles are kept for the
+// lifetime of the converter, so only the first conversion of each worker pays
+// for creating one.
+class ProcessConverter : public base::RefCountedThreadSafe<ProcessConverter> {
+ public:
+  // `program` is the soffice executable
+  ProcessConverter(base::FilePath program, size_t workers);
+
+  // no copy
+  ProcessConverter(const ProcessConverter&) = delete;
+  ProcessConverter& operator=(const ProcessConverter&) = delete;
+
+  // Converts `job` on a free worker, blocking until one is free and then until
+  // the worker process exits. Usable as a ConversionBatch::Converter, with
+  // base::WithBaseSyncPrimitives.
+  ConversionResult Convert(const ConversionJob& job, CancelFlagPtr cancel_flag);
+
+  size_t size() const { return busy_.size(); }
+
+  // Sets `worker` to the index of a free worker, which is busy until it is
+  // released. Blocks while every worker is busy, returns false if
+  // `cancel_flag` is set while waiting.
+  bool AcquireWorker(const CancelFlagPtr& cancel_flag, size_t* worker);
+  void ReleaseWorker(size_t worker);
+  bool IsBusy(size_t worker);
+
+ private:
+  friend class base::RefCountedThreadSafe<ProcessConverter>;
+  ~ProcessConverter();
+
+  // creates the profile of `worker` if it doesn't exist yet
+  bool EnsureProfile(size_t worker, base::FilePath* profile);
+
+  const base::FilePath program_;
+  base::Lock lock_;
+  // signaled when a worker is released
+  base::ConditionVariable released_;
+  std::vector<bool> busy_ GUARDED_BY(lock_);
+  std::vector<base::FilePath> profiles_ GUARDED_BY(lock_);
+};
+
+}  // namespace electron::office
@@ -0,0 +1,95 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "process_converter.h"
+
+#include "base/strings/string_util.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/test/bind.h"
+#include "base/threading/thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace electron::office {
+
+namespace {
+std::string Args(const base::CommandLine& command) {
+  std::vector<std::string> args;
+  for (const auto& arg : command.GetArgs()) {
+    args.push_back(base::FilePath(arg).AsUTF8Unsafe());
+  }
+  return base::JoinString(args, " ");
+}
+}  // namespace
+
+TEST(ProcessConverterTest, AssignsAFreeWorker) {
+  auto converter = base::MakeRefCounted<ProcessConverter>(
+      base::FilePath(FILE_PATH_LITERAL("soffice")), 3);
+  EXPECT_EQ(converter->size(), size_t(3));
+
+  size_t worker;
+  for (size_t expected : {0, 1, 2}) {
+    ASSERT_TRUE(converter->AcquireWorker(nullptr, &worker));
+    EXPECT_EQ(worker, expected);
+    EXPECT_TRUE(converter->IsBusy(worker));
+  }
+
+  // every worker is busy, so a cancelled job gives up instead of sharing one
+  CancelFlagPtr cancelled = CancelFlag::Create();
+  CancelFlag::Set(cancelled);
+  EXPECT_FALSE(converter->AcquireWorker(cancelled, &worker));
+
+  converter->ReleaseWorker(1);
+  EXPECT_FALSE(converter->IsBusy(1));
+  ASSERT_TRUE(converter->AcquireWorker(cancelled, &worker));
+  EXPECT_EQ(worker, size_t(1));
+}
+
+TEST(ProcessConverterTest, WaitsForAWorkerToBeReleased) {
+  auto converter = base::MakeRefCounted<ProcessConverter>(
+      base::FilePath(FILE_PATH_LITERAL("soffice")), 1);
+  size_t worker;
+  ASSERT_TRUE(converter->AcquireWorker(nullptr, &worker));
+
+  base::Thread thread("waiter");
+  ASSERT_TRUE(thread.Start());
+  base::WaitableEvent acquired;
+  size_t waited_worker = 99;
+  thread.task_runner()->PostTask(
+      FROM_HERE, base::BindLambdaForTesting([&] {
+        if (converter->AcquireWorker(nullptr, &waited_worker))
+          acquired.Signal();
+      }));
+
+  EXPECT_FALSE(acquired.TimedWait(base::Milliseconds(50)));
+  converter->ReleaseWorker(0);
+  acquired.Wait();
+  EXPECT_EQ(waited_worker, size_t(0));
+  EXPECT_TRUE(converter->IsBusy(0));
+  thread.Stop();
+}
+
+TEST(ProcessConverterTest, WorkerCommandLineUsesItsOwnProfile) {
+  ConversionJob job;
+  job.input = base::FilePath(FILE_PATH_LITERAL("in.docx"));
+  job.output = base::FilePath(FILE_PATH_LITERAL("out.pdf"));
+  const base::FilePath program(FILE_PATH_LITERAL("soffice"));
+  const base::FilePath profile(FILE_PATH_LITERAL("profile1"));
+  const base::FilePath out_dir(FILE_PATH_LITERAL("outdir"));
+
+  std::string args = Args(ConvertCommandLine(program, profile, out_dir, job));
+  EXPECT_NE(args.find("--headless"), std::string::npos);
+  EXPECT_NE(args.find("-env:UserInstallation=file://"), std::string::npos);
+  EXPECT_NE(args.find("profile1"), std::string::npos);
+  // the format defaults to the output extension
+  EXPECT_NE(args.find("--convert-to pdf --outdir outdir in.docx"),
+            std::string::npos);
+
+  job.format = "pdf:writer_pdf_Export";
+  job.filter_options = "{}";
+  args = Args(ConvertCommandLine(program, profile, out_dir, job));
+  EXPECT_NE(args.find("--convert-to pdf:writer_pdf_Export:{} "),
+            std::string::npos);
+}
+
+}  // namespace electron::office
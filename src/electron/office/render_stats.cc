@@ -0,0 +1,104 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "office/render_stats.h"
+
+#include <algorithm>
+
+namespace electron::office {
+
+LatencyHistogram::LatencyHistogram() = default;
+LatencyHistogram::~LatencyHistogram() = default;
+
+// static
+size_t LatencyHistogram::BucketIndex(base::TimeDelta latency) {
+  int64_t us = latency.InMicroseconds();
+  auto it = std::upper_bound(kBucketUpperBoundsUs.begin(),
+                             kBucketUpperBoundsUs.end(), us);
+  return it - kBucketUpperBoundsUs.begin();
+}
+
+void LatencyHistogram::Record(base::TimeDelta latency) {
+  buckets_[BucketIndex(latency)].fetch_add(1, std::memory_order_relaxed);
+  total_us_.fetch_add(latency.InMicroseconds(), std::memory_order_relaxed);
+}
+
+void LatencyHistogram::Reset() {
+  for (auto& bucket : buckets_) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+  total_us_.store(0, std::memory_order_relaxed);
+}
+
+std::array<uint64_t, LatencyHistogram::kBucketCount> LatencyHistogram::Counts()
+    const {
+  std::array<uint64_t, kBucketCount> result;
+  for (size_t i = 0; i < kBucketCount; ++i) {
+    result[i] = buckets_[i].load(std::memory_order_relaxed);
+  }
+  return result;
+}
+
+uint64_t LatencyHistogram::Count() const {
+  uint64_t result = 0;
+  for (auto& bucket : buckets_) {
+    result += bucket.load(std::memory_order_relaxed);
+  }
+  return result;
+}
+
+base::TimeDelta LatencyHistogram::Total() const {
+  return base::Microseconds(total_us_.load(std::memory_order_relaxed));
+}
+
+RenderStats::RenderStats() = default;
+RenderStats::~RenderStats() = default;
+
+void RenderStats::RecordTilePainted(base::TimeDelta latency) {
+  tiles_painted_.fetch_add(1, std::memory_order_relaxed);
+  tile_paint_latency_.Record(latency);
+}
+
+void RenderStats::RecordTilesCancelled(size_t count) {
+  tiles_cancelled_.fetch_add(count, std::memory_order_relaxed);
+}
+
+void RenderStats::RecordTilesFailed(size_t count) {
+  tiles_failed_.fetch_add(count, std::memory_order_relaxed);
+}
+
+void RenderStats::RecordInvalidationDeferred() {
+  invalidations_deferred_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RenderStats::RecordPoolLookup(bool hit) {
+  (hit ? pool_hits_ : pool_misses_).fetch_add(1, std::memory_order_relaxed);
+}
+
+void RenderStats::RecordFrame(base::TimeDelta latency, uint64_t generation) {
+  // the task was scheduled at a previous scale or tile size
+  if (generation != generation_)
+    return;
+  frame_latency_.Record(latency);
+}
+
+void RenderStats::Reset() {
+  tiles_painted_ = 0;
+  tiles_cancelled_ = 0;
+  tiles_failed_ = 0;
+  pool_hits_ = 0;
+  pool_misses_ = 0;
+  invalidations_deferred_ = 0;
+  tile_paint_latency_.Reset();
+  frame_latency_.Reset();
+  ++generation_;
+}
+
+double RenderStats::PoolHitRate() const {
+  uint64_t hits = pool_hits_;
+  uint64_t total = hits + pool_misses_;
+  return total == 0 ? 0.0 : static_cast<double>(hits) / total;
+}
+
+}  // namespace electron::office
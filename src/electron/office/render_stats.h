@@ -0,0 +1,101 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include "base/time/time.h"
+
+namespace electron::office {
+
+// A lock-free latency histogram with fixed, exponential buckets.
+// Safe to record from any thread.
+class LatencyHistogram {
+ public:
+  static constexpr size_t kBucketCount = 10;
+  // upper bound (exclusive) of each bucket in microseconds, the last bucket is
+  // unbounded
+  static constexpr std::array<int64_t, kBucketCount - 1> kBucketUpperBoundsUs =
+      {500, 1000, 2000, 4000, 8000, 16000, 32000, 64000, 128000};
+
+  LatencyHistogram();
+  ~LatencyHistogram();
+
+  // no copy
+  LatencyHistogram(const LatencyHistogram&) = delete;
+  LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+  void Record(base::TimeDelta latency);
+  void Reset();
+
+  static size_t BucketIndex(base::TimeDelta latency);
+
+  std::array<uint64_t, kBucketCount> Counts() const;
+  uint64_t Count() const;
+  base::TimeDelta Total() const;
+
+ private:
+  std::array<std::atomic<uint64_t>, kBucketCount> buckets_{};
+  std::atomic<int64_t> total_us_{0};
+};
+
+// Counters for the render pipeline of a single view. Tiles are painted on the
+// thread pool and presented on the renderer thread, so everything is atomic.
+class RenderStats {
+ public:
+  RenderStats();
+  ~RenderStats();
+
+  // no copy
+  RenderStats(const RenderStats&) = delete;
+  RenderStats& operator=(const RenderStats&) = delete;
+
+  // a tile was rasterized by LOK, `latency` is the time spent in paintTile
+  void RecordTilePainted(base::TimeDelta latency);
+  // a tile was skipped because its paint was cancelled or became stale
+  void RecordTilesCancelled(size_t count = 1);
+  // a tile couldn't be painted because it's outside of the buffer
+  void RecordTilesFailed(size_t count = 1);
+  // a tile that was needed for presentation was or wasn't resident in the pool
+  void RecordPoolLookup(bool hit);
+  // a paint task completed, `latency` is from scheduling to invalidation; it
+  // isn't recorded if the stats were reset since `generation`
+  void RecordFrame(base::TimeDelta latency, uint64_t generation);
+  // an invalidation was held back behind input and visible paints
+  void RecordInvalidationDeferred();
+
+  void Reset();
+  // incremented by Reset, taken when a paint task is scheduled
+  uint64_t generation() const { return generation_; }
+
+  uint64_t tiles_painted() const { return tiles_painted_; }
+  uint64_t tiles_cancelled() const { return tiles_cancelled_; }
+  uint64_t tiles_failed() const { return tiles_failed_; }
+  uint64_t pool_hits() const { return pool_hits_; }
+  uint64_t pool_misses() const { return pool_misses_; }
+  uint64_t invalidations_deferred() const { return invalidations_deferred_; }
+  // [0, 1], 0 if there were no lookups
+  double PoolHitRate() const;
+
+  const LatencyHistogram& tile_paint_latency() const {
+    return tile_paint_latency_;
+  }
+  const LatencyHistogram& frame_latency() const { return frame_latency_; }
+
+ private:
+  std::atomic<uint64_t> tiles_painted_{0};
+  std::atomic<uint64_t> tiles_cancelled_{0};
+  std::atomic<uint64_t> tiles_failed_{0};
+  std::atomic<uint64_t> pool_hits_{0};
+  std::atomic<uint64_t> pool_misses_{0};
+  std::atomic<uint64_t> invalidations_deferred_{0};
+  std::atomic<uint64_t> generation_{0};
+
+  LatencyHistogram tile_paint_latency_;
+  LatencyHistogram frame_latency_;
+};
+
+}  // namespace electron::office
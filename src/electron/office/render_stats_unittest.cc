@@ -0,0 +1,78 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "render_stats.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace electron::office {
+
+TEST(LatencyHistogramTest, BucketIndex) {
+  EXPECT_EQ(LatencyHistogram::BucketIndex(base::Microseconds(0)), size_t(0));
+  EXPECT_EQ(LatencyHistogram::BucketIndex(base::Microseconds(499)), size_t(0));
+  EXPECT_EQ(LatencyHistogram::BucketIndex(base::Microseconds(500)), size_t(1));
+  EXPECT_EQ(LatencyHistogram::BucketIndex(base::Milliseconds(3)), size_t(3));
+  EXPECT_EQ(LatencyHistogram::BucketIndex(base::Milliseconds(127)), size_t(8));
+  EXPECT_EQ(LatencyHistogram::BucketIndex(base::Seconds(10)),
+            LatencyHistogram::kBucketCount - 1);
+}
+
+TEST(LatencyHistogramTest, RecordAndReset) {
+  LatencyHistogram histogram;
+  histogram.Record(base::Milliseconds(1));
+  histogram.Record(base::Milliseconds(3));
+  histogram.Record(base::Seconds(1));
+
+  EXPECT_EQ(histogram.Count(), uint64_t(3));
+  EXPECT_EQ(histogram.Total(), base::Milliseconds(1004));
+  auto counts = histogram.Counts();
+  EXPECT_EQ(counts[2], uint64_t(1));
+  EXPECT_EQ(counts[3], uint64_t(1));
+  EXPECT_EQ(counts[LatencyHistogram::kBucketCount - 1], uint64_t(1));
+
+  histogram.Reset();
+  EXPECT_EQ(histogram.Count(), uint64_t(0));
+  EXPECT_EQ(histogram.Total(), base::TimeDelta());
+}
+
+TEST(RenderStatsTest, Counters) {
+  RenderStats stats;
+  EXPECT_EQ(stats.PoolHitRate(), 0.0);
+
+  stats.RecordTilePainted(base::Milliseconds(2));
+  stats.RecordTilePainted(base::Milliseconds(4));
+  stats.RecordTilesCancelled();
+  stats.RecordTilesCancelled(3);
+  stats.RecordTilesFailed(2);
+  stats.RecordPoolLookup(true);
+  stats.RecordPoolLookup(true);
+  stats.RecordPoolLookup(true);
+  stats.RecordPoolLookup(false);
+  uint64_t generation = stats.generation();
+  stats.RecordFrame(base::Milliseconds(16), generation);
+  stats.RecordInvalidationDeferred();
+
+  EXPECT_EQ(stats.tiles_painted(), uint64_t(2));
+  EXPECT_EQ(stats.tile_paint_latency().Count(), uint64_t(2));
+  EXPECT_EQ(stats.tiles_cancelled(), uint64_t(4));
+  EXPECT_EQ(stats.tiles_failed(), uint64_t(2));
+  EXPECT_EQ(stats.pool_hits(), uint64_t(3));
+  EXPECT_EQ(stats.pool_misses(), uint64_t(1));
+  EXPECT_DOUBLE_EQ(stats.PoolHitRate(), 0.75);
+  EXPECT_EQ(stats.frame_latency().Count(), uint64_t(1));
+  EXPECT_EQ(stats.invalidations_deferred(), uint64_t(1));
+
+  stats.Reset();
+  EXPECT_EQ(stats.tiles_painted(), uint64_t(0));
+  EXPECT_EQ(stats.frame_latency().Count(), uint64_t(0));
+  EXPECT_EQ(stats.invalidations_deferred(), uint64_t(0));
+
+  // a frame scheduled before the reset isn't counted after it
+  stats.RecordFrame(base::Milliseconds(16), generation);
+  EXPECT_EQ(stats.frame_latency().Count(), uint64_t(0));
+  stats.RecordFrame(base::Milliseconds(16), stats.generation());
+  EXPECT_EQ(stats.frame_latency().Count(), uint64_t(1));
+}
+
+}  // namespace electron::office
@@ -3,6 +3,11 @@
 // found in the LICENSE file.
 
 #include "renderer_transferable.h"
+
+#include <cstring>
+#include <limits>
+#include "base/numerics/checked_math.h"
+#include "base/trace_event/trace_event.h"
 #include "paint_manager.h"
 
 namespace electron::office {
@@ -24,10 +29,222 @@ RendererTransferable::RendererTransferable(
       last_cursor_rect(std::move(last_cursor)),
       zoom(zoom) {}
 
+bool DocumentStamp::CanRestoreFrom(const DocumentStamp& painted) const {
+  if (url_hash != painted.url_hash)
+    return false;
+  // the same document, with no invalidations since the tiles were painted
+  if (document_token == painted.document_token)
+    return invalidation_count == painted.invalidation_count;
+  // both loaded the saved file
+  return !modified && !painted.modified;
+}
+
 RendererTransferable::RendererTransferable() = default;
 RendererTransferable::~RendererTransferable() = default;
 RendererTransferable& RendererTransferable::operator=(
     RendererTransferable&&) noexcept = default;
 RendererTransferable::RendererTransferable(RendererTransferable&&) noexcept =
     default;
+
+namespace {
+// "LOKT"
+constexpr uint32_t kTransferMagic = 0x4c4f4b54;
+constexpr uint32_t kTransferVersion = 2;
+
+// followed by the page rects, the cursor rect, the tile indices and finally
+// the tile pixels
+struct TransferHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t tile_size_px;
+  uint32_t page_rect_count;
+  uint32_t cursor_length;
+  uint32_t tile_count;
+  uint32_t url_hash;
+  uint32_t modified;
+  uint64_t document_token_high;
+  uint64_t document_token_low;
+  uint64_t invalidation_count;
+  int64_t width_twips;
+  int64_t height_twips;
+  float scale;
+  float zoom;
+  int32_t scroll_y_position;
+  int32_t first_intersect;
+  int32_t last_intersect;
+};
+
+struct TransferRect {
+  int32_t x;
+  int32_t y;
+  int32_t width;
+  int32_t height;
+};
+
+// reads sequentially from a span, failing once it's exhausted
+class Reader {
+ public:
+  explicit Reader(base::span<const uint8_t> data) : data_(data) {}
+
+  const uint8_t* Read(size_t size) {
+    if (size > data_.size() - offset_)
+      return nullptr;
+    const uint8_t* result = data_.data() + offset_;
+    offset_ += size;
+    return result;
+  }
+
+  template <typename T>
+  bool ReadValue(T* out) {
+    const uint8_t* data = Read(sizeof(T));
+    if (!data)
+      return false;
+    std::memcpy(out, data, sizeof(T));
+    return true;
+  }
+
+ private:
+  base::span<const uint8_t> data_;
+  size_t offset_ = 0;
+};
+}  // namespace
+
+std::vector<uint8_t> RendererTransferable::Serialize(
+    const DocumentStamp& stamp) const {
+  TRACE_EVENT0("electron", "RendererTransferable::Serialize");
+  if (!tile_buffer || tile_buffer->IsEmpty())
+    return {};
+
+  std::vector<unsigned int> tiles = tile_buffer->ValidTiles();
+  const size_t tile_bytes = tile_buffer->TileByteSize();
+
+  base::CheckedNumeric<size_t> size = sizeof(TransferHeader);
+  size += base::CheckMul(page_rects.size(), sizeof(TransferRect));
+  size += last_cursor_rect.size();
+  size += base::CheckMul(tiles.size(), sizeof(uint32_t) + tile_bytes);
+  if (!size.IsValid())
+    return {};
+
+  std::vector<uint8_t> result(size.ValueOrDie());
+  uint8_t* out = result.data();
+  TransferHeader header;
+  // the padding is sent too
+  std::memset(&header, 0, sizeof(TransferHeader));
+  header.magic = kTransferMagic;
+  header.version = kTransferVersion;
+  header.tile_size_px = tile_buffer->tile_size_px();
+  header.page_rect_count = page_rects.size();
+  header.cursor_length = last_cursor_rect.size();
+  header.url_hash = stamp.url_hash;
+  header.modified = stamp.modified;
+  header.document_token_high = stamp.document_token.high();
+  header.document_token_low = stamp.document_token.low();
+  header.invalidation_count = stamp.invalidation_count;
+  header.width_twips = tile_buffer->doc_width_twips();
+  header.height_twips = tile_buffer->doc_height_twips();
+  header.scale = tile_buffer->scale();
+  header.zoom = zoom;
+  header.scroll_y_position = snapshot.scroll_y_position;
+  header.first_intersect = first_intersect;
+  header.last_intersect = last_intersect;
+  size_t offset = sizeof(TransferHeader);
+
+  for (const gfx::Rect& rect : page_rects) {
+    TransferRect transfer_rect{rect.x(), rect.y(), rect.width(),
+                               rect.height()};
+    std::memcpy(out + offset, &transfer_rect, sizeof(TransferRect));
+    offset += sizeof(TransferRect);
+  }
+
+  std::memcpy(out + offset, last_cursor_rect.data(), last_cursor_rect.size());
+  offset += last_cursor_rect.size();
+
+  // a tile can be evicted from the pool while it's being copied, so the
+  // indices are only written for the tiles that were
+  uint8_t* indices = out + offset;
+  uint8_t* pixels = indices + tiles.size() * sizeof(uint32_t);
+  uint32_t tile_count = 0;
+  for (unsigned int tile_index : tiles) {
+    if (!tile_buffer->CopyTile(tile_index, pixels + tile_count * tile_bytes))
+      continue;
+    uint32_t index = tile_index;
+    std::memcpy(indices + tile_count * sizeof(uint32_t), &index,
+                sizeof(uint32_t));
+    ++tile_count;
+  }
+  header.tile_count = tile_count;
+  std::memcpy(out, &header, sizeof(TransferHeader));
+  if (tile_count < tiles.size()) {
+    // close the gap left by the tiles that weren't copied, so that the pixels
+    // directly follow the indices
+    std::memmove(indices + tile_count * sizeof(uint32_t), pixels,
+                 tile_count * tile_bytes);
+    size_t missing = tiles.size() - tile_count;
+    result.resize(result.size() - missing * (sizeof(uint32_t) + tile_bytes));
+  }
+
+  return result;
+}
+
+// static
+RendererTransferable RendererTransferable::Deserialize(
+    base::span<const uint8_t> data,
+    const DocumentStamp& current) {
+  TRACE_EVENT0("electron", "RendererTransferable::Deserialize");
+  Reader reader(data);
+  TransferHeader header;
+  if (!reader.ReadValue(&header) || header.magic != kTransferMagic ||
+      header.version != kTransferVersion ||
+      !TileBuffer::IsValidTileSize(header.tile_size_px) ||
+      !(header.scale > 0) || !(header.zoom > 0)) {
+    return {};
+  }
+
+  DocumentStamp painted;
+  painted.url_hash = header.url_hash;
+  painted.modified = header.modified;
+  painted.document_token =
+      base::Token(header.document_token_high, header.document_token_low);
+  painted.invalidation_count = header.invalidation_count;
+  if (!current.CanRestoreFrom(painted))
+    return {};
+
+  std::vector<gfx::Rect> rects;
+  for (uint32_t i = 0; i < header.page_rect_count; ++i) {
+    TransferRect rect;
+    if (!reader.ReadValue(&rect))
+      return {};
+    rects.emplace_back(rect.x, rect.y, rect.width, rect.height);
+  }
+
+  const uint8_t* cursor = reader.Read(header.cursor_length);
+  if (!cursor)
+    return {};
+
+  const uint8_t* indices = reader.Read(
+      base::CheckMul(header.tile_count, sizeof(uint32_t)).ValueOrDefault(
+          std::numeric_limits<size_t>::max()));
+  const size_t tile_bytes = TileBuffer::TileByteSize(header.tile_size_px);
+  const uint8_t* pixels =
+      reader.Read(base::CheckMul(header.tile_count, tile_bytes)
+                      .ValueOrDefault(std::numeric_limits<size_t>::max()));
+  if (!indices || !pixels)
+    return {};
+
+  auto tiles = base::MakeRefCounted<TileBuffer>(header.tile_size_px);
+  tiles->Resize(header.width_twips, header.height_twips, header.scale);
+  for (uint32_t i = 0; i < header.tile_count; ++i) {
+    uint32_t tile_index;
+    std::memcpy(&tile_index, indices + i * sizeof(uint32_t), sizeof(uint32_t));
+    tiles->ImportTile(tile_index, pixels + i * tile_bytes);
+  }
+
+  return RendererTransferable(
+      std::move(tiles), nullptr,
+      Snapshot({}, 0.0f, 0, 0, 0, 0, header.scroll_y_position),
+      std::move(rects), header.first_intersect, header.last_intersect,
+      std::string(reinterpret_cast<const char*>(cursor),
+                  header.cursor_length),
+      header.zoom);
+}
 }  // namespace electron::office
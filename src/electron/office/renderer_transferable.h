@@ -4,12 +4,31 @@
 
 #pragma once
 
+#include <cstdint>
+#include <vector>
+#include "base/containers/span.h"
+#include "base/token.h"
 #include "office/lok_tilebuffer.h"
 
 namespace electron::office {
 
 class PaintManager;
 
+// identifies a document and the state its tiles were painted in
+struct DocumentStamp {
+  // hash of the document's URL, the same in every renderer process
+  uint32_t url_hash = 0;
+  // the document as loaded in one process
+  base::Token document_token;
+  // tile invalidations received by the document client
+  uint64_t invalidation_count = 0;
+  // has unsaved edits, which another process loading the URL doesn't have
+  bool modified = false;
+
+  // tiles painted at `painted` are still valid for this document
+  bool CanRestoreFrom(const DocumentStamp& painted) const;
+};
+
 struct RendererTransferable {
   scoped_refptr<TileBuffer> tile_buffer;
   std::unique_ptr<PaintManager> paint_manager;
@@ -39,5 +58,15 @@ struct RendererTransferable {
   // enable move
   RendererTransferable& operator=(RendererTransferable&&) noexcept;
   RendererTransferable(RendererTransferable&&) noexcept;
+
+  // Writes the painted tiles, page rects and scroll state, so that a document
+  // moved to another renderer process is shown without a repaint. The paint
+  // manager and snapshot stay behind, they are rebuilt from the tiles. Returns
+  // an empty vector if there is nothing to write.
+  std::vector<uint8_t> Serialize(const DocumentStamp& stamp) const;
+  // The inverse of Serialize, returns an empty transferable if `data` isn't
+  // valid or wasn't painted for the `current` document
+  static RendererTransferable Deserialize(base::span<const uint8_t> data,
+                                          const DocumentStamp& current);
 };
 }  // namespace electron::office
@@ -0,0 +1,158 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "office/scroll_predictor.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace electron::office {
+
+namespace {
+float VelocityBetween(int y0, base::TimeTicks t0, int y1, base::TimeTicks t1) {
+  const double seconds = (t1 - t0).InSecondsF();
+  return seconds > 0 ? static_cast<float>((y1 - y0) / seconds) : 0;
+}
+}  // namespace
+
+ScrollPrediction::ScrollPrediction() = default;
+ScrollPrediction::ScrollPrediction(const ScrollPrediction& other) = default;
+ScrollPrediction& ScrollPrediction::operator=(const ScrollPrediction& other) =
+    default;
+ScrollPrediction::~ScrollPrediction() = default;
+
+ScrollPredictor::ScrollPredictor() = default;
+ScrollPredictor::~ScrollPredictor() = default;
+
+void ScrollPredictor::AddSample(int y, base::TimeTicks time) {
+  // a pause ends the gesture
+  if (!samples_.empty() && time - samples_.back().time > kSampleWindow)
+    samples_.clear();
+
+  samples_.push_back({y, time});
+  while (samples_.size() > kMaxSamples ||
+         time - samples_.front().time > kSampleWindow) {
+    samples_.pop_front();
+  }
+}
+
+void ScrollPredictor::Reset() {
+  samples_.clear();
+}
+
+float ScrollPredictor::Velocity() const {
+  if (samples_.size() < 2)
+    return 0;
+  return VelocityBetween(samples_.front().y, samples_.front().time,
+                         samples_.back().y, samples_.back().time);
+}
+
+float ScrollPredictor::Deceleration() const {
+  if (samples_.size() < 3)
+    return 0;
+
+  // the velocity of the older half of the samples against the newer half
+  const Sample& front = samples_.front();
+  const Sample& mid = samples_[samples_.size() / 2];
+  const Sample& back = samples_.back();
+  const float older = VelocityBetween(front.y, front.time, mid.y, mid.time);
+  const float newer = VelocityBetween(mid.y, mid.time, back.y, back.time);
+  const double half = (back.time - front.time).InSecondsF() / 2;
+  if (half <= 0 || older * newer <= 0)
+    return 0;
+
+  const float slowing = std::abs(older) - std::abs(newer);
+  return slowing > 0 ? static_cast<float>(slowing / half) : 0;
+}
+
+ScrollPrediction ScrollPredictor::Predict(
+    int view_height,
+    int doc_height,
+    const std::vector<gfx::Rect>& page_rects,
+    int budget_px,
+    int reach_px) const {
+  ScrollPrediction result;
+  if (samples_.empty() || view_height <= 0 || doc_height <= 0)
+    return result;
+
+  const int y = samples_.back().y;
+  const int max_y = std::max(0, doc_height - view_height);
+  int remaining = std::max(0, budget_px);
+
+  // adds [start, end) within the document and the budget, a band that is cut
+  // short by the budget keeps the part nearest to the viewport
+  auto add = [&](int start, int end) {
+    start = std::max(start, 0);
+    end = std::min(end, doc_height);
+    const int height = std::min(end - start, remaining);
+    if (height <= 0)
+      return;
+    if (end <= y)
+      start = end - height;
+    result.prefetch.push_back({start, height});
+    remaining -= height;
+  };
+
+  const float velocity = Velocity();
+  result.velocity = velocity;
+  result.landing_y = y;
+  if (std::abs(velocity) < kMinVelocity) {
+    // still, a view on either side
+    add(y + view_height, y + 2 * view_height);
+    add(y - view_height, y);
+    return result;
+  }
+
+  const int direction = velocity > 0 ? 1 : -1;
+  const float speed = std::abs(velocity);
+  const float deceleration = Deceleration();
+  float distance;
+  if (deceleration > 0) {
+    const float max_fling = static_cast<float>(kMaxFling.InSecondsF());
+    const float t = std::min(speed / deceleration, max_fling);
+    distance = speed * t - 0.5f * deceleration * t * t;
+  } else {
+    distance = speed * static_cast<float>(kLookahead.InSecondsF());
+  }
+  distance = std::min(distance, static_cast<float>(std::max(0, reach_px)));
+  const int landing =
+      std::clamp(y + direction * static_cast<int>(std::round(distance)), 0,
+                 max_y);
+  result.landing_y = landing;
+
+  // landing near the top of a page usually settles on the top of that page
+  int landing_top = landing;
+  for (const gfx::Rect& page : page_rects) {
+    if (page.y() <= landing && landing < page.bottom()) {
+      if (landing - page.y() < view_height)
+        landing_top = page.y();
+      break;
+    }
+  }
+
+  // the next view ahead, the landing, the path to it that is mostly scrolled
+  // past and finally a little behind, in case the scroll is reversed
+  if (direction > 0) {
+    const int ahead_end = y + 2 * view_height;
+    add(y + view_height, ahead_end);
+    if (landing + view_height > ahead_end) {
+      const int landing_start = std::max(landing_top, ahead_end);
+      add(landing_start, landing + view_height);
+      add(ahead_end, landing_start);
+    }
+    add(y - view_height / 2, y);
+  } else {
+    const int ahead_start = y - view_height;
+    add(ahead_start, y);
+    if (landing_top < ahead_start) {
+      const int landing_end = std::min(landing + view_height, ahead_start);
+      add(landing_top, landing_end);
+      add(landing_end, ahead_start);
+    }
+    add(y + view_height, y + view_height + view_height / 2);
+  }
+  return result;
+}
+
+}  // namespace electron::office
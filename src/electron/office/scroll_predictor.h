@@ -0,0 +1,86 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "base/containers/circular_deque.h"
+#include "base/time/time.h"
+#include "ui/gfx/geometry/rect.h"
+
+namespace electron::office {
+
+// a vertical band of the document, in px
+struct ScrollBand {
+  int y = 0;
+  int height = 0;
+
+  int bottom() const { return y + height; }
+  bool operator==(const ScrollBand& other) const {
+    return y == other.y && height == other.height;
+  }
+};
+
+struct ScrollPrediction {
+  // px per second, positive when scrolling down
+  float velocity = 0;
+  // where the top of the viewport is expected to stop
+  int landing_y = 0;
+  // the bands to paint ahead of time, most important first
+  std::vector<ScrollBand> prefetch;
+
+  ScrollPrediction();
+  ScrollPrediction(const ScrollPrediction& other);
+  ScrollPrediction& operator=(const ScrollPrediction& other);
+  ~ScrollPrediction();
+};
+
+// Predicts where the viewport will land from the recent scroll positions, so
+// that the tiles there are painted before they're scrolled into view. A fling
+// lands where it decelerates to a stop, a steady scroll is projected a short
+// time ahead.
+class ScrollPredictor {
+ public:
+  // samples older than this aren't part of the current gesture
+  static constexpr base::TimeDelta kSampleWindow = base::Milliseconds(150);
+  static constexpr size_t kMaxSamples = 8;
+  // how far ahead a scroll that isn't slowing down is projected
+  static constexpr base::TimeDelta kLookahead = base::Milliseconds(500);
+  // the longest that a fling is followed
+  static constexpr base::TimeDelta kMaxFling = base::Seconds(2);
+  // slower than this, the viewport is considered still
+  static constexpr float kMinVelocity = 50;
+
+  ScrollPredictor();
+  ~ScrollPredictor();
+
+  void AddSample(int y, base::TimeTicks time);
+  void Reset();
+
+  // px per second, positive when scrolling down
+  float Velocity() const;
+  // px per second squared, positive when the scroll is slowing down
+  float Deceleration() const;
+
+  // Predicts the landing of the viewport at the last sample and the bands to
+  // prefetch for it. `page_rects` are in px, a landing is extended to the top
+  // of the page it lands on. The prefetched bands are at most `budget_px` in
+  // total and the landing is at most `reach_px` away from the viewport.
+  ScrollPrediction Predict(int view_height,
+                           int doc_height,
+                           const std::vector<gfx::Rect>& page_rects,
+                           int budget_px,
+                           int reach_px) const;
+
+ private:
+  struct Sample {
+    int y;
+    base::TimeTicks time;
+  };
+
+  base::circular_deque<Sample> samples_;
+};
+
+}  // namespace electron::office
@@ -0,0 +1,112 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "scroll_predictor.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace electron::office {
+
+namespace {
+constexpr int kViewHeight = 800;
+constexpr int kDocHeight = 100000;
+constexpr int kUnbounded = 1000000;
+
+// a sample every 10ms, starting at `start`
+void AddSamples(ScrollPredictor& predictor,
+                base::TimeTicks start,
+                const std::vector<int>& ys) {
+  for (size_t i = 0; i < ys.size(); ++i) {
+    predictor.AddSample(ys[i], start + base::Milliseconds(10 * i));
+  }
+}
+}  // namespace
+
+TEST(ScrollPredictorTest, StillViewportPrefetchesEitherSide) {
+  ScrollPredictor predictor;
+  AddSamples(predictor, base::TimeTicks::Now(), {2000, 2000, 2000});
+  EXPECT_EQ(predictor.Velocity(), 0);
+
+  ScrollPrediction prediction =
+      predictor.Predict(kViewHeight, kDocHeight, {}, kUnbounded, kUnbounded);
+  EXPECT_EQ(prediction.landing_y, 2000);
+  ASSERT_EQ(prediction.prefetch.size(), size_t(2));
+  EXPECT_EQ(prediction.prefetch[0], (ScrollBand{2800, kViewHeight}));
+  EXPECT_EQ(prediction.prefetch[1], (ScrollBand{1200, kViewHeight}));
+}
+
+TEST(ScrollPredictorTest, SteadyScrollIsProjectedWithinTheBudget) {
+  ScrollPredictor predictor;
+  // 10000px per second
+  AddSamples(predictor, base::TimeTicks::Now(), {0, 100, 200, 300});
+  EXPECT_FLOAT_EQ(predictor.Velocity(), 10000);
+  EXPECT_EQ(predictor.Deceleration(), 0);
+
+  ScrollPrediction prediction =
+      predictor.Predict(kViewHeight, kDocHeight, {}, 4000, kUnbounded);
+  EXPECT_EQ(prediction.landing_y, 5300);
+  // the next view, the landing, then as much of the path as the budget allows
+  ASSERT_EQ(prediction.prefetch.size(), size_t(3));
+  EXPECT_EQ(prediction.prefetch[0], (ScrollBand{1100, kViewHeight}));
+  EXPECT_EQ(prediction.prefetch[1], (ScrollBand{5300, kViewHeight}));
+  EXPECT_EQ(prediction.prefetch[2], (ScrollBand{1900, 2400}));
+}
+
+TEST(ScrollPredictorTest, FlingLandsWhereItStops) {
+  ScrollPredictor predictor;
+  AddSamples(predictor, base::TimeTicks::Now(), {0, 100, 190, 270, 340, 400});
+  EXPECT_GT(predictor.Deceleration(), 0);
+
+  // 8000px per second slowing by 100000px per second squared stops in 80ms
+  ScrollPrediction prediction =
+      predictor.Predict(kViewHeight, kDocHeight, {}, kUnbounded, kUnbounded);
+  EXPECT_NEAR(prediction.landing_y, 720, 2);
+}
+
+TEST(ScrollPredictorTest, LandingExtendsToTheTopOfItsPage) {
+  ScrollPredictor predictor;
+  AddSamples(predictor, base::TimeTicks::Now(), {0, 100});
+  std::vector<gfx::Rect> pages = {gfx::Rect(0, 3800, 800, 1000),
+                                  gfx::Rect(0, 4900, 800, 1000)};
+
+  ScrollPrediction prediction = predictor.Predict(
+      kViewHeight, kDocHeight, pages, kUnbounded, kUnbounded);
+  EXPECT_EQ(prediction.landing_y, 5100);
+  ASSERT_GE(prediction.prefetch.size(), size_t(2));
+  EXPECT_EQ(prediction.prefetch[1], (ScrollBand{4900, 1000}));
+
+  // a landing is never further than the reach
+  prediction =
+      predictor.Predict(kViewHeight, kDocHeight, pages, kUnbounded, 1000);
+  EXPECT_EQ(prediction.landing_y, 1100);
+}
+
+TEST(ScrollPredictorTest, ScrollingUpPrefetchesAbove) {
+  ScrollPredictor predictor;
+  AddSamples(predictor, base::TimeTicks::Now(), {5000, 4900, 4800});
+
+  ScrollPrediction prediction =
+      predictor.Predict(kViewHeight, kDocHeight, {}, 3000, kUnbounded);
+  EXPECT_LT(prediction.velocity, 0);
+  EXPECT_EQ(prediction.landing_y, 0);
+  ASSERT_EQ(prediction.prefetch.size(), size_t(3));
+  EXPECT_EQ(prediction.prefetch[0], (ScrollBand{4000, kViewHeight}));
+  EXPECT_EQ(prediction.prefetch[1], (ScrollBand{0, kViewHeight}));
+  // the part of the path nearest to the viewport
+  EXPECT_EQ(prediction.prefetch[2], (ScrollBand{2600, 1400}));
+}
+
+TEST(ScrollPredictorTest, PauseStartsANewGesture) {
+  ScrollPredictor predictor;
+  base::TimeTicks start = base::TimeTicks::Now();
+  predictor.AddSample(0, start);
+  predictor.AddSample(1000, start + base::Milliseconds(500));
+  EXPECT_EQ(predictor.Velocity(), 0);
+
+  predictor.Reset();
+  ScrollPrediction prediction =
+      predictor.Predict(kViewHeight, kDocHeight, {}, kUnbounded, kUnbounded);
+  EXPECT_TRUE(prediction.prefetch.empty());
+}
+
+}  // namespace electron::office
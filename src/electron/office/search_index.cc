@@ -0,0 +1,593 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "office/search_index.h"
+
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include "LibreOfficeKit/LibreOfficeKit.hxx"
+#include "LibreOfficeKit/LibreOfficeKitEnums.h"
+#include "base/check_op.h"
+#include "base/json/json_reader.h"
+#include "base/json/json_writer.h"
+#include "base/strings/utf_string_conversions.h"
+#include "base/synchronization/condition_variable.h"
+#include "base/time/time.h"
+#include "base/trace_event/trace_event.h"
+#include "base/values.h"
+#include "com/sun/star/container/XEnumeration.hpp"
+#include "com/sun/star/container/XEnumerationAccess.hpp"
+#include "com/sun/star/frame/XController.hpp"
+#include "com/sun/star/frame/XModel2.hpp"
+#include "com/sun/star/lang/XComponent.hpp"
+#include "com/sun/star/lang/XServiceInfo.hpp"
+#include "com/sun/star/text/XParagraphCursor.hpp"
+#include "com/sun/star/text/XText.hpp"
+#include "com/sun/star/text/XTextCursor.hpp"
+#include "com/sun/star/text/XTextDocument.hpp"
+#include "com/sun/star/text/XTextRange.hpp"
+#include "com/sun/star/text/XTextRangeCompare.hpp"
+#include "com/sun/star/text/XTextViewCursor.hpp"
+#include "com/sun/star/text/XTextViewCursorSupplier.hpp"
+#include "com/sun/star/uno/Any.hxx"
+#include "com/sun/star/uno/Reference.hxx"
+#include "office/lok_callback.h"
+#include "rtl/string.hxx"
+#include "rtl/ustring.hxx"
+#include "third_party/abseil-cpp/absl/types/optional.h"
+#include "third_party/icu/source/common/unicode/uchar.h"
+#include "third_party/icu/source/common/unicode/utf16.h"
+
+namespace electron::office {
+
+namespace {
+// simple case folding keeps the length, so offsets in the folded text are
+// offsets in the original
+std::u16string Fold(const std::u16string& text) {
+  std::u16string folded(text);
+  for (char16_t& c : folded) {
+    if (!U16_IS_SURROGATE(c))
+      c = static_cast<char16_t>(u_foldCase(c, U_FOLD_CASE_DEFAULT));
+  }
+  return folded;
+}
+
+bool IsWordCharacter(const std::u16string& text, size_t index) {
+  return index < text.size() && !U16_IS_SURROGATE(text[index]) &&
+         (u_isalnum(text[index]) || text[index] == u'_');
+}
+}  // namespace
+
+SearchIndex::SearchIndex() = default;
+SearchIndex::~SearchIndex() = default;
+
+size_t SearchIndex::Update(std::vector<std::u16string> paragraphs) {
+  TRACE_EVENT1("electron", "SearchIndex::Update", "paragraphs",
+               paragraphs.size());
+  size_t old_size = paragraphs_.size();
+  size_t new_size = paragraphs.size();
+  size_t prefix = 0;
+  while (prefix < old_size && prefix < new_size &&
+         paragraphs_[prefix] == paragraphs[prefix]) {
+    ++prefix;
+  }
+  size_t suffix = 0;
+  while (suffix < old_size - prefix && suffix < new_size - prefix &&
+         paragraphs_[old_size - suffix - 1] ==
+             paragraphs[new_size - suffix - 1]) {
+    ++suffix;
+  }
+
+  std::vector<std::u16string> folded;
+  folded.reserve(new_size);
+  std::move(folded_.begin(), folded_.begin() + prefix,
+            std::back_inserter(folded));
+  for (size_t i = prefix; i < new_size - suffix; ++i) {
+    folded.push_back(Fold(paragraphs[i]));
+  }
+  std::move(folded_.end() - suffix, folded_.end(), std::back_inserter(folded));
+
+  paragraphs_ = std::move(paragraphs);
+  folded_ = std::move(folded);
+  return prefix;
+}
+
+void SearchIndex::Replace(size_t begin,
+                          size_t end,
+                          std::vector<std::u16string> paragraphs) {
+  TRACE_EVENT1("electron", "SearchIndex::Replace", "paragraphs",
+               paragraphs.size());
+  DCHECK_LE(begin, end);
+  DCHECK_LE(end, paragraphs_.size());
+  std::vector<std::u16string> folded;
+  folded.reserve(paragraphs.size());
+  for (const std::u16string& paragraph : paragraphs)
+    folded.push_back(Fold(paragraph));
+
+  paragraphs_.erase(paragraphs_.begin() + begin, paragraphs_.begin() + end);
+  paragraphs_.insert(paragraphs_.begin() + begin,
+                     std::make_move_iterator(paragraphs.begin()),
+                     std::make_move_iterator(paragraphs.end()));
+  folded_.erase(folded_.begin() + begin, folded_.begin() + end);
+  folded_.insert(folded_.begin() + begin,
+                 std::make_move_iterator(folded.begin()),
+                 std::make_move_iterator(folded.end()));
+}
+
+std::vector<SearchMatch> SearchIndex::Find(const std::u16string& query,
+                                           const SearchOptions& options,
+                                           size_t* total) const {
+  TRACE_EVENT0("electron", "SearchIndex::Find");
+  std::vector<SearchMatch> matches;
+  *total = 0;
+  if (query.empty())
+    return matches;
+
+  const std::u16string needle = options.match_case ? query : Fold(query);
+  for (size_t i = 0; i < paragraphs_.size(); ++i) {
+    const std::u16string& haystack =
+        options.match_case ? paragraphs_[i] : folded_[i];
+    for (size_t offset = haystack.find(needle); offset != std::u16string::npos;
+         offset = haystack.find(needle, offset + 1)) {
+      if (options.whole_words &&
+          ((offset > 0 && IsWordCharacter(paragraphs_[i], offset - 1)) ||
+           IsWordCharacter(paragraphs_[i], offset + needle.size()))) {
+        continue;
+      }
+
+      ++*total;
+      if (matches.size() < options.max_matches)
+        matches.push_back({i, offset, needle.size()});
+      // matches don't overlap
+      offset += needle.size() - 1;
+    }
+  }
+  return matches;
+}
+
+SearchResult::SearchResult() = default;
+SearchResult::SearchResult(SearchResult&& other) noexcept = default;
+SearchResult& SearchResult::operator=(SearchResult&& other) noexcept = default;
+SearchResult::~SearchResult() = default;
+
+void GroupRectsByPage(const std::vector<gfx::Rect>& rects_twips,
+                      const std::vector<gfx::Rect>& page_rects_twips,
+                      SearchResult* result) {
+  std::vector<uint32_t> rect_pages(rects_twips.size(), 0);
+  for (size_t i = 0; i < rects_twips.size(); ++i) {
+    // page rects are ordered from top to bottom
+    auto after = std::upper_bound(
+        page_rects_twips.begin(), page_rects_twips.end(), rects_twips[i].y(),
+        [](int y, const gfx::Rect& page) { return y < page.y(); });
+    rect_pages[i] = after == page_rects_twips.begin()
+                        ? 0
+                        : std::distance(page_rects_twips.begin(), after) - 1;
+  }
+
+  // matches are in paragraph order, which is nearly always page order
+  std::vector<size_t> order(rects_twips.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return rect_pages[a] < rect_pages[b];
+  });
+
+  result->rects.clear();
+  result->pages.clear();
+  result->page_offsets.clear();
+  result->rects.reserve(rects_twips.size() * 4);
+  for (size_t i = 0; i < order.size(); ++i) {
+    uint32_t page = rect_pages[order[i]];
+    if (result->pages.empty() || result->pages.back() != page) {
+      result->pages.push_back(page);
+      result->page_offsets.push_back(i);
+    }
+    const gfx::Rect& rect = rects_twips[order[i]];
+    result->rects.insert(result->rects.end(),
+                         {rect.x(), rect.y(), rect.width(), rect.height()});
+  }
+  result->page_offsets.push_back(order.size());
+}
+
+std::vector<gfx::Rect> ParseSearchResultRects(std::string_view payload,
+                                              std::string* search_string) {
+  std::vector<gfx::Rect> rects;
+  absl::optional<base::Value> value = base::JSONReader::Read(payload);
+  if (!value || !value->is_dict())
+    return rects;
+  const base::Value::Dict& dict = value->GetDict();
+  if (const std::string* searched = dict.FindString("searchString"))
+    *search_string = *searched;
+  const base::Value::List* selection = dict.FindList("searchResultSelection");
+  if (!selection)
+    return rects;
+
+  rects.reserve(selection->size());
+  for (const base::Value& match : *selection) {
+    const std::string* rectangles =
+        match.is_dict() ? match.GetDict().FindString("rectangles") : nullptr;
+    if (!rectangles)
+      continue;
+    std::string_view rectangles_sv(*rectangles);
+    std::string_view::const_iterator start = rectangles_sv.begin();
+    gfx::Rect bounds;
+    for (const gfx::Rect& line : lok_callback::ParseMultipleRects(
+             start, rectangles_sv.end(), 1)) {
+      bounds.Union(line);
+    }
+    rects.push_back(bounds);
+  }
+  return rects;
+}
+
+namespace css = ::com::sun::star;
+using css::uno::Reference;
+using css::uno::UNO_QUERY;
+using css::uno::UNO_QUERY_THROW;
+
+struct TextSearch::Uno {
+  Reference<css::text::XText> text;
+  // one per paragraph in the index
+  std::vector<Reference<css::text::XTextRange>> paragraphs;
+};
+
+namespace {
+// appends the body paragraphs enumerated by `access`, skipping tables and
+// frames
+void ReadParagraphs(
+    const Reference<css::container::XEnumerationAccess>& access,
+    std::vector<std::u16string>* paragraphs,
+    std::vector<Reference<css::text::XTextRange>>* ranges) {
+  Reference<css::container::XEnumeration> elements =
+      access->createEnumeration();
+  while (elements->hasMoreElements()) {
+    Reference<css::lang::XServiceInfo> info(elements->nextElement(),
+                                            UNO_QUERY);
+    if (!info.is() || !info->supportsService("com.sun.star.text.Paragraph"))
+      continue;
+    Reference<css::text::XTextRange> range(info, UNO_QUERY);
+    OUString str = range->getString();
+    paragraphs->emplace_back(str.getStr(), str.getLength());
+    ranges->push_back(std::move(range));
+  }
+}
+
+base::Value::Dict UnoArgument(const char* type, base::Value value) {
+  base::Value::Dict argument;
+  argument.Set("type", type);
+  argument.Set("value", std::move(value));
+  return argument;
+}
+
+// com::sun::star::util::SearchFlags and TransliterationFlags
+constexpr int kNormWordOnly = 0x10;
+constexpr int kIgnoreCase = 0x100;
+// SvxSearchCmd
+constexpr int kFindAll = 1;
+
+constexpr base::TimeDelta kFindAllTimeout = base::Seconds(5);
+}  // namespace
+
+// A view that the user never sees, so that moving its cursor or selecting
+// through the layout doesn't move, scroll or reselect in the user's view. The
+// view that was current is current again after each call.
+class TextSearch::HiddenView {
+ public:
+  HiddenView(lok::Document* document,
+             const Reference<css::frame::XModel2>& model)
+      : document_(document), find_all_done_(&find_all_lock_) {
+    int original_view = document_->getView();
+    std::vector<Reference<css::frame::XController>> existing;
+    Reference<css::container::XEnumeration> controllers =
+        model->getControllers();
+    while (controllers->hasMoreElements())
+      existing.emplace_back(controllers->nextElement(), UNO_QUERY);
+
+    view_ = document_->createView();
+    if (view_ < 0)
+      return;
+    // the new view's controller is the one that wasn't there before
+    controllers = model->getControllers();
+    while (controllers->hasMoreElements()) {
+      Reference<css::frame::XController> controller(
+          controllers->nextElement(), UNO_QUERY);
+      if (std::find(existing.begin(), existing.end(), controller) !=
+          existing.end()) {
+        continue;
+      }
+      Reference<css::text::XTextViewCursorSupplier> supplier(controller,
+                                                             UNO_QUERY);
+      if (supplier.is())
+        cursor_ = supplier->getViewCursor();
+      break;
+    }
+
+    document_->setView(view_);
+    document_->registerCallback(&HiddenView::HandleCallback, this);
+    document_->setView(original_view);
+  }
+
+  ~HiddenView() {
+    if (view_ < 0)
+      return;
+    int original_view = document_->getView();
+    document_->setView(view_);
+    document_->registerCallback(nullptr, nullptr);
+    document_->destroyView(view_);
+    document_->setView(original_view);
+  }
+
+  // no copy
+  HiddenView(const HiddenView&) = delete;
+  HiddenView& operator=(const HiddenView&) = delete;
+
+  // false once the document was unloaded and reloaded, `document` is pinned
+  bool IsViewOf(lok::Document* document) const {
+    // a different document means this one was freed, so it isn't touched
+    if (document != document_)
+      return false;
+    std::vector<int> ids(document->getViewsCount());
+    document->getViewIds(ids.data(), ids.size());
+    return std::find(ids.begin(), ids.end(), view_) != ids.end();
+  }
+
+  // forgets a view that went with its document
+  void Abandon() { view_ = -1; }
+
+  const Reference<css::text::XTextViewCursor>& cursor() const {
+    return cursor_;
+  }
+
+  // the position in the layout nearest to `point_twips`
+  Reference<css::text::XTextRange> PositionAt(const gfx::Point& point_twips) {
+    int original_view = document_->getView();
+    document_->setView(view_);
+    document_->setTextSelection(LOK_SETTEXTSELECTION_RESET, point_twips.x(),
+                                point_twips.y());
+    document_->setView(original_view);
+    return cursor_->getStart();
+  }
+
+  // LOK's rect for each match of `query` in document order, including those
+  // outside of the body text. Null if LOK didn't answer in time
+  absl::optional<std::vector<gfx::Rect>> FindAll(
+      const std::u16string& query,
+      const SearchOptions& options) {
+    TRACE_EVENT0("electron", "TextSearch::HiddenView::FindAll");
+    std::string query_utf8 = base::UTF16ToUTF8(query);
+    base::Value::Dict arguments;
+    arguments.Set("SearchItem.SearchString",
+                  UnoArgument("string", base::Value(query_utf8)));
+    arguments.Set("SearchItem.Backward",
+                  UnoArgument("boolean", base::Value(false)));
+    arguments.Set("SearchItem.Command",
+                  UnoArgument("long", base::Value(kFindAll)));
+    arguments.Set("SearchItem.SearchFlags",
+                  UnoArgument("long", base::Value(options.whole_words
+                                                      ? kNormWordOnly
+                                                      : 0)));
+    arguments.Set("SearchItem.TransliterateFlags",
+                  UnoArgument("long", base::Value(options.match_case
+                                                      ? 0
+                                                      : kIgnoreCase)));
+    std::string json;
+    if (!base::JSONWriter::Write(arguments, &json))
+      return absl::nullopt;
+
+    {
+      base::AutoLock lock(find_all_lock_);
+      found_.reset();
+    }
+    int original_view = document_->getView();
+    document_->setView(view_);
+    document_->postUnoCommand(".uno:ExecuteSearch", json.c_str(), false);
+    document_->setView(original_view);
+
+    // the answer arrives through the view's callback, which may still deliver
+    // the answer of an earlier search that timed out
+    base::TimeTicks deadline = base::TimeTicks::Now() + kFindAllTimeout;
+    base::AutoLock lock(find_all_lock_);
+    while (!found_ || found_->first != query_utf8) {
+      base::TimeDelta remaining = deadline - base::TimeTicks::Now();
+      if (!remaining.is_positive())
+        return absl::nullopt;
+      find_all_done_.TimedWait(remaining);
+    }
+    return std::move(found_->second);
+  }
+
+ private:
+  static void HandleCallback(int type, const char* payload, void* data) {
+    if (type != LOK_CALLBACK_SEARCH_RESULT_SELECTION &&
+        type != LOK_CALLBACK_SEARCH_NOT_FOUND) {
+      return;
+    }
+
+    auto* self = static_cast<HiddenView*>(data);
+    std::string search_string;
+    std::vector<gfx::Rect> rects;
+    if (type == LOK_CALLBACK_SEARCH_NOT_FOUND) {
+      search_string = payload;
+    } else {
+      rects = ParseSearchResultRects(payload, &search_string);
+    }
+
+    base::AutoLock lock(self->find_all_lock_);
+    self->found_.emplace(std::move(search_string), std::move(rects));
+    self->find_all_done_.Signal();
+  }
+
+  lok::Document* const document_;
+  int view_ = -1;
+  Reference<css::text::XTextViewCursor> cursor_;
+
+  base::Lock find_all_lock_;
+  base::ConditionVariable find_all_done_;
+  // the query LOK searched and its match rects
+  absl::optional<std::pair<std::string, std::vector<gfx::Rect>>> found_
+      GUARDED_BY(find_all_lock_);
+};
+
+TextSearch::TextSearch() = default;
+TextSearch::~TextSearch() = default;
+
+void TextSearch::MarkStale() {
+  base::AutoLock lock(stale_lock_);
+  stale_ = true;
+}
+
+void TextSearch::MarkStale(const gfx::Rect& rect_twips) {
+  base::AutoLock lock(stale_lock_);
+  stale_rect_.Union(rect_twips);
+}
+
+void TextSearch::ReleaseView(lok::Document* document) {
+  base::AutoLock lock(lock_);
+  if (hidden_view_ && !hidden_view_->IsViewOf(document))
+    hidden_view_->Abandon();
+  hidden_view_.reset();
+}
+
+bool TextSearch::Search(lok::Document* document,
+                        const std::u16string& query,
+                        const SearchOptions& options,
+                        const std::vector<gfx::Rect>& page_rects_twips,
+                        SearchResult* result,
+                        std::string* error) {
+  TRACE_EVENT0("electron", "TextSearch::Search");
+  base::AutoLock lock(lock_);
+  bool stale;
+  gfx::Rect stale_rect;
+  {
+    base::AutoLock stale_lock(stale_lock_);
+    stale = std::exchange(stale_, false);
+    stale_rect = std::exchange(stale_rect_, gfx::Rect());
+  }
+
+  try {
+    Reference<css::text::XTextDocument> text_document(
+        static_cast<css::lang::XComponent*>(document->getXComponent()),
+        UNO_QUERY);
+    Reference<css::frame::XModel2> model(text_document, UNO_QUERY);
+    if (!text_document.is() || !model.is()) {
+      *error = "document is not a text document";
+      return false;
+    }
+
+    if (hidden_view_ && !hidden_view_->IsViewOf(document)) {
+      hidden_view_->Abandon();
+      hidden_view_.reset();
+      // the ranges belong to the document before it was reloaded
+      uno_.reset();
+    }
+    if (!hidden_view_)
+      hidden_view_ = std::make_unique<HiddenView>(document, model);
+
+    if (!stale && uno_ && !stale_rect.IsEmpty()) {
+      TRACE_EVENT0("electron", "TextSearch::Search::RefreshRect");
+      stale = !hidden_view_->cursor().is() || !RefreshRect(stale_rect);
+    }
+
+    if (stale || !uno_) {
+      TRACE_EVENT0("electron", "TextSearch::Search::Refresh");
+      auto uno = std::make_unique<Uno>();
+      uno->text = text_document->getText();
+      // only body paragraphs are indexed, not tables, frames or notes
+      std::vector<std::u16string> paragraphs;
+      ReadParagraphs(Reference<css::container::XEnumerationAccess>(
+                         uno->text, UNO_QUERY_THROW),
+                     &paragraphs, &uno->paragraphs);
+
+      index_.Update(std::move(paragraphs));
+      uno_ = std::move(uno);
+    }
+
+    std::vector<SearchMatch> matches =
+        index_.Find(query, options, &result->count);
+    std::vector<gfx::Rect> rects;
+    // the body has no match, so LOK isn't asked
+    if (!matches.empty()) {
+      absl::optional<std::vector<gfx::Rect>> found =
+          hidden_view_->FindAll(query, options);
+      if (!found) {
+        *error = "LibreOffice didn't return the match rects";
+        return false;
+      }
+      // LOK also searches text that isn't indexed (tables, frames, headers),
+      // its matches are the ones it would highlight
+      result->count = found->size();
+      size_t returned = std::min(found->size(), options.max_matches);
+      rects.assign(found->begin(), found->begin() + returned);
+    }
+
+    GroupRectsByPage(rects, page_rects_twips, result);
+    return true;
+  } catch (const css::uno::Exception& e) {
+    // refreshed fully by the next search
+    MarkStale();
+    *error = OUStringToOString(e.Message, RTL_TEXTENCODING_UTF8).getStr();
+    return false;
+  }
+}
+
+bool TextSearch::RefreshRect(const gfx::Rect& rect_twips) {
+  try {
+    // the paragraphs starting from the one at the top left of the rect to the
+    // one at the bottom right, the old ranges follow their paragraphs through
+    // the edit so they can be compared with the new layout
+    Reference<css::text::XTextRange> top =
+        hidden_view_->PositionAt(rect_twips.origin());
+    Reference<css::text::XTextRange> bottom =
+        hidden_view_->PositionAt(rect_twips.bottom_right());
+    Reference<css::text::XTextRangeCompare> compare(uno_->text,
+                                                    UNO_QUERY_THROW);
+    // columns can lay the bottom right out before the top left
+    if (compare->compareRegionStarts(top, bottom) < 0)
+      return false;
+    // the number of old paragraphs starting at or before `range`, positions
+    // outside of the body text throw and are refreshed fully
+    auto starting_before = [&](const Reference<css::text::XTextRange>& range) {
+      size_t low = 0;
+      size_t high = uno_->paragraphs.size();
+      while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (compare->compareRegionStarts(uno_->paragraphs[mid], range) >= 0)
+          low = mid + 1;
+        else
+          high = mid;
+      }
+      return low;
+    };
+    size_t first = starting_before(top);
+    size_t end = starting_before(bottom);
+    Reference<css::text::XTextRange> from = uno_->text->getStart();
+    if (first > 0) {
+      --first;
+      from = uno_->paragraphs[first]->getStart();
+    }
+
+    Reference<css::text::XParagraphCursor> cursor(
+        uno_->text->createTextCursorByRange(from), UNO_QUERY_THROW);
+    cursor->gotoRange(bottom, true);
+    cursor->gotoEndOfParagraph(true);
+
+    std::vector<std::u16string> paragraphs;
+    std::vector<Reference<css::text::XTextRange>> ranges;
+    ReadParagraphs(
+        Reference<css::container::XEnumerationAccess>(cursor, UNO_QUERY_THROW),
+        &paragraphs, &ranges);
+
+    index_.Replace(first, end, std::move(paragraphs));
+    uno_->paragraphs.erase(uno_->paragraphs.begin() + first,
+                           uno_->paragraphs.begin() + end);
+    uno_->paragraphs.insert(uno_->paragraphs.begin() + first,
+                            std::make_move_iterator(ranges.begin()),
+                            std::make_move_iterator(ranges.end()));
+    return true;
+  } catch (const css::uno::Exception&) {
+    return false;
+  }
+}
+
+}  // namespace electron::office
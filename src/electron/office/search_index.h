@@ -0,0 +1,169 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "base/memory/ref_counted.h"
+#include "base/synchronization/lock.h"
+#include "base/thread_annotations.h"
+#include "ui/gfx/geometry/rect.h"
+
+namespace lok {
+class Document;
+}
+
+namespace electron::office {
+
+struct SearchOptions {
+  static constexpr size_t kDefaultMaxMatches = 1000;
+
+  bool match_case = false;
+  // a match must not be surrounded by letters or digits
+  bool whole_words = false;
+  // matches past this are counted, but not returned
+  size_t max_matches = kDefaultMaxMatches;
+};
+
+struct SearchMatch {
+  size_t paragraph = 0;
+  // in UTF-16 code units
+  size_t offset = 0;
+  size_t length = 0;
+
+  bool operator==(const SearchMatch& other) const {
+    return paragraph == other.paragraph && offset == other.offset &&
+           length == other.length;
+  }
+};
+
+// The UTF-16 text of every paragraph of a document with a case folded copy,
+// so that a query doesn't go through the document model or layout.
+class SearchIndex {
+ public:
+  SearchIndex();
+  ~SearchIndex();
+
+  // no copy
+  SearchIndex(const SearchIndex&) = delete;
+  SearchIndex& operator=(const SearchIndex&) = delete;
+
+  // Replaces the paragraphs, only folding those between the unchanged prefix
+  // and suffix. Returns the index of the first paragraph that changed, or
+  // size() if none did.
+  size_t Update(std::vector<std::u16string> paragraphs);
+  // replaces the paragraphs [begin, end) with `paragraphs`, folding only those
+  void Replace(size_t begin,
+               size_t end,
+               std::vector<std::u16string> paragraphs);
+
+  // returns the matches in document order, up to `options.max_matches`.
+  // `total` is set to the number of matches, including those not returned
+  std::vector<SearchMatch> Find(const std::u16string& query,
+                                const SearchOptions& options,
+                                size_t* total) const;
+
+  size_t size() const { return paragraphs_.size(); }
+  const std::u16string& paragraph(size_t index) const {
+    return paragraphs_[index];
+  }
+
+ private:
+  std::vector<std::u16string> paragraphs_;
+  std::vector<std::u16string> folded_;
+};
+
+// match rects grouped by page
+struct SearchResult {
+  // every match, including those without a rect
+  size_t count = 0;
+  // x, y, width, height in twips for each returned match, ordered by page
+  std::vector<int32_t> rects;
+  // the pages with matches, ascending
+  std::vector<uint32_t> pages;
+  // one per page plus one, the rects of pages[i] are the matches
+  // [page_offsets[i], page_offsets[i + 1])
+  std::vector<uint32_t> page_offsets;
+
+  SearchResult();
+  SearchResult(SearchResult&& other) noexcept;
+  SearchResult& operator=(SearchResult&& other) noexcept;
+  ~SearchResult();
+};
+
+// Groups `rects_twips` by the page they start on. Rects that aren't on a page
+// are grouped with the nearest page before them.
+void GroupRectsByPage(const std::vector<gfx::Rect>& rects_twips,
+                      const std::vector<gfx::Rect>& page_rects_twips,
+                      SearchResult* result);
+
+// The rect in twips of each match in the payload of
+// LOK_CALLBACK_SEARCH_RESULT_SELECTION, the bounds of its lines if it wraps.
+// `search_string` is set to the query LOK searched for.
+std::vector<gfx::Rect> ParseSearchResultRects(std::string_view payload,
+                                              std::string* search_string);
+
+// Searches a text document through a SearchIndex. The index is refreshed from
+// the document model after it changes, re-reading only the paragraphs under
+// the invalidated rects when it can. Match rects are LOK's, from a find-all in
+// a hidden view that's kept between searches, so the user's selection and
+// scroll position aren't touched. Searches block on LOK and should run with
+// the document pinned, MarkStale can be called from any thread and doesn't
+// wait on a search.
+class TextSearch : public base::RefCountedThreadSafe<TextSearch> {
+ public:
+  TextSearch();
+
+  // no copy
+  TextSearch(const TextSearch&) = delete;
+  TextSearch& operator=(const TextSearch&) = delete;
+
+  // every paragraph may have changed
+  void MarkStale();
+  // destroys the hidden view, since a document with more than one view isn't
+  // unloaded. `document` is pinned
+  void ReleaseView(lok::Document* document);
+  // the paragraphs under `rect_twips` may have changed
+  void MarkStale(const gfx::Rect& rect_twips);
+
+  // `document` is pinned with its view current, which is current again after
+  bool Search(lok::Document* document,
+              const std::u16string& query,
+              const SearchOptions& options,
+              const std::vector<gfx::Rect>& page_rects_twips,
+              SearchResult* result,
+              std::string* error);
+
+ private:
+  friend class base::RefCountedThreadSafe<TextSearch>;
+  ~TextSearch();
+
+  struct Uno;
+  class HiddenView;
+
+  // re-reads the paragraphs under `rect_twips`, returns false if they can't
+  // be told apart and the whole document should be read instead
+  bool RefreshRect(const gfx::Rect& rect_twips)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // held for a whole search
+  base::Lock lock_;
+  SearchIndex index_ GUARDED_BY(lock_);
+  std::unique_ptr<Uno> uno_ GUARDED_BY(lock_);
+  std::unique_ptr<HiddenView> hidden_view_ GUARDED_BY(lock_);
+
+  // only held to mark or take what's stale, so that invalidations on the
+  // renderer thread don't wait on a search
+  base::Lock stale_lock_;
+  bool stale_ GUARDED_BY(stale_lock_) = true;
+  // the union of the invalidated rects since the last refresh
+  gfx::Rect stale_rect_ GUARDED_BY(stale_lock_);
+};
+
+}  // namespace electron::office
@@ -0,0 +1,135 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "search_index.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace electron::office {
+
+TEST(SearchIndexTest, FindsCaseInsensitiveByDefault) {
+  SearchIndex index;
+  index.Update({u"The contract", u"", u"THE END, the end"});
+
+  size_t total;
+  auto matches = index.Find(u"the", SearchOptions(), &total);
+  EXPECT_EQ(total, size_t(3));
+  ASSERT_EQ(matches.size(), size_t(3));
+  EXPECT_EQ(matches[0], (SearchMatch{0, 0, 3}));
+  EXPECT_EQ(matches[1], (SearchMatch{2, 0, 3}));
+  EXPECT_EQ(matches[2], (SearchMatch{2, 9, 3}));
+
+  SearchOptions match_case;
+  match_case.match_case = true;
+  matches = index.Find(u"the", match_case, &total);
+  EXPECT_EQ(total, size_t(1));
+  EXPECT_EQ(matches[0], (SearchMatch{2, 9, 3}));
+}
+
+TEST(SearchIndexTest, WholeWordsAndNonOverlapping) {
+  SearchIndex index;
+  index.Update({u"other the bathe", u"aaaa"});
+
+  SearchOptions whole_words;
+  whole_words.whole_words = true;
+  size_t total;
+  auto matches = index.Find(u"the", whole_words, &total);
+  ASSERT_EQ(total, size_t(1));
+  EXPECT_EQ(matches[0], (SearchMatch{0, 6, 3}));
+
+  matches = index.Find(u"aa", SearchOptions(), &total);
+  EXPECT_EQ(total, size_t(2));
+}
+
+TEST(SearchIndexTest, LimitsReturnedMatchesButCountsAll) {
+  SearchIndex index;
+  index.Update({u"a a a a a"});
+
+  SearchOptions options;
+  options.max_matches = 2;
+  size_t total;
+  auto matches = index.Find(u"a", options, &total);
+  EXPECT_EQ(total, size_t(5));
+  EXPECT_EQ(matches.size(), size_t(2));
+}
+
+TEST(SearchIndexTest, UpdateReportsFirstChangedParagraph) {
+  SearchIndex index;
+  EXPECT_EQ(index.Update({u"one", u"two", u"three"}), size_t(0));
+  EXPECT_EQ(index.Update({u"one", u"two", u"three"}), size_t(3));
+  EXPECT_EQ(index.Update({u"one", u"TWO", u"three"}), size_t(1));
+  EXPECT_EQ(index.Update({u"one", u"TWO", u"2.5", u"three"}), size_t(2));
+  EXPECT_EQ(index.size(), size_t(4));
+
+  // the folded copies of unchanged paragraphs are kept in order
+  size_t total;
+  auto matches = index.Find(u"three", SearchOptions(), &total);
+  ASSERT_EQ(total, size_t(1));
+  EXPECT_EQ(matches[0].paragraph, size_t(3));
+  matches = index.Find(u"two", SearchOptions(), &total);
+  ASSERT_EQ(total, size_t(1));
+  EXPECT_EQ(matches[0].paragraph, size_t(1));
+}
+
+TEST(SearchIndexTest, ReplaceOnlyTouchesTheRange) {
+  SearchIndex index;
+  index.Update({u"one", u"two", u"three", u"four"});
+  // a paragraph split in two and its neighbour edited
+  index.Replace(1, 3, {u"tw", u"o", u"THREE!"});
+  ASSERT_EQ(index.size(), size_t(5));
+  EXPECT_EQ(index.paragraph(0), u"one");
+  EXPECT_EQ(index.paragraph(3), u"THREE!");
+  EXPECT_EQ(index.paragraph(4), u"four");
+
+  size_t total;
+  auto matches = index.Find(u"three", SearchOptions(), &total);
+  ASSERT_EQ(total, size_t(1));
+  EXPECT_EQ(matches[0].paragraph, size_t(3));
+  matches = index.Find(u"four", SearchOptions(), &total);
+  ASSERT_EQ(total, size_t(1));
+  EXPECT_EQ(matches[0].paragraph, size_t(4));
+
+  // removing paragraphs
+  index.Replace(1, 4, {});
+  ASSERT_EQ(index.size(), size_t(2));
+  index.Find(u"o", SearchOptions(), &total);
+  EXPECT_EQ(total, size_t(2));
+}
+
+TEST(SearchIndexTest, GroupsRectsByPage) {
+  std::vector<gfx::Rect> pages = {gfx::Rect(0, 0, 1000, 1400),
+                                  gfx::Rect(0, 1500, 1000, 1400),
+                                  gfx::Rect(0, 3000, 1000, 1400)};
+  std::vector<gfx::Rect> rects = {gfx::Rect(10, 3100, 5, 5),
+                                  gfx::Rect(10, 100, 5, 5),
+                                  gfx::Rect(10, 3200, 5, 5)};
+  SearchResult result;
+  GroupRectsByPage(rects, pages, &result);
+
+  EXPECT_EQ(result.pages, (std::vector<uint32_t>{0, 2}));
+  EXPECT_EQ(result.page_offsets, (std::vector<uint32_t>{0, 1, 3}));
+  ASSERT_EQ(result.rects.size(), size_t(12));
+  EXPECT_EQ(result.rects[1], 100);
+  EXPECT_EQ(result.rects[5], 3100);
+  EXPECT_EQ(result.rects[9], 3200);
+}
+
+TEST(SearchIndexTest, ParsesSearchResultRects) {
+  std::string searched;
+  std::vector<gfx::Rect> rects = ParseSearchResultRects(
+      R"({"searchString":"fox","highlightAll":"true",)"
+      R"("searchResultSelection":[)"
+      R"({"part":"0","rectangles":"1418, 1418, 500, 276"},)"
+      R"({"part":"0","rectangles":"9000, 2000, 400, 276; 1418, 2276, 100, 276"}]})",
+      &searched);
+
+  EXPECT_EQ(searched, "fox");
+  ASSERT_EQ(rects.size(), size_t(2));
+  EXPECT_EQ(rects[0], gfx::Rect(1418, 1418, 500, 276));
+  // a match that wraps is covered by the bounds of its lines
+  EXPECT_EQ(rects[1], gfx::Rect(1418, 2000, 7982, 552));
+
+  EXPECT_TRUE(ParseSearchResultRects("not json", &searched).empty());
+}
+
+}  // namespace electron::office
@@ -0,0 +1,245 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "office/startup_prefetch.h"
+
+#include <algorithm>
+#include <iterator>
+#include <set>
+#include "base/files/file_enumerator.h"
+#include "base/files/file_util.h"
+#include "base/files/important_file_writer.h"
+#include "base/hash/hash.h"
+#include "base/logging.h"
+#include "base/native_library.h"
+#include "base/path_service.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
+#include "base/trace_event/trace_event.h"
+#include "build/build_config.h"
+
+#if BUILDFLAG(IS_MAC)
+#include <mach-o/dyld.h>
+#endif
+
+namespace electron::office {
+
+StartupTrace::StartupTrace() = default;
+StartupTrace::~StartupTrace() = default;
+
+void StartupTrace::StartPhase(std::string name) {
+  Finish();
+  phases_.push_back({std::move(name), base::TimeDelta()});
+  phase_start_ = base::TimeTicks::Now();
+  in_phase_ = true;
+}
+
+void StartupTrace::Finish() {
+  if (!in_phase_)
+    return;
+  phases_.back().duration = base::TimeTicks::Now() - phase_start_;
+  in_phase_ = false;
+}
+
+StartupProfile::StartupProfile() = default;
+StartupProfile::StartupProfile(const StartupProfile& other) = default;
+StartupProfile& StartupProfile::operator=(const StartupProfile& other) =
+    default;
+StartupProfile::~StartupProfile() = default;
+
+base::FilePath PrefetchManifestPath(const base::FilePath& install_dir) {
+  base::FilePath cache_dir;
+#if BUILDFLAG(IS_WIN)
+  constexpr int kCacheKey = base::DIR_LOCAL_APP_DATA;
+#else
+  constexpr int kCacheKey = base::DIR_CACHE;
+#endif
+  if (!base::PathService::Get(kCacheKey, &cache_dir))
+    return {};
+
+  // a manifest per install, so that apps bundling LOK don't share one
+  return cache_dir.Append(FILE_PATH_LITERAL("libreofficekit"))
+      .AppendASCII("prefetch-" +
+                   base::NumberToString(
+                       base::PersistentHash(install_dir.AsUTF8Unsafe())) +
+                   ".txt");
+}
+
+std::vector<base::FilePath> ReadPrefetchManifest(
+    const base::FilePath& manifest,
+    const base::FilePath& install_dir) {
+  std::vector<base::FilePath> result;
+  std::string contents;
+  if (manifest.empty() || !base::ReadFileToString(manifest, &contents))
+    return result;
+
+  for (const auto& line : base::SplitStringPiece(
+           contents, "\n", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+    base::FilePath relative = base::FilePath::FromUTF8Unsafe(line);
+    if (relative.IsAbsolute() || relative.ReferencesParent())
+      continue;
+    result.push_back(install_dir.Append(relative));
+  }
+  return result;
+}
+
+bool WritePrefetchManifest(const base::FilePath& manifest,
+                           const base::FilePath& install_dir,
+                           const std::vector<base::FilePath>& files) {
+  if (manifest.empty() || !base::CreateDirectory(manifest.DirName()))
+    return false;
+
+  std::string contents;
+  for (const auto& file : files) {
+    base::FilePath relative;
+    if (!install_dir.AppendRelativePath(file, &relative))
+      continue;
+    contents += relative.AsUTF8Unsafe();
+    contents += '\n';
+  }
+  return base::ImportantFileWriter::WriteFileAtomically(manifest, contents);
+}
+
+std::vector<base::FilePath> ParseProcMaps(const std::string& maps,
+                                          const base::FilePath& dir) {
+  std::vector<base::FilePath> result;
+  std::set<base::FilePath> seen;
+  for (const auto& line : base::SplitStringPiece(
+           maps, "\n", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+    // address perms offset dev inode pathname, where the path may have spaces
+    base::StringPiece rest = line;
+    for (int field = 0; field < 5 && !rest.empty(); ++field) {
+      size_t end = rest.find_first_of(" \t");
+      rest = end == base::StringPiece::npos ? base::StringPiece()
+                                            : rest.substr(end);
+      rest = base::TrimWhitespaceASCII(rest, base::TRIM_LEADING);
+    }
+    if (rest.empty() || rest[0] != '/' ||
+        base::EndsWith(rest, " (deleted)")) {
+      continue;
+    }
+
+    base::FilePath path = base::FilePath::FromUTF8Unsafe(rest);
+    if (dir.IsParent(path) && seen.insert(path).second)
+      result.push_back(std::move(path));
+  }
+  return result;
+}
+
+std::vector<base::FilePath> MappedFilesUnder(const base::FilePath& dir) {
+  TRACE_EVENT0("electron", "MappedFilesUnder");
+#if BUILDFLAG(IS_LINUX) || BUILDFLAG(IS_CHROMEOS)
+  std::string maps;
+  if (!base::ReadFileToString(base::FilePath("/proc/self/maps"), &maps))
+    return {};
+  return ParseProcMaps(maps, dir);
+#elif BUILDFLAG(IS_MAC)
+  std::vector<base::FilePath> result;
+  for (uint32_t i = 0; i < _dyld_image_count(); ++i) {
+    const char* name = _dyld_get_image_name(i);
+    if (!name)
+      continue;
+    base::FilePath path(name);
+    if (dir.IsParent(path))
+      result.push_back(std::move(path));
+  }
+  return result;
+#else
+  return {};
+#endif
+}
+
+std::vector<base::FilePath> StartupConfigFiles(
+    const base::FilePath& install_dir) {
+  TRACE_EVENT0("electron", "StartupConfigFiles");
+  // the bootstrap files are named without an extension outside of Windows
+#if BUILDFLAG(IS_WIN)
+  constexpr base::FilePath::CharType kBootstrapPattern[] =
+      FILE_PATH_LITERAL("*.ini");
+#else
+  constexpr base::FilePath::CharType kBootstrapPattern[] =
+      FILE_PATH_LITERAL("*rc");
+#endif
+  const struct {
+    const base::FilePath::CharType* dir;
+    const base::FilePath::CharType* pattern;
+  } kSubtrees[] = {
+      {FILE_PATH_LITERAL("program"), kBootstrapPattern},
+      {FILE_PATH_LITERAL("program"), FILE_PATH_LITERAL("*.rdb")},
+      {FILE_PATH_LITERAL("program/types"), FILE_PATH_LITERAL("*.rdb")},
+      {FILE_PATH_LITERAL("program/services"), FILE_PATH_LITERAL("*.rdb")},
+      {FILE_PATH_LITERAL("share/registry"), FILE_PATH_LITERAL("*.xcd")},
+      {FILE_PATH_LITERAL("share/registry/res"), FILE_PATH_LITERAL("*.xcd")},
+  };
+
+  std::vector<base::FilePath> result;
+  for (const auto& subtree : kSubtrees) {
+    std::vector<base::FilePath> files;
+    base::FileEnumerator enumerator(
+        install_dir.Append(subtree.dir).NormalizePathSeparators(),
+        /*recursive=*/false, base::FileEnumerator::FILES, subtree.pattern);
+    for (base::FilePath file = enumerator.Next(); !file.empty();
+         file = enumerator.Next()) {
+      files.push_back(std::move(file));
+    }
+    // enumeration order is up to the file system
+    std::sort(files.begin(), files.end());
+    std::move(files.begin(), files.end(), std::back_inserter(result));
+  }
+  return result;
+}
+
+PrefetchStats PrefetchFiles(const std::vector<base::FilePath>& files) {
+  TRACE_EVENT1("electron", "PrefetchFiles", "files", files.size());
+  base::TimeTicks start = base::TimeTicks::Now();
+  PrefetchStats stats;
+  for (const auto& file : files) {
+    int64_t size = 0;
+    if (!base::GetFileSize(file, &size))
+      continue;
+
+    const base::FilePath::StringType extension = file.FinalExtension();
+    const bool is_executable =
+        extension == FILE_PATH_LITERAL(".so") ||
+        extension == FILE_PATH_LITERAL(".dylib") ||
+        extension == FILE_PATH_LITERAL(".dll") ||
+        file.BaseName().value().find(FILE_PATH_LITERAL(".so.")) !=
+            base::FilePath::StringType::npos;
+    if (base::PreReadFile(file, is_executable)) {
+      ++stats.files;
+      stats.bytes += size;
+    }
+  }
+  stats.duration = base::TimeTicks::Now() - start;
+  return stats;
+}
+
+bool PreloadLibrary(const base::FilePath& program_dir) {
+#if BUILDFLAG(IS_POSIX)
+#if BUILDFLAG(IS_MAC)
+  constexpr const char* kLibraries[] = {"libsofficeapp.dylib",
+                                        "libmergedlo.dylib"};
+#else
+  constexpr const char* kLibraries[] = {"libsofficeapp.so", "libmergedlo.so"};
+#endif
+  // the same order as lok_cpp_init, which then finds the library loaded
+  for (const char* library : kLibraries) {
+    base::FilePath path = program_dir.AppendASCII(library);
+    if (!base::PathExists(path))
+      continue;
+
+    base::NativeLibraryLoadError error;
+    // intentionally leaked, LOK holds the library for the life of the process
+    if (base::LoadNativeLibrary(path, &error))
+      return true;
+    LOG(ERROR) << "unable to preload " << path << ": " << error.ToString();
+    return false;
+  }
+#endif
+  // LOK sets up the DLL search path itself on Windows
+  return false;
+}
+
+}  // namespace electron::office
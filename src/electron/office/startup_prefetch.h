@@ -0,0 +1,97 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "base/files/file_path.h"
+#include "base/time/time.h"
+
+namespace electron::office {
+
+struct StartupPhase {
+  std::string name;
+  base::TimeDelta duration;
+};
+
+// Times the phases of starting LOK, in order
+class StartupTrace {
+ public:
+  StartupTrace();
+  ~StartupTrace();
+
+  // ends the current phase, if any, and starts `name`
+  void StartPhase(std::string name);
+  // ends the current phase
+  void Finish();
+
+  const std::vector<StartupPhase>& phases() const { return phases_; }
+
+ private:
+  std::vector<StartupPhase> phases_;
+  base::TimeTicks phase_start_;
+  bool in_phase_ = false;
+};
+
+struct PrefetchStats {
+  size_t files = 0;
+  int64_t bytes = 0;
+  base::TimeDelta duration;
+};
+
+struct StartupProfile {
+  std::vector<StartupPhase> phases;
+  PrefetchStats prefetch;
+  // the libraries mapped and the configuration read while starting, relative
+  // to the install directory. set shortly after LOK is loaded
+  std::vector<base::FilePath> files_read;
+
+  StartupProfile();
+  StartupProfile(const StartupProfile& other);
+  StartupProfile& operator=(const StartupProfile& other);
+  ~StartupProfile();
+};
+
+// where the prefetch manifest of the LibreOffice at `install_dir` is kept
+// between launches
+base::FilePath PrefetchManifestPath(const base::FilePath& install_dir);
+
+// Reads the manifest at `manifest`, a path relative to `install_dir` per line.
+// Returns the absolute paths, skipping any that would leave `install_dir`.
+std::vector<base::FilePath> ReadPrefetchManifest(
+    const base::FilePath& manifest,
+    const base::FilePath& install_dir);
+
+// writes `files` that are within `install_dir` to `manifest`
+bool WritePrefetchManifest(const base::FilePath& manifest,
+                           const base::FilePath& install_dir,
+                           const std::vector<base::FilePath>& files);
+
+// Returns the files under `dir` that are mapped into this process, which are
+// the shared libraries and mapped resources read by LOK. Empty on Windows.
+std::vector<base::FilePath> MappedFilesUnder(const base::FilePath& dir);
+
+// Returns the configuration under `install_dir` that LOK reads with read()
+// while starting, which doesn't show up as a mapping: the bootstrap rc or ini
+// files, the type and service registries and the configuration layers in
+// share/registry, in that order.
+std::vector<base::FilePath> StartupConfigFiles(
+    const base::FilePath& install_dir);
+
+// returns the files under `dir` in the contents of /proc/<pid>/maps, in order
+// of their first mapping
+std::vector<base::FilePath> ParseProcMaps(const std::string& maps,
+                                          const base::FilePath& dir);
+
+// reads ahead `files` into the page cache, so that they're warm when LOK opens
+// them
+PrefetchStats PrefetchFiles(const std::vector<base::FilePath>& files);
+
+// Loads the LOK library from `program_dir` ahead of lok_cpp_init, so that
+// dynamic linking is traced separately from LOK's own initialization. Returns
+// false if the library wasn't found or can't be preloaded on this platform.
+bool PreloadLibrary(const base::FilePath& program_dir);
+
+}  // namespace electron::office
@@ -0,0 +1,139 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "startup_prefetch.h"
+
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "build/build_config.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace electron::office {
+
+namespace {
+base::FilePath Path(const char* path) {
+  return base::FilePath::FromUTF8Unsafe(path);
+}
+}  // namespace
+
+TEST(StartupPrefetchTest, TimesPhasesInOrder) {
+  StartupTrace trace;
+  trace.StartPhase("first");
+  trace.StartPhase("second");
+  trace.Finish();
+  // finishing again doesn't add or change a phase
+  trace.Finish();
+
+  ASSERT_EQ(trace.phases().size(), size_t(2));
+  EXPECT_EQ(trace.phases()[0].name, "first");
+  EXPECT_EQ(trace.phases()[1].name, "second");
+  EXPECT_GE(trace.phases()[0].duration, base::TimeDelta());
+}
+
+TEST(StartupPrefetchTest, ParsesMappedFilesUnderADirectory) {
+  const std::string maps =
+      "7f00-7f10 r--p 00000000 08:01 11 /opt/lo/program/libmergedlo.so\n"
+      "7f10-7f20 r-xp 00010000 08:01 11 /opt/lo/program/libmergedlo.so\n"
+      "7f20-7f30 r--p 00000000 08:01 12 /opt/lo/program/types.rdb\n"
+      "7f30-7f40 r--p 00000000 08:01 13 /usr/lib/libc.so.6\n"
+      "7f40-7f50 rw-p 00000000 00:00 0 \n"
+      "7f50-7f60 r--p 00000000 08:01 14 /opt/lo/share/a file.xcd\n"
+      "7f60-7f70 r--p 00000000 08:01 15 /opt/lo/program/old.so (deleted)\n"
+      "7f70-7f80 rw-p 00000000 00:00 0 [heap]\n";
+
+  std::vector<base::FilePath> files = ParseProcMaps(maps, Path("/opt/lo"));
+  ASSERT_EQ(files.size(), size_t(3));
+  EXPECT_EQ(files[0], Path("/opt/lo/program/libmergedlo.so"));
+  EXPECT_EQ(files[1], Path("/opt/lo/program/types.rdb"));
+  EXPECT_EQ(files[2], Path("/opt/lo/share/a file.xcd"));
+}
+
+TEST(StartupPrefetchTest, ManifestRoundTrip) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  base::FilePath install_dir = temp_dir.GetPath().AppendASCII("install");
+  base::FilePath manifest =
+      temp_dir.GetPath().AppendASCII("cache").AppendASCII("prefetch.txt");
+
+  std::vector<base::FilePath> files = {
+      install_dir.AppendASCII("program").AppendASCII("libmergedlo.so"),
+      install_dir.AppendASCII("share").AppendASCII("registry.xcd"),
+      // outside of the install, so it isn't written
+      temp_dir.GetPath().AppendASCII("other.so"),
+  };
+  ASSERT_TRUE(WritePrefetchManifest(manifest, install_dir, files));
+
+  std::vector<base::FilePath> read = ReadPrefetchManifest(manifest, install_dir);
+  ASSERT_EQ(read.size(), size_t(2));
+  EXPECT_EQ(read[0], files[0]);
+  EXPECT_EQ(read[1], files[1]);
+}
+
+TEST(StartupPrefetchTest, ManifestStaysWithinTheInstall) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  base::FilePath manifest = temp_dir.GetPath().AppendASCII("prefetch.txt");
+  ASSERT_TRUE(base::WriteFile(manifest, "../secret\nprogram/a.so\n\n"));
+
+  std::vector<base::FilePath> read =
+      ReadPrefetchManifest(manifest, temp_dir.GetPath());
+  ASSERT_EQ(read.size(), size_t(1));
+  EXPECT_EQ(read[0], temp_dir.GetPath().AppendASCII("program").AppendASCII(
+                         "a.so"));
+
+  EXPECT_TRUE(ReadPrefetchManifest(temp_dir.GetPath().AppendASCII("missing"),
+                                   temp_dir.GetPath())
+                  .empty());
+}
+
+TEST(StartupPrefetchTest, ListsTheStartupConfiguration) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  const base::FilePath& install = temp_dir.GetPath();
+  for (const char* dir : {"program", "program/types", "share/registry"}) {
+    ASSERT_TRUE(base::CreateDirectory(
+        install.AppendASCII(dir).NormalizePathSeparators()));
+  }
+  const char* kFiles[] = {
+#if BUILDFLAG(IS_WIN)
+      "program/fundamental.ini",
+#else
+      "program/fundamentalrc",
+#endif
+      "program/services.rdb", "program/types/offapi.rdb",
+      "share/registry/writer.xcd", "share/registry/main.xcd",
+      // not read while starting
+      "program/libmergedlo.so", "share/registry/notes.txt"};
+  for (const char* file : kFiles) {
+    ASSERT_TRUE(base::WriteFile(
+        install.AppendASCII(file).NormalizePathSeparators(), "x"));
+  }
+
+  std::vector<base::FilePath> files = StartupConfigFiles(install);
+  ASSERT_EQ(files.size(), size_t(5));
+  EXPECT_EQ(files[0], install.AppendASCII(kFiles[0]).NormalizePathSeparators());
+  EXPECT_EQ(files[1], install.AppendASCII("program/services.rdb")
+                          .NormalizePathSeparators());
+  EXPECT_EQ(files[2], install.AppendASCII("program/types/offapi.rdb")
+                          .NormalizePathSeparators());
+  // sorted within a directory
+  EXPECT_EQ(files[3], install.AppendASCII("share/registry/main.xcd")
+                          .NormalizePathSeparators());
+  EXPECT_EQ(files[4], install.AppendASCII("share/registry/writer.xcd")
+                          .NormalizePathSeparators());
+}
+
+TEST(StartupPrefetchTest, PrefetchesExistingFiles) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  base::FilePath file = temp_dir.GetPath().AppendASCII("registry.xcd");
+  ASSERT_TRUE(base::WriteFile(file, "0123456789"));
+
+  PrefetchStats stats =
+      PrefetchFiles({file, temp_dir.GetPath().AppendASCII("missing.xcd")});
+  EXPECT_EQ(stats.files, size_t(1));
+  EXPECT_EQ(stats.bytes, 10);
+}
+
+}  // namespace electron::office
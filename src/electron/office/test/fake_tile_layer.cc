@@ -0,0 +1,54 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "fake_web_plugin_container.h"
+#include "office/tile_layer.h"
+#include "office/web_plugin_utils.h"
+
+namespace electron::office {
+
+// there is no compositor, so recording the layer is treated as a container
+// invalidation
+class TileLayer::Impl {
+ public:
+  explicit Impl(blink::WebPluginContainer* container) : container_(container) {}
+
+  void Record() { container::Invalidate(container_); }
+
+ private:
+  blink::WebPluginContainer* container_;
+};
+
+TileLayer::Overlay::Overlay() = default;
+TileLayer::Overlay::Overlay(const Overlay& other) = default;
+TileLayer::Overlay& TileLayer::Overlay::operator=(const Overlay& other) =
+    default;
+TileLayer::Overlay::~Overlay() = default;
+
+TileLayer::TileLayer(Client* client, blink::WebPluginContainer* container)
+    : impl_(std::make_unique<Impl>(container)) {}
+
+TileLayer::~TileLayer() = default;
+
+bool TileLayer::Covers(const gfx::Rect& view) const {
+  return band_.Contains(view);
+}
+
+bool TileLayer::Record(const gfx::Rect& band, const gfx::Rect& damage) {
+  if (!damage.IsEmpty() && band == band_ && !band.Intersects(damage))
+    return false;
+  band_ = band;
+  impl_->Record();
+  return true;
+}
+
+void TileLayer::ScrollTo(int y_position) {}
+
+void TileLayer::SetOverlay(const Overlay& overlay) {
+  overlay_ = overlay;
+}
+
+void TileLayer::SetCaretVisible(bool visible) {}
+
+}  // namespace electron::office
@@ -15,5 +15,6 @@ public:
 	float device_scale_factor_ = 1.0f;
 	std::string css_cursor_ = "default";
 	base::OnceClosure invalidated;
+	int invalidation_count = 0;
 };
 }
@@ -23,6 +23,7 @@ std::string CSSCursor(blink::WebPluginContainer* container) {
 }
 
 void Invalidate(blink::WebPluginContainer* container) {
+  ++container->invalidation_count;
   if (container->invalidated) {
     std::move(container->invalidated).Run();
   }
@@ -14,17 +14,22 @@
 #include "base/run_loop.h"
 #include "gin/arguments.h"
 #include "gin/converter.h"
+#include "gin/dictionary.h"
 #include "gin/object_template_builder.h"
 #include "gin/public/isolate_holder.h"
 #include "gin/try_catch.h"
 #include "gtest/gtest.h"
 #include "net/base/filename_util.h"
+#include "office/document_client.h"
 #include "office/office_client.h"
 #include "office/office_instance.h"
 #include "office/office_web_plugin.h"
 #include "office/promise.h"
 #include "office/test/fake_render_frame.h"
 #include "office/test/simulated_input.h"
+#include "office/tile_layer.h"
+#include "shell/common/gin_converters/gfx_converter.h"
+#include "testing/perf/perf_result_reporter.h"
 #include "v8/include/v8-exception.h"
 #include "v8/include/v8-primitive.h"
 #include "v8/include/v8-value.h"
@@ -437,6 +442,37 @@ v8::Local<v8::ObjectTemplate> PluginTest::GetGlobalTemplate(
 
                    return resolver->GetPromise();
                  })
+      .SetMethod("getOverlay",
+                 [](v8::Isolate* isolate) -> v8::Local<v8::Value> {
+                   DCHECK(self_);
+                   const TileLayer* tile_layer = self_->plugin_->tile_layer();
+                   if (!tile_layer)
+                     return v8::Undefined(isolate);
+                   const TileLayer::Overlay& overlay = tile_layer->overlay();
+                   gin::Dictionary dict = gin::Dictionary::CreateEmpty(isolate);
+                   dict.Set("caret", overlay.caret);
+                   dict.Set("selection", overlay.selection);
+                   dict.Set("cellCursor", overlay.cell_cursor);
+                   return gin::ConvertToV8(isolate, dict);
+                 })
+      .SetMethod("thumbnailsRendered",
+                 []() -> double {
+                   DCHECK(self_);
+                   DocumentClient* client = self_->plugin_->document_client();
+                   return client ? client->thumbnails_rendered() : 0;
+                 })
+      .SetMethod("invalidationCount",
+                 []() {
+                   DCHECK(self_);
+                   return self_->plugin_->Container()->invalidation_count;
+                 })
+      .SetMethod("recordResult",
+                 [](const std::string& metric, const std::string& story,
+                    double value, const std::string& units) {
+                   perf_test::PerfResultReporter reporter(metric, story);
+                   reporter.RegisterImportantMetric("", units);
+                   reporter.AddResult("", value);
+                 })
       .SetMethod("remountEmbed",
                  []() {
                    DCHECK(self_);
@@ -0,0 +1,272 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "office/thumbnail_cache.h"
+
+#include <algorithm>
+#include <cmath>
+#include "LibreOfficeKit/LibreOfficeKit.hxx"
+#include "base/trace_event/trace_event.h"
+#include "com/sun/star/awt/Point.hpp"
+#include "com/sun/star/awt/Size.hpp"
+#include "com/sun/star/beans/XPropertySet.hpp"
+#include "com/sun/star/container/XIndexAccess.hpp"
+#include "com/sun/star/drawing/XDrawPagesSupplier.hpp"
+#include "com/sun/star/lang/XComponent.hpp"
+#include "com/sun/star/sheet/XSheetCellCursor.hpp"
+#include "com/sun/star/sheet/XSpreadsheet.hpp"
+#include "com/sun/star/sheet/XSpreadsheetDocument.hpp"
+#include "com/sun/star/sheet/XUsedAreaCursor.hpp"
+#include "com/sun/star/uno/Any.hxx"
+#include "com/sun/star/uno/Reference.hxx"
+#include "third_party/skia/include/core/SkImageInfo.h"
+#include "third_party/skia/include/core/SkPixmap.h"
+
+namespace electron::office {
+
+Thumbnail::Thumbnail() = default;
+Thumbnail::Thumbnail(int page_,
+                     int width_,
+                     int height_,
+                     scoped_refptr<base::RefCountedBytes> pixels_)
+    : page(page_), width(width_), height(height_), pixels(std::move(pixels_)) {}
+Thumbnail::Thumbnail(const Thumbnail& other) = default;
+Thumbnail& Thumbnail::operator=(const Thumbnail& other) = default;
+Thumbnail::~Thumbnail() = default;
+
+PagePaint::PagePaint() = default;
+PagePaint::PagePaint(PagePaint&& other) noexcept = default;
+PagePaint& PagePaint::operator=(PagePaint&& other) noexcept = default;
+PagePaint::~PagePaint() = default;
+
+namespace {
+// sizes a paint of `rect_twips` to `width` pixels, keeping its aspect ratio
+PagePaint AllocatePaint(int index, const gfx::Rect& rect_twips, int width) {
+  PagePaint paint;
+  paint.page = index;
+  paint.width = width;
+  paint.height = std::max<int>(
+      1, std::round(static_cast<double>(width) * rect_twips.height() /
+                    rect_twips.width()));
+
+  // LOK paints premultiplied BGRA, the same as the tile buffer
+  paint.bgra.resize(static_cast<size_t>(width) * 4 * paint.height);
+  return paint;
+}
+}  // namespace
+
+PagePaint PaintThumbnail(DocumentHolderWithView document,
+                         int page,
+                         const gfx::Rect& page_rect_twips,
+                         int width) {
+  TRACE_EVENT1("electron", "PaintThumbnail", "page", page);
+  if (width <= 0 || page_rect_twips.IsEmpty())
+    return {};
+
+  PagePaint paint = AllocatePaint(page, page_rect_twips, width);
+  document->paintTile(paint.bgra.data(), paint.width, paint.height,
+                      page_rect_twips.x(), page_rect_twips.y(),
+                      page_rect_twips.width(), page_rect_twips.height());
+  return paint;
+}
+
+Thumbnail ToThumbnail(const PagePaint& paint) {
+  size_t row_bytes = static_cast<size_t>(paint.width) * 4;
+  if (paint.width <= 0 || paint.bgra.size() != row_bytes * paint.height)
+    return {};
+
+  // ImageData in JS is unpremultiplied RGBA
+  auto rgba = base::MakeRefCounted<base::RefCountedBytes>(paint.bgra.size());
+  SkPixmap src(SkImageInfo::Make(paint.width, paint.height,
+                                 kBGRA_8888_SkColorType, kPremul_SkAlphaType),
+               paint.bgra.data(), row_bytes);
+  if (!src.readPixels(
+          SkImageInfo::Make(paint.width, paint.height, kRGBA_8888_SkColorType,
+                            kUnpremul_SkAlphaType),
+          rgba->data().data(), row_bytes)) {
+    return {};
+  }
+
+  return Thumbnail(paint.page, paint.width, paint.height, std::move(rgba));
+}
+
+Thumbnail RenderThumbnail(DocumentHolderWithView document,
+                          int page,
+                          const gfx::Rect& page_rect_twips,
+                          int width) {
+  TRACE_EVENT1("electron", "RenderThumbnail", "page", page);
+  return ToThumbnail(PaintThumbnail(document, page, page_rect_twips, width));
+}
+
+namespace {
+namespace css = ::com::sun::star;
+using css::uno::Reference;
+using css::uno::UNO_QUERY;
+using css::uno::UNO_QUERY_THROW;
+
+int Mm100ToTwip(sal_Int32 mm100) {
+  // 2540 1/100 mm and 1440 twips to an inch
+  return static_cast<int>(std::lround(mm100 * 1440.0 / 2540.0));
+}
+}  // namespace
+
+gfx::Rect ModelPartRect(lok::Document* document, int part) {
+  try {
+    Reference<css::lang::XComponent> component(
+        static_cast<css::lang::XComponent*>(document->getXComponent()));
+    // a sheet is as large as its used area, checked first since a spreadsheet
+    // also has draw pages
+    Reference<css::sheet::XSpreadsheetDocument> spreadsheet(component,
+                                                            UNO_QUERY);
+    if (spreadsheet.is()) {
+      Reference<css::container::XIndexAccess> sheets(spreadsheet->getSheets(),
+                                                     UNO_QUERY_THROW);
+      if (part < 0 || part >= sheets->getCount())
+        return {};
+      Reference<css::sheet::XSpreadsheet> sheet(sheets->getByIndex(part),
+                                                UNO_QUERY_THROW);
+      Reference<css::sheet::XSheetCellCursor> cursor = sheet->createCursor();
+      Reference<css::sheet::XUsedAreaCursor>(cursor, UNO_QUERY_THROW)
+          ->gotoEndOfUsedArea(false);
+      Reference<css::beans::XPropertySet> last(cursor, UNO_QUERY_THROW);
+      css::awt::Point position;
+      css::awt::Size size;
+      last->getPropertyValue("Position") >>= position;
+      last->getPropertyValue("Size") >>= size;
+      return gfx::Rect(Mm100ToTwip(position.X + size.Width),
+                       Mm100ToTwip(position.Y + size.Height));
+    }
+
+    // the pages of a drawing can each have their own size
+    Reference<css::drawing::XDrawPagesSupplier> drawing(component, UNO_QUERY);
+    if (drawing.is()) {
+      Reference<css::container::XIndexAccess> pages(drawing->getDrawPages(),
+                                                    UNO_QUERY_THROW);
+      if (part < 0 || part >= pages->getCount())
+        return {};
+      Reference<css::beans::XPropertySet> page(pages->getByIndex(part),
+                                               UNO_QUERY_THROW);
+      sal_Int32 width = 0;
+      sal_Int32 height = 0;
+      page->getPropertyValue("Width") >>= width;
+      page->getPropertyValue("Height") >>= height;
+      return gfx::Rect(Mm100ToTwip(width), Mm100ToTwip(height));
+    }
+  } catch (const css::uno::Exception&) {
+  }
+  return {};
+}
+
+PagePaint PaintPart(DocumentHolderWithView document,
+                    int part,
+                    const gfx::Rect& part_rect_twips,
+                    int width) {
+  TRACE_EVENT1("electron", "PaintPart", "part", part);
+  if (width <= 0 || part < 0)
+    return {};
+
+  gfx::Rect rect;
+  {
+    PinnedDocument doc = document.Pin();
+    if (!doc)
+      return {};
+    rect = ModelPartRect(doc.get(), part);
+  }
+  if (rect.IsEmpty())
+    rect = part_rect_twips;
+  if (rect.IsEmpty())
+    return {};
+
+  PagePaint paint = AllocatePaint(part, rect, width);
+  // LOK switches the part with the view's callbacks disabled, setPart would
+  // invalidate the view and race with the paint of its tiles
+  document->paintPartTile(paint.bgra.data(), part, paint.width, paint.height,
+                          rect.x(), rect.y(), rect.width(), rect.height());
+  return paint;
+}
+
+Thumbnail RenderPart(DocumentHolderWithView document,
+                     int part,
+                     const gfx::Rect& part_rect_twips,
+                     int width) {
+  TRACE_EVENT1("electron", "RenderPart", "part", part);
+  return ToThumbnail(PaintPart(document, part, part_rect_twips, width));
+}
+
+ThumbnailCache::ThumbnailCache(size_t max_bytes)
+    : max_bytes_(max_bytes), cache_(decltype(cache_)::NO_AUTO_EVICT) {}
+
+ThumbnailCache::~ThumbnailCache() = default;
+
+const Thumbnail* ThumbnailCache::Get(int page, int width) {
+  auto it = cache_.Get(Key(page, width));
+  return it == cache_.end() ? nullptr : &it->second;
+}
+
+void ThumbnailCache::Put(Thumbnail thumbnail, uint64_t generation) {
+  if (thumbnail.page < 0 || !thumbnail.pixels ||
+      generation != Generation(thumbnail.page))
+    return;
+
+  uint64_t key = Key(thumbnail.page, thumbnail.width);
+  auto existing = cache_.Peek(key);
+  if (existing != cache_.end()) {
+    bytes_ -= existing->second.ByteSize();
+    cache_.Erase(existing);
+  }
+
+  bytes_ += thumbnail.ByteSize();
+  cache_.Put(key, std::move(thumbnail));
+  EvictToBudget();
+}
+
+void ThumbnailCache::InvalidateTwipRect(
+    const gfx::Rect& rect_twips,
+    const std::vector<gfx::Rect>& page_rects_twips) {
+  for (size_t page = 0; page < page_rects_twips.size(); ++page) {
+    if (page_rects_twips[page].Intersects(rect_twips))
+      InvalidatePage(page);
+  }
+}
+
+void ThumbnailCache::InvalidatePage(int page) {
+  if (page < 0)
+    return;
+  if (static_cast<size_t>(page) >= page_generations_.size())
+    page_generations_.resize(page + 1, 0);
+  ++page_generations_[page];
+
+  for (auto it = cache_.begin(); it != cache_.end();) {
+    if (it->second.page == page) {
+      bytes_ -= it->second.ByteSize();
+      it = cache_.Erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void ThumbnailCache::InvalidateAll() {
+  ++all_generation_;
+  cache_.Clear();
+  bytes_ = 0;
+}
+
+uint64_t ThumbnailCache::Generation(int page) const {
+  uint64_t page_generation =
+      page >= 0 && static_cast<size_t>(page) < page_generations_.size()
+          ? page_generations_[page]
+          : 0;
+  return all_generation_ + page_generation;
+}
+
+void ThumbnailCache::EvictToBudget() {
+  while (bytes_ > max_bytes_ && !cache_.empty()) {
+    auto oldest = std::prev(cache_.end());
+    bytes_ -= oldest->second.ByteSize();
+    cache_.Erase(oldest);
+  }
+}
+
+}  // namespace electron::office
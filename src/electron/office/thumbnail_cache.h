@@ -0,0 +1,141 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "base/containers/lru_cache.h"
+#include "base/memory/ref_counted_memory.h"
+#include "base/memory/scoped_refptr.h"
+#include "office/document_holder.h"
+#include "ui/gfx/geometry/rect.h"
+
+namespace electron::office {
+
+// an RGBA (unpremultiplied) raster of a single page
+struct Thumbnail {
+  int page = -1;
+  int width = 0;
+  int height = 0;
+  scoped_refptr<base::RefCountedBytes> pixels;
+
+  Thumbnail();
+  Thumbnail(int page_, int width_, int height_,
+            scoped_refptr<base::RefCountedBytes> pixels_);
+  Thumbnail(const Thumbnail& other);
+  Thumbnail& operator=(const Thumbnail& other);
+  ~Thumbnail();
+
+  size_t ByteSize() const { return pixels ? pixels->size() : 0; }
+};
+
+// a page as painted by LOK in premultiplied BGRA, before it's converted to a
+// Thumbnail
+struct PagePaint {
+  int page = -1;
+  int width = 0;
+  int height = 0;
+  std::vector<uint8_t> bgra;
+
+  PagePaint();
+  PagePaint(PagePaint&& other) noexcept;
+  PagePaint& operator=(PagePaint&& other) noexcept;
+  ~PagePaint();
+};
+
+// a page that wasn't cached and is rendered for the request at `index`
+struct ThumbnailRequest {
+  size_t index;
+  int page;
+  gfx::Rect page_rect_twips;
+  uint64_t generation;
+};
+
+// Rasterizes the page at `page_rect_twips` to `width` pixels wide, keeping the
+// aspect ratio of the page. Blocks on LOK, so it should be called with
+// MayBlock.
+Thumbnail RenderThumbnail(DocumentHolderWithView document,
+                          int page,
+                          const gfx::Rect& page_rect_twips,
+                          int width);
+
+// the LOK half of RenderThumbnail, so that the conversion by ToThumbnail can
+// run elsewhere
+PagePaint PaintThumbnail(DocumentHolderWithView document,
+                         int page,
+                         const gfx::Rect& page_rect_twips,
+                         int width);
+
+// Converts a paint to the unpremultiplied RGBA of a thumbnail. Doesn't use
+// LOK, so it can run on any sequence.
+Thumbnail ToThumbnail(const PagePaint& paint);
+
+// Rasterizes part `part` of a presentation, drawing or spreadsheet to `width`
+// pixels wide, at the size from ModelPartRect or `part_rect_twips` if the model
+// has none, keeping the aspect ratio. The view's current part is left as is.
+// Blocks on LOK, so it should be called with MayBlock.
+Thumbnail RenderPart(DocumentHolderWithView document,
+                     int part,
+                     const gfx::Rect& part_rect_twips,
+                     int width);
+
+// the rect in twips of part `part`, read from the document model since LOK only
+// reports the size of the view's current part: a slide or drawing page is its
+// page size, and a sheet its used area. Empty if the model has none. `document`
+// is pinned
+gfx::Rect ModelPartRect(lok::Document* document, int part);
+
+// the LOK half of RenderPart
+PagePaint PaintPart(DocumentHolderWithView document,
+                    int part,
+                    const gfx::Rect& part_rect_twips,
+                    int width);
+
+// A byte-bounded LRU cache of page thumbnails, keyed by page and width. Also
+// used for the parts of a presentation or drawing, keyed by part.
+// Only accessed from the renderer thread.
+class ThumbnailCache {
+ public:
+  static constexpr size_t kDefaultMaxBytes = 64 * 1024 * 1024;
+
+  explicit ThumbnailCache(size_t max_bytes = kDefaultMaxBytes);
+  ~ThumbnailCache();
+
+  // no copy
+  ThumbnailCache(const ThumbnailCache&) = delete;
+  ThumbnailCache& operator=(const ThumbnailCache&) = delete;
+
+  // returns nullptr if the page isn't cached at that width
+  const Thumbnail* Get(int page, int width);
+  // `generation` is the value of Generation(page) when the render started, a
+  // thumbnail that was invalidated while rendering is dropped
+  void Put(Thumbnail thumbnail, uint64_t generation);
+
+  // invalidates every page intersecting `rect_twips`
+  void InvalidateTwipRect(const gfx::Rect& rect_twips,
+                          const std::vector<gfx::Rect>& page_rects_twips);
+  void InvalidatePage(int page);
+  void InvalidateAll();
+
+  uint64_t Generation(int page) const;
+  size_t ByteSize() const { return bytes_; }
+  size_t size() const { return cache_.size(); }
+
+ private:
+  static uint64_t Key(int page, int width) {
+    return (static_cast<uint64_t>(page) << 32) | static_cast<uint32_t>(width);
+  }
+
+  void EvictToBudget();
+
+  const size_t max_bytes_;
+  size_t bytes_ = 0;
+  base::LRUCache<uint64_t, Thumbnail> cache_;
+  // bumped for a page on every invalidation
+  std::vector<uint64_t> page_generations_;
+  uint64_t all_generation_ = 0;
+};
+
+}  // namespace electron::office
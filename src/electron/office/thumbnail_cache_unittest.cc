@@ -0,0 +1,95 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "thumbnail_cache.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace electron::office {
+
+namespace {
+Thumbnail MakeThumbnail(int page, int width, int height) {
+  return Thumbnail(page, width, height,
+                   base::MakeRefCounted<base::RefCountedBytes>(
+                       static_cast<size_t>(width) * height * 4));
+}
+}  // namespace
+
+TEST(ThumbnailCacheTest, PutAndGet) {
+  ThumbnailCache cache;
+  cache.Put(MakeThumbnail(0, 100, 140), cache.Generation(0));
+  cache.Put(MakeThumbnail(1, 100, 140), cache.Generation(1));
+
+  ASSERT_NE(cache.Get(0, 100), nullptr);
+  EXPECT_EQ(cache.Get(0, 100)->height, 140);
+  EXPECT_EQ(cache.Get(0, 200), nullptr);
+  EXPECT_EQ(cache.Get(2, 100), nullptr);
+  EXPECT_EQ(cache.ByteSize(), size_t(2 * 100 * 140 * 4));
+}
+
+TEST(ThumbnailCacheTest, InvalidateTwipRectOnlyTouchesIntersectingPages) {
+  ThumbnailCache cache;
+  std::vector<gfx::Rect> pages = {gfx::Rect(0, 0, 1000, 1400),
+                                  gfx::Rect(0, 1500, 1000, 1400),
+                                  gfx::Rect(0, 3000, 1000, 1400)};
+  for (int page = 0; page < 3; ++page) {
+    cache.Put(MakeThumbnail(page, 10, 14), cache.Generation(page));
+  }
+
+  cache.InvalidateTwipRect(gfx::Rect(100, 1600, 50, 50), pages);
+
+  EXPECT_NE(cache.Get(0, 10), nullptr);
+  EXPECT_EQ(cache.Get(1, 10), nullptr);
+  EXPECT_NE(cache.Get(2, 10), nullptr);
+  EXPECT_EQ(cache.size(), size_t(2));
+}
+
+TEST(ThumbnailCacheTest, DropsStaleRenders) {
+  ThumbnailCache cache;
+  uint64_t generation = cache.Generation(0);
+  cache.InvalidatePage(0);
+  cache.Put(MakeThumbnail(0, 10, 10), generation);
+  EXPECT_EQ(cache.Get(0, 10), nullptr);
+
+  generation = cache.Generation(1);
+  cache.InvalidateAll();
+  cache.Put(MakeThumbnail(1, 10, 10), generation);
+  EXPECT_EQ(cache.Get(1, 10), nullptr);
+}
+
+TEST(ThumbnailCacheTest, EvictsLeastRecentlyUsed) {
+  ThumbnailCache cache(2 * 10 * 10 * 4);
+  cache.Put(MakeThumbnail(0, 10, 10), cache.Generation(0));
+  cache.Put(MakeThumbnail(1, 10, 10), cache.Generation(1));
+  // touch page 0 so page 1 is the oldest
+  ASSERT_NE(cache.Get(0, 10), nullptr);
+  cache.Put(MakeThumbnail(2, 10, 10), cache.Generation(2));
+
+  EXPECT_NE(cache.Get(0, 10), nullptr);
+  EXPECT_EQ(cache.Get(1, 10), nullptr);
+  EXPECT_NE(cache.Get(2, 10), nullptr);
+  EXPECT_EQ(cache.ByteSize(), size_t(2 * 10 * 10 * 4));
+}
+
+TEST(ThumbnailCacheTest, ConvertsPaintToRGBA) {
+  PagePaint paint;
+  paint.page = 3;
+  paint.width = 2;
+  paint.height = 1;
+  // an opaque pixel and a transparent one
+  paint.bgra = {10, 20, 30, 255, 0, 0, 0, 0};
+
+  Thumbnail thumbnail = ToThumbnail(paint);
+  ASSERT_TRUE(thumbnail.pixels);
+  EXPECT_EQ(thumbnail.page, 3);
+  EXPECT_EQ(thumbnail.width, 2);
+  EXPECT_EQ(thumbnail.height, 1);
+  const std::vector<uint8_t> expected = {30, 20, 10, 255, 0, 0, 0, 0};
+  EXPECT_EQ(thumbnail.pixels->data(), expected);
+
+  // a paint that doesn't match its size isn't converted
+  paint.height = 2;
+  EXPECT_FALSE(ToThumbnail(paint).pixels);
+}
+
+}  // namespace electron::office
@@ -0,0 +1,242 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "office/tile_layer.h"
+
+#include "base/memory/scoped_refptr.h"
+#include "base/trace_event/trace_event.h"
+#include "cc/layers/content_layer_client.h"
+#include "cc/layers/layer.h"
+#include "cc/layers/picture_layer.h"
+#include "cc/layers/solid_color_layer.h"
+#include "cc/paint/display_item_list.h"
+#include "cc/paint/paint_canvas.h"
+#include "cc/paint/paint_flags.h"
+#include "cc/paint/paint_recorder.h"
+#include "third_party/blink/public/web/web_plugin_container.h"
+#include "ui/gfx/geometry/point_f.h"
+#include "ui/gfx/geometry/skia_conversions.h"
+
+namespace electron::office {
+
+namespace {
+constexpr SkColor kCaretColor = SK_ColorBLACK;
+constexpr SkColor kSelectionColor = SkColorSetARGB(0x50, 0x43, 0xac, 0xe8);
+constexpr SkColor kCellCursorColor = SK_ColorBLACK;
+constexpr int kCellCursorWidth = 2;
+
+// the text selection and cell cursor, which change far less often than the
+// caret blinks
+class OverlayClient : public cc::ContentLayerClient {
+ public:
+  explicit OverlayClient(const TileLayer* owner) : owner_(owner) {}
+
+  // the area covered by the overlay, in document device pixels
+  static gfx::Rect Bounds(const TileLayer::Overlay& overlay) {
+    gfx::Rect bounds;
+    for (const gfx::Rect& rect : overlay.selection) {
+      bounds.Union(rect);
+    }
+    if (!overlay.cell_cursor.IsEmpty()) {
+      gfx::Rect cell_cursor = overlay.cell_cursor;
+      cell_cursor.Inset(-kCellCursorWidth, -kCellCursorWidth);
+      bounds.Union(cell_cursor);
+    }
+    return bounds;
+  }
+
+  // cc::ContentLayerClient {
+  scoped_refptr<cc::DisplayItemList> PaintContentsToDisplayList() override {
+    TRACE_EVENT0("electron", "TileLayer::PaintOverlay");
+    const TileLayer::Overlay& overlay = owner_->overlay();
+    gfx::Rect bounds = Bounds(overlay);
+    gfx::Rect layer_bounds(bounds.size());
+
+    auto display_list = base::MakeRefCounted<cc::DisplayItemList>();
+    display_list->StartPaint();
+    if (!bounds.IsEmpty()) {
+      cc::PaintRecorder recorder;
+      cc::PaintCanvas* canvas =
+          recorder.beginRecording(gfx::RectToSkRect(layer_bounds));
+      canvas->translate(-bounds.x(), -bounds.y());
+
+      cc::PaintFlags selection_flags;
+      selection_flags.setColor(kSelectionColor);
+      for (const gfx::Rect& rect : overlay.selection) {
+        canvas->drawRect(gfx::RectToSkRect(rect), selection_flags);
+      }
+
+      if (!overlay.cell_cursor.IsEmpty()) {
+        cc::PaintFlags cell_cursor_flags;
+        cell_cursor_flags.setColor(kCellCursorColor);
+        cell_cursor_flags.setStyle(cc::PaintFlags::kStroke_Style);
+        cell_cursor_flags.setStrokeWidth(kCellCursorWidth);
+        canvas->drawRect(gfx::RectToSkRect(overlay.cell_cursor),
+                         cell_cursor_flags);
+      }
+
+      display_list->push<cc::DrawRecordOp>(
+          recorder.finishRecordingAsPicture());
+    }
+    display_list->EndPaintOfUnpaired(layer_bounds);
+    display_list->Finalize();
+    return display_list;
+  }
+
+  bool FillsBoundsCompletely() const override { return false; }
+  // }
+
+ private:
+  const TileLayer* owner_;
+};
+}  // namespace
+
+class TileLayer::Impl : public cc::ContentLayerClient {
+ public:
+  Impl(TileLayer* owner,
+       TileLayer::Client* client,
+       blink::WebPluginContainer* container)
+      : owner_(owner),
+        client_(client),
+        container_(container),
+        overlay_client_(owner) {
+    clip_layer_ = cc::Layer::Create();
+    clip_layer_->SetMasksToBounds(true);
+    content_layer_ = cc::PictureLayer::Create(this);
+    content_layer_->SetIsDrawable(true);
+    clip_layer_->AddChild(content_layer_);
+
+    // the overlay is a child of the content, so it scrolls with it
+    overlay_layer_ = cc::PictureLayer::Create(&overlay_client_);
+    overlay_layer_->SetIsDrawable(true);
+    content_layer_->AddChild(overlay_layer_);
+    caret_layer_ = cc::SolidColorLayer::Create();
+    caret_layer_->SetBackgroundColor(kCaretColor);
+    caret_layer_->SetIsDrawable(true);
+    caret_layer_->SetHideLayerAndSubtree(true);
+    content_layer_->AddChild(caret_layer_);
+
+    container_->SetCcLayer(clip_layer_.get());
+  }
+
+  ~Impl() override {
+    container_->SetCcLayer(nullptr);
+    content_layer_->ClearClient();
+    overlay_layer_->ClearClient();
+  }
+
+  // `damage` is relative to the band, empty to raster all of it
+  void Record(const gfx::Rect& band, const gfx::Rect& damage) {
+    content_layer_->SetBounds(band.size());
+    if (damage.IsEmpty()) {
+      content_layer_->SetNeedsDisplay();
+    } else {
+      content_layer_->SetNeedsDisplayRect(damage);
+    }
+    PositionOverlay();
+  }
+
+  void RecordOverlay() {
+    overlay_layer_->SetBounds(
+        OverlayClient::Bounds(owner_->overlay()).size());
+    overlay_layer_->SetNeedsDisplay();
+    PositionOverlay();
+  }
+
+  void SetCaretVisible(bool visible) {
+    caret_layer_->SetHideLayerAndSubtree(!visible ||
+                                         owner_->overlay().caret.IsEmpty());
+  }
+
+  void SetOffset(int y) { content_layer_->SetPosition(gfx::PointF(0, y)); }
+
+  // cc::ContentLayerClient {
+  scoped_refptr<cc::DisplayItemList> PaintContentsToDisplayList() override {
+    TRACE_EVENT0("electron", "TileLayer::PaintContentsToDisplayList");
+    const gfx::Rect& band = owner_->band();
+    gfx::Rect bounds(band.size());
+
+    auto display_list = base::MakeRefCounted<cc::DisplayItemList>();
+    display_list->StartPaint();
+    if (!bounds.IsEmpty()) {
+      cc::PaintRecorder recorder;
+      client_->PaintTileLayer(
+          recorder.beginRecording(gfx::RectToSkRect(bounds)), band);
+      display_list->push<cc::DrawRecordOp>(
+          recorder.finishRecordingAsPicture());
+    }
+    display_list->EndPaintOfUnpaired(bounds);
+    display_list->Finalize();
+    return display_list;
+  }
+
+  bool FillsBoundsCompletely() const override { return false; }
+  // }
+
+ private:
+  // the overlay is in document coordinates, but its parent is at the band
+  void PositionOverlay() {
+    const gfx::Rect& band = owner_->band();
+    const TileLayer::Overlay& overlay = owner_->overlay();
+    gfx::Rect bounds = OverlayClient::Bounds(overlay);
+    overlay_layer_->SetPosition(
+        gfx::PointF(bounds.x() - band.x(), bounds.y() - band.y()));
+    caret_layer_->SetBounds(overlay.caret.size());
+    caret_layer_->SetPosition(gfx::PointF(overlay.caret.x() - band.x(),
+                                          overlay.caret.y() - band.y()));
+  }
+
+  TileLayer* owner_;
+  TileLayer::Client* client_;
+  blink::WebPluginContainer* container_;
+  OverlayClient overlay_client_;
+  scoped_refptr<cc::Layer> clip_layer_;
+  scoped_refptr<cc::PictureLayer> content_layer_;
+  scoped_refptr<cc::PictureLayer> overlay_layer_;
+  scoped_refptr<cc::SolidColorLayer> caret_layer_;
+};
+
+TileLayer::Overlay::Overlay() = default;
+TileLayer::Overlay::Overlay(const Overlay& other) = default;
+TileLayer::Overlay& TileLayer::Overlay::operator=(const Overlay& other) =
+    default;
+TileLayer::Overlay::~Overlay() = default;
+
+TileLayer::TileLayer(Client* client, blink::WebPluginContainer* container)
+    : impl_(std::make_unique<Impl>(this, client, container)) {}
+
+TileLayer::~TileLayer() = default;
+
+bool TileLayer::Covers(const gfx::Rect& view) const {
+  return band_.Contains(view);
+}
+
+bool TileLayer::Record(const gfx::Rect& band, const gfx::Rect& damage) {
+  gfx::Rect band_damage;
+  if (!damage.IsEmpty() && band == band_) {
+    band_damage = gfx::IntersectRects(damage, band);
+    if (band_damage.IsEmpty())
+      return false;
+    band_damage.Offset(-band.x(), -band.y());
+  }
+  band_ = band;
+  impl_->Record(band, band_damage);
+  return true;
+}
+
+void TileLayer::ScrollTo(int y_position) {
+  impl_->SetOffset(band_.y() - y_position);
+}
+
+void TileLayer::SetOverlay(const Overlay& overlay) {
+  overlay_ = overlay;
+  impl_->RecordOverlay();
+  impl_->SetCaretVisible(true);
+}
+
+void TileLayer::SetCaretVisible(bool visible) {
+  impl_->SetCaretVisible(visible);
+}
+
+}  // namespace electron::office
@@ -0,0 +1,82 @@
+// Copyright (c) 2023 Macro.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "ui/gfx/geometry/rect.h"
+
+namespace blink {
+class WebPluginContainer;
+}  // namespace blink
+
+namespace cc {
+class PaintCanvas;
+}  // namespace cc
+
+namespace electron::office {
+
+// Presents the tiles of a plugin as a compositor layer instead of through
+// WebPlugin::Paint.
+//
+// A band of the document around the view is recorded into a picture layer that
+// is clipped to the plugin. Scrolling within the band only moves the layer,
+// which is applied by the compositor without a main thread paint.
+class TileLayer {
+ public:
+  class Client {
+   public:
+    // records the tiles within `band`, in device pixels relative to the top of
+    // the document, with the origin of the canvas at the top of the band
+    virtual void PaintTileLayer(cc::PaintCanvas* canvas,
+                                const gfx::Rect& band) = 0;
+  };
+
+  // drawn over the tiles, in device pixels relative to the top of the document
+  struct Overlay {
+    Overlay();
+    Overlay(const Overlay& other);
+    Overlay& operator=(const Overlay& other);
+    ~Overlay();
+
+    // empty if hidden
+    gfx::Rect caret;
+    std::vector<gfx::Rect> selection;
+    // empty if hidden
+    gfx::Rect cell_cursor;
+  };
+
+  TileLayer(Client* client, blink::WebPluginContainer* container);
+  ~TileLayer();
+
+  // no copy
+  TileLayer(const TileLayer&) = delete;
+  TileLayer& operator=(const TileLayer&) = delete;
+
+  // true if the recorded band covers `view`
+  bool Covers(const gfx::Rect& view) const;
+  // records `band` on the next commit. while the band is unchanged, a
+  // non-empty `damage` limits the raster to the tiles within it, in device
+  // pixels relative to the top of the document. returns false if the damage is
+  // outside of the band, which then isn't recorded
+  bool Record(const gfx::Rect& band, const gfx::Rect& damage = gfx::Rect());
+  // moves the recorded band relative to the scroll position
+  void ScrollTo(int y_position);
+  const gfx::Rect& band() const { return band_; }
+
+  // records the overlay, independent of the tiles
+  void SetOverlay(const Overlay& overlay);
+  // shows or hides the caret without recording, used to blink the caret
+  void SetCaretVisible(bool visible);
+  const Overlay& overlay() const { return overlay_; }
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
+  gfx::Rect band_;
+  Overlay overlay_;
+};
+
+}  // namespace electron::office